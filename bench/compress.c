@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Cold Page Compression Benchmark
+ * Fills guest memory with a synthetic idle instance: zeroed heap, repeated
+ * code, tables of small values and a little noise. Every page is then swept
+ * out, and the resident memory and the cost of bringing each page back on its
+ * next access are reported. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+
+#define BENCH_PAGES	1024
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_fill(uint32_t page)
+{
+	static const uint16_t code[] = { 0x4E56, 0xFFF8, 0x48E7, 0x1F38, 0x206E, 0x0008, 0x4A68, 0x0004, 0x6700, 0x0012, 0x4CDF, 0x1CF8, 0x4E5E, 0x4E75 };
+	uint32_t base = page * M68_MMU_PAGE_SIZE;
+
+	switch (page % 8) {
+		case 0: case 1: case 2: case 3:
+			/* Heap that has been cleared, with the odd block header. */
+			m68_mmu_write_long(base, 0x00000000);
+			m68_mmu_write_long(base + 0x100, 0x80000040);
+			break;
+		case 4: case 5:
+			for (uint32_t i = 0; i < M68_MMU_PAGE_SIZE; i += 2) {
+				m68_mmu_write_word(base + i, code[(i / 2 + (i >> 7)) % (sizeof(code) / sizeof(code[0]))]);
+			}
+			break;
+		case 6:
+			for (uint32_t i = 0; i < M68_MMU_PAGE_SIZE; i += 4) {
+				m68_mmu_write_long(base + i, (i & 0xFF) ? 0x00010000 + (i >> 4) : 0);
+			}
+			break;
+		default:
+			for (uint32_t i = 0; i < M68_MMU_PAGE_SIZE; i += 2) {
+				m68_mmu_write_word(base + i, (uint16_t)rand());
+			}
+			break;
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	struct m68_mmu_compression_stats stats;
+
+	m68_mmu_initialise();
+	srand(68000);
+	for (uint32_t page = 0; page < BENCH_PAGES; ++page) {
+		bench_fill(page);
+	}
+
+	m68_mmu_sweep();
+	uint64_t start = bench_now();
+	uint32_t compressed = m68_mmu_sweep();
+	uint64_t sweep = bench_now() - start;
+
+	m68_mmu_compression_stats(&stats);
+	uint64_t resident = (uint64_t)stats.resident_pages * M68_MMU_PAGE_SIZE + stats.compressed_bytes;
+	printf("Cold pages: %u pages, %u compressed in %.2f ms\n", BENCH_PAGES, compressed, (double)sweep / 1e6);
+	printf("resident     %8llu KiB of %u KiB, %.2fx smaller\n", (unsigned long long)(resident / 1024),
+		BENCH_PAGES * M68_MMU_PAGE_SIZE / 1024, (double)BENCH_PAGES * M68_MMU_PAGE_SIZE / (double)resident);
+
+	uint32_t sum = 0;
+	start = bench_now();
+	for (uint32_t page = 0; page < BENCH_PAGES; ++page) {
+		sum += m68_mmu_read_byte(page * M68_MMU_PAGE_SIZE + 0x100);
+	}
+	uint64_t elapsed = bench_now() - start;
+	printf("first access %8.2f us per page (%u)\n", (double)elapsed / 1e3 / BENCH_PAGES, sum & 1);
+
+	m68_mmu_destroy();
+	return 0;
+}
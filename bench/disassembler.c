@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Disassembler Throughput Benchmark
+ * Disassembles a synthetic 4 MiB "ROM" made of a mix of known and unknown
+ * opcodes, in output batches as an analysis pipeline would. As the tables do
+ * not have MOVE yet, it is added with a disassembly template so that the mix
+ * includes extension words and effective addresses: d16(An), absolute long,
+ * brief and full indexed, and immediate operands. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cpu/instruction.h"
+#include "cpu/disassembler.h"
+
+#define BENCH_ROM_SIZE	(4 * 1024 * 1024)
+#define BENCH_BATCH	4096
+#define BENCH_PASSES	5
+
+#define BENCH_MOVE_D16	0x3028	/* MOVE.W d16(A0),D0 */
+#define BENCH_MOVE_ABSL	0x3039	/* MOVE.W xxx.L,D0 */
+#define BENCH_MOVE_INDEX	0x3030	/* MOVE.W d8(A0,Xn),D0 or ([bd,A0,Xn],od),D0 */
+#define BENCH_MOVE_IMM	0x303C	/* MOVE.W #imm,D0 */
+#define BENCH_MOVE_STORE	0x3340	/* MOVE.W D0,d16(A1) */
+
+static void bench_handler(void)
+{
+}
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+int main(int argc, char const *argv[])
+{
+	uint8_t *rom = malloc(BENCH_ROM_SIZE);
+	static struct m68_disassembly out[BENCH_BATCH];
+
+	const uint16_t moves[] = { BENCH_MOVE_D16, BENCH_MOVE_ABSL, BENCH_MOVE_INDEX, BENCH_MOVE_IMM, BENCH_MOVE_STORE };
+	for (size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); ++i) {
+		m68_instruction_table[moves[i]] = (struct m68_instruction){ "MOVE.W %ew,%Ew", bench_handler, 8 };
+	}
+
+	/* Half of the instructions are ABCD, three in eight are MOVE with
+	 * extension words and one in eight is an arbitrary word. */
+	srand(68000);
+	uint16_t words[8];
+	size_t i = 0;
+	while (i < BENCH_ROM_SIZE) {
+		size_t count = 1;
+		int kind = rand() & 15;
+		if (kind < 8) {
+			words[0] = 0xC100 | ((rand() & 7) << 9) | (rand() & 0xF);
+		} else if (kind < 14) {
+			words[0] = moves[(kind - 8) % 5];
+			words[1] = (uint16_t)rand();
+			words[2] = (uint16_t)rand();
+			words[3] = (uint16_t)rand();
+			count = words[0] == BENCH_MOVE_ABSL ? 3 : 2;
+			if (words[0] == BENCH_MOVE_INDEX) {
+				/* Brief, or full with a word base and outer displacement. */
+				words[1] = (rand() & 1) ? (words[1] & 0xFEFF) : ((words[1] & 0xF800) | 0x0126);
+				count = (words[1] & 0x0100) ? 4 : 2;
+			}
+		} else {
+			words[0] = (uint16_t)rand();
+		}
+
+		for (size_t w = 0; w < count && i < BENCH_ROM_SIZE; ++w, i += 2) {
+			rom[i] = words[w] >> 8;
+			rom[i + 1] = words[w] & 0xFF;
+		}
+	}
+
+	uint64_t best = UINT64_MAX;
+	size_t instructions = 0;
+	for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+		uint64_t start = bench_now();
+		size_t offset = 0;
+		instructions = 0;
+		while (offset < BENCH_ROM_SIZE) {
+			size_t n = m68_disassemble_buffer(rom + offset, BENCH_ROM_SIZE - offset, (uint32_t)offset, out, BENCH_BATCH);
+			offset = out[n - 1].address + out[n - 1].length;
+			instructions += n;
+		}
+		uint64_t elapsed = bench_now() - start;
+		best = elapsed < best ? elapsed : best;
+	}
+
+	printf("disassembled %zu instructions (%d KiB) in %.2f ms: %.1f MB/s, %.1f M instructions/s\n",
+		instructions, BENCH_ROM_SIZE / 1024, best / 1e6,
+		(double)BENCH_ROM_SIZE * 1000.0 / best,
+		(double)instructions * 1000.0 / best);
+
+	free(rom);
+	return 0;
+}
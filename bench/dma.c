@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Device Transfer Benchmark
+ * Reports the cost of reading a disk image into guest memory, as a device
+ * would for DMA, through a bounce buffer and m68_mmu_write_block(), and
+ * straight into the pages described by m68_mmu_map_span(). The image is a
+ * temporary file, so it is read from the host's page cache. Swizzled builds
+ * would also have to swap the words read into the spans, which is not timed. */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+
+#define BENCH_TRANSFER	(64 * 1024)
+#define BENCH_IMAGE	(16 * 1024 * 1024)
+#define BENCH_SPANS	(BENCH_TRANSFER / M68_MMU_PAGE_SIZE + 1)
+#define BENCH_ADDRESS	0x00100000
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, uint64_t elapsed)
+{
+	double transfers = BENCH_IMAGE / BENCH_TRANSFER;
+	printf("%-14s %8.2f us per 64KiB, %7.0f MiB/s\n", name, (double)elapsed / transfers / 1000.0,
+		(double)BENCH_IMAGE / (1024.0 * 1024.0) / ((double)elapsed / 1e9));
+}
+
+int main(int argc, char const *argv[])
+{
+	FILE *image = tmpfile();
+	uint8_t *buffer = malloc(BENCH_TRANSFER);
+	if (image == NULL || buffer == NULL) {
+		perror("dma");
+		return 1;
+	}
+	for (uint32_t i = 0; i < BENCH_TRANSFER; ++i) {
+		buffer[i] = (uint8_t)(i * 2654435761U >> 24);
+	}
+	for (uint32_t offset = 0; offset < BENCH_IMAGE; offset += BENCH_TRANSFER) {
+		fwrite(buffer, 1, BENCH_TRANSFER, image);
+	}
+	fflush(image);
+	int fd = fileno(image);
+
+	m68_mmu_initialise();
+	printf("Device transfers: %d MiB image, %s layout\n", BENCH_IMAGE >> 20, M68_MMU_SWIZZLE ? "swizzled" : "big-endian");
+
+	/* Warm the page cache and the guest pages. */
+	for (off_t offset = 0; offset < BENCH_IMAGE; offset += BENCH_TRANSFER) {
+		if (pread(fd, buffer, BENCH_TRANSFER, offset) != BENCH_TRANSFER) {
+			perror("dma");
+			return 1;
+		}
+		m68_mmu_write_block(BENCH_ADDRESS, buffer, BENCH_TRANSFER);
+	}
+
+	uint64_t start = bench_now();
+	for (off_t offset = 0; offset < BENCH_IMAGE; offset += BENCH_TRANSFER) {
+		pread(fd, buffer, BENCH_TRANSFER, offset);
+		m68_mmu_write_block(BENCH_ADDRESS, buffer, BENCH_TRANSFER);
+	}
+	bench_report("bounce buffer", bench_now() - start);
+
+	struct iovec spans[BENCH_SPANS];
+	start = bench_now();
+	for (off_t offset = 0; offset < BENCH_IMAGE; offset += BENCH_TRANSFER) {
+		int count = m68_mmu_map_span(BENCH_ADDRESS, BENCH_TRANSFER, 1, spans, BENCH_SPANS);
+		preadv(fd, spans, count, offset);
+	}
+	bench_report("mapped spans", bench_now() - start);
+
+	m68_mmu_destroy();
+	free(buffer);
+	fclose(image);
+	return 0;
+}
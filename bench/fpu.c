@@ -0,0 +1,91 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* FPU Benchmark
+ * Runs a block of register to register FADD, FMUL, FDIV and FSUB
+ * instructions in each FPU mode, and reports the cost of an instruction. The
+ * block leaves FP0 unchanged (give or take rounding), so the operands stay in
+ * the normal range however long it runs. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/execute.h"
+#include "cpu/fpu.h"
+
+#define BENCH_BLOCK		1024
+#define BENCH_INSTRUCTIONS	(1 << 22)
+
+static const uint16_t bench_block[] = {
+	0xF200, 0x0823,		/* FMUL.X FP2,FP0 */
+	0xF200, 0x0820,		/* FDIV.X FP2,FP0 */
+	0xF200, 0x0422,		/* FADD.X FP1,FP0 */
+	0xF200, 0x0428,		/* FSUB.X FP1,FP0 */
+};
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_run(enum m68_fpu_mode mode, const char *name, uint32_t fpcr)
+{
+	m68_fpu_set_mode(mode);
+	m68_fpu_reset();
+	CPU68.FPCR.value = fpcr;
+	m68_fpu_set(0, m68_float80_from_int32(1000));
+	m68_fpu_set(1, m68_float80_from_int32(3));
+	m68_fpu_set(2, m68_float80_from_int32(7));
+
+	uint64_t start = bench_now();
+	for (uint32_t n = 0; n < BENCH_INSTRUCTIONS; n += BENCH_BLOCK) {
+		CPU68.PC.value = 0x1000;
+		for (uint32_t i = 0; i < BENCH_BLOCK; ++i) {
+			m68_step();
+		}
+	}
+	uint64_t elapsed = bench_now() - start;
+
+	printf("%-24s %6.1f ns per instruction\n", name, (double)elapsed / (double)BENCH_INSTRUCTIONS);
+}
+
+int main(int argc, char const *argv[])
+{
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68020);
+	for (uint32_t i = 0; i < BENCH_BLOCK; ++i) {
+		m68_mmu_write_long(0x1000 + 4 * i, ((uint32_t)bench_block[(2 * i) % 8] << 16) | bench_block[(2 * i + 1) % 8]);
+	}
+
+	printf("FPU arithmetic: %d instructions\n", BENCH_INSTRUCTIONS);
+	bench_run(M68_FPU_EXACT, "exact", 0);
+	bench_run(M68_FPU_EXACT, "exact, round to zero", M68_ROUND_ZERO << 4);
+	bench_run(M68_FPU_FAST, "fast", 0);
+	bench_run(M68_FPU_FAST, "fast, round to zero", M68_ROUND_ZERO << 4);
+	m68_fpu_set_mode(M68_FPU_EXACT);
+	return 0;
+}
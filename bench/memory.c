@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Guest Memory Benchmark
+ * Reports the cost of single word and long accesses and of opcode fetches
+ * through the TLB fast paths, over a few resident pages. Compare builds made
+ * with SWIZZLE=0 and SWIZZLE=1 to measure the word-swizzled memory layout. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+
+#define BENCH_PAGES	4
+#define BENCH_SPAN	(BENCH_PAGES * M68_MMU_PAGE_SIZE)
+#define BENCH_PASSES	256
+
+static volatile uint32_t bench_sink = 0;
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_report(const char *name, uint64_t elapsed, uint32_t step)
+{
+	double accesses = (double)BENCH_PASSES * (double)(BENCH_SPAN / step);
+	printf("%-12s %6.2f ns per access\n", name, (double)elapsed / accesses);
+}
+
+int main(int argc, char const *argv[])
+{
+	m68_mmu_initialise();
+	for (uint32_t address = 0; address < BENCH_SPAN; address += 4) {
+		m68_mmu_write_long(address, address * 2654435761U);
+	}
+
+	printf("Guest memory: %d pages, %s layout\n", BENCH_PAGES, M68_MMU_SWIZZLE ? "swizzled" : "big-endian");
+
+	uint64_t start = bench_now();
+	uint32_t sum = 0;
+	for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+		for (uint32_t address = 0; address < BENCH_SPAN; address += 2) {
+			sum += m68_mmu_read_word(address);
+		}
+	}
+	bench_report("read word", bench_now() - start, 2);
+
+	start = bench_now();
+	for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+		for (uint32_t address = 0; address < BENCH_SPAN; address += 4) {
+			sum += m68_mmu_read_long(address);
+		}
+	}
+	bench_report("read long", bench_now() - start, 4);
+
+	start = bench_now();
+	for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+		for (uint32_t address = 0; address < BENCH_SPAN; address += 4) {
+			m68_mmu_write_long(address, address + pass);
+		}
+	}
+	bench_report("write long", bench_now() - start, 4);
+
+	start = bench_now();
+	for (int pass = 0; pass < BENCH_PASSES; ++pass) {
+		for (uint32_t address = 0; address < BENCH_SPAN; address += 2) {
+			uint16_t opcode = 0;
+			m68_mmu_fetch_word(address, &opcode);
+			sum += opcode;
+		}
+	}
+	bench_report("fetch word", bench_now() - start, 2);
+
+	bench_sink = sum;
+	m68_mmu_destroy();
+	return 0;
+}
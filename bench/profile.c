@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Profiler Benchmark
+ * Runs the same block of ABCD instructions with and without the profiler,
+ * sampling at several periods, and reports how much slower the profiled runs
+ * are. The host's speed drifts by a few percent over a second or so, which
+ * is more than the difference being measured, so each profiled run is paired
+ * with an unprofiled one next to it (in alternating order), and the median
+ * of the ratios is reported along with its quartiles. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/profile.h"
+
+#define BENCH_ORIGIN	0x10000
+#define BENCH_BLOCK	(1 << 15)
+#define BENCH_CYCLES	(1ULL << 23)
+#define BENCH_PAIRS	101
+#define BENCH_PERIODS	4
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Run the block until the specified number of cycles have elapsed, and
+ * return the time taken in nanoseconds. A period of zero runs without the
+ * profiler. */
+static uint64_t bench_time(uint64_t period)
+{
+	m68_scheduler_reset();
+	m68_profile_reset();
+	CPU68.cycles = 0;
+	if (period && m68_profile_start(period, (uint32_t)(BENCH_CYCLES / period) + 1)) {
+		return 0;
+	}
+
+	/* ABCD Dn,Dn takes 6 cycles, so stop a little short of the end of the
+	 * block and start again from the top. */
+	uint64_t start = bench_now();
+	for (uint64_t cycles = 0; cycles < BENCH_CYCLES; ) {
+		CPU68.PC.value = BENCH_ORIGIN;
+		cycles += m68_run((BENCH_BLOCK - 16) * 6);
+	}
+	uint64_t elapsed = bench_now() - start;
+
+	m68_profile_stop();
+	return elapsed;
+}
+
+static int bench_compare(const void *a, const void *b)
+{
+	double x = *(const double *)a, y = *(const double *)b;
+	return (x > y) - (x < y);
+}
+
+int main(int argc, char const *argv[])
+{
+	static const uint64_t periods[BENCH_PERIODS] = { 100000, 5000, 1000, 100 };
+
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68000);
+	CPU68.A[7].value = 0x8000;
+	for (uint32_t address = BENCH_ORIGIN; address < BENCH_ORIGIN + 2 * BENCH_BLOCK; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+
+	printf("Profiler overhead: %llu cycles per run, median of %d pairs of runs\n",
+		(unsigned long long)BENCH_CYCLES, BENCH_PAIRS);
+	for (int i = 0; i < BENCH_PERIODS; ++i) {
+		double ratios[BENCH_PAIRS];
+		for (int pair = 0; pair < BENCH_PAIRS; ++pair) {
+			uint64_t plain, profiled;
+			if (pair & 1) {
+				plain = bench_time(0);
+				profiled = bench_time(periods[i]);
+			}
+			else {
+				profiled = bench_time(periods[i]);
+				plain = bench_time(0);
+			}
+			ratios[pair] = (double)profiled / (double)plain - 1.0;
+		}
+		qsort(ratios, BENCH_PAIRS, sizeof(ratios[0]), bench_compare);
+
+		char name[32];
+		snprintf(name, sizeof(name), "every %llu cycles", (unsigned long long)periods[i]);
+		printf("%-24s %+6.2f%%  (quartiles %+6.2f%% to %+6.2f%%)  %6llu samples\n", name,
+			100.0 * ratios[BENCH_PAIRS / 2], 100.0 * ratios[BENCH_PAIRS / 4], 100.0 * ratios[3 * BENCH_PAIRS / 4],
+			(unsigned long long)(BENCH_CYCLES / periods[i]));
+	}
+
+	m68_profile_reset();
+	m68_scheduler_reset();
+	return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Ring Buffer Contention Benchmark
+ * A producer thread streams 32-bit samples to a consumer thread, once through
+ * an m68_ring and once through a mutex guarded queue of the same capacity.
+ * Reports throughput and the worst case cost of a single dequeue on the
+ * consumer (emulator) side, which is what shows up as audio jitter. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include "device/ring.h"
+
+#define BENCH_ELEMENTS	(1 << 24)
+#define BENCH_CAPACITY	4096
+#define BENCH_BATCH	64
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// MARK: - Mutex Queue
+
+struct bench_locked_queue {
+	pthread_mutex_t lock;
+	uint32_t buffer[BENCH_CAPACITY];
+	size_t head, tail;
+};
+
+static size_t bench_locked_enqueue(struct bench_locked_queue *q, const uint32_t *in, size_t count)
+{
+	pthread_mutex_lock(&q->lock);
+	size_t n = 0;
+	while (n < count && q->tail - q->head < BENCH_CAPACITY) {
+		q->buffer[q->tail++ % BENCH_CAPACITY] = in[n++];
+	}
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+static size_t bench_locked_dequeue(struct bench_locked_queue *q, uint32_t *out, size_t count)
+{
+	pthread_mutex_lock(&q->lock);
+	size_t n = 0;
+	while (n < count && q->head != q->tail) {
+		out[n++] = q->buffer[q->head++ % BENCH_CAPACITY];
+	}
+	pthread_mutex_unlock(&q->lock);
+	return n;
+}
+
+// MARK: - Harness
+
+struct bench_queue {
+	const char *name;
+	size_t(*enqueue)(void *, const uint32_t *, size_t);
+	size_t(*dequeue)(void *, uint32_t *, size_t);
+	void *context;
+};
+
+static size_t bench_ring_enqueue(void *ctx, const uint32_t *in, size_t count)
+{
+	return m68_ring_enqueue(ctx, in, count);
+}
+
+static size_t bench_ring_dequeue(void *ctx, uint32_t *out, size_t count)
+{
+	return m68_ring_dequeue(ctx, out, count);
+}
+
+static size_t bench_mutex_enqueue(void *ctx, const uint32_t *in, size_t count)
+{
+	return bench_locked_enqueue(ctx, in, count);
+}
+
+static size_t bench_mutex_dequeue(void *ctx, uint32_t *out, size_t count)
+{
+	return bench_locked_dequeue(ctx, out, count);
+}
+
+static void *bench_producer(void *context)
+{
+	struct bench_queue *queue = context;
+	uint32_t batch[BENCH_BATCH];
+	uint32_t next = 0;
+	while (next < BENCH_ELEMENTS) {
+		for (int i = 0; i < BENCH_BATCH; ++i) {
+			batch[i] = next + i;
+		}
+		size_t remaining = BENCH_ELEMENTS - next;
+		next += queue->enqueue(queue->context, batch, remaining < BENCH_BATCH ? remaining : BENCH_BATCH);
+	}
+	return NULL;
+}
+
+static void bench_run(struct bench_queue *queue)
+{
+	pthread_t producer;
+	uint32_t batch[BENCH_BATCH];
+	uint64_t received = 0, checksum = 0, worst = 0;
+
+	uint64_t start = bench_now();
+	pthread_create(&producer, NULL, bench_producer, queue);
+	while (received < BENCH_ELEMENTS) {
+		uint64_t before = bench_now();
+		size_t count = queue->dequeue(queue->context, batch, BENCH_BATCH);
+		uint64_t cost = bench_now() - before;
+		worst = cost > worst ? cost : worst;
+		for (size_t i = 0; i < count; ++i) {
+			checksum += batch[i];
+		}
+		received += count;
+	}
+	pthread_join(producer, NULL);
+	uint64_t elapsed = bench_now() - start;
+
+	printf("%-8s %8.1f M elements/s   worst dequeue %8.1f us   (checksum %llx)\n",
+		queue->name,
+		(double)BENCH_ELEMENTS * 1000.0 / (double)elapsed,
+		(double)worst / 1000.0,
+		(unsigned long long)checksum);
+}
+
+int main(int argc, char const *argv[])
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint32_t), BENCH_CAPACITY);
+
+	static struct bench_locked_queue locked;
+	pthread_mutex_init(&locked.lock, NULL);
+
+	struct bench_queue queues[] = {
+		{ "ring", bench_ring_enqueue, bench_ring_dequeue, &ring },
+		{ "mutex", bench_mutex_enqueue, bench_mutex_dequeue, &locked },
+	};
+
+	printf("SPSC ring vs mutex queue: %d elements, capacity %d, batch %d\n",
+		BENCH_ELEMENTS, BENCH_CAPACITY, BENCH_BATCH);
+	for (size_t i = 0; i < sizeof(queues) / sizeof(*queues); ++i) {
+		bench_run(&queues[i]);
+	}
+
+	m68_ring_destroy(&ring);
+	pthread_mutex_destroy(&locked.lock);
+	return 0;
+}
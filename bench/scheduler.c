@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Event Scheduler Benchmark
+ * Keeps a fixed number of periodic events pending, each rescheduling itself
+ * when it fires, and reports the cost of a single fire and reschedule. This
+ * should grow only slowly with the number of pending events. */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "cpu/cpu.h"
+#include "cpu/scheduler.h"
+
+#define BENCH_FIRES	(1 << 22)
+
+static uint64_t bench_fired = 0;
+
+static uint64_t bench_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void bench_periodic(struct m68_event *event)
+{
+	++bench_fired;
+	m68_event_schedule_at(event, event->when + (uint64_t)(uintptr_t)event->context);
+}
+
+static void bench_run(uint32_t pending)
+{
+	static struct m68_event events[4096];
+
+	m68_scheduler_reset();
+	CPU68.cycles = 0;
+	CPU68.deadline = UINT64_MAX;
+	bench_fired = 0;
+	for (uint32_t i = 0; i < pending; ++i) {
+		/* Periods between 1000 and 1999 cycles, so events interleave. */
+		uintptr_t period = 1000 + (i * 7919) % 1000;
+		m68_event_initialise(&events[i], bench_periodic, (void *)period);
+		m68_event_schedule(&events[i], period);
+	}
+
+	uint64_t start = bench_now();
+	while (bench_fired < BENCH_FIRES) {
+		CPU68.cycles = m68_scheduler_next();
+		m68_scheduler_dispatch();
+	}
+	uint64_t elapsed = bench_now() - start;
+
+	printf("%5u pending   %6.1f ns per event\n", pending, (double)elapsed / (double)bench_fired);
+}
+
+int main(int argc, char const *argv[])
+{
+	printf("Event scheduler: %d fires\n", BENCH_FIRES);
+	for (uint32_t pending = 4; pending <= 4096; pending *= 4) {
+		bench_run(pending);
+	}
+	m68_scheduler_reset();
+	return 0;
+}
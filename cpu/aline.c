@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/aline.h"
+
+static m68_aline_handler m68_aline_toolbox_handlers[M68_ALINE_TOOLBOX_TRAPS];
+static m68_aline_handler m68_aline_os_handlers[M68_ALINE_OS_TRAPS];
+
+// MARK: - Registration
+
+struct m68_aline_trap m68_aline_decode(uint16_t opcode)
+{
+	struct m68_aline_trap trap = { .opcode = opcode };
+	trap.toolbox = (opcode >> 11) & 1;
+	if (trap.toolbox) {
+		trap.number = opcode & (M68_ALINE_TOOLBOX_TRAPS - 1);
+		trap.auto_pop = (opcode >> 10) & 1;
+	} else {
+		trap.number = opcode & (M68_ALINE_OS_TRAPS - 1);
+		trap.flags = (opcode >> 9) & 3;
+		trap.return_a0 = (opcode >> 8) & 1;
+	}
+	return trap;
+}
+
+void m68_aline_register_toolbox(uint16_t trap, m68_aline_handler handler)
+{
+	m68_aline_toolbox_handlers[trap & (M68_ALINE_TOOLBOX_TRAPS - 1)] = handler;
+}
+
+void m68_aline_register_os(uint16_t trap, m68_aline_handler handler)
+{
+	m68_aline_os_handlers[trap & (M68_ALINE_OS_TRAPS - 1)] = handler;
+}
+
+void m68_aline_reset(void)
+{
+	for (int i = 0; i < M68_ALINE_TOOLBOX_TRAPS; ++i) {
+		m68_aline_toolbox_handlers[i] = NULL;
+	}
+	for (int i = 0; i < M68_ALINE_OS_TRAPS; ++i) {
+		m68_aline_os_handlers[i] = NULL;
+	}
+}
+
+// MARK: - Dispatch
+
+static int m68_aline_call_os(const struct m68_aline_trap *trap, m68_aline_handler handler)
+{
+	uint32_t a0 = CPU68.A[0].value;
+	uint32_t a1 = CPU68.A[1].value;
+	uint32_t d1 = CPU68.D[1].value;
+	uint32_t d2 = CPU68.D[2].value;
+
+	if (!handler(trap)) {
+		return 0;
+	}
+
+	if (!trap->return_a0) {
+		CPU68.A[0].value = a0;
+	}
+	CPU68.A[1].value = a1;
+	CPU68.D[1].value = d1;
+	CPU68.D[2].value = d2;
+
+	/* TST.W D0 */
+	CPU68.CCR.bitmask.user.N = (CPU68.D[0].word[0] >> 15) & 1;
+	CPU68.CCR.bitmask.user.Z = CPU68.D[0].word[0] == 0;
+	CPU68.CCR.bitmask.user.V = 0;
+	CPU68.CCR.bitmask.user.C = 0;
+	return 1;
+}
+
+void m68_aline_dispatch(void)
+{
+	uint32_t address = CPU68.PC.value;
+	struct m68_aline_trap trap = m68_aline_decode(m68_mmu_read_word(address));
+	trap.address = address;
+
+	m68_aline_handler handler = trap.toolbox
+		? m68_aline_toolbox_handlers[trap.number]
+		: m68_aline_os_handlers[trap.number];
+
+	if (handler) {
+		CPU68.PC.value = address + 2;
+		int handled = trap.toolbox ? handler(&trap) : m68_aline_call_os(&trap, handler);
+		if (handled) {
+			if (trap.auto_pop) {
+				CPU68.PC.value = m68_mmu_read_long(CPU68.A[7].value);
+				CPU68.A[7].value += 4;
+			}
+			return;
+		}
+		CPU68.PC.value = address;
+	}
+
+	/* The stacked PC for a Line 1010 exception is the trap word itself, which
+	 * is how the guest's dispatcher finds the trap number. */
+	m68_exception_process(M68_VECTOR_LINE_1010, address);
+}
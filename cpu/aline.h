@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_ALineTraps)
+#define lib68_ALineTraps
+
+#define M68_ALINE_TOOLBOX_TRAPS	0x400
+#define M68_ALINE_OS_TRAPS	0x100
+
+/* A-Line Trap
+ * Classic Mac OS calls the Operating System and Toolbox through unimplemented
+ * 1010 opcodes. The trap word is decoded as follows:
+ *
+ *	Toolbox	1010 1ann nnnn nnnn	a = auto-pop, n = trap number
+ *	OS	1010 0ffr nnnn nnnn	f = flags, r = don't preserve A0,
+ *					n = trap number */
+struct m68_aline_trap {
+	uint16_t opcode;
+	uint16_t number;
+	uint32_t address;	/* Address of the trap word */
+	uint8_t toolbox;
+	uint8_t auto_pop;	/* Toolbox only */
+	uint8_t flags;		/* OS only, e.g. SYS/CLEAR for NewPtr */
+	uint8_t return_a0;	/* OS only, A0 is a result rather than preserved */
+};
+
+/* Native Trap Handler
+ * Called with the PC already pointing after the trap word. Returns non-zero if
+ * the trap was handled, or zero to let the guest's own trap dispatcher handle
+ * it. For OS traps, D1, D2, A1 and (unless return_a0 is set) A0 are preserved
+ * across the handler, and the condition codes are set from D0.W afterwards,
+ * as the ROM trap dispatcher does. */
+typedef int(*m68_aline_handler)(const struct m68_aline_trap *trap);
+
+/* Decode the specified trap word. */
+struct m68_aline_trap m68_aline_decode(uint16_t opcode);
+
+/* Register a native handler for the specified Toolbox trap, replacing any
+ * existing one. Passing NULL removes the handler. The trap may be given as the
+ * trap number or the full trap word. */
+void m68_aline_register_toolbox(uint16_t trap, m68_aline_handler handler);
+
+/* Register a native handler for the specified OS trap. */
+void m68_aline_register_os(uint16_t trap, m68_aline_handler handler);
+
+/* Remove all registered handlers. */
+void m68_aline_reset(void);
+
+/* Instruction handler for all 1010 opcodes. Traps without a native handler are
+ * passed to the guest through the Line 1010 exception vector. */
+void m68_aline_dispatch(void);
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/mmu.h"
+#include "cpu/cache.h"
+#include "cpu/aot.h"
+
+static const struct m68_aot_module *m68_aot_modules[M68_AOT_MAX_MODULES];
+static uint32_t m68_aot_module_count = 0;
+
+// MARK: - Registration
+
+int m68_aot_register(const struct m68_aot_module *module)
+{
+	if (m68_aot_module_count == M68_AOT_MAX_MODULES) {
+		return -1;
+	}
+	m68_aot_modules[m68_aot_module_count++] = module;
+	m68_cache_set_blocks(1);
+	return 0;
+}
+
+void m68_aot_reset(void)
+{
+	m68_aot_module_count = 0;
+	m68_cache_set_blocks(0);
+}
+
+// MARK: - Lookup
+
+static const struct m68_aot_block *m68_aot_find(const struct m68_aot_module *module, uint32_t pc)
+{
+	uint32_t low = 0;
+	uint32_t high = module->count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		const struct m68_aot_block *block = &module->blocks[middle];
+		if (block->pc == pc) {
+			return block;
+		} else if (block->pc < pc) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return NULL;
+}
+
+const struct m68_aot_block *m68_aot_lookup(uint32_t pc)
+{
+	for (uint32_t i = 0; i < m68_aot_module_count; ++i) {
+		const struct m68_aot_module *module = m68_aot_modules[i];
+		if (module->model != CPU68.model) {
+			continue;
+		}
+		const struct m68_aot_block *block = m68_aot_find(module, pc);
+		uint32_t offset = pc & ~M68_MMU_PAGE_MASK;
+		if (block == NULL || offset + block->length > M68_MMU_PAGE_SIZE) {
+			continue;
+		}
+
+		/* The block is only good for the code it was translated from. */
+		if (m68_cache_code_matches(pc, block->code, block->length / 2)) {
+			return block;
+		}
+	}
+	return NULL;
+}
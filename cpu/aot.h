@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/cache.h"
+#include "cpu/instruction.h"
+
+#if !defined(lib68_AOT)
+#define lib68_AOT
+
+/* Translated blocks are kept short and within a page, so that flushing a
+ * range of the decode cache only has to look a little way back for blocks
+ * that run into it. */
+#define M68_AOT_MAX_BLOCK_LENGTH	M68_CACHE_SUPERINSTRUCTION_SPAN
+#define M68_AOT_MAX_BLOCK_INSTRUCTIONS	32
+#define M68_AOT_MAX_MODULES		16
+
+/* Ahead-of-Time Translation
+ * tools/aot translates the straight-line code in a ROM or application image
+ * into C, with each block a single function that runs the handler bodies of
+ * its instructions with the operands as constants. The output is compiled
+ * into the host and its module registered here.
+ *
+ * A block is used by the decode cache in place of the instruction at its
+ * start, in the same way as a fused instruction (cpu/fusion.h), and only
+ * once the words at the PC have been checked against the code it was
+ * translated from. In M68_CACHE_STRICT mode, and always on the 68000 and
+ * 68010, they are checked again each time the block is run (cpu/cache.h).
+ * m68_step() never runs one.
+ *
+ * A block charges the cycles of each instruction as it goes, and returns to
+ * the run loop as soon as an instruction faults, leaves the PC anywhere but
+ * on the next instruction, flushes the decode cache or reaches the deadline.
+ * Anything the translator can not handle ends the block, and is left to the
+ * interpreter. */
+struct m68_aot_block {
+	uint32_t pc;
+	uint32_t length;
+	const uint16_t *code;
+	struct m68_instruction instruction;
+};
+
+/* Translated Module
+ * The blocks of an image, sorted by PC, for a single model. */
+struct m68_aot_module {
+	const char *name;
+	enum m68_model model;
+	uint32_t count;
+	const struct m68_aot_block *blocks;
+};
+
+/* Register a translated module. The decode cache is flushed. Returns 0 on
+ * success, or -1 if there is no room for another module. */
+int m68_aot_register(const struct m68_aot_module *module);
+
+/* Forget every registered module. The decode cache is flushed. */
+void m68_aot_reset(void);
+
+/* The block starting at the PC, or NULL. Called by the decode cache when it
+ * fills an entry, so the page holding the PC is in the read look-aside
+ * buffer. */
+const struct m68_aot_block *m68_aot_lookup(uint32_t pc);
+
+/* Called by a translated block after an instruction that started at pc, with
+ * next the address of the instruction after it. Returns 0 if the block must
+ * return to the run loop. A fault is given its offset from the start of the
+ * block, so that the run loop takes it on the right instruction. */
+static inline int m68_aot_continue(uint32_t start, uint32_t pc, uint32_t next, uint32_t generation)
+{
+	if (__builtin_expect(CPU68.fault.vector != 0, 0)) {
+		CPU68.fault.offset = (uint8_t)(pc - start);
+		return 0;
+	}
+	return CPU68.PC.value == next
+		&& DECODE_CACHE_GENERATION == generation
+		&& CPU68.cycles < CPU68.deadline;
+}
+
+#endif
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/cache.h"
+#include "cpu/fusion.h"
+#include "cpu/aot.h"
+
+/* Instruction cache lines are 16 bytes on the 68030 and 68040. The 68020 has
+ * 4 byte entries, which a line always covers. */
+#define M68_CACHE_ILINE_SIZE	16
+
+static enum m68_cache_mode m68_cache_current_mode = M68_CACHE_STRICT;
+
+// MARK: - Configuration
+
+/* Whether the guest's instruction cache is switched on. */
+static int m68_cache_instruction_enabled(void)
+{
+	switch (CPU68.model) {
+		case M68_MODEL_68020:
+		case M68_MODEL_68030:
+			return (CPU68.CACR.value & M68_CACR_EI) != 0;
+		case M68_MODEL_68040:
+			return (CPU68.CACR.value & M68_CACR_040_IE) != 0;
+		default:
+			return 0;
+	}
+}
+
+static void m68_cache_update(void)
+{
+	DECODE_CACHE_TRUSTED = m68_cache_current_mode == M68_CACHE_TRUST && m68_cache_instruction_enabled();
+	DECODE_CACHE_ACTIVE = DECODE_CACHE_TRUSTED || DECODE_CACHE_BLOCKS;
+}
+
+void m68_cache_set_mode(enum m68_cache_mode mode)
+{
+	m68_cache_current_mode = mode;
+	m68_cache_flush();
+	m68_cache_update();
+}
+
+enum m68_cache_mode m68_cache_mode(void)
+{
+	return m68_cache_current_mode;
+}
+
+void m68_cache_set_blocks(int registered)
+{
+	DECODE_CACHE_BLOCKS = registered;
+	m68_cache_flush();
+	m68_cache_update();
+}
+
+void m68_cache_set_cacr(uint32_t value)
+{
+	uint32_t mask;
+	switch (CPU68.model) {
+		case M68_MODEL_68020:
+			mask = M68_CACR_EI | M68_CACR_FI;
+			break;
+		case M68_MODEL_68030:
+			mask = M68_CACR_EI | M68_CACR_FI | M68_CACR_IBE | M68_CACR_ED
+				| M68_CACR_FD | M68_CACR_DBE | M68_CACR_WA;
+			break;
+		case M68_MODEL_68040:
+			mask = M68_CACR_040_IE | M68_CACR_040_DE;
+			break;
+		default:
+			mask = 0;
+			break;
+	}
+
+	/* The cache does not forget its contents when it is disabled, but
+	 * nothing says they are still good when it comes back, so decodes are
+	 * dropped whenever it is switched on. */
+	int was_enabled = m68_cache_instruction_enabled();
+	CPU68.CACR.value = value & mask;
+	if (!was_enabled && m68_cache_instruction_enabled()) {
+		m68_cache_flush();
+	}
+
+	if (CPU68.model == M68_MODEL_68020 || CPU68.model == M68_MODEL_68030) {
+		if (value & M68_CACR_CI) {
+			m68_cache_flush();
+		} else if (value & M68_CACR_CEI) {
+			m68_cache_flush_range(CPU68.CAAR.value & ~(M68_CACHE_ILINE_SIZE - 1), M68_CACHE_ILINE_SIZE);
+		}
+	}
+
+	m68_cache_update();
+}
+
+void m68_cache_reset(void)
+{
+	CPU68.CACR.value = 0;
+	m68_cache_flush();
+	m68_cache_update();
+}
+
+// MARK: - Flushing
+
+void m68_cache_flush(void)
+{
+	/* Clear the entries for real when the generation wraps, so that an entry
+	 * from 2^32 flushes ago can not come back. */
+	if (++DECODE_CACHE_GENERATION == 0) {
+		for (int i = 0; i < M68_CACHE_DECODE_ENTRIES; ++i) {
+			DECODE_CACHE[i].pc = M68_CACHE_DECODE_INVALID;
+		}
+	}
+}
+
+void m68_cache_flush_range(uint32_t address, uint32_t length)
+{
+	if (length >= 2 * M68_CACHE_DECODE_ENTRIES) {
+		m68_cache_flush();
+		return;
+	}
+
+	/* A superinstruction starting before the range may run into it. */
+	uint32_t span = M68_CACHE_SUPERINSTRUCTION_SPAN - 2;
+	for (uint32_t offset = 0; offset < length + span; offset += 2) {
+		uint32_t pc = (address & ~1u) - span + offset;
+		struct m68_cache_decode_entry *entry = &DECODE_CACHE[(pc >> 1) & (M68_CACHE_DECODE_ENTRIES - 1)];
+		if (entry->pc == pc) {
+			entry->pc = M68_CACHE_DECODE_INVALID;
+		}
+	}
+}
+
+// MARK: - Superinstructions
+
+void m68_cache_superinstruction(struct m68_cache_decode_entry *entry, uint16_t opcode)
+{
+	const struct m68_aot_block *block = m68_aot_lookup(entry->pc);
+	if (block) {
+		entry->fused = &block->instruction;
+		entry->code = block->code;
+		entry->words = block->length / 2;
+		return;
+	}
+
+	entry->fused = DECODE_CACHE_TRUSTED ? m68_fusion_decode(entry->pc, opcode) : NULL;
+	entry->code = NULL;
+	entry->words = 0;
+}
+
+const struct m68_instruction *m68_cache_decode_block(uint32_t pc, uint16_t opcode,
+	const struct m68_instruction *instruction)
+{
+	/* Only the superinstruction is taken from the entry, and only if its code
+	 * is unchanged. Otherwise the entry is filled again. */
+	struct m68_cache_decode_entry *entry = &DECODE_CACHE[(pc >> 1) & (M68_CACHE_DECODE_ENTRIES - 1)];
+	if (entry->pc == pc && entry->generation == DECODE_CACHE_GENERATION) {
+		if (entry->fused == NULL) {
+			return instruction;
+		}
+		if (m68_cache_code_matches(pc, entry->code, entry->words)) {
+			return entry->fused;
+		}
+	}
+	m68_cache_fill(entry, pc, opcode, instruction);
+	return instruction;
+}
+
+// MARK: - Instructions
+
+/* CINV and CPUSH, which only the 68040 table has. Only the instruction cache
+ * needs any work, as there is no data cache to push. Pages are taken to be
+ * 4KiB. */
+void m68_cache_control(void)
+{
+	uint32_t pc = CPU68.PC.value;
+	uint16_t opcode = m68_mmu_read_word(pc);
+	uint8_t caches = (opcode >> 6) & 3;
+	uint8_t scope = (opcode >> 3) & 3;
+	uint32_t address = CPU68.A[opcode & 7].value;
+
+	if (scope == 0) {
+		m68_exception_process(M68_VECTOR_LINE_1111, pc);
+		return;
+	}
+	if (!CPU68.CCR.bitmask.mask.S) {
+		m68_exception_process(M68_VECTOR_PRIVILEGE_VIOLATION, pc);
+		return;
+	}
+
+	if (caches & 2) {
+		switch (scope) {
+			case 1:
+				m68_cache_flush_range(address & ~(M68_CACHE_ILINE_SIZE - 1), M68_CACHE_ILINE_SIZE);
+				break;
+			case 2:
+				m68_cache_flush_range(address & M68_MMU_PAGE_MASK, M68_MMU_PAGE_SIZE);
+				break;
+			case 3:
+				m68_cache_flush();
+				break;
+		}
+	}
+
+	CPU68.PC.value = pc + 2;
+}
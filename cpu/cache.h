@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+
+#if !defined(lib68_Cache)
+#define lib68_Cache
+
+/* Instruction Cache
+ * The 68020 and later cache instructions on chip, so software that generates
+ * or modifies code has to flush the cache before running it: with MOVEC to
+ * CACR on the 68020 and 68030, or CINV/CPUSH on the 68040. The emulator keeps
+ * a cache of decoded instructions, indexed by PC, and uses those flushes to
+ * invalidate it.
+ *
+ * The decode cache runs in one of two modes:
+ *	M68_CACHE_STRICT	Every instruction is fetched and decoded from
+ *				memory, so code can be modified without
+ *				flushing. This is the default.
+ *	M68_CACHE_TRUST		While the guest's instruction cache is enabled,
+ *				decodes are kept until the guest flushes it, or
+ *				the memory map or translation changes. Software
+ *				that forgets to flush will run stale code, as it
+ *				would on a real cache, only more often.
+ *
+ * The 68000 and 68010 have no cache, so they always run in the strict mode.
+ * The host must call m68_cache_flush() after writing code itself, and the
+ * mode or CACR must be set after the model.
+ *
+ * Translated blocks (cpu/aot.h) are cached in both modes. In the strict mode
+ * the words a block was translated from are compared with memory each time
+ * the run loop reaches it, and if they have changed the single instruction
+ * at the PC is run instead. A block that modifies its own later instructions
+ * still runs them as they were. Fused pairs (cpu/fusion.h) save too little
+ * to pay for that check, so they are only formed in the trust mode.
+ *
+ * Data caches are accepted in CACR, but as memory is always coherent they
+ * have no effect. */
+
+enum m68_cache_mode {
+	M68_CACHE_STRICT = 0,
+	M68_CACHE_TRUST = 1,
+};
+
+/* CACR bits of the 68020 and 68030. The 68020 only has the instruction cache
+ * bits, and the clear bits are commands that always read as zero. */
+#define M68_CACR_EI		(1u << 0)	/* Enable Instruction Cache */
+#define M68_CACR_FI		(1u << 1)	/* Freeze Instruction Cache */
+#define M68_CACR_CEI		(1u << 2)	/* Clear Entry in Instruction Cache */
+#define M68_CACR_CI		(1u << 3)	/* Clear Instruction Cache */
+#define M68_CACR_IBE		(1u << 4)	/* Instruction Burst Enable */
+#define M68_CACR_ED		(1u << 8)	/* Enable Data Cache */
+#define M68_CACR_FD		(1u << 9)	/* Freeze Data Cache */
+#define M68_CACR_CED		(1u << 10)	/* Clear Entry in Data Cache */
+#define M68_CACR_CD		(1u << 11)	/* Clear Data Cache */
+#define M68_CACR_DBE		(1u << 12)	/* Data Burst Enable */
+#define M68_CACR_WA		(1u << 13)	/* Write Allocate */
+
+/* CACR bits of the 68040. */
+#define M68_CACR_040_IE		(1u << 15)	/* Enable Instruction Cache */
+#define M68_CACR_040_DE		(1u << 31)	/* Enable Data Cache */
+
+#define M68_CACHE_DECODE_ENTRIES	4096
+#define M68_CACHE_DECODE_INVALID	1
+
+/* The most bytes of code a superinstruction may cover. */
+#define M68_CACHE_SUPERINSTRUCTION_SPAN	64
+
+/* Decode Cache Entry
+ * An entry is only valid in the generation it was filled in, so the whole
+ * cache can be flushed without touching it. If a superinstruction starts with
+ * the instruction, the entry also holds it: a translated block (cpu/aot.h),
+ * or failing that a fused pair of instructions (cpu/fusion.h). A block's code
+ * is kept too, for the strict mode to check. */
+struct m68_cache_decode_entry {
+	uint32_t pc;
+	uint32_t generation;
+	const struct m68_instruction *instruction;
+	const struct m68_instruction *fused;
+	const uint16_t *code;
+	uint32_t words;
+};
+
+extern struct m68_cache_decode_entry DECODE_CACHE[M68_CACHE_DECODE_ENTRIES];
+extern uint32_t DECODE_CACHE_GENERATION;
+extern int DECODE_CACHE_TRUSTED;
+
+/* Whether any translated module is registered (cpu/aot.h), and whether the
+ * decode cache is looked in at all: in the trust mode, or to find translated
+ * blocks in the strict mode. */
+extern int DECODE_CACHE_BLOCKS;
+extern int DECODE_CACHE_ACTIVE;
+
+/* Select the mode. The decode cache is flushed. */
+void m68_cache_set_mode(enum m68_cache_mode mode);
+enum m68_cache_mode m68_cache_mode(void);
+
+/* Set whether any translated module is registered (cpu/aot.h). The decode
+ * cache is flushed. */
+void m68_cache_set_blocks(int registered);
+
+/* Write CACR, as MOVEC does for the current model: bits the model does not
+ * have are cleared, and the clear commands are carried out. */
+void m68_cache_set_cacr(uint32_t value);
+
+/* Clear CACR and flush the decode cache. The mode is unchanged. */
+void m68_cache_reset(void);
+
+/* Drop every decode, or those of instructions starting in the range. */
+void m68_cache_flush(void);
+void m68_cache_flush_range(uint32_t address, uint32_t length);
+
+/* Instruction handler for CINV and CPUSH (68040). */
+void m68_cache_control(void);
+
+/* Find the superinstruction starting with the instruction at the entry's PC,
+ * and store it and its code in the entry, or NULL if there is none. Called
+ * when an entry is filled. */
+void m68_cache_superinstruction(struct m68_cache_decode_entry *entry, uint16_t opcode);
+
+/* Whether the words at the PC are still the specified code, which must not
+ * cross into the next page. Only pages in the read look-aside buffer are
+ * checked, as any other may have a breakpoint or fault. */
+static inline int m68_cache_code_matches(uint32_t pc, const uint16_t *code, uint32_t words)
+{
+	const struct m68_mmu_tlb_entry *tlb = m68_mmu_tlb_entry(MMU_READ_TLB, pc);
+	if (tlb->tag != (pc & M68_MMU_PAGE_MASK)) {
+		return 0;
+	}
+	const uint8_t *ptr = tlb->page + (pc & ~M68_MMU_PAGE_MASK);
+	for (uint32_t i = 0; i < words; ++i) {
+		if (m68_mmu_load_word(ptr + i * 2) != code[i]) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+/* The translated block at the PC if its code is unchanged, or else the
+ * instruction that was fetched there. Used by the strict mode. */
+const struct m68_instruction *m68_cache_decode_block(uint32_t pc, uint16_t opcode,
+	const struct m68_instruction *instruction);
+
+/* Fill the entry with the instruction at the PC, if it can be cached. */
+static inline void m68_cache_fill(struct m68_cache_decode_entry *entry, uint32_t pc, uint16_t opcode,
+	const struct m68_instruction *instruction)
+{
+	if (instruction->imp && m68_mmu_tlb_entry(MMU_READ_TLB, pc)->tag == (pc & M68_MMU_PAGE_MASK)) {
+		entry->pc = pc;
+		entry->generation = DECODE_CACHE_GENERATION;
+		entry->instruction = instruction;
+		m68_cache_superinstruction(entry, opcode);
+	}
+}
+
+/* Decode the instruction at the PC, from the decode cache if it can be
+ * trusted. If fuse is set, a superinstruction is returned in place of the
+ * instruction where there is one. Returns NULL if a breakpoint stops
+ * execution before the instruction. The opcode is only stored on a miss,
+ * and only instructions that exist are cached, so it is always available
+ * for an illegal one.
+ *
+ * Only instructions on pages held by the look-aside buffers are cached, as
+ * anything else (breakpoints, faults, small guest pages) has to be checked on
+ * every fetch. */
+static inline const struct m68_instruction *m68_cache_decode(uint32_t pc, uint16_t *opcode, int fuse)
+{
+	if (__builtin_expect(!DECODE_CACHE_ACTIVE, 1)) {
+		if (!m68_mmu_fetch_word(pc, opcode)) {
+			return NULL;
+		}
+		return &m68_instruction_table[*opcode];
+	}
+
+	if (!DECODE_CACHE_TRUSTED) {
+		if (!m68_mmu_fetch_word(pc, opcode)) {
+			return NULL;
+		}
+		const struct m68_instruction *instruction = &m68_instruction_table[*opcode];
+		return fuse ? m68_cache_decode_block(pc, *opcode, instruction) : instruction;
+	}
+
+	struct m68_cache_decode_entry *entry = &DECODE_CACHE[(pc >> 1) & (M68_CACHE_DECODE_ENTRIES - 1)];
+	if (entry->pc == pc && entry->generation == DECODE_CACHE_GENERATION) {
+		return fuse && entry->fused ? entry->fused : entry->instruction;
+	}
+
+	if (!m68_mmu_fetch_word(pc, opcode)) {
+		return NULL;
+	}
+	const struct m68_instruction *instruction = &m68_instruction_table[*opcode];
+	m68_cache_fill(entry, pc, *opcode, instruction);
+	return instruction;
+}
+
+#endif
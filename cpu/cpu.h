@@ -20,10 +20,13 @@
  */
 
 #include <stdint.h>
+#include <stddef.h>
 
 #if !defined(lib68_CPU)
 #define lib68_CPU
 
+#define M68_CPU_CACHE_LINE_SIZE	64
+
 /* A union representing a standard 32-bit register in the Motorola 68000
  * series CPU. */
 typedef union {
@@ -32,14 +35,119 @@ typedef union {
 	uint16_t	word[2];
 } m68_register32_t;
 
+/* An 80-bit extended precision value, as held in the FPU registers. The
+ * exponent holds the sign in bit 15 and the biased exponent below it, and the
+ * mantissa has an explicit integer bit. */
+typedef struct {
+	uint64_t mantissa;
+	uint16_t exponent;
+} m68_float80_t;
+
+/* An FPU register. Which member is in use depends on the FPU mode, see
+ * cpu/fpu.h. */
+typedef union {
+	m68_float80_t x;
+	double d;
+} m68_fp_register_t;
+
+/* A 68030 root pointer. The upper long holds the limit and descriptor type
+ * of the top level table, and the lower long its address. */
+typedef struct {
+	m68_register32_t limit;
+	m68_register32_t address;
+} m68_root_pointer_t;
+
+/* CPU Models
+ * The values match the model numbers used in cpu/instructions.spec. */
+enum m68_model {
+	M68_MODEL_68000 = 68000,
+	M68_MODEL_68010 = 68010,
+	M68_MODEL_68020 = 68020,
+	M68_MODEL_68030 = 68030,
+	M68_MODEL_68040 = 68040,
+};
+
+/* Pending Fault
+ * Memory accesses can not unwind the instruction that made them, so a bus or
+ * address error is recorded here and turned into an exception once the
+ * instruction has finished. */
+struct m68_fault {
+	uint8_t vector;		/* Zero if no fault is pending */
+	uint8_t write;
+	uint8_t instruction;
+	uint8_t offset;		/* From the dispatched instruction to the faulting one */
+	uint32_t address;
+};
+
+/* Control Registers
+ * The supervisor and memory management registers are rarely touched, so they
+ * are kept apart from the registers used by almost every instruction. They are
+ * listed once here and used both as struct m68_control_registers, and as an
+ * anonymous member of struct M68000 so that CPU68.VBR and friends still work. */
+#define M68_CONTROL_REGISTERS						\
+	/* Supervisor Only Registers */					\
+	m68_register32_t AC0, AC1;					\
+	m68_register32_t ACUSR;						\
+	m68_register32_t CAAR;						\
+	m68_register32_t CACR;						\
+	m68_register32_t DACR0, DACR1;					\
+	m68_register32_t DFC;						\
+	m68_register32_t DTT0, DTT1;					\
+	m68_register32_t IACR0, IACR1;					\
+	m68_register32_t ITT0, ITT1;					\
+	m68_register32_t MSP;						\
+	m68_register32_t SFC;						\
+	m68_register32_t SSP, ISP, USP;					\
+	m68_register32_t TT0, TT1;					\
+	m68_register32_t VBR;						\
+									\
+	/* Supervisor Only Register - Related to Paged Memory Management */ \
+	union {								\
+		uint32_t value;						\
+		struct {						\
+			uint8_t FC_MASK:3;	/* Function Code Mask */	\
+			uint8_t _1:1;					\
+			uint8_t FC_BASE:3;	/* Function Code Base */	\
+			uint8_t _2:1;					\
+			uint8_t RWM:1;		/* Read / Write Mask */	\
+			uint8_t RW:1;		/* Read / Write */	\
+			uint8_t CI:1;		/* Cache Inhibit */	\
+			uint8_t _3:4;					\
+			uint8_t E:1; 		/* Enable */		\
+			uint8_t ADDRESS_MASK;				\
+			uint8_t ADDRESS_BASE;				\
+		} mask;							\
+	} AC;								\
+	m68_register32_t CAL;						\
+	m68_root_pointer_t CRP;						\
+	m68_register32_t DRP;						\
+	m68_register32_t PCSR;						\
+	m68_register32_t PMMUSR;					\
+	m68_register32_t MMUSR;						\
+	m68_register32_t SCC;						\
+	m68_root_pointer_t SRP;						\
+	m68_register32_t TC;						\
+	m68_register32_t URP;						\
+	m68_register32_t VAL;
+
+struct m68_control_registers {
+	M68_CONTROL_REGISTERS
+};
+
 /* This structure represents the internal state of a Motorola 68000 series
- * CPU. */
+ * CPU. The registers used by almost every instruction are packed into the
+ * first two cache lines, and the control registers follow on their own. */
 struct M68000 {
-	/* Data Registers */
-	m68_register32_t D[8];
-	
-	/* Address Registers */
-	m68_register32_t A[8];
+	/* Data & Address Registers
+	 * R holds D0-D7 followed by A0-A7, so the 4-bit register field used by
+	 * many encodings (e.g. index registers) can index it directly. */
+	union {
+		m68_register32_t R[16];
+		struct {
+			m68_register32_t D[8];
+			m68_register32_t A[8];
+		};
+	};
 
 	/* Control Register - PC */
 	m68_register32_t PC;
@@ -66,50 +174,36 @@ struct M68000 {
 		} bitmask;
 	} CCR;
 
-	/* Supervisor Only Registers */
-	m68_register32_t AC0, AC1;
-	m68_register32_t ACUSR;
-	m68_register32_t CAAR;
-	m68_register32_t DACR0, DACR1;
-	m68_register32_t DFC;
-	m68_register32_t DTT0, DTT1;
-	m68_register32_t IACR0, IACR1;
-	m68_register32_t ITT0, ITT1;
-	m68_register32_t MSP;
-	m68_register32_t SFC;
-	m68_register32_t SSP, ISP;
-	m68_register32_t TT0, TT1;
-	m68_register32_t VBR;
-
-	/* Supervisor Only Register - Related to Paged Memory Management */
+	/* Number of clock cycles executed, and the cycle count at which the run
+	 * loop should next return to its caller. */
+	uint64_t cycles;
+	uint64_t deadline;
+
+	/* The model being emulated. */
+	enum m68_model model;
+
+	/* Bus or address error raised by the current instruction. */
+	struct m68_fault fault;
+
+	/* Control Registers */
 	union {
-		uint32_t value;
+		struct m68_control_registers control;
 		struct {
-			uint8_t FC_MASK:3;	/* Function Code Mask */
-			uint8_t _1:1;
-			uint8_t FC_BASE:3;	/* Function Code Base */
-			uint8_t _2:1;
-			uint8_t RWM:1;		/* Read / Write Mask */
-			uint8_t RW:1;		/* Read / Write */
-			uint8_t CI:1;		/* Cache Inhibit */
-			uint8_t _3:4;		
-			uint8_t E:1; 		/* Enable */
-			uint8_t ADDRESS_MASK;
-			uint8_t ADDRESS_BASE;
-		} mask;	
-	} AC;
-	m68_register32_t CAL;
-	m68_register32_t CRP;
-	m68_register32_t DRP;
-	m68_register32_t PCSR;
-	m68_register32_t PMMUSR;
-	m68_register32_t MMUSR;
-	m68_register32_t SCC;
-	m68_register32_t SRP;
-	m68_register32_t TC;
-	m68_register32_t URP;
-	m68_register32_t VAL;	
-};
+			M68_CONTROL_REGISTERS
+		};
+	} __attribute__((aligned(M68_CPU_CACHE_LINE_SIZE)));
+
+	/* Floating Point Registers (68881/68882) */
+	struct {
+		m68_fp_register_t FP[8];
+		m68_register32_t FPCR;
+		m68_register32_t FPSR;
+		m68_register32_t FPIAR;
+	} __attribute__((aligned(M68_CPU_CACHE_LINE_SIZE)));
+} __attribute__((aligned(M68_CPU_CACHE_LINE_SIZE)));
+
+_Static_assert(offsetof(struct M68000, deadline) < 2 * M68_CPU_CACHE_LINE_SIZE,
+	"The hot registers must fit within the first two cache lines");
 
 extern struct M68000 CPU68;
 
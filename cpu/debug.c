@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/debug.h"
+
+struct m68_watchpoint {
+	int active;
+	enum m68_watch_kind kinds;
+	uint32_t first;
+	uint32_t last;
+	m68_watch_callback callback;
+	void *context;
+};
+
+struct m68_breakpoint {
+	int active;
+	uint32_t address;
+	m68_break_callback callback;
+	void *context;
+};
+
+static struct m68_watchpoint m68_debug_watchpoints[M68_DEBUG_MAX_WATCHPOINTS];
+static struct m68_breakpoint m68_debug_breakpoints[M68_DEBUG_MAX_BREAKPOINTS];
+
+/* Where the CPU last stopped at a breakpoint. It is still stopped there if
+ * neither the PC nor the cycle count has moved since. */
+static struct {
+	int valid;
+	uint32_t address;
+	uint64_t cycles;
+} m68_debug_stop;
+
+// MARK: - Page Flags
+
+/* Recompute the flags of every page between the two addresses. */
+static void m68_debug_update_pages(uint32_t first, uint32_t last)
+{
+	uint32_t page = first & M68_MMU_PAGE_MASK;
+	for (;;) {
+		uint32_t page_last = page + (M68_MMU_PAGE_SIZE - 1);
+		int watch = 0, breakpoint = 0;
+
+		for (int i = 0; i < M68_DEBUG_MAX_WATCHPOINTS && !watch; ++i) {
+			struct m68_watchpoint *w = &m68_debug_watchpoints[i];
+			watch = w->active && w->first <= page_last && w->last >= page;
+		}
+		for (int i = 0; i < M68_DEBUG_MAX_BREAKPOINTS && !breakpoint; ++i) {
+			struct m68_breakpoint *b = &m68_debug_breakpoints[i];
+			breakpoint = b->active && (b->address & M68_MMU_PAGE_MASK) == page;
+		}
+		m68_mmu_set_debug_flags(page, watch, breakpoint);
+
+		if (page_last >= last) {
+			break;
+		}
+		page += M68_MMU_PAGE_SIZE;
+	}
+}
+
+// MARK: - Watchpoints
+
+int m68_debug_add_watchpoint(uint32_t address, uint32_t length, enum m68_watch_kind kinds,
+	m68_watch_callback callback, void *context)
+{
+	/* The range may end at the top of memory, but not wrap past it. */
+	if (length == 0 || length - 1 > UINT32_MAX - address || callback == NULL) {
+		return -1;
+	}
+
+	for (int i = 0; i < M68_DEBUG_MAX_WATCHPOINTS; ++i) {
+		struct m68_watchpoint *w = &m68_debug_watchpoints[i];
+		if (w->active) {
+			continue;
+		}
+		w->active = 1;
+		w->kinds = kinds;
+		w->first = address;
+		w->last = address + (length - 1);
+		w->callback = callback;
+		w->context = context;
+		m68_debug_update_pages(w->first, w->last);
+		return i;
+	}
+	return -1;
+}
+
+void m68_debug_remove_watchpoint(int watchpoint)
+{
+	if (watchpoint < 0 || watchpoint >= M68_DEBUG_MAX_WATCHPOINTS) {
+		return;
+	}
+	struct m68_watchpoint *w = &m68_debug_watchpoints[watchpoint];
+	if (w->active) {
+		w->active = 0;
+		m68_debug_update_pages(w->first, w->last);
+	}
+}
+
+void m68_debug_access(uint32_t address, uint8_t size, uint32_t value, int write)
+{
+	enum m68_watch_kind kind = write ? M68_WATCH_WRITE : M68_WATCH_READ;
+	uint32_t last = address + (size - 1);
+
+	for (int i = 0; i < M68_DEBUG_MAX_WATCHPOINTS; ++i) {
+		struct m68_watchpoint *w = &m68_debug_watchpoints[i];
+		if (!w->active || !(w->kinds & kind) || w->first > last || w->last < address) {
+			continue;
+		}
+		struct m68_watch_hit hit = {
+			.watchpoint = i,
+			.address = address,
+			.value = value,
+			.size = size,
+			.write = (uint8_t)write,
+		};
+		w->callback(&hit, w->context);
+	}
+}
+
+// MARK: - Breakpoints
+
+int m68_debug_add_breakpoint(uint32_t address, m68_break_callback callback, void *context)
+{
+	for (int i = 0; i < M68_DEBUG_MAX_BREAKPOINTS; ++i) {
+		struct m68_breakpoint *b = &m68_debug_breakpoints[i];
+		if (b->active) {
+			continue;
+		}
+		b->active = 1;
+		b->address = address;
+		b->callback = callback;
+		b->context = context;
+		m68_debug_update_pages(address, address);
+		return i;
+	}
+	return -1;
+}
+
+void m68_debug_remove_breakpoint(int breakpoint)
+{
+	if (breakpoint < 0 || breakpoint >= M68_DEBUG_MAX_BREAKPOINTS) {
+		return;
+	}
+	struct m68_breakpoint *b = &m68_debug_breakpoints[breakpoint];
+	if (b->active) {
+		b->active = 0;
+		m68_debug_update_pages(b->address, b->address);
+	}
+}
+
+int m68_debug_stopped(void)
+{
+	return m68_debug_stop.valid
+		&& m68_debug_stop.address == CPU68.PC.value
+		&& m68_debug_stop.cycles == CPU68.cycles;
+}
+
+int m68_debug_fetch(uint32_t address)
+{
+	/* Resuming from a breakpoint executes the instruction it stopped on. */
+	if (m68_debug_stopped()) {
+		m68_debug_stop.valid = 0;
+		return 1;
+	}
+
+	int stop = 0;
+	for (int i = 0; i < M68_DEBUG_MAX_BREAKPOINTS; ++i) {
+		struct m68_breakpoint *b = &m68_debug_breakpoints[i];
+		if (b->active && b->address == address) {
+			stop |= b->callback ? b->callback(address, b->context) : 1;
+		}
+	}
+
+	if (stop) {
+		m68_debug_stop.valid = 1;
+		m68_debug_stop.address = address;
+		m68_debug_stop.cycles = CPU68.cycles;
+		return 0;
+	}
+	return 1;
+}
+
+// MARK: - Reset
+
+void m68_debug_reset(void)
+{
+	for (int i = 0; i < M68_DEBUG_MAX_WATCHPOINTS; ++i) {
+		m68_debug_remove_watchpoint(i);
+	}
+	for (int i = 0; i < M68_DEBUG_MAX_BREAKPOINTS; ++i) {
+		m68_debug_remove_breakpoint(i);
+	}
+	m68_debug_stop.valid = 0;
+}
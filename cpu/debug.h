@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_Debug)
+#define lib68_Debug
+
+#define M68_DEBUG_MAX_WATCHPOINTS	64
+#define M68_DEBUG_MAX_BREAKPOINTS	256
+
+/* Watchpoints & Breakpoints
+ * Pages holding a watchpoint or breakpoint are flagged in the page table and
+ * kept out of the look-aside buffers (see cpu/mmu.h). Accesses to every other
+ * page stay on the fast path, so setting a watchpoint only slows down the
+ * page it is in, and the exact ranges are only checked on the slow path.
+ *
+ * The flags live in the page tables, so watchpoints and breakpoints must be
+ * added after m68_mmu_initialise(). */
+
+enum m68_watch_kind {
+	M68_WATCH_READ = 1,
+	M68_WATCH_WRITE = 2,
+	M68_WATCH_ACCESS = M68_WATCH_READ | M68_WATCH_WRITE,
+};
+
+/* The access that hit a watchpoint. The value is the value read or written.
+ * An access that crosses a page boundary is reported a byte at a time. */
+struct m68_watch_hit {
+	int watchpoint;
+	uint32_t address;
+	uint32_t value;
+	uint8_t size;
+	uint8_t write;
+};
+
+/* Called after the access has been made. Call m68_yield() to stop the run
+ * loop once the current instruction has finished. */
+typedef void(*m68_watch_callback)(const struct m68_watch_hit *hit, void *context);
+
+/* Called before the instruction at the breakpoint is executed. Returns
+ * non-zero to stop there, or zero to carry on. */
+typedef int(*m68_break_callback)(uint32_t address, void *context);
+
+/* Watch accesses of the specified kinds to the specified range.
+ * Returns the watchpoint number, or -1 if there is no room for it or the
+ * range is empty or wraps past the top of memory. */
+int m68_debug_add_watchpoint(uint32_t address, uint32_t length, enum m68_watch_kind kinds,
+	m68_watch_callback callback, void *context);
+
+/* Remove the specified watchpoint. */
+void m68_debug_remove_watchpoint(int watchpoint);
+
+/* Break on the instruction at the specified address. A NULL callback always
+ * stops. Returns the breakpoint number, or -1 if there is no room for it. */
+int m68_debug_add_breakpoint(uint32_t address, m68_break_callback callback, void *context);
+
+/* Remove the specified breakpoint. */
+void m68_debug_remove_breakpoint(int breakpoint);
+
+/* Remove every watchpoint and breakpoint. */
+void m68_debug_reset(void);
+
+/* Whether the CPU is stopped at a breakpoint, before the instruction at the
+ * PC. Running or stepping from here executes that instruction. */
+int m68_debug_stopped(void);
+
+/* Called by the MMU slow paths for accesses to pages with a watchpoint. */
+void m68_debug_access(uint32_t address, uint8_t size, uint32_t value, int write);
+
+/* Called by the MMU when fetching from a page with a breakpoint. Returns 0 if
+ * execution should stop before the instruction at the address. */
+int m68_debug_fetch(uint32_t address);
+
+#endif
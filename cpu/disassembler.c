@@ -0,0 +1,513 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "cpu/instruction.h"
+#include "cpu/disassembler.h"
+#include "cpu/mmu.h"
+
+static const char m68_hex_digits[16] = "0123456789ABCDEF";
+
+/* How far ahead of the stream the table entries of the next opcodes are
+ * loaded, in bytes. */
+#define M68_DISASSEMBLY_PREFETCH	16
+
+// MARK: - Input Stream
+
+/* The stream exposes a window of guest memory through a host pointer. For a
+ * host buffer the window is the whole buffer, and for a guest range it is the
+ * current page, which is refilled as the stream moves across pages. */
+struct m68_disassembly_stream {
+	const uint8_t *data;
+	uint32_t window_start;
+	uint32_t window_end;
+	uint32_t address;
+	uint32_t end;
+	int guest;
+};
+
+/* Guest pages are in the memory layout, and host buffers in the guest's
+ * byte order. */
+static inline uint16_t m68_disassembly_word(const struct m68_disassembly_stream *stream, const uint8_t *ptr)
+{
+	return stream->guest ? m68_mmu_load_word_unaligned(ptr) : (uint16_t)((ptr[0] << 8) | ptr[1]);
+}
+
+static inline int m68_disassembly_fetch(struct m68_disassembly_stream *stream, uint16_t *word)
+{
+	uint32_t address = stream->address;
+	if (stream->end - address < 2) {
+		return 0;
+	}
+
+	uint32_t window_size = stream->window_end - stream->window_start;
+	uint32_t offset = address - stream->window_start;
+	if (window_size < 2 || offset > window_size - 2) {
+		if (!stream->guest) {
+			return 0;
+		}
+
+		/* A word starting on the last byte of a page straddles two pages and
+		 * is assembled from its bytes, without going through the guest's
+		 * accessors, which could raise a fault or trip a watchpoint. */
+		if ((address & ~M68_MMU_PAGE_MASK) == M68_MMU_PAGE_SIZE - 1) {
+			uint8_t hi = m68_mmu_load_byte(m68_mmu_translate_read(address));
+			uint8_t lo = m68_mmu_load_byte(m68_mmu_translate_read(address + 1));
+			*word = (uint16_t)((hi << 8) | lo);
+			stream->address += 2;
+			return 1;
+		}
+
+		stream->window_start = address & M68_MMU_PAGE_MASK;
+		stream->window_end = stream->window_start + M68_MMU_PAGE_SIZE;
+		stream->data = m68_mmu_translate_read(stream->window_start);
+		offset = address - stream->window_start;
+	}
+
+	*word = m68_disassembly_word(stream, stream->data + offset);
+	stream->address += 2;
+	return 1;
+}
+
+static inline int m68_disassembly_fetch_long(struct m68_disassembly_stream *stream, uint32_t *value)
+{
+	uint16_t hi, lo;
+	if (!m68_disassembly_fetch(stream, &hi) || !m68_disassembly_fetch(stream, &lo)) {
+		return 0;
+	}
+	*value = ((uint32_t)hi << 16) | lo;
+	return 1;
+}
+
+// MARK: - Output Text
+
+struct m68_disassembly_text {
+	char *ptr;
+	char *end;
+};
+
+static inline void m68_text_char(struct m68_disassembly_text *text, char c)
+{
+	if (text->ptr < text->end) {
+		*text->ptr++ = c;
+	}
+}
+
+static inline void m68_text_string(struct m68_disassembly_text *text, const char *str)
+{
+	while (*str && text->ptr < text->end) {
+		*text->ptr++ = *str++;
+	}
+}
+
+static inline void m68_text_hex(struct m68_disassembly_text *text, uint32_t value, int digits)
+{
+	m68_text_char(text, '$');
+	for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+		m68_text_char(text, m68_hex_digits[(value >> shift) & 0xF]);
+	}
+}
+
+/* Write a signed displacement in the shortest form, e.g. $10 or -$10. */
+static void m68_text_displacement(struct m68_disassembly_text *text, int32_t value)
+{
+	uint32_t magnitude = value < 0 ? -(uint32_t)value : (uint32_t)value;
+	if (value < 0) {
+		m68_text_char(text, '-');
+	}
+
+	int digits = 1;
+	while (digits < 8 && (magnitude >> (digits * 4))) {
+		++digits;
+	}
+	m68_text_hex(text, magnitude, digits);
+}
+
+static inline void m68_text_register(struct m68_disassembly_text *text, char kind, uint8_t reg)
+{
+	m68_text_char(text, kind);
+	m68_text_char(text, '0' + (reg & 7));
+}
+
+// MARK: - Effective Addresses
+
+static int m68_disassemble_immediate(struct m68_disassembly_stream *stream, struct m68_disassembly_text *text, char size)
+{
+	uint16_t word;
+	uint32_t value;
+
+	m68_text_char(text, '#');
+	switch (size) {
+		case 'b':
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			m68_text_hex(text, word & 0xFF, 2);
+			return 1;
+		case 'w':
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			m68_text_hex(text, word, 4);
+			return 1;
+		default:
+			if (!m68_disassembly_fetch_long(stream, &value)) return 0;
+			m68_text_hex(text, value, 8);
+			return 1;
+	}
+}
+
+static void m68_disassemble_index(struct m68_disassembly_text *text, uint16_t extension)
+{
+	m68_text_register(text, (extension & 0x8000) ? 'A' : 'D', extension >> 12);
+	m68_text_string(text, (extension & 0x0800) ? ".L" : ".W");
+
+	uint8_t scale = (extension >> 9) & 3;
+	if (scale) {
+		m68_text_char(text, '*');
+		m68_text_char(text, '0' + (1 << scale));
+	}
+}
+
+/* Disassemble a full format extension word (68020+), including the memory
+ * indirect forms. The base is either an address register or the PC. */
+static int m68_disassemble_full_extension(struct m68_disassembly_stream *stream, struct m68_disassembly_text *text, uint16_t extension, uint8_t reg, int pc_relative, uint32_t pc)
+{
+	int base_suppress = (extension >> 7) & 1;
+	int index_suppress = (extension >> 6) & 1;
+	uint8_t bd_size = (extension >> 4) & 3;
+	uint8_t iis = extension & 7;
+	int32_t bd = 0, od = 0;
+	uint16_t word;
+	uint32_t value;
+
+	if (bd_size == 2) {
+		if (!m68_disassembly_fetch(stream, &word)) return 0;
+		bd = (int16_t)word;
+	} else if (bd_size == 3) {
+		if (!m68_disassembly_fetch_long(stream, &value)) return 0;
+		bd = (int32_t)value;
+	}
+
+	uint8_t od_size = iis & 3;
+	if (od_size == 2) {
+		if (!m68_disassembly_fetch(stream, &word)) return 0;
+		od = (int16_t)word;
+	} else if (od_size == 3) {
+		if (!m68_disassembly_fetch_long(stream, &value)) return 0;
+		od = (int32_t)value;
+	}
+
+	int memory_indirect = (iis != 0);
+	int post_indexed = !index_suppress && (iis & 4);
+
+	m68_text_char(text, '(');
+	if (memory_indirect) {
+		m68_text_char(text, '[');
+	}
+
+	int need_comma = 0;
+	if (bd_size >= 2) {
+		if (pc_relative && !base_suppress) {
+			m68_text_hex(text, pc + bd, 8);
+		} else {
+			m68_text_displacement(text, bd);
+		}
+		need_comma = 1;
+	}
+	if (!base_suppress) {
+		if (need_comma) m68_text_char(text, ',');
+		if (pc_relative) {
+			m68_text_string(text, "PC");
+		} else {
+			m68_text_register(text, 'A', reg);
+		}
+		need_comma = 1;
+	}
+	if (!index_suppress && !post_indexed) {
+		if (need_comma) m68_text_char(text, ',');
+		m68_disassemble_index(text, extension);
+		need_comma = 1;
+	}
+
+	if (memory_indirect) {
+		m68_text_char(text, ']');
+		need_comma = 1;
+		if (post_indexed) {
+			m68_text_char(text, ',');
+			m68_disassemble_index(text, extension);
+		}
+		if (od_size >= 2) {
+			m68_text_char(text, ',');
+			m68_text_displacement(text, od);
+		}
+	}
+
+	m68_text_char(text, ')');
+	return 1;
+}
+
+/* Disassemble the effective address described by mode and reg, consuming any
+ * extension words that it requires. Returns 0 if the stream was exhausted. */
+static int m68_disassemble_ea(struct m68_disassembly_stream *stream, struct m68_disassembly_text *text, uint8_t mode, uint8_t reg, char size)
+{
+	uint16_t word;
+	uint32_t value;
+	uint32_t pc;
+
+	switch (mode & 7) {
+		case 0:
+			m68_text_register(text, 'D', reg);
+			return 1;
+		case 1:
+			m68_text_register(text, 'A', reg);
+			return 1;
+		case 2:
+			m68_text_char(text, '(');
+			m68_text_register(text, 'A', reg);
+			m68_text_char(text, ')');
+			return 1;
+		case 3:
+			m68_text_char(text, '(');
+			m68_text_register(text, 'A', reg);
+			m68_text_string(text, ")+");
+			return 1;
+		case 4:
+			m68_text_string(text, "-(");
+			m68_text_register(text, 'A', reg);
+			m68_text_char(text, ')');
+			return 1;
+		case 5:
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			m68_text_char(text, '(');
+			m68_text_displacement(text, (int16_t)word);
+			m68_text_char(text, ',');
+			m68_text_register(text, 'A', reg);
+			m68_text_char(text, ')');
+			return 1;
+		case 6:
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			if (word & 0x0100) {
+				return m68_disassemble_full_extension(stream, text, word, reg, 0, 0);
+			}
+			m68_text_char(text, '(');
+			m68_text_displacement(text, (int8_t)(word & 0xFF));
+			m68_text_char(text, ',');
+			m68_text_register(text, 'A', reg);
+			m68_text_char(text, ',');
+			m68_disassemble_index(text, word);
+			m68_text_char(text, ')');
+			return 1;
+	}
+
+	/* Mode 7 - the register field selects the addressing mode. */
+	switch (reg & 7) {
+		case 0:
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			m68_text_hex(text, word, 4);
+			m68_text_string(text, ".W");
+			return 1;
+		case 1:
+			if (!m68_disassembly_fetch_long(stream, &value)) return 0;
+			m68_text_hex(text, value, 8);
+			m68_text_string(text, ".L");
+			return 1;
+		case 2:
+			pc = stream->address;
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			m68_text_hex(text, pc + (int16_t)word, 8);
+			m68_text_string(text, "(PC)");
+			return 1;
+		case 3:
+			pc = stream->address;
+			if (!m68_disassembly_fetch(stream, &word)) return 0;
+			if (word & 0x0100) {
+				return m68_disassemble_full_extension(stream, text, word, 0, 1, pc);
+			}
+			m68_text_hex(text, pc + (int8_t)(word & 0xFF), 8);
+			m68_text_string(text, "(PC,");
+			m68_disassemble_index(text, word);
+			m68_text_char(text, ')');
+			return 1;
+		case 4:
+			return m68_disassemble_immediate(stream, text, size);
+		default:
+			m68_text_string(text, "???");
+			return 1;
+	}
+}
+
+// MARK: - Instruction Templates
+
+/* Expand an instruction template (see struct m68_instruction) into text,
+ * resolving each operand placeholder. Returns 0 if the stream was exhausted
+ * part way through the instruction. */
+static int m68_disassemble_template(struct m68_disassembly_stream *stream, struct m68_disassembly_text *text, const char *template, uint16_t opcode, uint32_t address)
+{
+	uint16_t word;
+	uint32_t value;
+
+	for (const char *c = template; *c; ++c) {
+		/* Copy the literal text up to the next placeholder in one go. */
+		char *ptr = text->ptr;
+		while (*c != '%' && *c && ptr < text->end) {
+			*ptr++ = *c++;
+		}
+		text->ptr = ptr;
+		if (*c != '%') {
+			break;
+		}
+
+		char kind = *++c;
+		if (kind == '\0') {
+			break;
+		}
+		char size = *++c;
+		if (size == '\0') {
+			break;
+		}
+
+		switch (kind) {
+			case 'e':
+				if (!m68_disassemble_ea(stream, text, (opcode >> 3) & 7, opcode & 7, size)) return 0;
+				break;
+			case 'E':
+				if (!m68_disassemble_ea(stream, text, (opcode >> 6) & 7, (opcode >> 9) & 7, size)) return 0;
+				break;
+			case 'i':
+				if (!m68_disassemble_immediate(stream, text, size)) return 0;
+				break;
+			case 'r':
+				/* Branch displacements are relative to the address of the
+				 * first extension word, i.e. the opcode address + 2. */
+				if (size == 'b') {
+					m68_text_hex(text, address + 2 + (int8_t)(opcode & 0xFF), 8);
+				} else if (size == 'w') {
+					if (!m68_disassembly_fetch(stream, &word)) return 0;
+					m68_text_hex(text, address + 2 + (int16_t)word, 8);
+				} else {
+					if (!m68_disassembly_fetch_long(stream, &value)) return 0;
+					m68_text_hex(text, address + 2 + value, 8);
+				}
+				break;
+			default:
+				m68_text_char(text, '%');
+				m68_text_char(text, kind);
+				m68_text_char(text, size);
+				break;
+		}
+	}
+	return 1;
+}
+
+// MARK: - Disassembly
+
+static size_t m68_disassemble_stream(struct m68_disassembly_stream *stream, struct m68_disassembly *out, size_t count)
+{
+	size_t n = 0;
+	uint16_t opcode;
+
+	while (n < count) {
+		struct m68_disassembly *entry = &out[n];
+		uint32_t address = stream->address;
+		if (!m68_disassembly_fetch(stream, &opcode)) {
+			break;
+		}
+
+		/* Start loading the table entries of the two words a little ahead,
+		 * which are guesses at the next opcodes. The table is too large to
+		 * stay in the cache, and data between the instructions looks up
+		 * entries all over it. This is done here rather than in a function
+		 * of its own, as the compiler would find that function has no effect
+		 * and drop the call. */
+		uint32_t ahead = stream->address - stream->window_start + M68_DISASSEMBLY_PREFETCH;
+		if (stream->window_end - stream->window_start >= ahead + 4) {
+			const uint8_t *ptr = stream->data + ahead;
+			__builtin_prefetch(&m68_instruction_table[m68_disassembly_word(stream, ptr)]);
+			__builtin_prefetch(&m68_instruction_table[m68_disassembly_word(stream, ptr + 2)]);
+		}
+
+		struct m68_disassembly_text text = { entry->text, entry->text + M68_DISASSEMBLY_TEXT_MAX - 1 };
+		struct m68_instruction *instruction = &m68_instruction_table[opcode];
+		if (instruction->mnemonic == NULL) {
+			instruction = NULL;
+		}
+
+		/* Most mnemonics have no placeholders and can be copied verbatim. */
+		size_t length = instruction ? strlen(instruction->mnemonic) : 0;
+		if (instruction && length < M68_DISASSEMBLY_TEXT_MAX && !memchr(instruction->mnemonic, '%', length)) {
+			memcpy(entry->text, instruction->mnemonic, length);
+			text.ptr = entry->text + length;
+		}
+		else if (instruction && !m68_disassemble_template(stream, &text, instruction->mnemonic, opcode, address)) {
+			/* The instruction runs off the end of the input, so only the
+			 * opcode word can be reported, as data. */
+			instruction = NULL;
+			stream->address = address + 2;
+			text.ptr = entry->text;
+		}
+
+		if (instruction == NULL) {
+			/* The text buffer always has room for this. */
+			char *ptr = entry->text;
+			ptr[0] = 'D'; ptr[1] = 'C'; ptr[2] = '.'; ptr[3] = 'W'; ptr[4] = ' '; ptr[5] = '$';
+			ptr[6] = m68_hex_digits[opcode >> 12];
+			ptr[7] = m68_hex_digits[(opcode >> 8) & 0xF];
+			ptr[8] = m68_hex_digits[(opcode >> 4) & 0xF];
+			ptr[9] = m68_hex_digits[opcode & 0xF];
+			text.ptr = ptr + 10;
+		}
+
+		*text.ptr = '\0';
+		entry->address = address;
+		entry->opcode = opcode;
+		entry->length = (uint16_t)(stream->address - address);
+		++n;
+	}
+
+	return n;
+}
+
+size_t m68_disassemble_buffer(const uint8_t *buffer, size_t length, uint32_t origin, struct m68_disassembly *out, size_t count)
+{
+	struct m68_disassembly_stream stream = {
+		.data = buffer,
+		.window_start = origin,
+		.window_end = origin + (uint32_t)length,
+		.address = origin,
+		.end = origin + (uint32_t)length,
+		.guest = 0,
+	};
+	return m68_disassemble_stream(&stream, out, count);
+}
+
+size_t m68_disassemble_range(uint32_t address, uint32_t length, struct m68_disassembly *out, size_t count)
+{
+	/* Start with an empty window so that the first fetch pulls in the page. */
+	struct m68_disassembly_stream stream = {
+		.data = NULL,
+		.window_start = address,
+		.window_end = address,
+		.address = address,
+		.end = address + length,
+		.guest = 1,
+	};
+	return m68_disassemble_stream(&stream, out, count);
+}
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if !defined(lib68_Disassembler)
+#define lib68_Disassembler
+
+#define M68_DISASSEMBLY_TEXT_MAX	96
+
+/* Disassembled Instruction
+ * A single decoded instruction. The text is always NUL terminated, and is
+ * truncated if the instruction would not fit. */
+struct m68_disassembly {
+	uint32_t address;
+	uint16_t opcode;
+	uint16_t length;
+	char text[M68_DISASSEMBLY_TEXT_MAX];
+};
+
+/* Disassemble the host buffer, treating the first byte as being located at
+ * the guest address origin. Up to count instructions are written to out.
+ * Returns the number of instructions written. Disassembly stops early if the
+ * buffer is exhausted; the next instruction to decode begins immediately after
+ * the last one returned. An instruction whose extension words run past the end
+ * of the input is reported as a DC.W of its opcode. No memory is allocated. */
+size_t m68_disassemble_buffer(const uint8_t *buffer, size_t length, uint32_t origin, struct m68_disassembly *out, size_t count);
+
+/* Disassemble length bytes of guest memory starting at address. Behaves as
+ * m68_disassemble_buffer. */
+size_t m68_disassemble_range(uint32_t address, uint32_t length, struct m68_disassembly *out, size_t count);
+
+#endif
@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/ea.h"
+
+// MARK: - Accessors
+
+/* A variant of each routine for an effective address and size, with the
+ * operands as constants. */
+#define M68_EA_SIZED(_MODE, _REG, _SIZE, _SUFFIX)						\
+	static uint32_t m68_ea_address_##_MODE##_##_REG##_SUFFIX(uint32_t *next)		\
+	{											\
+		return m68_ea_address(_MODE, _REG, _SIZE, next);				\
+	}											\
+	static uint32_t m68_ea_read_##_MODE##_##_REG##_SUFFIX(uint32_t *next)			\
+	{											\
+		return m68_ea_read(_MODE, _REG, _SIZE, next);					\
+	}											\
+	static void m68_ea_write_##_MODE##_##_REG##_SUFFIX(uint32_t *next, uint32_t value)	\
+	{											\
+		m68_ea_write(_MODE, _REG, _SIZE, next, value);					\
+	}
+
+#define M68_EA_VARIANTS(_MODE, _REG)					\
+	M68_EA_SIZED(_MODE, _REG, M68_EA_BYTE, _b)			\
+	M68_EA_SIZED(_MODE, _REG, M68_EA_WORD, _w)			\
+	M68_EA_SIZED(_MODE, _REG, M68_EA_LONG, _l)
+
+#define M68_EA_MODE_VARIANTS(_MODE)					\
+	M68_EA_VARIANTS(_MODE, 0) M68_EA_VARIANTS(_MODE, 1)		\
+	M68_EA_VARIANTS(_MODE, 2) M68_EA_VARIANTS(_MODE, 3)		\
+	M68_EA_VARIANTS(_MODE, 4) M68_EA_VARIANTS(_MODE, 5)		\
+	M68_EA_VARIANTS(_MODE, 6) M68_EA_VARIANTS(_MODE, 7)
+
+M68_EA_MODE_VARIANTS(0)
+M68_EA_MODE_VARIANTS(1)
+M68_EA_MODE_VARIANTS(2)
+M68_EA_MODE_VARIANTS(3)
+M68_EA_MODE_VARIANTS(4)
+M68_EA_MODE_VARIANTS(5)
+M68_EA_MODE_VARIANTS(6)
+M68_EA_VARIANTS(7, 0)
+M68_EA_VARIANTS(7, 1)
+M68_EA_VARIANTS(7, 2)
+M68_EA_VARIANTS(7, 3)
+M68_EA_VARIANTS(7, 4)
+
+// MARK: - Table
+
+#define M68_EA_ENTRY(_MODE, _REG)							\
+	[(_MODE << 3) | _REG] = {							\
+		{ m68_ea_address_##_MODE##_##_REG##_b, m68_ea_address_##_MODE##_##_REG##_w,	\
+			m68_ea_address_##_MODE##_##_REG##_l },				\
+		{ m68_ea_read_##_MODE##_##_REG##_b, m68_ea_read_##_MODE##_##_REG##_w,		\
+			m68_ea_read_##_MODE##_##_REG##_l },				\
+		{ m68_ea_write_##_MODE##_##_REG##_b, m68_ea_write_##_MODE##_##_REG##_w,	\
+			m68_ea_write_##_MODE##_##_REG##_l },				\
+	}
+
+#define M68_EA_MODE_ENTRIES(_MODE)					\
+	M68_EA_ENTRY(_MODE, 0), M68_EA_ENTRY(_MODE, 1),			\
+	M68_EA_ENTRY(_MODE, 2), M68_EA_ENTRY(_MODE, 3),			\
+	M68_EA_ENTRY(_MODE, 4), M68_EA_ENTRY(_MODE, 5),			\
+	M68_EA_ENTRY(_MODE, 6), M68_EA_ENTRY(_MODE, 7)
+
+const struct m68_ea_accessors m68_ea_table[64] = {
+	M68_EA_MODE_ENTRIES(0),
+	M68_EA_MODE_ENTRIES(1),
+	M68_EA_MODE_ENTRIES(2),
+	M68_EA_MODE_ENTRIES(3),
+	M68_EA_MODE_ENTRIES(4),
+	M68_EA_MODE_ENTRIES(5),
+	M68_EA_MODE_ENTRIES(6),
+	M68_EA_ENTRY(7, 0),
+	M68_EA_ENTRY(7, 1),
+	M68_EA_ENTRY(7, 2),
+	M68_EA_ENTRY(7, 3),
+	M68_EA_ENTRY(7, 4),
+};
@@ -0,0 +1,261 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+
+#if !defined(lib68_EffectiveAddress)
+#define lib68_EffectiveAddress
+
+/* Effective Addresses
+ * An effective address is given by a 3-bit mode and a 3-bit register, as
+ * decoded by the EA_MODE and EA_REG (or DEST_EA_MODE and DEST_EA_REG) macros
+ * of a form in cpu/instruction_forms.h. Mode 7 picks one of the absolute,
+ * PC relative and immediate modes with the register.
+ *
+ * Handlers get at an operand through the inline functions below, with the
+ * mode, register and size as constants where they are specialised, so that
+ * the switch on the mode folds away. Where they are not, m68_ea_table holds
+ * a variant of each routine for every mode, register and size, so that
+ * getting at the operand is a single indirect call.
+ *
+ * Extension words are read from next, which starts just past the opcode and
+ * is advanced past each word used, so that the handler can set the PC to it
+ * once every operand has been decoded. The 68000 and 68010 only have the
+ * brief extension word, and ignore its scale. The 68020 and later add the
+ * scale and the full extension word, with base and outer displacements and
+ * memory indirection. Reserved encodings of the full extension word are taken
+ * to have a null displacement and no indirection.
+ *
+ * Byte accesses through A7 adjust it by 2 in the post-increment and
+ * pre-decrement modes, to keep the stack pointer aligned. */
+enum m68_ea_mode {
+	M68_EA_DN = 0,
+	M68_EA_AN = 1,
+	M68_EA_IND = 2,
+	M68_EA_POST = 3,
+	M68_EA_PRE = 4,
+	M68_EA_DISP = 5,
+	M68_EA_INDEX = 6,
+	M68_EA_OTHER = 7,
+};
+
+/* Registers of mode 7. */
+enum m68_ea_other {
+	M68_EA_ABSW = 0,
+	M68_EA_ABSL = 1,
+	M68_EA_PCDISP = 2,
+	M68_EA_PCINDEX = 3,
+	M68_EA_IMM = 4,
+};
+
+enum m68_ea_size {
+	M68_EA_BYTE = 1,
+	M68_EA_WORD = 2,
+	M68_EA_LONG = 4,
+};
+
+/* Extension word fields. */
+#define M68_EA_EXT_FULL		(1u << 8)
+#define M68_EA_EXT_BS		(1u << 7)	/* Base Suppress */
+#define M68_EA_EXT_IS		(1u << 6)	/* Index Suppress */
+
+// MARK: - Extension Words
+
+static inline uint16_t m68_ea_fetch_word(uint32_t *next)
+{
+	uint16_t value = m68_mmu_read_word(*next);
+	*next += 2;
+	return value;
+}
+
+static inline uint32_t m68_ea_fetch_long(uint32_t *next)
+{
+	uint32_t value = m68_mmu_read_long(*next);
+	*next += 4;
+	return value;
+}
+
+/* A base or outer displacement of the size in bits 1-0 of the field. */
+static inline uint32_t m68_ea_fetch_displacement(uint8_t size, uint32_t *next)
+{
+	switch (size & 3) {
+		case 2: return (uint32_t)(int16_t)m68_ea_fetch_word(next);
+		case 3: return m68_ea_fetch_long(next);
+		default: return 0;
+	}
+}
+
+/* The index register of an extension word, sign extended and scaled. */
+static inline uint32_t m68_ea_index_value(uint16_t extension)
+{
+	uint32_t index = CPU68.R[extension >> 12].value;
+	if (!(extension & 0x0800)) {
+		index = (uint32_t)(int16_t)index;
+	}
+	return index << ((extension >> 9) & 3);
+}
+
+/* The address given by a base register and the extension words at next, for
+ * the indexed modes. */
+static inline uint32_t m68_ea_indexed(uint32_t base, uint32_t *next)
+{
+	uint16_t extension = m68_ea_fetch_word(next);
+	if (CPU68.model < M68_MODEL_68020) {
+		extension &= ~(M68_EA_EXT_FULL | 0x0600);
+	}
+	if (!(extension & M68_EA_EXT_FULL)) {
+		return base + m68_ea_index_value(extension) + (uint32_t)(int8_t)extension;
+	}
+
+	if (extension & M68_EA_EXT_BS) {
+		base = 0;
+	}
+	uint32_t index = (extension & M68_EA_EXT_IS) ? 0 : m68_ea_index_value(extension);
+	base += m68_ea_fetch_displacement(extension >> 4, next);
+
+	uint8_t indirect = extension & 7;
+	if (indirect == 0 || ((extension & M68_EA_EXT_IS) && indirect > 3) || indirect == 4) {
+		return base + index;
+	}
+	if (indirect < 4) {
+		base = m68_mmu_read_long(base + index);
+		index = 0;
+	} else {
+		base = m68_mmu_read_long(base);
+	}
+	return base + index + m68_ea_fetch_displacement(indirect, next);
+}
+
+// MARK: - Operand Access
+
+/* The address of a memory operand, carrying out any increment or decrement of
+ * the address register. Immediate data is addressed in the instruction
+ * stream. Returns 0 for the register modes. */
+static inline uint32_t m68_ea_address(uint8_t mode, uint8_t reg, uint8_t size, uint32_t *next)
+{
+	uint32_t step = (reg == 7 && size == M68_EA_BYTE) ? 2 : size;
+	uint32_t address;
+
+	switch (mode) {
+		case M68_EA_IND:
+			return CPU68.A[reg].value;
+		case M68_EA_POST:
+			address = CPU68.A[reg].value;
+			CPU68.A[reg].value += step;
+			return address;
+		case M68_EA_PRE:
+			return CPU68.A[reg].value -= step;
+		case M68_EA_DISP:
+			return CPU68.A[reg].value + (uint32_t)(int16_t)m68_ea_fetch_word(next);
+		case M68_EA_INDEX:
+			return m68_ea_indexed(CPU68.A[reg].value, next);
+		case M68_EA_OTHER:
+			switch (reg) {
+				case M68_EA_ABSW:
+					return (uint32_t)(int16_t)m68_ea_fetch_word(next);
+				case M68_EA_ABSL:
+					return m68_ea_fetch_long(next);
+				case M68_EA_PCDISP:
+					address = *next;
+					return address + (uint32_t)(int16_t)m68_ea_fetch_word(next);
+				case M68_EA_PCINDEX:
+					return m68_ea_indexed(*next, next);
+				case M68_EA_IMM:
+					address = *next + (size == M68_EA_BYTE);
+					*next += (size == M68_EA_LONG) ? 4 : 2;
+					return address;
+				default:
+					return 0;
+			}
+		default:
+			return 0;
+	}
+}
+
+/* Read an operand from the address given by m68_ea_address(), or from its
+ * register. Bytes and words are zero extended. */
+static inline uint32_t m68_ea_load(uint8_t mode, uint8_t reg, uint8_t size, uint32_t address)
+{
+	if (mode == M68_EA_DN || mode == M68_EA_AN) {
+		uint32_t value = (mode == M68_EA_DN ? CPU68.D[reg] : CPU68.A[reg]).value;
+		return size == M68_EA_LONG ? value : value & ((1u << (size * 8)) - 1);
+	}
+	switch (size) {
+		case M68_EA_BYTE: return m68_mmu_read_byte(address);
+		case M68_EA_WORD: return m68_mmu_read_word(address);
+		default: return m68_mmu_read_long(address);
+	}
+}
+
+/* Write an operand to the address given by m68_ea_address(), or to its
+ * register. Only the low bits of a data register are written, and words
+ * written to an address register are sign extended. */
+static inline void m68_ea_store(uint8_t mode, uint8_t reg, uint8_t size, uint32_t address, uint32_t value)
+{
+	if (mode == M68_EA_DN) {
+		switch (size) {
+			case M68_EA_BYTE: CPU68.D[reg].byte[0] = (uint8_t)value; break;
+			case M68_EA_WORD: CPU68.D[reg].word[0] = (uint16_t)value; break;
+			default: CPU68.D[reg].value = value; break;
+		}
+		return;
+	}
+	if (mode == M68_EA_AN) {
+		CPU68.A[reg].value = size == M68_EA_WORD ? (uint32_t)(int16_t)value : value;
+		return;
+	}
+	switch (size) {
+		case M68_EA_BYTE: m68_mmu_write_byte(address, (uint8_t)value); break;
+		case M68_EA_WORD: m68_mmu_write_word(address, (uint16_t)value); break;
+		default: m68_mmu_write_long(address, value); break;
+	}
+}
+
+static inline uint32_t m68_ea_read(uint8_t mode, uint8_t reg, uint8_t size, uint32_t *next)
+{
+	return m68_ea_load(mode, reg, size, m68_ea_address(mode, reg, size, next));
+}
+
+static inline void m68_ea_write(uint8_t mode, uint8_t reg, uint8_t size, uint32_t *next, uint32_t value)
+{
+	m68_ea_store(mode, reg, size, m68_ea_address(mode, reg, size, next), value);
+}
+
+// MARK: - Accessor Table
+
+/* The routines for an effective address, indexed by size: byte, word and
+ * long. The entries for the unused registers of mode 7 are NULL. */
+struct m68_ea_accessors {
+	uint32_t (*address[3])(uint32_t *next);
+	uint32_t (*read[3])(uint32_t *next);
+	void (*write[3])(uint32_t *next, uint32_t value);
+};
+
+/* The index into the routines for a size. */
+#define M68_EA_SIZE_INDEX(_SIZE)	((_SIZE) >> 1)
+
+/* Indexed by the 6-bit effective address field, mode in bits 5-3. */
+extern const struct m68_ea_accessors m68_ea_table[64];
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/pmmu.h"
+
+// MARK: - Fault Recording
+
+static void m68_exception_record_fault(uint8_t vector, uint32_t address, int write, int instruction)
+{
+	/* Only the first fault of an instruction is reported. */
+	if (CPU68.fault.vector) {
+		return;
+	}
+	CPU68.fault.vector = vector;
+	CPU68.fault.address = address;
+	CPU68.fault.write = (uint8_t)write;
+	CPU68.fault.instruction = (uint8_t)instruction;
+}
+
+void m68_exception_address_error(uint32_t address, int write, int instruction)
+{
+	m68_exception_record_fault(M68_VECTOR_ADDRESS_ERROR, address, write, instruction);
+}
+
+void m68_exception_bus_error(uint32_t address, int write, int instruction)
+{
+	m68_exception_record_fault(M68_VECTOR_BUS_ERROR, address, write, instruction);
+}
+
+// MARK: - Stack Frames
+
+static inline void m68_exception_push_word(uint16_t value)
+{
+	CPU68.A[7].value -= 2;
+	m68_mmu_write_word(CPU68.A[7].value, value);
+}
+
+static inline void m68_exception_push_long(uint32_t value)
+{
+	CPU68.A[7].value -= 4;
+	m68_mmu_write_long(CPU68.A[7].value, value);
+}
+
+/* Switch to supervisor mode, swapping in the supervisor stack if needed.
+ * Returns the status register as it was before the switch. */
+static uint16_t m68_exception_enter_supervisor(void)
+{
+	uint16_t sr = CPU68.CCR.value;
+	if (!CPU68.CCR.bitmask.mask.S) {
+		CPU68.USP.value = CPU68.A[7].value;
+		CPU68.A[7].value = CPU68.SSP.value;
+		CPU68.CCR.bitmask.mask.S = 1;
+		m68_pmmu_supervisor_changed();
+	}
+	CPU68.CCR.bitmask.mask.TE = 0;
+	return sr;
+}
+
+static void m68_exception_jump(uint8_t vector)
+{
+	/* The 68000 has no VBR, but it is never changed from zero on one. */
+	CPU68.PC.value = m68_mmu_read_long(CPU68.VBR.value + vector * 4);
+}
+
+// MARK: - Exception Processing
+
+void m68_exception_process(uint8_t vector, uint32_t return_address)
+{
+	uint16_t sr = m68_exception_enter_supervisor();
+
+	if (CPU68.model >= M68_MODEL_68010) {
+		/* Format $0 - Four word stack frame */
+		m68_exception_push_word(vector * 4);
+	}
+	m68_exception_push_long(return_address);
+	m68_exception_push_word(sr);
+
+	m68_exception_jump(vector);
+}
+
+int m68_exception_process_fault(void)
+{
+	struct m68_fault fault = CPU68.fault;
+	if (fault.vector == 0) {
+		return 0;
+	}
+	CPU68.fault.vector = 0;
+
+	uint32_t pc = CPU68.PC.value;
+	uint16_t opcode = m68_mmu_read_word(pc & ~1);
+	uint16_t sr = m68_exception_enter_supervisor();
+
+	/* Function code of the faulting access, from the mode it was made in. */
+	uint16_t fc = ((sr & 0x2000) ? 4 : 0) | (fault.instruction ? 2 : 1);
+
+	if (CPU68.model <= M68_MODEL_68000) {
+		/* Group 0 frame - PC, SR, instruction register, access address, and
+		 * the R/W, I/N and function code of the access. */
+		m68_exception_push_long(pc);
+		m68_exception_push_word(sr);
+		m68_exception_push_word(opcode);
+		m68_exception_push_long(fault.address);
+		m68_exception_push_word((fault.write ? 0 : 0x10) | (fault.instruction ? 0 : 0x08) | fc);
+	} else if (CPU68.model == M68_MODEL_68010) {
+		/* Format $8 - 29 word bus fault frame. Only the fault address and
+		 * special status word are meaningful here. */
+		for (int i = 0; i < 16; ++i) {
+			m68_exception_push_word(0);
+		}
+		m68_exception_push_word(opcode);
+		for (int i = 0; i < 5; ++i) {
+			m68_exception_push_word(0);
+		}
+		m68_exception_push_long(fault.address);
+		m68_exception_push_word((fault.write ? 0 : 0x0100) | fc);
+		m68_exception_push_word(0x8000 | (fault.vector * 4));
+		m68_exception_push_long(pc);
+		m68_exception_push_word(sr);
+	} else if (CPU68.model <= M68_MODEL_68030) {
+		/* Format $A - Short bus cycle fault frame. */
+		m68_exception_push_long(0);
+		m68_exception_push_long(0);
+		m68_exception_push_long(0);
+		m68_exception_push_long(fault.address);
+		m68_exception_push_word(0);
+		m68_exception_push_word(opcode);
+		m68_exception_push_word((fault.instruction ? 0 : 0x0100) | (fault.write ? 0 : 0x0040) | fc);
+		m68_exception_push_word(0);
+		m68_exception_push_word(0xA000 | (fault.vector * 4));
+		m68_exception_push_long(pc);
+		m68_exception_push_word(sr);
+	} else if (fault.vector == M68_VECTOR_BUS_ERROR) {
+		/* Format $7 - 30 word access error frame. The write-backs and push
+		 * data are left empty, as nothing is buffered. */
+		for (int i = 0; i < 9; ++i) {
+			m68_exception_push_long(0);
+		}
+		m68_exception_push_long(fault.address);
+		m68_exception_push_word(0);
+		m68_exception_push_word(0);
+		m68_exception_push_word(0);
+		m68_exception_push_word((fault.write ? 0 : 0x0100) | fc);
+		m68_exception_push_long(0);
+		m68_exception_push_word(0x7000 | (fault.vector * 4));
+		m68_exception_push_long(pc);
+		m68_exception_push_word(sr);
+	} else {
+		/* Format $2 - Six word frame, with the faulting address. */
+		m68_exception_push_long(fault.address);
+		m68_exception_push_word(0x2000 | (fault.vector * 4));
+		m68_exception_push_long(pc);
+		m68_exception_push_word(sr);
+	}
+
+	m68_exception_jump(fault.vector);
+	return 1;
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+
+#if !defined(lib68_Exception)
+#define lib68_Exception
+
+/* Exception Vectors */
+enum m68_exception_vector {
+	M68_VECTOR_RESET_SSP = 0,
+	M68_VECTOR_RESET_PC = 1,
+	M68_VECTOR_BUS_ERROR = 2,
+	M68_VECTOR_ADDRESS_ERROR = 3,
+	M68_VECTOR_ILLEGAL_INSTRUCTION = 4,
+	M68_VECTOR_ZERO_DIVIDE = 5,
+	M68_VECTOR_CHK = 6,
+	M68_VECTOR_TRAPV = 7,
+	M68_VECTOR_PRIVILEGE_VIOLATION = 8,
+	M68_VECTOR_TRACE = 9,
+	M68_VECTOR_LINE_1010 = 10,
+	M68_VECTOR_LINE_1111 = 11,
+	M68_VECTOR_FORMAT_ERROR = 14,
+	M68_VECTOR_UNINITIALISED_INTERRUPT = 15,
+	M68_VECTOR_SPURIOUS_INTERRUPT = 24,
+	M68_VECTOR_TRAP_0 = 32,
+	M68_VECTOR_MMU_CONFIGURATION_ERROR = 56,
+};
+
+/* Record an address error for the access to the specified address. The
+ * exception is taken by m68_exception_process_fault() once the current
+ * instruction has finished. */
+void m68_exception_address_error(uint32_t address, int write, int instruction);
+
+/* Record a bus error for the access to the specified address. */
+void m68_exception_bus_error(uint32_t address, int write, int instruction);
+
+/* Take the exception for the pending fault, if there is one. The PC is
+ * expected to still hold the address of the faulting instruction.
+ * Returns 1 if an exception was taken. */
+int m68_exception_process_fault(void);
+
+/* Take the specified exception, stacking a normal four word (or on the 68000
+ * two word) frame with the specified return address, and jumping to the
+ * handler in the vector table. */
+void m68_exception_process(uint8_t vector, uint32_t return_address);
+
+#endif
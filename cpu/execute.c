@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/cache.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/idle.h"
+#include "cpu/scheduler.h"
+
+/* Approximate 68000 timings for exceptions raised by the run loop itself. */
+#define M68_EXECUTE_ILLEGAL_CYCLES	34
+#define M68_EXECUTE_FAULT_CYCLES	50
+
+// MARK: - Single Instruction
+
+/* Fused instructions are only run if fuse is set, so that a step is always a
+ * single instruction. */
+static inline void m68_execute_instruction(int fuse)
+{
+	uint32_t pc = CPU68.PC.value;
+
+	if (__builtin_expect(pc & 1, 0)) {
+		m68_exception_address_error(pc, 0, 1);
+		m68_exception_process_fault();
+		CPU68.cycles += M68_EXECUTE_FAULT_CYCLES;
+		return;
+	}
+
+	/* A breakpoint stops the run loop before the instruction. */
+	uint16_t opcode;
+	const struct m68_instruction *instruction = m68_cache_decode(pc, &opcode, fuse);
+	if (__builtin_expect(instruction == NULL, 0)) {
+		m68_yield();
+		return;
+	}
+
+	if (__builtin_expect(instruction->imp == NULL, 0)) {
+		uint8_t vector = (opcode >> 12) == 0xF ? M68_VECTOR_LINE_1111 : M68_VECTOR_ILLEGAL_INSTRUCTION;
+		m68_exception_process(vector, pc);
+		CPU68.cycles += M68_EXECUTE_ILLEGAL_CYCLES;
+		return;
+	}
+
+	instruction->imp();
+	CPU68.cycles += instruction->cycles;
+
+	/* Faults are taken with the PC back on the instruction that caused them. */
+	if (__builtin_expect(CPU68.fault.vector != 0, 0)) {
+		CPU68.PC.value = pc + CPU68.fault.offset;
+		CPU68.fault.offset = 0;
+		m68_exception_process_fault();
+		CPU68.cycles += M68_EXECUTE_FAULT_CYCLES;
+	}
+}
+
+void m68_step(void)
+{
+	m68_execute_instruction(0);
+}
+
+// MARK: - Run Loop
+
+static int m68_execute_yielded = 0;
+
+uint64_t m68_run(uint64_t cycles)
+{
+	uint64_t start = CPU68.cycles;
+	uint64_t end = start + cycles;
+	int idle = m68_idle_configuration().enabled;
+	m68_execute_yielded = 0;
+
+	/* Instructions are executed in slices that end on the next event, so
+	 * nothing but the cycle count is checked between instructions. */
+	m68_scheduler_dispatch();
+	while (CPU68.cycles < end && !m68_execute_yielded) {
+		uint64_t next = m68_scheduler_next();
+		CPU68.deadline = next < end ? next : end;
+
+		while (CPU68.cycles < CPU68.deadline) {
+			uint32_t pc = CPU68.PC.value;
+			m68_execute_instruction(1);
+			if (idle && CPU68.PC.value <= pc) {
+				m68_idle_backward_branch(pc, CPU68.PC.value);
+			}
+		}
+
+		m68_scheduler_dispatch();
+	}
+
+	return CPU68.cycles - start;
+}
+
+void m68_yield(void)
+{
+	m68_execute_yielded = 1;
+	CPU68.deadline = CPU68.cycles;
+}
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_Execute)
+#define lib68_Execute
+
+/* Execute the instruction at the PC, taking any exception it raises. */
+void m68_step(void);
+
+/* Execute instructions until at least the specified number of cycles have
+ * elapsed, or m68_yield() is called, firing scheduled events as they fall
+ * due. The last instruction before an event may overrun it. If the idle loop
+ * detector finds the guest spinning, the cycles up to the next event are
+ * skipped rather than executed, so the caller should pace calls to
+ * real time rather than expecting each to take a fixed amount of host time.
+ * Returns the number of cycles that elapsed. */
+uint64_t m68_run(uint64_t cycles);
+
+/* Return from m68_run() once the current instruction has finished. */
+void m68_yield(void);
+
+#endif
@@ -0,0 +1,582 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/float80.h"
+
+typedef unsigned __int128 m68_uint128_t;
+
+enum m68_float80_class {
+	M68_FLOAT80_CLASS_ZERO,
+	M68_FLOAT80_CLASS_NORMAL,
+	M68_FLOAT80_CLASS_INF,
+	M68_FLOAT80_CLASS_NAN,
+};
+
+/* An unpacked value. Normal values (including denormals, which are
+ * normalised here) are m * 2^(e - 63), with bit 63 of m set. */
+struct m68_float80_parts {
+	enum m68_float80_class cls;
+	int sign;
+	int32_t e;
+	uint64_t m;
+};
+
+/* The 68881 allows a zero biased exponent with the integer bit set, so the
+ * smallest exponent is one lower than it is for IEEE formats. */
+#define M68_FLOAT80_EMIN	(-M68_FLOAT80_BIAS)
+#define M68_FLOAT80_EMAX	(M68_FLOAT80_BIAS)
+
+#define M68_FLOAT80_QUIET	(1ULL << 62)
+
+static const int m68_float80_precision_bits[] = { 64, 24, 53, 64 };
+
+// MARK: - Packing
+
+static inline int m68_float80_clz128(m68_uint128_t v)
+{
+	uint64_t hi = (uint64_t)(v >> 64);
+	return hi ? __builtin_clzll(hi) : 64 + __builtin_clzll((uint64_t)v);
+}
+
+static struct m68_float80_parts m68_float80_unpack(m68_float80_t a)
+{
+	struct m68_float80_parts p = { .sign = a.exponent >> 15, .m = a.mantissa };
+	uint32_t exponent = a.exponent & 0x7FFF;
+
+	if (exponent == M68_FLOAT80_EXPONENT_MAX) {
+		p.cls = (a.mantissa << 1) ? M68_FLOAT80_CLASS_NAN : M68_FLOAT80_CLASS_INF;
+	} else if (a.mantissa == 0) {
+		p.cls = M68_FLOAT80_CLASS_ZERO;
+	} else {
+		int shift = __builtin_clzll(a.mantissa);
+		p.cls = M68_FLOAT80_CLASS_NORMAL;
+		p.m = a.mantissa << shift;
+		p.e = (int32_t)exponent - M68_FLOAT80_BIAS - shift;
+	}
+	return p;
+}
+
+static inline m68_float80_t m68_float80_make(int sign, uint16_t exponent, uint64_t mantissa)
+{
+	return (m68_float80_t){ .mantissa = mantissa, .exponent = (uint16_t)((sign << 15) | exponent) };
+}
+
+static inline m68_float80_t m68_float80_zero(int sign)
+{
+	return m68_float80_make(sign, 0, 0);
+}
+
+static inline m68_float80_t m68_float80_inf(int sign)
+{
+	return m68_float80_make(sign, M68_FLOAT80_EXPONENT_MAX, 0);
+}
+
+m68_float80_t m68_float80_nan(void)
+{
+	return m68_float80_make(0, M68_FLOAT80_EXPONENT_MAX, UINT64_MAX);
+}
+
+/* Round m to p significant bits, for a format with the specified exponent
+ * range. m must be normalised (bit 127 set) and represent m * 2^(e - 127).
+ * Values below the normal range are denormalised first. Returns 0, or 1 if
+ * the result overflowed to infinity. */
+static int m68_float80_round_bits(int sign, int32_t *e, m68_uint128_t *m, int p,
+	int32_t emin, int32_t emax, struct m68_float80_env *env)
+{
+	m68_uint128_t v = *m;
+	int32_t exponent = *e;
+	int tiny = 0;
+
+	if (exponent < emin) {
+		uint32_t shift = (uint32_t)(emin - exponent);
+		m68_uint128_t lost = shift >= 128 ? v : v & (((m68_uint128_t)1 << shift) - 1);
+		v = (shift >= 128 ? 0 : v >> shift) | (lost != 0);
+		exponent = emin;
+		tiny = 1;
+	}
+
+	int drop = 128 - p;
+	m68_uint128_t mask = ((m68_uint128_t)1 << drop) - 1;
+	m68_uint128_t half = (m68_uint128_t)1 << (drop - 1);
+	m68_uint128_t rest = v & mask;
+	int increment = 0;
+
+	switch (env->rounding) {
+		case M68_ROUND_NEAREST:
+			increment = rest > half || (rest == half && ((v >> drop) & 1));
+			break;
+		case M68_ROUND_ZERO:
+			break;
+		case M68_ROUND_MINUS:
+			increment = sign && rest;
+			break;
+		case M68_ROUND_PLUS:
+			increment = !sign && rest;
+			break;
+	}
+
+	if (rest) {
+		env->exceptions |= M68_FLOAT80_INEX2 | (tiny ? M68_FLOAT80_UNFL : 0);
+	}
+	v &= ~mask;
+	if (increment) {
+		v += (m68_uint128_t)1 << drop;
+		if (v == 0) {
+			v = (m68_uint128_t)1 << 127;
+			++exponent;
+		}
+	}
+
+	if (exponent > emax) {
+		env->exceptions |= M68_FLOAT80_OVFL | M68_FLOAT80_INEX2;
+		int to_infinity = env->rounding == M68_ROUND_NEAREST
+			|| (env->rounding == M68_ROUND_MINUS && sign)
+			|| (env->rounding == M68_ROUND_PLUS && !sign);
+		if (to_infinity) {
+			return 1;
+		}
+		exponent = emax;
+		v = ~mask;
+	}
+
+	*m = v;
+	*e = exponent;
+	return 0;
+}
+
+/* Normalise, round and pack m * 2^(e - 127) into extended precision, rounding
+ * to the precision given by the environment. */
+static m68_float80_t m68_float80_pack(int sign, int32_t e, m68_uint128_t m, struct m68_float80_env *env)
+{
+	if (m == 0) {
+		return m68_float80_zero(sign);
+	}
+	int shift = m68_float80_clz128(m);
+	m <<= shift;
+	e -= shift;
+
+	int p = m68_float80_precision_bits[env->precision & 3];
+	if (m68_float80_round_bits(sign, &e, &m, p, M68_FLOAT80_EMIN, M68_FLOAT80_EMAX, env)) {
+		return m68_float80_inf(sign);
+	}
+	return m68_float80_make(sign, (uint16_t)(e + M68_FLOAT80_BIAS), (uint64_t)(m >> 64));
+}
+
+static inline m68_float80_t m68_float80_pack_parts(const struct m68_float80_parts *p, struct m68_float80_env *env)
+{
+	return m68_float80_pack(p->sign, p->e, (m68_uint128_t)p->m << 64, env);
+}
+
+// MARK: - NaN Handling
+
+/* The result of an operation on a NaN is the first NaN operand, made quiet.
+ * A signalling NaN raises SNAN. */
+static m68_float80_t m68_float80_propagate(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env)
+{
+	m68_float80_t nan = m68_float80_is_nan(a) ? a : b;
+	if ((m68_float80_is_nan(a) && !(a.mantissa & M68_FLOAT80_QUIET))
+		|| (m68_float80_is_nan(b) && !(b.mantissa & M68_FLOAT80_QUIET))) {
+		env->exceptions |= M68_FLOAT80_SNAN;
+	}
+	nan.mantissa |= M68_FLOAT80_QUIET;
+	return nan;
+}
+
+static inline m68_float80_t m68_float80_invalid(struct m68_float80_env *env)
+{
+	env->exceptions |= M68_FLOAT80_OPERR;
+	return m68_float80_nan();
+}
+
+// MARK: - Arithmetic
+
+static m68_float80_t m68_float80_add_parts(struct m68_float80_parts a, struct m68_float80_parts b,
+	m68_float80_t x, m68_float80_t y, struct m68_float80_env *env)
+{
+	if (a.cls == M68_FLOAT80_CLASS_NAN || b.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(x, y, env);
+	}
+	if (a.cls == M68_FLOAT80_CLASS_INF) {
+		if (b.cls == M68_FLOAT80_CLASS_INF && a.sign != b.sign) {
+			return m68_float80_invalid(env);
+		}
+		return m68_float80_inf(a.sign);
+	}
+	if (b.cls == M68_FLOAT80_CLASS_INF) {
+		return m68_float80_inf(b.sign);
+	}
+	if (a.cls == M68_FLOAT80_CLASS_ZERO && b.cls == M68_FLOAT80_CLASS_ZERO) {
+		int sign = a.sign == b.sign ? a.sign : env->rounding == M68_ROUND_MINUS;
+		return m68_float80_zero(sign);
+	}
+	if (a.cls == M68_FLOAT80_CLASS_ZERO) {
+		return m68_float80_pack_parts(&b, env);
+	}
+	if (b.cls == M68_FLOAT80_CLASS_ZERO) {
+		return m68_float80_pack_parts(&a, env);
+	}
+
+	/* Line the smaller operand up with the larger one, keeping 63 bits below
+	 * the mantissa and folding anything shifted out of those into the lowest
+	 * bit, which is enough to round correctly. */
+	if (a.e < b.e || (a.e == b.e && a.m < b.m)) {
+		struct m68_float80_parts t = a;
+		a = b;
+		b = t;
+	}
+	m68_uint128_t ma = (m68_uint128_t)a.m << 63;
+	m68_uint128_t mb = (m68_uint128_t)b.m << 63;
+	uint32_t shift = (uint32_t)(a.e - b.e);
+	if (shift >= 127) {
+		mb = 1;
+	} else if (shift) {
+		mb = (mb >> shift) | ((mb & (((m68_uint128_t)1 << shift) - 1)) != 0);
+	}
+
+	if (a.sign == b.sign) {
+		return m68_float80_pack(a.sign, a.e + 1, ma + mb, env);
+	}
+	m68_uint128_t difference = ma - mb;
+	if (difference == 0) {
+		return m68_float80_zero(env->rounding == M68_ROUND_MINUS);
+	}
+	return m68_float80_pack(a.sign, a.e + 1, difference, env);
+}
+
+m68_float80_t m68_float80_add(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env)
+{
+	return m68_float80_add_parts(m68_float80_unpack(a), m68_float80_unpack(b), a, b, env);
+}
+
+m68_float80_t m68_float80_sub(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pb = m68_float80_unpack(b);
+	pb.sign ^= 1;
+	return m68_float80_add_parts(m68_float80_unpack(a), pb, a, b, env);
+}
+
+m68_float80_t m68_float80_mul(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a), pb = m68_float80_unpack(b);
+	int sign = pa.sign ^ pb.sign;
+
+	if (pa.cls == M68_FLOAT80_CLASS_NAN || pb.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(a, b, env);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_INF || pb.cls == M68_FLOAT80_CLASS_INF) {
+		if (pa.cls == M68_FLOAT80_CLASS_ZERO || pb.cls == M68_FLOAT80_CLASS_ZERO) {
+			return m68_float80_invalid(env);
+		}
+		return m68_float80_inf(sign);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_ZERO || pb.cls == M68_FLOAT80_CLASS_ZERO) {
+		return m68_float80_zero(sign);
+	}
+
+	m68_uint128_t product = (m68_uint128_t)pa.m * pb.m;
+	return m68_float80_pack(sign, pa.e + pb.e + 1, product, env);
+}
+
+m68_float80_t m68_float80_div(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a), pb = m68_float80_unpack(b);
+	int sign = pa.sign ^ pb.sign;
+
+	if (pa.cls == M68_FLOAT80_CLASS_NAN || pb.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(a, b, env);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_INF) {
+		return pb.cls == M68_FLOAT80_CLASS_INF ? m68_float80_invalid(env) : m68_float80_inf(sign);
+	}
+	if (pb.cls == M68_FLOAT80_CLASS_INF) {
+		return m68_float80_zero(sign);
+	}
+	if (pb.cls == M68_FLOAT80_CLASS_ZERO) {
+		if (pa.cls == M68_FLOAT80_CLASS_ZERO) {
+			return m68_float80_invalid(env);
+		}
+		env->exceptions |= M68_FLOAT80_DZ;
+		return m68_float80_inf(sign);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_ZERO) {
+		return m68_float80_zero(sign);
+	}
+
+	/* Two long divisions give a 128-bit quotient, with the first 64 bits
+	 * normalised, and the final remainder decides the lowest bit. */
+	int32_t e = pa.e - pb.e;
+	m68_uint128_t numerator = (m68_uint128_t)pa.m << 64;
+	if (pa.m >= pb.m) {
+		numerator >>= 1;
+		e += 1;
+	}
+	m68_uint128_t high = numerator / pb.m;
+	m68_uint128_t remainder = numerator % pb.m;
+	m68_uint128_t low = (remainder << 64) / pb.m;
+	remainder = (remainder << 64) % pb.m;
+	m68_uint128_t quotient = (high << 64) | low | (remainder != 0);
+	return m68_float80_pack(sign, e - 1, quotient, env);
+}
+
+m68_float80_t m68_float80_sqrt(m68_float80_t a, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a);
+
+	if (pa.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(a, a, env);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_ZERO) {
+		return a;
+	}
+	if (pa.sign) {
+		return m68_float80_invalid(env);
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_INF) {
+		return a;
+	}
+
+	/* Take the square root of a 128-bit integer that has an even power of two
+	 * to go with it. The root has 64 bits; the remainder tells whether the
+	 * true root lies above the half way point, and whether it is exact. */
+	m68_uint128_t n = (m68_uint128_t)pa.m << ((pa.e & 1) ? 64 : 63);
+	int32_t e = (pa.e & 1) ? (pa.e - 1) / 2 : pa.e / 2;
+	m68_uint128_t root = 0, remainder = 0;
+	for (int i = 0; i < 64; ++i) {
+		remainder = (remainder << 2) | (n >> 126);
+		n <<= 2;
+		m68_uint128_t trial = (root << 2) | 1;
+		root <<= 1;
+		if (remainder >= trial) {
+			remainder -= trial;
+			root |= 1;
+		}
+	}
+
+	m68_uint128_t m = (root << 64) | ((m68_uint128_t)(remainder > root) << 63) | (remainder != 0);
+	return m68_float80_pack(0, e, m, env);
+}
+
+m68_float80_t m68_float80_int(m68_float80_t a, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a);
+
+	if (pa.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(a, a, env);
+	}
+	if (pa.cls != M68_FLOAT80_CLASS_NORMAL || pa.e >= 63) {
+		return a;
+	}
+
+	/* Split into integer and fraction bits. Anything below a half only
+	 * needs to be known to be non-zero. */
+	uint32_t fraction_bits = 127;
+	m68_uint128_t m = 1;
+	if (pa.e >= -1) {
+		fraction_bits = (uint32_t)(126 - pa.e);
+		m = (m68_uint128_t)pa.m << 63;
+	}
+	m68_uint128_t mask = ((m68_uint128_t)1 << fraction_bits) - 1;
+	m68_uint128_t half = (m68_uint128_t)1 << (fraction_bits - 1);
+	m68_uint128_t rest = m & mask;
+	uint64_t integer = (uint64_t)(m >> fraction_bits);
+
+	if (rest) {
+		env->exceptions |= M68_FLOAT80_INEX2;
+	}
+	switch (env->rounding) {
+		case M68_ROUND_NEAREST:
+			integer += rest > half || (rest == half && (integer & 1));
+			break;
+		case M68_ROUND_ZERO:
+			break;
+		case M68_ROUND_MINUS:
+			integer += pa.sign && rest;
+			break;
+		case M68_ROUND_PLUS:
+			integer += !pa.sign && rest;
+			break;
+	}
+
+	if (integer == 0) {
+		return m68_float80_zero(pa.sign);
+	}
+	int shift = __builtin_clzll(integer);
+	return m68_float80_make(pa.sign, (uint16_t)(63 - shift + M68_FLOAT80_BIAS), integer << shift);
+}
+
+m68_float80_t m68_float80_round(m68_float80_t a, struct m68_float80_env *env)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a);
+	if (pa.cls == M68_FLOAT80_CLASS_NAN) {
+		return m68_float80_propagate(a, a, env);
+	}
+	if (pa.cls != M68_FLOAT80_CLASS_NORMAL) {
+		return a;
+	}
+	return m68_float80_pack_parts(&pa, env);
+}
+
+enum m68_float80_order m68_float80_compare(m68_float80_t a, m68_float80_t b)
+{
+	struct m68_float80_parts pa = m68_float80_unpack(a), pb = m68_float80_unpack(b);
+
+	if (pa.cls == M68_FLOAT80_CLASS_NAN || pb.cls == M68_FLOAT80_CLASS_NAN) {
+		return M68_FLOAT80_UNORDERED;
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_ZERO && pb.cls == M68_FLOAT80_CLASS_ZERO) {
+		return M68_FLOAT80_EQUAL;
+	}
+	if (pa.cls == M68_FLOAT80_CLASS_ZERO) {
+		return pb.sign ? M68_FLOAT80_GREATER : M68_FLOAT80_LESS;
+	}
+	if (pb.cls == M68_FLOAT80_CLASS_ZERO || pa.sign != pb.sign) {
+		return pa.sign ? M68_FLOAT80_LESS : M68_FLOAT80_GREATER;
+	}
+
+	/* Same sign, both non-zero. Infinities compare beyond every exponent. */
+	int32_t ea = pa.cls == M68_FLOAT80_CLASS_INF ? INT32_MAX : pa.e;
+	int32_t eb = pb.cls == M68_FLOAT80_CLASS_INF ? INT32_MAX : pb.e;
+	int order = ea != eb ? (ea > eb ? 1 : -1) : (pa.m > pb.m) - (pa.m < pb.m);
+	if (ea == INT32_MAX && eb == INT32_MAX) {
+		order = 0;
+	}
+	return (enum m68_float80_order)(pa.sign ? -order : order);
+}
+
+// MARK: - Integer Conversion
+
+m68_float80_t m68_float80_from_int32(int32_t value)
+{
+	if (value == 0) {
+		return m68_float80_zero(0);
+	}
+	int sign = value < 0;
+	uint64_t magnitude = sign ? (uint64_t)-(int64_t)value : (uint64_t)value;
+	int shift = __builtin_clzll(magnitude);
+	return m68_float80_make(sign, (uint16_t)(63 - shift + M68_FLOAT80_BIAS), magnitude << shift);
+}
+
+int32_t m68_float80_to_int32(m68_float80_t a, struct m68_float80_env *env)
+{
+	if (m68_float80_is_nan(a)) {
+		env->exceptions |= M68_FLOAT80_OPERR;
+		return m68_float80_sign(a) ? INT32_MIN : INT32_MAX;
+	}
+
+	m68_float80_t integral = m68_float80_int(a, env);
+	struct m68_float80_parts p = m68_float80_unpack(integral);
+	if (p.cls == M68_FLOAT80_CLASS_ZERO) {
+		return 0;
+	}
+
+	/* Anything at or beyond 2^31 is out of range, except -2^31 itself. */
+	if (p.cls == M68_FLOAT80_CLASS_INF || p.e > 31 || (p.e == 31 && !(p.sign && p.m == 1ULL << 63))) {
+		env->exceptions |= M68_FLOAT80_OPERR;
+		return p.sign ? INT32_MIN : INT32_MAX;
+	}
+	uint64_t magnitude = p.m >> (63 - p.e);
+	return p.sign ? (int32_t)-(int64_t)magnitude : (int32_t)magnitude;
+}
+
+// MARK: - IEEE Conversion
+
+/* Unpack an IEEE value with the specified exponent and fraction widths. */
+static m68_float80_t m68_float80_from_ieee(uint64_t bits, int exponent_bits, int fraction_bits)
+{
+	int sign = (int)(bits >> (exponent_bits + fraction_bits)) & 1;
+	int32_t bias = (1 << (exponent_bits - 1)) - 1;
+	uint32_t exponent = (uint32_t)(bits >> fraction_bits) & ((1u << exponent_bits) - 1);
+	uint64_t fraction = bits & ((1ULL << fraction_bits) - 1);
+
+	if (exponent == (1u << exponent_bits) - 1) {
+		if (fraction == 0) {
+			return m68_float80_inf(sign);
+		}
+		/* Keep the payload, including the quiet bit, at the top. */
+		return m68_float80_make(sign, M68_FLOAT80_EXPONENT_MAX, (1ULL << 63) | (fraction << (63 - fraction_bits)));
+	}
+	if (exponent == 0) {
+		if (fraction == 0) {
+			return m68_float80_zero(sign);
+		}
+		int shift = __builtin_clzll(fraction);
+		int32_t e = 1 - bias - (shift - (63 - fraction_bits));
+		return m68_float80_make(sign, (uint16_t)(e + M68_FLOAT80_BIAS), fraction << shift);
+	}
+	uint64_t mantissa = (1ULL << 63) | (fraction << (63 - fraction_bits));
+	return m68_float80_make(sign, (uint16_t)((int32_t)exponent - bias + M68_FLOAT80_BIAS), mantissa);
+}
+
+/* Round and pack into an IEEE format. */
+static uint64_t m68_float80_to_ieee(m68_float80_t a, int exponent_bits, int fraction_bits, struct m68_float80_env *env)
+{
+	struct m68_float80_parts p = m68_float80_unpack(a);
+	uint64_t sign = (uint64_t)p.sign << (exponent_bits + fraction_bits);
+	uint64_t exponent_max = (1ULL << exponent_bits) - 1;
+	int32_t bias = (1 << (exponent_bits - 1)) - 1;
+
+	switch (p.cls) {
+		case M68_FLOAT80_CLASS_ZERO:
+			return sign;
+		case M68_FLOAT80_CLASS_INF:
+			return sign | (exponent_max << fraction_bits);
+		case M68_FLOAT80_CLASS_NAN:
+			if (!(p.m & M68_FLOAT80_QUIET)) {
+				env->exceptions |= M68_FLOAT80_SNAN;
+			}
+			return sign | (exponent_max << fraction_bits) | (1ULL << (fraction_bits - 1))
+				| ((p.m << 1) >> (64 - fraction_bits));
+		case M68_FLOAT80_CLASS_NORMAL:
+			break;
+	}
+
+	int32_t e = p.e;
+	m68_uint128_t m = (m68_uint128_t)p.m << 64;
+	if (m68_float80_round_bits(p.sign, &e, &m, fraction_bits + 1, 1 - bias, bias, env)) {
+		return sign | (exponent_max << fraction_bits);
+	}
+	uint64_t significand = (uint64_t)(m >> (127 - fraction_bits));
+	if (!(significand >> fraction_bits)) {
+		return sign | significand;
+	}
+	return sign | ((uint64_t)(e + bias) << fraction_bits) | (significand & ((1ULL << fraction_bits) - 1));
+}
+
+m68_float80_t m68_float80_from_single(uint32_t bits)
+{
+	return m68_float80_from_ieee(bits, 8, 23);
+}
+
+uint32_t m68_float80_to_single(m68_float80_t a, struct m68_float80_env *env)
+{
+	return (uint32_t)m68_float80_to_ieee(a, 8, 23, env);
+}
+
+m68_float80_t m68_float80_from_double(uint64_t bits)
+{
+	return m68_float80_from_ieee(bits, 11, 52);
+}
+
+uint64_t m68_float80_to_double(m68_float80_t a, struct m68_float80_env *env)
+{
+	return m68_float80_to_ieee(a, 11, 52, env);
+}
@@ -0,0 +1,146 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+
+#if !defined(lib68_Float80)
+#define lib68_Float80
+
+/* Software Extended Precision
+ * Exact emulation of the 68881/68882 arithmetic on 80-bit extended values,
+ * used by the FPU in its exact mode. Results are rounded once, to the
+ * precision and in the direction given by the environment, as the FPU does.
+ * The exponent range is always that of extended precision, even when the
+ * rounding precision is single or double. */
+
+/* Rounding directions, in the order of the FPCR RND field. */
+enum m68_float80_rounding {
+	M68_ROUND_NEAREST = 0,
+	M68_ROUND_ZERO = 1,
+	M68_ROUND_MINUS = 2,
+	M68_ROUND_PLUS = 3,
+};
+
+/* Rounding precisions, in the order of the FPCR PREC field. */
+enum m68_float80_precision {
+	M68_PRECISION_EXTENDED = 0,
+	M68_PRECISION_SINGLE = 1,
+	M68_PRECISION_DOUBLE = 2,
+};
+
+/* Exceptions, as the bits of the FPSR exception byte. */
+enum m68_float80_exception {
+	M68_FLOAT80_INEX1 = 1 << 8,
+	M68_FLOAT80_INEX2 = 1 << 9,
+	M68_FLOAT80_DZ = 1 << 10,
+	M68_FLOAT80_UNFL = 1 << 11,
+	M68_FLOAT80_OVFL = 1 << 12,
+	M68_FLOAT80_OPERR = 1 << 13,
+	M68_FLOAT80_SNAN = 1 << 14,
+	M68_FLOAT80_BSUN = 1 << 15,
+};
+
+/* The rounding to apply, and the exceptions raised while applying it. */
+struct m68_float80_env {
+	enum m68_float80_rounding rounding;
+	enum m68_float80_precision precision;
+	uint32_t exceptions;
+};
+
+/* Comparison results. */
+enum m68_float80_order {
+	M68_FLOAT80_LESS = -1,
+	M68_FLOAT80_EQUAL = 0,
+	M68_FLOAT80_GREATER = 1,
+	M68_FLOAT80_UNORDERED = 2,
+};
+
+#define M68_FLOAT80_EXPONENT_MAX	0x7FFF
+#define M68_FLOAT80_BIAS		16383
+
+// MARK: - Arithmetic
+
+m68_float80_t m68_float80_add(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env);
+m68_float80_t m68_float80_sub(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env);
+m68_float80_t m68_float80_mul(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env);
+m68_float80_t m68_float80_div(m68_float80_t a, m68_float80_t b, struct m68_float80_env *env);
+m68_float80_t m68_float80_sqrt(m68_float80_t a, struct m68_float80_env *env);
+
+/* Round to an integral value, in the direction given by the environment. */
+m68_float80_t m68_float80_int(m68_float80_t a, struct m68_float80_env *env);
+
+/* Round to the precision given by the environment, as FMOVE does. */
+m68_float80_t m68_float80_round(m68_float80_t a, struct m68_float80_env *env);
+
+enum m68_float80_order m68_float80_compare(m68_float80_t a, m68_float80_t b);
+
+static inline m68_float80_t m68_float80_neg(m68_float80_t a)
+{
+	a.exponent ^= 0x8000;
+	return a;
+}
+
+static inline m68_float80_t m68_float80_abs(m68_float80_t a)
+{
+	a.exponent &= 0x7FFF;
+	return a;
+}
+
+static inline int m68_float80_sign(m68_float80_t a)
+{
+	return a.exponent >> 15;
+}
+
+static inline int m68_float80_is_zero(m68_float80_t a)
+{
+	return (a.exponent & 0x7FFF) == 0 && a.mantissa == 0;
+}
+
+static inline int m68_float80_is_inf(m68_float80_t a)
+{
+	return (a.exponent & 0x7FFF) == M68_FLOAT80_EXPONENT_MAX && (a.mantissa << 1) == 0;
+}
+
+static inline int m68_float80_is_nan(m68_float80_t a)
+{
+	return (a.exponent & 0x7FFF) == M68_FLOAT80_EXPONENT_MAX && (a.mantissa << 1) != 0;
+}
+
+/* The default NaN produced by invalid operations. */
+m68_float80_t m68_float80_nan(void);
+
+// MARK: - Conversion
+
+/* Integers convert exactly. Converting to an integer rounds in the direction
+ * given by the environment, and raises OPERR if the value is out of range. */
+m68_float80_t m68_float80_from_int32(int32_t value);
+int32_t m68_float80_to_int32(m68_float80_t a, struct m68_float80_env *env);
+
+/* IEEE single and double precision, given as their bit patterns. Widening is
+ * exact, narrowing rounds in the direction given by the environment. */
+m68_float80_t m68_float80_from_single(uint32_t bits);
+uint32_t m68_float80_to_single(m68_float80_t a, struct m68_float80_env *env);
+m68_float80_t m68_float80_from_double(uint64_t bits);
+uint64_t m68_float80_to_double(m68_float80_t a, struct m68_float80_env *env);
+
+#endif
@@ -0,0 +1,745 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fenv.h>
+#include <math.h>
+#include <string.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/fpu.h"
+
+/* Command word fields. */
+#define M68_FPU_OPCLASS(_C)	(((_C) >> 13) & 7)
+#define M68_FPU_SOURCE(_C)	(((_C) >> 10) & 7)
+#define M68_FPU_DESTINATION(_C)	(((_C) >> 7) & 7)
+#define M68_FPU_OPMODE(_C)	((_C) & 0x7F)
+
+/* FPCR fields, and the FPCR and FPSR bits that exist. */
+#define M68_FPCR_RND(_R)	(((_R) >> 4) & 3)
+#define M68_FPCR_PREC(_R)	(((_R) >> 6) & 3)
+#define M68_FPCR_MASK		0x0000FFF0
+#define M68_FPSR_MASK		0x0FFFFFF8
+#define M68_FPSR_CONDITION	0x0F000000
+#define M68_FPSR_EXCEPTION	0x0000FF00
+
+enum m68_fpu_opclass {
+	M68_FPU_REGISTER_TO_REGISTER = 0,
+	M68_FPU_MEMORY_TO_REGISTER = 2,
+	M68_FPU_REGISTER_TO_MEMORY = 3,
+	M68_FPU_MEMORY_TO_CONTROL = 4,
+	M68_FPU_CONTROL_TO_MEMORY = 5,
+};
+
+enum m68_fpu_opmode {
+	M68_FPU_FMOVE = 0x00,
+	M68_FPU_FINT = 0x01,
+	M68_FPU_FINTRZ = 0x03,
+	M68_FPU_FSQRT = 0x04,
+	M68_FPU_FABS = 0x18,
+	M68_FPU_FNEG = 0x1A,
+	M68_FPU_FDIV = 0x20,
+	M68_FPU_FADD = 0x22,
+	M68_FPU_FMUL = 0x23,
+	M68_FPU_FSUB = 0x28,
+	M68_FPU_FCMP = 0x38,
+	M68_FPU_FTST = 0x3A,
+};
+
+enum m68_fpu_format {
+	M68_FPU_LONG = 0,
+	M68_FPU_SINGLE = 1,
+	M68_FPU_EXTENDED = 2,
+	M68_FPU_PACKED = 3,
+	M68_FPU_WORD = 4,
+	M68_FPU_DOUBLE = 5,
+	M68_FPU_BYTE = 6,
+	M68_FPU_PACKED_DYNAMIC = 7,
+};
+
+static const uint32_t m68_fpu_format_size[] = { 4, 4, 12, 12, 2, 8, 1, 12 };
+
+static const int m68_fpu_host_rounding[] = { FE_TONEAREST, FE_TOWARDZERO, FE_DOWNWARD, FE_UPWARD };
+
+static enum m68_fpu_mode m68_fpu_current_mode = M68_FPU_EXACT;
+
+// MARK: - Registers
+
+static inline double m68_fpu_double(uint64_t bits)
+{
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+static inline uint64_t m68_fpu_double_bits(double d)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return bits;
+}
+
+static inline double m68_fpu_extended_to_double(m68_float80_t x)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	return m68_fpu_double(m68_float80_to_double(x, &env));
+}
+
+void m68_fpu_set_mode(enum m68_fpu_mode mode)
+{
+	if (mode == m68_fpu_current_mode) {
+		return;
+	}
+	for (int i = 0; i < 8; ++i) {
+		if (mode == M68_FPU_FAST) {
+			CPU68.FP[i].d = m68_fpu_extended_to_double(CPU68.FP[i].x);
+		} else {
+			CPU68.FP[i].x = m68_float80_from_double(m68_fpu_double_bits(CPU68.FP[i].d));
+		}
+	}
+	m68_fpu_current_mode = mode;
+}
+
+enum m68_fpu_mode m68_fpu_mode(void)
+{
+	return m68_fpu_current_mode;
+}
+
+void m68_fpu_reset(void)
+{
+	for (int i = 0; i < 8; ++i) {
+		m68_fpu_set(i, m68_float80_nan());
+	}
+	CPU68.FPCR.value = 0;
+	CPU68.FPSR.value = 0;
+	CPU68.FPIAR.value = 0;
+}
+
+m68_float80_t m68_fpu_get(int n)
+{
+	if (m68_fpu_current_mode == M68_FPU_FAST) {
+		return m68_float80_from_double(m68_fpu_double_bits(CPU68.FP[n & 7].d));
+	}
+	return CPU68.FP[n & 7].x;
+}
+
+void m68_fpu_set(int n, m68_float80_t value)
+{
+	if (m68_fpu_current_mode == M68_FPU_FAST) {
+		CPU68.FP[n & 7].d = m68_fpu_extended_to_double(value);
+	} else {
+		CPU68.FP[n & 7].x = value;
+	}
+}
+
+// MARK: - Status
+
+static void m68_fpu_set_status(uint32_t condition, uint32_t exceptions)
+{
+	uint32_t accrued = 0;
+	if (exceptions & (M68_FLOAT80_SNAN | M68_FLOAT80_OPERR)) {
+		accrued |= M68_FPSR_IOP;
+	}
+	if (exceptions & M68_FLOAT80_OVFL) {
+		accrued |= M68_FPSR_OVFL;
+	}
+	if ((exceptions & M68_FLOAT80_UNFL) && (exceptions & M68_FLOAT80_INEX2)) {
+		accrued |= M68_FPSR_UNFL;
+	}
+	if (exceptions & M68_FLOAT80_DZ) {
+		accrued |= M68_FPSR_DZ;
+	}
+	if (exceptions & (M68_FLOAT80_INEX1 | M68_FLOAT80_INEX2 | M68_FLOAT80_OVFL)) {
+		accrued |= M68_FPSR_INEX;
+	}
+
+	uint32_t fpsr = CPU68.FPSR.value & ~(M68_FPSR_CONDITION | M68_FPSR_EXCEPTION);
+	CPU68.FPSR.value = fpsr | condition | exceptions | accrued;
+}
+
+static uint32_t m68_fpu_condition_extended(m68_float80_t x)
+{
+	uint32_t condition = m68_float80_sign(x) ? M68_FPSR_N : 0;
+	if (m68_float80_is_zero(x)) {
+		condition |= M68_FPSR_Z;
+	} else if (m68_float80_is_inf(x)) {
+		condition |= M68_FPSR_I;
+	} else if (m68_float80_is_nan(x)) {
+		condition |= M68_FPSR_NAN;
+	}
+	return condition;
+}
+
+static uint32_t m68_fpu_condition_double(double d)
+{
+	uint32_t condition = signbit(d) ? M68_FPSR_N : 0;
+	if (d == 0) {
+		condition |= M68_FPSR_Z;
+	} else if (isinf(d)) {
+		condition |= M68_FPSR_I;
+	} else if (isnan(d)) {
+		condition |= M68_FPSR_NAN;
+	}
+	return condition;
+}
+
+static uint32_t m68_fpu_condition_order(enum m68_float80_order order)
+{
+	switch (order) {
+		case M68_FLOAT80_LESS:
+			return M68_FPSR_N;
+		case M68_FLOAT80_EQUAL:
+			return M68_FPSR_Z;
+		case M68_FLOAT80_GREATER:
+			return 0;
+		case M68_FLOAT80_UNORDERED:
+		default:
+			return M68_FPSR_NAN;
+	}
+}
+
+// MARK: - Effective Addresses
+
+/* Resolve a memory operand of the specified size, advancing *pc past any
+ * extension words. Returns 0, or -1 if the addressing mode is not
+ * supported. */
+static int m68_fpu_address(uint8_t ea, uint32_t size, uint32_t *pc, uint32_t *address)
+{
+	uint8_t reg = ea & 7;
+	m68_register32_t *an = &CPU68.A[reg];
+	uint32_t step = (size == 1 && reg == 7) ? 2 : size;
+
+	switch ((ea >> 3) & 7) {
+		case 2:
+			*address = an->value;
+			return 0;
+		case 3:
+			*address = an->value;
+			an->value += step;
+			return 0;
+		case 4:
+			an->value -= step;
+			*address = an->value;
+			return 0;
+		case 5:
+			*address = an->value + (int16_t)m68_mmu_read_word(*pc);
+			*pc += 2;
+			return 0;
+		case 7:
+			switch (reg) {
+				case 0:
+					*address = (uint32_t)(int16_t)m68_mmu_read_word(*pc);
+					*pc += 2;
+					return 0;
+				case 1:
+					*address = m68_mmu_read_long(*pc);
+					*pc += 4;
+					return 0;
+				case 2:
+					*address = *pc + (int16_t)m68_mmu_read_word(*pc);
+					*pc += 2;
+					return 0;
+				case 4:
+					/* Immediate bytes are in the low half of a word. */
+					*address = *pc + (size == 1);
+					*pc += size == 1 ? 2 : size;
+					return 0;
+			}
+			break;
+	}
+	return -1;
+}
+
+/* Read an integer or IEEE operand of up to 8 bytes. Data registers hold
+ * operands of up to 4 bytes. */
+static int m68_fpu_read_bits(uint8_t ea, uint32_t size, uint32_t *pc, uint64_t *bits)
+{
+	if ((ea >> 3) == 0) {
+		if (size > 4) {
+			return -1;
+		}
+		*bits = CPU68.D[ea & 7].value;
+		return 0;
+	}
+
+	uint32_t address;
+	if (m68_fpu_address(ea, size, pc, &address)) {
+		return -1;
+	}
+	switch (size) {
+		case 1:
+			*bits = m68_mmu_read_byte(address);
+			break;
+		case 2:
+			*bits = m68_mmu_read_word(address);
+			break;
+		case 4:
+			*bits = m68_mmu_read_long(address);
+			break;
+		case 8:
+			*bits = ((uint64_t)m68_mmu_read_long(address) << 32) | m68_mmu_read_long(address + 4);
+			break;
+	}
+	return 0;
+}
+
+static int m68_fpu_write_bits(uint8_t ea, uint32_t size, uint32_t *pc, uint64_t bits)
+{
+	if ((ea >> 3) == 0) {
+		m68_register32_t *dn = &CPU68.D[ea & 7];
+		switch (size) {
+			case 1:
+				dn->value = (dn->value & 0xFFFFFF00) | (uint8_t)bits;
+				return 0;
+			case 2:
+				dn->value = (dn->value & 0xFFFF0000) | (uint16_t)bits;
+				return 0;
+			case 4:
+				dn->value = (uint32_t)bits;
+				return 0;
+		}
+		return -1;
+	}
+
+	uint32_t address;
+	if (((ea >> 3) & 7) == 7 && (ea & 7) >= 2) {
+		return -1;
+	}
+	if (m68_fpu_address(ea, size, pc, &address)) {
+		return -1;
+	}
+	switch (size) {
+		case 1:
+			m68_mmu_write_byte(address, (uint8_t)bits);
+			break;
+		case 2:
+			m68_mmu_write_word(address, (uint16_t)bits);
+			break;
+		case 4:
+			m68_mmu_write_long(address, (uint32_t)bits);
+			break;
+		case 8:
+			m68_mmu_write_long(address, (uint32_t)(bits >> 32));
+			m68_mmu_write_long(address + 4, (uint32_t)bits);
+			break;
+	}
+	return 0;
+}
+
+/* Extended operands are 12 bytes: the sign and exponent, a word of padding,
+ * and the mantissa. */
+static int m68_fpu_read_extended(uint8_t ea, uint32_t *pc, m68_float80_t *x)
+{
+	uint32_t address;
+	if ((ea >> 3) == 0 || m68_fpu_address(ea, 12, pc, &address)) {
+		return -1;
+	}
+	x->exponent = m68_mmu_read_word(address);
+	x->mantissa = ((uint64_t)m68_mmu_read_long(address + 4) << 32) | m68_mmu_read_long(address + 8);
+	return 0;
+}
+
+static int m68_fpu_write_extended(uint8_t ea, uint32_t *pc, m68_float80_t x)
+{
+	uint32_t address;
+	if ((ea >> 3) == 0 || (((ea >> 3) & 7) == 7 && (ea & 7) >= 2) || m68_fpu_address(ea, 12, pc, &address)) {
+		return -1;
+	}
+	m68_mmu_write_long(address, (uint32_t)x.exponent << 16);
+	m68_mmu_write_long(address + 4, (uint32_t)(x.mantissa >> 32));
+	m68_mmu_write_long(address + 8, (uint32_t)x.mantissa);
+	return 0;
+}
+
+/* Read a source operand in the specified format into a register value for
+ * the current mode. */
+static int m68_fpu_read_source(uint8_t format, uint8_t ea, uint32_t *pc, m68_fp_register_t *value)
+{
+	int fast = m68_fpu_current_mode == M68_FPU_FAST;
+	uint64_t bits = 0;
+
+	if (format == M68_FPU_EXTENDED) {
+		if (m68_fpu_read_extended(ea, pc, &value->x)) {
+			return -1;
+		}
+		if (fast) {
+			value->d = m68_fpu_extended_to_double(value->x);
+		}
+		return 0;
+	}
+	if (format == M68_FPU_PACKED || format == M68_FPU_PACKED_DYNAMIC) {
+		return -1;
+	}
+	if (m68_fpu_read_bits(ea, m68_fpu_format_size[format], pc, &bits)) {
+		return -1;
+	}
+
+	switch (format) {
+		case M68_FPU_LONG:
+			if (fast) {
+				value->d = (int32_t)bits;
+			} else {
+				value->x = m68_float80_from_int32((int32_t)bits);
+			}
+			break;
+		case M68_FPU_WORD:
+			if (fast) {
+				value->d = (int16_t)bits;
+			} else {
+				value->x = m68_float80_from_int32((int16_t)bits);
+			}
+			break;
+		case M68_FPU_BYTE:
+			if (fast) {
+				value->d = (int8_t)bits;
+			} else {
+				value->x = m68_float80_from_int32((int8_t)bits);
+			}
+			break;
+		case M68_FPU_SINGLE:
+			if (fast) {
+				float f;
+				uint32_t single = (uint32_t)bits;
+				memcpy(&f, &single, sizeof(f));
+				value->d = f;
+			} else {
+				value->x = m68_float80_from_single((uint32_t)bits);
+			}
+			break;
+		case M68_FPU_DOUBLE:
+			if (fast) {
+				value->d = m68_fpu_double(bits);
+			} else {
+				value->x = m68_float80_from_double(bits);
+			}
+			break;
+	}
+	return 0;
+}
+
+// MARK: - Exact Mode
+
+static int m68_fpu_exact_operation(uint8_t opmode, uint8_t dst, m68_float80_t src)
+{
+	uint32_t fpcr = CPU68.FPCR.value;
+	struct m68_float80_env env = {
+		(enum m68_float80_rounding)M68_FPCR_RND(fpcr),
+		(enum m68_float80_precision)M68_FPCR_PREC(fpcr),
+		0
+	};
+	m68_float80_t result;
+
+	switch (opmode) {
+		case M68_FPU_FMOVE:
+			result = m68_float80_round(src, &env);
+			break;
+		case M68_FPU_FINT:
+			result = m68_float80_int(src, &env);
+			break;
+		case M68_FPU_FINTRZ:
+			env.rounding = M68_ROUND_ZERO;
+			result = m68_float80_int(src, &env);
+			break;
+		case M68_FPU_FSQRT:
+			result = m68_float80_sqrt(src, &env);
+			break;
+		case M68_FPU_FABS:
+			result = m68_float80_round(m68_float80_abs(src), &env);
+			break;
+		case M68_FPU_FNEG:
+			result = m68_float80_round(m68_float80_neg(src), &env);
+			break;
+		case M68_FPU_FDIV:
+			result = m68_float80_div(CPU68.FP[dst].x, src, &env);
+			break;
+		case M68_FPU_FADD:
+			result = m68_float80_add(CPU68.FP[dst].x, src, &env);
+			break;
+		case M68_FPU_FMUL:
+			result = m68_float80_mul(CPU68.FP[dst].x, src, &env);
+			break;
+		case M68_FPU_FSUB:
+			result = m68_float80_sub(CPU68.FP[dst].x, src, &env);
+			break;
+		case M68_FPU_FCMP:
+			m68_fpu_set_status(m68_fpu_condition_order(m68_float80_compare(CPU68.FP[dst].x, src)), 0);
+			return 0;
+		case M68_FPU_FTST:
+			m68_fpu_set_status(m68_fpu_condition_extended(src), 0);
+			return 0;
+		default:
+			return -1;
+	}
+
+	CPU68.FP[dst].x = result;
+	m68_fpu_set_status(m68_fpu_condition_extended(result), env.exceptions);
+	return 0;
+}
+
+// MARK: - Fast Mode
+
+static int m68_fpu_fast_operation(uint8_t opmode, uint8_t dst, double src)
+{
+	uint32_t fpcr = CPU68.FPCR.value;
+	int rounding = M68_FPCR_RND(fpcr);
+	double result;
+
+	/* The host is left rounding to nearest between instructions, so that the
+	 * embedder is not affected by the guest's choice. */
+	int saved = FE_TONEAREST;
+	if (rounding != M68_ROUND_NEAREST) {
+		saved = fegetround();
+		fesetround(m68_fpu_host_rounding[rounding]);
+	}
+
+	switch (opmode) {
+		case M68_FPU_FMOVE:
+			result = src;
+			break;
+		case M68_FPU_FINT:
+			result = nearbyint(src);
+			break;
+		case M68_FPU_FINTRZ:
+			result = trunc(src);
+			break;
+		case M68_FPU_FSQRT:
+			result = sqrt(src);
+			break;
+		case M68_FPU_FABS:
+			result = fabs(src);
+			break;
+		case M68_FPU_FNEG:
+			result = -src;
+			break;
+		case M68_FPU_FDIV:
+			result = CPU68.FP[dst].d / src;
+			break;
+		case M68_FPU_FADD:
+			result = CPU68.FP[dst].d + src;
+			break;
+		case M68_FPU_FMUL:
+			result = CPU68.FP[dst].d * src;
+			break;
+		case M68_FPU_FSUB:
+			result = CPU68.FP[dst].d - src;
+			break;
+		case M68_FPU_FCMP: {
+			double d = CPU68.FP[dst].d;
+			enum m68_float80_order order = isunordered(d, src) ? M68_FLOAT80_UNORDERED
+				: d < src ? M68_FLOAT80_LESS : d > src ? M68_FLOAT80_GREATER : M68_FLOAT80_EQUAL;
+			m68_fpu_set_status(m68_fpu_condition_order(order), 0);
+			goto done;
+		}
+		case M68_FPU_FTST:
+			m68_fpu_set_status(m68_fpu_condition_double(src), 0);
+			goto done;
+		default:
+			result = 0;
+			break;
+	}
+
+	if (M68_FPCR_PREC(fpcr) == M68_PRECISION_SINGLE) {
+		result = (float)result;
+	}
+	CPU68.FP[dst].d = result;
+	m68_fpu_set_status(m68_fpu_condition_double(result), 0);
+
+done:
+	if (rounding != M68_ROUND_NEAREST) {
+		fesetround(saved);
+	}
+	return 0;
+}
+
+static int m68_fpu_supported(uint8_t opmode)
+{
+	switch (opmode) {
+		case M68_FPU_FMOVE:
+		case M68_FPU_FINT:
+		case M68_FPU_FINTRZ:
+		case M68_FPU_FSQRT:
+		case M68_FPU_FABS:
+		case M68_FPU_FNEG:
+		case M68_FPU_FDIV:
+		case M68_FPU_FADD:
+		case M68_FPU_FMUL:
+		case M68_FPU_FSUB:
+		case M68_FPU_FCMP:
+		case M68_FPU_FTST:
+			return 1;
+		default:
+			return 0;
+	}
+}
+
+// MARK: - Moves
+
+/* FMOVE FPn,<ea>: convert to the destination format, rounding as the FPCR
+ * specifies. Condition codes are not affected. */
+static int m68_fpu_move_out(uint8_t format, uint8_t ea, uint8_t src, uint32_t *pc)
+{
+	uint32_t fpcr = CPU68.FPCR.value;
+	struct m68_float80_env env = { (enum m68_float80_rounding)M68_FPCR_RND(fpcr), M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t x = m68_fpu_get(src);
+	uint32_t size = m68_fpu_format_size[format];
+	uint64_t bits = 0;
+
+	switch (format) {
+		case M68_FPU_EXTENDED:
+			if (m68_fpu_write_extended(ea, pc, x)) {
+				return -1;
+			}
+			m68_fpu_set_status(CPU68.FPSR.value & M68_FPSR_CONDITION, 0);
+			return 0;
+		case M68_FPU_LONG:
+		case M68_FPU_WORD:
+		case M68_FPU_BYTE: {
+			int32_t limit = format == M68_FPU_LONG ? INT32_MAX : format == M68_FPU_WORD ? INT16_MAX : INT8_MAX;
+			int32_t value = m68_float80_to_int32(x, &env);
+			if (value > limit || value < -limit - 1) {
+				env.exceptions |= M68_FLOAT80_OPERR;
+				value = value > limit ? limit : -limit - 1;
+			}
+			bits = (uint32_t)value;
+			break;
+		}
+		case M68_FPU_SINGLE:
+			bits = m68_float80_to_single(x, &env);
+			break;
+		case M68_FPU_DOUBLE:
+			bits = m68_float80_to_double(x, &env);
+			break;
+		default:
+			return -1;
+	}
+
+	if (m68_fpu_write_bits(ea, size, pc, bits)) {
+		return -1;
+	}
+	if (m68_fpu_current_mode == M68_FPU_FAST) {
+		env.exceptions = 0;
+	}
+	m68_fpu_set_status(CPU68.FPSR.value & M68_FPSR_CONDITION, env.exceptions);
+	return 0;
+}
+
+/* FMOVE(M) to or from any combination of FPCR, FPSR and FPIAR, which are
+ * transferred in that order. */
+static int m68_fpu_move_control(uint16_t command, uint8_t ea, uint32_t *pc)
+{
+	int to_control = M68_FPU_OPCLASS(command) == M68_FPU_MEMORY_TO_CONTROL;
+	uint8_t list = M68_FPU_SOURCE(command);
+	m68_register32_t *registers[] = { &CPU68.FPIAR, &CPU68.FPSR, &CPU68.FPCR };
+	const uint32_t masks[] = { UINT32_MAX, M68_FPSR_MASK, M68_FPCR_MASK };
+	int count = __builtin_popcount(list);
+	uint8_t mode = (ea >> 3) & 7;
+
+	if (count == 0) {
+		return -1;
+	}
+
+	/* A data register can hold any one control register, and an address
+	 * register only the FPIAR. */
+	if (mode == 0 || mode == 1) {
+		if (count != 1 || (mode == 1 && list != 1)) {
+			return -1;
+		}
+		int n = __builtin_ctz(list);
+		m68_register32_t *rn = &CPU68.R[ea & 15];
+		if (to_control) {
+			registers[n]->value = rn->value & masks[n];
+		} else {
+			rn->value = registers[n]->value;
+		}
+		return 0;
+	}
+
+	if (!to_control && mode == 7 && (ea & 7) >= 2) {
+		return -1;
+	}
+	uint32_t address;
+	if (m68_fpu_address(ea, 4 * (uint32_t)count, pc, &address)) {
+		return -1;
+	}
+	for (int n = 2; n >= 0; --n) {
+		if (!(list & (1 << n))) {
+			continue;
+		}
+		if (to_control) {
+			registers[n]->value = m68_mmu_read_long(address) & masks[n];
+		} else {
+			m68_mmu_write_long(address, registers[n]->value);
+		}
+		address += 4;
+	}
+	return 0;
+}
+
+// MARK: - Dispatch
+
+void m68_fpu_general(void)
+{
+	uint32_t pc = CPU68.PC.value;
+	uint8_t ea = m68_mmu_read_word(pc) & 0x3F;
+	uint16_t command = m68_mmu_read_word(pc + 2);
+	uint32_t next = pc + 4;
+	int fast = m68_fpu_current_mode == M68_FPU_FAST;
+	int result = -1;
+
+	switch (M68_FPU_OPCLASS(command)) {
+		case M68_FPU_REGISTER_TO_REGISTER:
+		case M68_FPU_MEMORY_TO_REGISTER: {
+			uint8_t opmode = M68_FPU_OPMODE(command);
+			if (!m68_fpu_supported(opmode)) {
+				break;
+			}
+
+			m68_fp_register_t source;
+			if (M68_FPU_OPCLASS(command) == M68_FPU_REGISTER_TO_REGISTER) {
+				source = CPU68.FP[M68_FPU_SOURCE(command)];
+			} else if (m68_fpu_read_source(M68_FPU_SOURCE(command), ea, &next, &source)) {
+				break;
+			}
+
+			uint8_t dst = M68_FPU_DESTINATION(command);
+			result = fast
+				? m68_fpu_fast_operation(opmode, dst, source.d)
+				: m68_fpu_exact_operation(opmode, dst, source.x);
+			CPU68.FPIAR.value = pc;
+			break;
+		}
+		case M68_FPU_REGISTER_TO_MEMORY:
+			result = m68_fpu_move_out(M68_FPU_SOURCE(command), ea, M68_FPU_DESTINATION(command), &next);
+			CPU68.FPIAR.value = pc;
+			break;
+		case M68_FPU_MEMORY_TO_CONTROL:
+		case M68_FPU_CONTROL_TO_MEMORY:
+			result = m68_fpu_move_control(command, ea, &next);
+			break;
+	}
+
+	if (result) {
+		m68_exception_process(M68_VECTOR_LINE_1111, pc);
+		return;
+	}
+	CPU68.PC.value = next;
+}
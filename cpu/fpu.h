@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/float80.h"
+
+#if !defined(lib68_FPU)
+#define lib68_FPU
+
+/* Floating Point Unit
+ * The 68881/68882 general instructions: FMOVE, FINT, FINTRZ, FSQRT, FABS,
+ * FNEG, FADD, FSUB, FMUL, FDIV, FCMP and FTST, with register, integer, single,
+ * double and extended operands, and FMOVE(M) of the control registers.
+ *
+ * The FPU runs in one of two modes:
+ *	M68_FPU_EXACT	Registers hold 80-bit extended values and arithmetic
+ *			is done in software, exactly as the FPU would,
+ *			including the FPSR exception and accrued bytes.
+ *	M68_FPU_FAST	Registers hold host doubles and arithmetic is done by
+ *			the host FPU. Rounding direction and single precision
+ *			are honoured, but extended precision and range are
+ *			not, and only the condition codes of the FPSR are
+ *			maintained.
+ *
+ * Exception traps, FBcc/FScc/FTRAPcc, the transcendental functions, packed
+ * decimal operands and FSAVE/FRESTORE are not emulated, and raise a Line 1111
+ * exception. */
+
+enum m68_fpu_mode {
+	M68_FPU_EXACT = 0,
+	M68_FPU_FAST = 1,
+};
+
+/* FPSR condition code bits. */
+#define M68_FPSR_N	(1u << 27)
+#define M68_FPSR_Z	(1u << 26)
+#define M68_FPSR_I	(1u << 25)
+#define M68_FPSR_NAN	(1u << 24)
+
+/* FPSR accrued exception bits. The exception byte uses the values from
+ * enum m68_float80_exception. */
+#define M68_FPSR_IOP	(1u << 7)
+#define M68_FPSR_OVFL	(1u << 6)
+#define M68_FPSR_UNFL	(1u << 5)
+#define M68_FPSR_DZ	(1u << 4)
+#define M68_FPSR_INEX	(1u << 3)
+
+/* Switch mode, converting the contents of the data registers. Switching to
+ * the fast mode rounds them to double precision. */
+void m68_fpu_set_mode(enum m68_fpu_mode mode);
+enum m68_fpu_mode m68_fpu_mode(void);
+
+/* Put the FPU into its reset state: every data register a NaN, and the
+ * control registers clear. The mode is unchanged. */
+void m68_fpu_reset(void);
+
+/* Access a data register as an extended value, whichever mode the FPU is in. */
+m68_float80_t m68_fpu_get(int n);
+void m68_fpu_set(int n, m68_float80_t value);
+
+/* Instruction handler for the general FPU instructions (F-line coprocessor
+ * ID 1, type 000). */
+void m68_fpu_general(void);
+
+#endif
@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/cache.h"
+#include "cpu/fusion.h"
+#include "cpu/instruction_forms.h"
+#include "cpu/instructions/abcd.h"
+
+enum m68_fusion_id {
+	M68_FUSION_ABCD_M8_M8,
+	M68_FUSION_ABCD_DN_DN,
+	M68_FUSION_COUNT,
+};
+
+static int m68_fusion_active = 1;
+
+static void abcd_m8_m8_pair(void);
+static void abcd_dn_dn_pair(void);
+
+// MARK: - Fusions
+
+/* The base cycles of a fusion are those of the two instructions. */
+static struct m68_fusion m68_fusion_table[M68_FUSION_COUNT] = {
+	[M68_FUSION_ABCD_M8_M8] = {
+		"ABCD -(Ay),-(Ax); ABCD -(Ay),-(Ax)",
+		0xF1F8, 0xC108, 0xF1F8, 0xC108,
+		{ "ABCD -(Ay),-(Ax); ABCD -(Ay),-(Ax)", abcd_m8_m8_pair, 36 },
+		0
+	},
+	[M68_FUSION_ABCD_DN_DN] = {
+		"ABCD Dy,Dx; ABCD Dy,Dx",
+		0xF1F8, 0xC100, 0xF1F8, 0xC100,
+		{ "ABCD Dy,Dx; ABCD Dy,Dx", abcd_dn_dn_pair, 12 },
+		0
+	},
+};
+
+// MARK: - Fused Handlers
+
+static void abcd_m8_m8_pair(void)
+{
+	/* Both words are on the page, so they can be read as a long. */
+	uint32_t words = m68_mmu_read_long(CPU68.PC.value);
+	uint16_t first = (uint16_t)(words >> 16);
+	uint16_t second = (uint16_t)words;
+	++m68_fusion_table[M68_FUSION_ABCD_M8_M8].fired;
+	abcd_m8_m8_pair_body(M68_ABCD_M8_M8_X(first), M68_ABCD_M8_M8_Y(first),
+		M68_ABCD_M8_M8_X(second), M68_ABCD_M8_M8_Y(second));
+}
+
+static void abcd_dn_dn_pair(void)
+{
+	uint32_t words = m68_mmu_read_long(CPU68.PC.value);
+	uint16_t first = (uint16_t)(words >> 16);
+	uint16_t second = (uint16_t)words;
+	++m68_fusion_table[M68_FUSION_ABCD_DN_DN].fired;
+	abcd_dn_dn_pair_body(M68_ABCD_DN_DN_X(first), M68_ABCD_DN_DN_Y(first),
+		M68_ABCD_DN_DN_X(second), M68_ABCD_DN_DN_Y(second));
+}
+
+// MARK: - Configuration
+
+void m68_fusion_set_enabled(int enabled)
+{
+	m68_fusion_active = enabled;
+	m68_cache_flush();
+}
+
+int m68_fusion_enabled(void)
+{
+	return m68_fusion_active;
+}
+
+// MARK: - Decoding
+
+const struct m68_instruction *m68_fusion_decode(uint32_t pc, uint16_t opcode)
+{
+	uint32_t offset = pc & ~M68_MMU_PAGE_MASK;
+	if (!m68_fusion_active || offset > M68_MMU_PAGE_SIZE - 4) {
+		return NULL;
+	}
+
+	/* The decode cache only fills entries for pages in the read look-aside
+	 * buffer, so the next word can be read from there. */
+	uint16_t next = m68_mmu_load_word(m68_mmu_tlb_entry(MMU_READ_TLB, pc)->page + offset + 2);
+	if (m68_instruction_table[next].imp == NULL) {
+		return NULL;
+	}
+
+	for (uint32_t i = 0; i < M68_FUSION_COUNT; ++i) {
+		const struct m68_fusion *fusion = &m68_fusion_table[i];
+		if ((opcode & fusion->first_mask) == fusion->first_match
+			&& (next & fusion->second_mask) == fusion->second_match) {
+			return &fusion->instruction;
+		}
+	}
+	return NULL;
+}
+
+// MARK: - Reports
+
+const struct m68_fusion *m68_fusions(uint32_t *count)
+{
+	*count = M68_FUSION_COUNT;
+	return m68_fusion_table;
+}
+
+static int m68_fusion_compare_fired(const void *lhs, const void *rhs)
+{
+	const struct m68_fusion *a = *(const struct m68_fusion * const *)lhs;
+	const struct m68_fusion *b = *(const struct m68_fusion * const *)rhs;
+	return (a->fired < b->fired) - (a->fired > b->fired);
+}
+
+void m68_fusion_write_report(FILE *out)
+{
+	const struct m68_fusion *order[M68_FUSION_COUNT];
+	for (uint32_t i = 0; i < M68_FUSION_COUNT; ++i) {
+		order[i] = &m68_fusion_table[i];
+	}
+	qsort(order, M68_FUSION_COUNT, sizeof(*order), m68_fusion_compare_fired);
+
+	fprintf(out, "%u fusions, %s\n", M68_FUSION_COUNT, m68_fusion_active ? "enabled" : "disabled");
+	for (uint32_t i = 0; i < M68_FUSION_COUNT; ++i) {
+		fprintf(out, "%12llu  %s\n", (unsigned long long)order[i]->fired, order[i]->name);
+	}
+}
+
+void m68_fusion_reset(void)
+{
+	for (uint32_t i = 0; i < M68_FUSION_COUNT; ++i) {
+		m68_fusion_table[i].fired = 0;
+	}
+}
@@ -0,0 +1,74 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "cpu/instruction.h"
+
+#if !defined(lib68_Fusion)
+#define lib68_Fusion
+
+/* Instruction Fusion
+ * Some pairs of instructions are so common that dispatching the second costs
+ * as much as executing it. When the decode cache fills an entry it looks for
+ * a fusion starting with the instruction, and if the next instruction
+ * completes it the entry also holds a fused instruction that executes both.
+ * The fused handler keeps the intermediate condition codes to itself where
+ * the second instruction overwrites them.
+ *
+ * Fusion is only done by the decode cache in M68_CACHE_TRUST mode while the
+ * guest's instruction cache is enabled, so never on the 68000 or 68010. In
+ * the strict mode every pair would have to be checked against memory before
+ * it ran, which costs more than the dispatch it saves. The first instruction
+ * must be a single word, and both must be on the same page. m68_step() always
+ * executes a single instruction.
+ *
+ * A fused handler that faults in the second instruction sets
+ * CPU68.fault.offset to its distance from the first, so that the exception
+ * is taken on the right instruction. */
+struct m68_fusion {
+	const char *name;
+	uint16_t first_mask, first_match;
+	uint16_t second_mask, second_match;
+	struct m68_instruction instruction;
+	uint64_t fired;
+};
+
+/* Enable or disable fusion. The decode cache is flushed. Fusion is enabled
+ * by default. */
+void m68_fusion_set_enabled(int enabled);
+int m68_fusion_enabled(void);
+
+/* The fused instruction for the instruction at the PC and the one after it,
+ * or NULL. Called by the decode cache when it fills an entry. */
+const struct m68_instruction *m68_fusion_decode(uint32_t pc, uint16_t opcode);
+
+/* Every fusion, with the number of times each has fired. */
+const struct m68_fusion *m68_fusions(uint32_t *count);
+
+/* Write the number of times each fusion has fired, most frequent first. */
+void m68_fusion_write_report(FILE *out);
+
+/* Reset the number of times each fusion has fired. */
+void m68_fusion_reset(void);
+
+#endif
@@ -23,8 +23,23 @@
 #include <stddef.h>
 #include "cpu/mmu.h"
 #include "cpu/cpu.h"
+#include "cpu/cache.h"
 
 // MARK: - Global Variables and References
 
 union m68_mmu_page_table_entry *MMU_PAGE_DIR = NULL;
-struct M68000 CPU68 = { 0 };
+struct m68_mmu_tlb_entry MMU_READ_TLB[M68_MMU_TLB_ENTRIES] = {
+	[0 ... M68_MMU_TLB_ENTRIES - 1] = { M68_MMU_TLB_INVALID, NULL }
+};
+struct m68_mmu_tlb_entry MMU_WRITE_TLB[M68_MMU_TLB_ENTRIES] = {
+	[0 ... M68_MMU_TLB_ENTRIES - 1] = { M68_MMU_TLB_INVALID, NULL }
+};
+uint64_t MMU_SLOW_WRITES = 0;
+struct m68_cache_decode_entry DECODE_CACHE[M68_CACHE_DECODE_ENTRIES] = {
+	[0 ... M68_CACHE_DECODE_ENTRIES - 1] = { M68_CACHE_DECODE_INVALID, 0, NULL, NULL, NULL, 0 }
+};
+uint32_t DECODE_CACHE_GENERATION = 1;
+int DECODE_CACHE_TRUSTED = 0;
+int DECODE_CACHE_BLOCKS = 0;
+int DECODE_CACHE_ACTIVE = 0;
+struct M68000 CPU68 = { .model = M68_MODEL_68000 };
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/idle.h"
+
+/* Number of consecutive iterations a loop may fail the check before it is
+ * treated as a busy loop. */
+#define M68_IDLE_MAX_MISSES	4
+
+static struct m68_idle_config m68_idle_config = {
+	.enabled = 1,
+	.max_loop_size = M68_IDLE_DEFAULT_MAX_LOOP_SIZE,
+};
+
+/* The loop being watched, and the state of the CPU at the start of the
+ * current iteration. */
+static struct {
+	uint32_t head;
+	uint32_t tail;
+	unsigned misses;
+	uint64_t writes;
+	uint16_t sr;
+	m68_register32_t R[16];
+} m68_idle_loop = { .head = 1, .tail = 1 };
+
+static uint64_t m68_idle_skipped = 0;
+
+// MARK: - Configuration
+
+void m68_idle_configure(const struct m68_idle_config *config)
+{
+	m68_idle_config = *config;
+	m68_idle_reset();
+}
+
+struct m68_idle_config m68_idle_configuration(void)
+{
+	return m68_idle_config;
+}
+
+uint64_t m68_idle_skipped_cycles(void)
+{
+	return m68_idle_skipped;
+}
+
+void m68_idle_reset(void)
+{
+	/* Instructions are never at odd addresses, so this matches no loop. */
+	m68_idle_loop.head = 1;
+	m68_idle_loop.tail = 1;
+	m68_idle_skipped = 0;
+}
+
+// MARK: - Detection
+
+static void m68_idle_snapshot(void)
+{
+	memcpy(m68_idle_loop.R, CPU68.R, sizeof(m68_idle_loop.R));
+	m68_idle_loop.sr = CPU68.CCR.value;
+	m68_mmu_flush_write_tlb();
+	m68_idle_loop.writes = MMU_SLOW_WRITES;
+}
+
+static int m68_idle_unchanged(void)
+{
+	return MMU_SLOW_WRITES == m68_idle_loop.writes
+		&& CPU68.CCR.value == m68_idle_loop.sr
+		&& memcmp(m68_idle_loop.R, CPU68.R, sizeof(m68_idle_loop.R)) == 0;
+}
+
+void m68_idle_backward_branch(uint32_t from, uint32_t to)
+{
+	if (from - to > m68_idle_config.max_loop_size) {
+		return;
+	}
+
+	if (from != m68_idle_loop.tail || to != m68_idle_loop.head) {
+		m68_idle_loop.head = to;
+		m68_idle_loop.tail = from;
+		m68_idle_loop.misses = 0;
+		m68_idle_snapshot();
+		return;
+	}
+
+	if (m68_idle_loop.misses >= M68_IDLE_MAX_MISSES) {
+		return;
+	}
+
+	if (m68_idle_unchanged()) {
+		/* The snapshot is kept, as nothing has changed, and the look-aside
+		 * buffer is still flushed. Only misses in a row count against the
+		 * loop, as an event may write memory between skips. */
+		m68_idle_loop.misses = 0;
+		if (CPU68.deadline > CPU68.cycles) {
+			m68_idle_skipped += CPU68.deadline - CPU68.cycles;
+			CPU68.cycles = CPU68.deadline;
+		}
+		return;
+	}
+
+	++m68_idle_loop.misses;
+	m68_idle_snapshot();
+}
@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_IdleLoop)
+#define lib68_IdleLoop
+
+/* Idle Loop Detection
+ * Guests spend much of their time polling for something that only an event
+ * can change: Ticks, a VIA flag or a VBL counter. The run loop watches short
+ * loops that branch backwards to the same place. While one is being watched
+ * the write look-aside buffer is flushed, so that any write is seen by the
+ * slow path. If an iteration of the loop writes nothing and leaves every
+ * register as it found it, the next iteration will do exactly the same, and
+ * the CPU is fast forwarded to the next scheduled event.
+ *
+ * Loops that fail the check a few times in a row are left alone until the
+ * CPU moves on to a different loop, so that busy loops do not pay for the
+ * flushes. */
+struct m68_idle_config {
+	int enabled;
+	uint32_t max_loop_size;		/* Largest loop body watched, in bytes */
+};
+
+#define M68_IDLE_DEFAULT_MAX_LOOP_SIZE	64
+
+/* Replace the idle loop configuration. Detection is enabled by default. */
+void m68_idle_configure(const struct m68_idle_config *config);
+
+/* The current idle loop configuration. */
+struct m68_idle_config m68_idle_configuration(void);
+
+/* Number of cycles that have been skipped since the last reset. */
+uint64_t m68_idle_skipped_cycles(void);
+
+/* Forget the loop being watched and reset the number of skipped cycles. */
+void m68_idle_reset(void);
+
+/* Called by the run loop when the instruction at the specified address
+ * branched backwards (or to itself) to the specified target. */
+void m68_idle_backward_branch(uint32_t from, uint32_t to);
+
+#endif
@@ -33,16 +33,80 @@
 
 /* Instruction Definition Structure 
  * This helps with lookup of instruction implementation functions and mnemonics
- * for easy identification. */
+ * for easy identification.
+ *
+ * The mnemonic doubles as a disassembly template. Operands that depend on
+ * extension words are written as a placeholder, which is a '%', an operand
+ * kind and a size (b, w or l):
+ *	%e	effective address in bits 5-0 (mode 5-3, register 2-0)
+ *	%E	effective address in bits 11-6 (register 11-9, mode 8-6)
+ *	%i	immediate data
+ *	%r	branch target (%rb uses the displacement in the opcode)
+ *
+ * The handler is responsible for advancing the PC past the instruction and
+ * any extension words. The run loop charges the base number of cycles, and
+ * the handler adds any that depend on the operands. */
 struct m68_instruction {
 	const char *mnemonic;
 	void(*imp)(void);
+	uint32_t cycles;
 };
 
-/* Instruction Look Up Table 
- * This table is defined else where, but the symbol is globally accessible. 
- * This is primarily for test purposes. */
-extern struct m68_instruction m68_instruction_table[M68_MAX_AVAILABLE_INSTRUCTIONS];
+/* Specialised Handlers
+ * Forms marked for specialisation in cpu/instructions.spec have a variant of
+ * their handler generated for each combination of the specialised operand
+ * fields, so that the operands are compile time constants. The variants are
+ * only used when built with M68_SPECIALISED_HANDLERS, as they add a
+ * considerable amount of code. */
+#if defined(M68_SPECIALISED_HANDLERS)
+#	define M68_HANDLER(_GENERIC, _SPECIALISED)	_SPECIALISED
+#else
+#	define M68_HANDLER(_GENERIC, _SPECIALISED)	_GENERIC
+#endif
+
+/* Instruction Form Structure
+ * Describes one form of an instruction, as written in cpu/instructions.spec.
+ * An opcode belongs to a form if (opcode & mask) == match, and the form is
+ * available from the model up to and including the last model. Specialised
+ * forms have a handler body, which cpu/instruction_bodies.h exposes as
+ * M68_<FORM>_BODY(opcode, model). */
+struct m68_instruction_form {
+	const char *name;
+	uint16_t mask;
+	uint16_t match;
+	uint32_t model;
+	uint32_t last;
+	int specialised;
+};
+
+/* Instruction Look Up Tables
+ * A table is generated from cpu/instructions.spec at build time for each
+ * model, holding only the instructions that model has. Handlers that behave
+ * differently on each model are specialised on it, so that a 68000 core never
+ * checks for 68020 features.
+ *
+ * m68_instruction_table points at the table for the selected model. The
+ * symbols are globally accessible, primarily for test purposes. */
+extern struct m68_instruction *m68_instruction_table;
+extern struct m68_instruction m68_instruction_table_68000[M68_MAX_AVAILABLE_INSTRUCTIONS];
+extern struct m68_instruction m68_instruction_table_68010[M68_MAX_AVAILABLE_INSTRUCTIONS];
+extern struct m68_instruction m68_instruction_table_68020[M68_MAX_AVAILABLE_INSTRUCTIONS];
+extern struct m68_instruction m68_instruction_table_68030[M68_MAX_AVAILABLE_INSTRUCTIONS];
+extern struct m68_instruction m68_instruction_table_68040[M68_MAX_AVAILABLE_INSTRUCTIONS];
+
+/* The table for the specified model. */
+struct m68_instruction *m68_instruction_table_for_model(enum m68_model model);
+
+/* Select the model to emulate. This sets CPU68.model and switches to its
+ * table, and resets the caches (cpu/cache.h). Code must not set CPU68.model
+ * directly. */
+void m68_set_model(enum m68_model model);
+
+/* Instruction Forms
+ * Every form in the specification, and the form of each opcode (indexed by
+ * opcode, zero for none). */
+extern const struct m68_instruction_form m68_instruction_forms[];
+extern const uint16_t m68_instruction_form_index[M68_MAX_AVAILABLE_INSTRUCTIONS];
 
 /* Fetch the Instruction Structure for the instruction denoted by the opcode. */
 struct m68_instruction *m68_fetch_instruction_for_opcode(uint16_t);
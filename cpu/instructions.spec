@@ -0,0 +1,131 @@
+# Copyright (c) 2019 Tom Hancocks, The Diamond Project
+# 
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+# 
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+# 
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+# Instruction Forms
+#
+# Each line describes one form of an instruction, and is expanded by
+# tools/opgen into every opcode it covers when the library is built. The
+# generated dispatch table (cpu/instruction_table.c), operand decoders
+# (cpu/instruction_forms.h) and handler bodies (cpu/instruction_bodies.h) must
+# not be edited by hand.
+#
+#	<name> <pattern> [key=value ...]
+#
+# The name identifies the form and is also the name of its handler, unless a
+# handler is given explicitly.
+#
+# The pattern is 16 bits, most significant first, and may be broken up with
+# underscores. 0 and 1 are fixed bits. Any other lower case letter is an
+# operand field, which may be spread over several runs of bits. The letters
+# 'e' and 'E' are reserved for effective addresses: 'e' is the 6-bit field in
+# bits 5-0 (mode 5-3, register 2-0) and 'E' is the 6-bit field in bits 11-6
+# (register 11-9, mode 8-6), as used by MOVE.
+#
+# Keys:
+#	handler=<symbol>	implementation function (defaults to the name)
+#	model=<cpu>		first CPU to support the form (defaults to 68000)
+#	last=<cpu>		last CPU to support the form (defaults to 68040)
+#	cycles=<count>		base clock cycles, charged by the run loop
+#	ea=<modes>		valid modes for the 'e' field
+#	EA=<modes>		valid modes for the 'E' field
+#	text="<template>"	mnemonic template
+#	specialise=<fields>	comma separated fields to specialise the handler on,
+#				or "model"
+#
+# Addressing modes are a comma separated list of: dn, an, ind, post, pre,
+# disp, index, absw, absl, pcdisp, pcindex, imm, or one of the classes all,
+# data, memory, control, alterable, data-alterable, memory-alterable and
+# control-alterable.
+#
+# A specialised form must provide "static inline void <handler>_body(...)",
+# taking the specialised fields in order (an effective address is passed as a
+# mode and a register), in a header named with "@include <header>". A variant
+# of the handler is generated for each combination of field values, and is
+# used in place of the handler when built with M68_SPECIALISED_HANDLERS.
+#
+# A dispatch table is generated for each model, holding the forms available
+# on it. A form specialised on the model provides "static inline void
+# <handler>_body(enum m68_model model)" instead, and always has a variant for
+# each of its models, in which the model is a compile time constant. It can
+# not also be specialised on fields.
+#
+# In the template, {f} is replaced by the value of field f ({f:x} for hex),
+# and {e:s} / {E:s} by the effective address for an operand of size s (b, w
+# or l). Addresses that need extension words are left for the disassembler
+# to resolve.
+
+# MARK: - ABCD
+
+@include cpu/instructions/abcd.h
+
+abcd_dn_dn	1100_xxx1_0000_0yyy	specialise=x,y	cycles=6	text="ABCD D{y},D{x}"
+abcd_m8_m8	1100_xxx1_0000_1yyy	specialise=x,y	cycles=18	text="ABCD -(A{y}),-(A{x})"
+
+# MARK: - MOVEC
+
+@include cpu/instructions/movec.h
+
+movec_cr	0100_1110_0111_1010	model=68010	specialise=model	cycles=12	text="MOVEC %iw"
+movec_rc	0100_1110_0111_1011	model=68010	specialise=model	cycles=12	text="MOVEC %iw"
+
+# MARK: - Line 1010 (A-Line Traps)
+
+@include cpu/aline.h
+
+aline		1010_tttt_tttt_tttt	handler=m68_aline_dispatch	cycles=34	text="DC.W $A{t:x}"
+
+# MARK: - Line 1111 (Memory Management Unit)
+
+@include cpu/pmmu.h
+
+# Coprocessor instructions take their operation from the command word that
+# follows the opcode, so these forms only decode the effective address, and
+# disassemble as the generic coprocessor instruction with the command word as
+# its first operand.
+pmmu		1111_0000_00ee_eeee	handler=m68_pmmu_instruction	model=68030	last=68030	cycles=20	ea=dn,ind,post,pre,disp,absw,absl	text="cpGEN %iw,{e:l}"
+
+# MARK: - Line 1111 (Floating Point Coprocessor)
+
+@include cpu/fpu.h
+
+fpu_general	1111_0010_00ee_eeee	handler=m68_fpu_general	model=68020	cycles=50	ea=dn,an,ind,post,pre,disp,absw,absl,pcdisp,imm	text="cpGEN %iw,{e:l}"
+
+# MARK: - Line 1111 (Cache Control)
+
+@include cpu/cache.h
+
+cinvl_dc	1111_0100_0100_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVL DC,(A{r})"
+cinvl_ic	1111_0100_1000_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVL IC,(A{r})"
+cinvl_bc	1111_0100_1100_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVL BC,(A{r})"
+cinvp_dc	1111_0100_0101_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVP DC,(A{r})"
+cinvp_ic	1111_0100_1001_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVP IC,(A{r})"
+cinvp_bc	1111_0100_1101_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVP BC,(A{r})"
+cinva_dc	1111_0100_0101_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVA DC"
+cinva_ic	1111_0100_1001_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVA IC"
+cinva_bc	1111_0100_1101_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CINVA BC"
+cpushl_dc	1111_0100_0110_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHL DC,(A{r})"
+cpushl_ic	1111_0100_1010_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHL IC,(A{r})"
+cpushl_bc	1111_0100_1110_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHL BC,(A{r})"
+cpushp_dc	1111_0100_0111_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHP DC,(A{r})"
+cpushp_ic	1111_0100_1011_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHP IC,(A{r})"
+cpushp_bc	1111_0100_1111_0rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHP BC,(A{r})"
+cpusha_dc	1111_0100_0111_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHA DC"
+cpusha_ic	1111_0100_1011_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHA IC"
+cpusha_bc	1111_0100_1111_1rrr	handler=m68_cache_control	model=68040	cycles=16	text="CPUSHA BC"
@@ -21,23 +21,125 @@
  */
 
 #include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
 #include "cpu/instruction.h"
+#include "cpu/ea.h"
 
 #if !defined(lib68_Instruction_ABCD)
 #define lib68_Instruction_ABCD
 
-union m68_abcd_opcode {
-	uint16_t value;
-	struct {
-		uint16_t Ry:3;
-		uint16_t rm:1;
-		uint16_t unused_1:5;
-		uint16_t Rx:3;
-		uint16_t unused_2:4;
-	} field;
-};
-
 void abcd_dn_dn(void);
 void abcd_m8_m8(void);
 
+// MARK: - Handler Bodies
+
+/* Add the two BCD bytes and the extend bit, without touching the condition
+ * codes. Returns the result, and stores the carry and overflow bits. */
+static inline uint8_t abcd_sum(uint8_t Vx, uint8_t Vy, uint8_t X, uint8_t *C, uint8_t *V)
+{
+	uint8_t r = Vx + Vy + X;
+	uint8_t bc = ((Vx & Vy) | (~r & Vx) | (~r & Vy)) & 0x88;
+	uint8_t dc = (((r + 0x66) ^ r) & 0x110) >> 1;
+	uint8_t corf = (bc | dc) - ((bc | dc) >> 2);
+	uint8_t rr = r + corf;
+
+	*C = (bc | (r & ~rr)) >> 7;
+	*V = (~r && r) >> 7;
+	return rr;
+}
+
+/* Add the two BCD bytes and the extend bit, updating the condition codes.
+ * Returns the result. */
+static inline uint8_t abcd_add(uint8_t Vx, uint8_t Vy)
+{
+	uint8_t C, V;
+	uint8_t rr = abcd_sum(Vx, Vy, CPU68.CCR.bitmask.user.X, &C, &V);
+
+	CPU68.CCR.bitmask.user.C = C;
+	CPU68.CCR.bitmask.user.X = C;
+	CPU68.CCR.bitmask.user.V = V;
+	CPU68.CCR.bitmask.user.Z &= (rr == 0);
+	CPU68.CCR.bitmask.user.N = rr >> 7;
+
+	return rr;
+}
+
+/* ABCD Dy,Dx */
+static inline void abcd_dn_dn_body(uint8_t Rx, uint8_t Ry)
+{
+	CPU68.D[Ry].byte[0] = abcd_add(CPU68.D[Rx].byte[0], CPU68.D[Ry].byte[0]);
+	CPU68.PC.value += 2;
+}
+
+/* ABCD -(Ay),-(Ax) */
+static inline void abcd_m8_m8_body(uint8_t Rx, uint8_t Ry)
+{
+	uint32_t next = CPU68.PC.value + 2;
+	uint8_t Vx = m68_ea_read(M68_EA_PRE, Rx, M68_EA_BYTE, &next);
+	uint32_t address = m68_ea_address(M68_EA_PRE, Ry, M68_EA_BYTE, &next);
+	uint8_t Vy = m68_ea_load(M68_EA_PRE, Ry, M68_EA_BYTE, address);
+	m68_ea_store(M68_EA_PRE, Ry, M68_EA_BYTE, address, abcd_add(Vx, Vy));
+	CPU68.PC.value = next;
+}
+
+/* ABCD Dy,Dx twice, as in adding BCD numbers held a byte to a register. The
+ * extend bit is carried between the two in a local, and the condition codes
+ * are written once, as the second leaves them. */
+static inline void abcd_dn_dn_pair_body(uint8_t Rx1, uint8_t Ry1, uint8_t Rx2, uint8_t Ry2)
+{
+	uint8_t C, V;
+	uint8_t first = abcd_sum(CPU68.D[Rx1].byte[0], CPU68.D[Ry1].byte[0], CPU68.CCR.bitmask.user.X, &C, &V);
+	CPU68.D[Ry1].byte[0] = first;
+	uint8_t second = abcd_sum(CPU68.D[Rx2].byte[0], CPU68.D[Ry2].byte[0], C, &C, &V);
+	CPU68.D[Ry2].byte[0] = second;
+	CPU68.PC.value += 4;
+
+	CPU68.CCR.bitmask.user.C = C;
+	CPU68.CCR.bitmask.user.X = C;
+	CPU68.CCR.bitmask.user.V = V;
+	CPU68.CCR.bitmask.user.Z &= (first == 0) & (second == 0);
+	CPU68.CCR.bitmask.user.N = second >> 7;
+}
+
+/* ABCD -(Ay),-(Ax) twice, as in an unrolled BCD string loop. The extend bit
+ * is carried between the two in a local, and the condition codes are written
+ * once, as the second leaves them. A fault in the first stops before the
+ * second. */
+static inline void abcd_m8_m8_pair_body(uint8_t Rx1, uint8_t Ry1, uint8_t Rx2, uint8_t Ry2)
+{
+	uint8_t C, V;
+	uint32_t next = CPU68.PC.value + 2;
+	uint8_t Vx = m68_ea_read(M68_EA_PRE, Rx1, M68_EA_BYTE, &next);
+	uint32_t address = m68_ea_address(M68_EA_PRE, Ry1, M68_EA_BYTE, &next);
+	uint8_t Vy = m68_ea_load(M68_EA_PRE, Ry1, M68_EA_BYTE, address);
+	uint8_t first = abcd_sum(Vx, Vy, CPU68.CCR.bitmask.user.X, &C, &V);
+	m68_ea_store(M68_EA_PRE, Ry1, M68_EA_BYTE, address, first);
+	CPU68.PC.value = next;
+
+	uint8_t Z = CPU68.CCR.bitmask.user.Z & (first == 0);
+	if (__builtin_expect(CPU68.fault.vector == 0, 1)) {
+		next += 2;
+		Vx = m68_ea_read(M68_EA_PRE, Rx2, M68_EA_BYTE, &next);
+		address = m68_ea_address(M68_EA_PRE, Ry2, M68_EA_BYTE, &next);
+		Vy = m68_ea_load(M68_EA_PRE, Ry2, M68_EA_BYTE, address);
+		uint8_t second = abcd_sum(Vx, Vy, C, &C, &V);
+		m68_ea_store(M68_EA_PRE, Ry2, M68_EA_BYTE, address, second);
+		CPU68.PC.value = next;
+
+		Z &= (second == 0);
+		CPU68.CCR.bitmask.user.N = second >> 7;
+		if (__builtin_expect(CPU68.fault.vector != 0, 0)) {
+			CPU68.fault.offset = 2;
+		}
+	} else {
+		CPU68.CCR.bitmask.user.N = first >> 7;
+	}
+
+	CPU68.CCR.bitmask.user.C = C;
+	CPU68.CCR.bitmask.user.X = C;
+	CPU68.CCR.bitmask.user.V = V;
+	CPU68.CCR.bitmask.user.Z = Z;
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,129 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/cache.h"
+#include "cpu/pmmu.h"
+#include "cpu/instruction.h"
+
+#if !defined(lib68_Instruction_MOVEC)
+#define lib68_Instruction_MOVEC
+
+// MARK: - Handler Bodies
+
+/* The control register named by the 12-bit field of a MOVEC extension word,
+ * or NULL if the model does not have it. The model is a constant in every
+ * handler, so this folds down to the registers the model has. On the 68040 the MMU registers are
+ * only stored, as its paging is not emulated, and with no master state ISP
+ * is always the active stack pointer. */
+static inline m68_register32_t *movec_register(enum m68_model model, uint16_t code)
+{
+	int is_020 = model >= M68_MODEL_68020;
+	int is_040 = model == M68_MODEL_68040;
+
+	switch (code) {
+		case 0x000: return &CPU68.SFC;
+		case 0x001: return &CPU68.DFC;
+		case 0x800: return &CPU68.USP;
+		case 0x801: return &CPU68.VBR;
+		case 0x002: return is_020 ? &CPU68.CACR : NULL;
+		case 0x802: return is_020 && !is_040 ? &CPU68.CAAR : NULL;
+		case 0x803: return is_020 ? &CPU68.MSP : NULL;
+		case 0x804: return is_020 ? &CPU68.A[7] : NULL;
+		case 0x003: return is_040 ? &CPU68.TC : NULL;
+		case 0x004: return is_040 ? &CPU68.ITT0 : NULL;
+		case 0x005: return is_040 ? &CPU68.ITT1 : NULL;
+		case 0x006: return is_040 ? &CPU68.DTT0 : NULL;
+		case 0x007: return is_040 ? &CPU68.DTT1 : NULL;
+		case 0x805: return is_040 ? &CPU68.MMUSR : NULL;
+		case 0x806: return is_040 ? &CPU68.URP : NULL;
+		case 0x807: return is_040 ? &CPU68.SRP.address : NULL;
+		default: return NULL;
+	}
+}
+
+/* Write a control register, carrying out anything the write implies. */
+static inline void movec_write(uint16_t code, m68_register32_t *reg, uint32_t value)
+{
+	switch (code) {
+		case 0x000:
+		case 0x001:
+			reg->value = value & 7;
+			break;
+		case 0x002:
+			m68_cache_set_cacr(value);
+			break;
+		case 0x004:
+		case 0x005:
+			m68_pmmu_set_tt(M68_PMMU_ITT0 + (code - 0x004), value);
+			break;
+		case 0x006:
+		case 0x007:
+			m68_pmmu_set_tt(M68_PMMU_DTT0 + (code - 0x006), value);
+			break;
+		default:
+			reg->value = value;
+			break;
+	}
+}
+
+static inline void movec_body(enum m68_model model, int to_control)
+{
+	uint32_t pc = CPU68.PC.value;
+
+	if (!CPU68.CCR.bitmask.mask.S) {
+		m68_exception_process(M68_VECTOR_PRIVILEGE_VIOLATION, pc);
+		return;
+	}
+
+	uint16_t extension = m68_mmu_read_word(pc + 2);
+	uint16_t code = extension & 0xFFF;
+	m68_register32_t *reg = movec_register(model, code);
+	if (reg == NULL) {
+		m68_exception_process(M68_VECTOR_ILLEGAL_INSTRUCTION, pc);
+		return;
+	}
+
+	if (to_control) {
+		movec_write(code, reg, CPU68.R[extension >> 12].value);
+	} else {
+		CPU68.R[extension >> 12].value = reg->value;
+	}
+	CPU68.PC.value = pc + 4;
+}
+
+/* MOVEC Rc,Rn */
+static inline void movec_cr_body(enum m68_model model)
+{
+	movec_body(model, 0);
+}
+
+/* MOVEC Rn,Rc */
+static inline void movec_rc_body(enum m68_model model)
+{
+	movec_body(model, 1);
+}
+
+#endif
@@ -0,0 +1,179 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include "cpu/lz.h"
+
+#define M68_LZ_HASH_BITS	12
+#define M68_LZ_MAX_OFFSET	0xFFFF
+
+// MARK: - Compression
+
+static inline uint32_t m68_lz_hash(const uint8_t *src)
+{
+	uint32_t value;
+	memcpy(&value, src, sizeof(value));
+	return (value * 2654435761u) >> (32 - M68_LZ_HASH_BITS);
+}
+
+/* Write the bytes that extend a nibble of 15. */
+static inline void m68_lz_put_length(uint8_t *dst, size_t *op, size_t length)
+{
+	for (; length >= 255; length -= 255) {
+		dst[(*op)++] = 255;
+	}
+	dst[(*op)++] = (uint8_t)length;
+}
+
+/* Write a sequence, or the last sequence if the match length is zero.
+ * Returns 0 if it does not fit. */
+static int m68_lz_put_sequence(uint8_t *dst, size_t capacity, size_t *op, const uint8_t *literals,
+	size_t literal_length, size_t offset, size_t match_length)
+{
+	size_t worst = 1 + literal_length / 255 + 1 + literal_length + 2 + match_length / 255 + 1;
+	if (*op + worst > capacity) {
+		return 0;
+	}
+
+	size_t token = (*op)++;
+	dst[token] = (uint8_t)((literal_length < 15 ? literal_length : 15) << 4);
+	if (literal_length >= 15) {
+		m68_lz_put_length(dst, op, literal_length - 15);
+	}
+	memcpy(dst + *op, literals, literal_length);
+	*op += literal_length;
+	if (match_length == 0) {
+		return 1;
+	}
+
+	dst[(*op)++] = offset & 0xFF;
+	dst[(*op)++] = (offset >> 8) & 0xFF;
+	size_t extra = match_length - M68_LZ_MIN_MATCH;
+	dst[token] |= (uint8_t)(extra < 15 ? extra : 15);
+	if (extra >= 15) {
+		m68_lz_put_length(dst, op, extra - 15);
+	}
+	return 1;
+}
+
+size_t m68_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity)
+{
+	/* Positions are stored plus one, so that zero is an empty slot. */
+	uint32_t table[1 << M68_LZ_HASH_BITS];
+	memset(table, 0, sizeof(table));
+
+	size_t ip = 0;
+	size_t anchor = 0;
+	size_t op = 0;
+	while (ip + M68_LZ_MIN_MATCH <= length) {
+		uint32_t hash = m68_lz_hash(src + ip);
+		size_t candidate = table[hash];
+		table[hash] = (uint32_t)(ip + 1);
+
+		if (candidate == 0 || ip - (candidate - 1) > M68_LZ_MAX_OFFSET
+			|| memcmp(src + candidate - 1, src + ip, M68_LZ_MIN_MATCH) != 0) {
+			++ip;
+			continue;
+		}
+
+		size_t match = candidate - 1;
+		size_t match_length = M68_LZ_MIN_MATCH;
+		while (ip + match_length < length && src[match + match_length] == src[ip + match_length]) {
+			++match_length;
+		}
+		if (!m68_lz_put_sequence(dst, capacity, &op, src + anchor, ip - anchor, ip - match, match_length)) {
+			return 0;
+		}
+		ip += match_length;
+		anchor = ip;
+	}
+
+	if (!m68_lz_put_sequence(dst, capacity, &op, src + anchor, length - anchor, 0, 0)) {
+		return 0;
+	}
+	return op;
+}
+
+// MARK: - Decompression
+
+/* Read the bytes that extend a nibble of 15. Returns 0 if the stream ends. */
+static inline int m68_lz_get_length(const uint8_t *src, size_t length, size_t *ip, size_t *value)
+{
+	uint8_t byte;
+	do {
+		if (*ip >= length) {
+			return 0;
+		}
+		byte = src[(*ip)++];
+		*value += byte;
+	} while (byte == 255);
+	return 1;
+}
+
+size_t m68_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity)
+{
+	size_t ip = 0;
+	size_t op = 0;
+	while (ip < length) {
+		uint8_t token = src[ip++];
+
+		size_t literal_length = token >> 4;
+		if (literal_length == 15 && !m68_lz_get_length(src, length, &ip, &literal_length)) {
+			return 0;
+		}
+		if (literal_length > length - ip || literal_length > capacity - op) {
+			return 0;
+		}
+		memcpy(dst + op, src + ip, literal_length);
+		ip += literal_length;
+		op += literal_length;
+		if (ip == length) {
+			break;
+		}
+
+		if (length - ip < 2) {
+			return 0;
+		}
+		size_t offset = src[ip] | (src[ip + 1] << 8);
+		ip += 2;
+		size_t match_length = token & 15;
+		if (match_length == 15 && !m68_lz_get_length(src, length, &ip, &match_length)) {
+			return 0;
+		}
+		match_length += M68_LZ_MIN_MATCH;
+		if (offset == 0 || offset > op || match_length > capacity - op) {
+			return 0;
+		}
+
+		/* An overlapping match repeats the last offset bytes. Copying from
+		 * the start of the match a whole number of repeats at a time keeps
+		 * each copy clear of its source, and doubles what can be copied. */
+		uint8_t *out = dst + op;
+		for (size_t done = 0; done < match_length;) {
+			size_t count = done + offset < match_length - done ? done + offset : match_length - done;
+			memcpy(out + done, out - offset, count);
+			done += count;
+		}
+		op += match_length;
+	}
+	return op;
+}
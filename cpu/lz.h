@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if !defined(lib68_LZ)
+#define lib68_LZ
+
+/* LZ Codec
+ * A small byte oriented LZ77 codec, used to hold cold guest pages
+ * compressed. It favours speed over ratio: a page of guest memory, which is
+ * mostly zeroes, repeated code and tables, decompresses in a few
+ * microseconds.
+ *
+ * The stream is a series of sequences, each a token byte holding the number
+ * of literals in the high nibble and the match length less 4 in the low
+ * nibble, followed by the literals, and a 16-bit little endian offset back
+ * to the match. A nibble of 15 is extended by the bytes that follow it, up to
+ * and including the first that is not 255. The last sequence has only
+ * literals. */
+
+#define M68_LZ_MIN_MATCH	4
+
+/* Compress length bytes into dst. Returns the compressed size, or 0 if it
+ * does not fit in capacity bytes. */
+size_t m68_lz_compress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity);
+
+/* Decompress length bytes into dst. Returns the decompressed size, or 0 if
+ * the stream is corrupt or does not fit in capacity bytes. */
+size_t m68_lz_decompress(const uint8_t *src, size_t length, uint8_t *dst, size_t capacity);
+
+#endif
@@ -20,15 +20,32 @@
  * SOFTWARE.
  */
 
+#include "cpu/cpu.h"
 #include "cpu/mmu.h"
-#include "cpu/endian.h"
+#include "cpu/exception.h"
+#include "cpu/page_pool.h"
+#include "cpu/debug.h"
+#include "cpu/pmmu.h"
+#include "cpu/cache.h"
+#include "cpu/lz.h"
 #include <stdio.h>
 #include <stdlib.h>
-#include <arpa/inet.h>
+#include <string.h>
 
 #define MMU_PAGE_DIR_MAX_ENTRIES	1024
 #define MMU_PAGE_TABLE_MAX_ENTRIES 	1024
 
+/* Number of pages with the watch flag set. */
+static uint32_t m68_mmu_watched_pages = 0;
+
+/* Whether the PMMU translates addresses on the slow paths, and the size of
+ * the smallest block of logical memory that is physically contiguous. */
+static int m68_mmu_translating = 0;
+static uint32_t m68_mmu_boundary = M68_MMU_PAGE_SIZE;
+
+/* Number of compressed pages that have been decompressed. */
+static uint64_t m68_mmu_decompressions = 0;
+
 // MARK: - Initialisation & Destruction
 
 int m68_mmu_initialise(void)
@@ -42,6 +59,10 @@ int m68_mmu_initialise(void)
 	if (MMU_PAGE_DIR == NULL) {
 		return 1;
 	}
+	m68_mmu_watched_pages = 0;
+	m68_mmu_decompressions = 0;
+	m68_pmmu_reset();
+	m68_mmu_flush_tlb();
 	m68_mmu_page_alloc(0x00000000);
 
 	return 0;
@@ -59,17 +80,21 @@ void m68_mmu_destroy(void)
 			}
 
 			/* Fetch the page table */
-			union m68_mmu_page_entry *PAGE_TABLE = (void *)((uintptr_t)MMU_PAGE_DIR[i].field.address << 4);
+			union m68_mmu_page_entry *PAGE_TABLE = (void *)((uintptr_t)MMU_PAGE_DIR[i].field.address << 2);
 
 			/* Iterate over all pages in the table */
 			for (int j = 0; j < MMU_PAGE_TABLE_MAX_ENTRIES; ++j) {
-				if (!PAGE_TABLE[i].field.present) {
+				if (!PAGE_TABLE[j].field.present) {
 					continue;
 				}
 
 				/* Fetch the page */
-				void *PAGE = (void *)((uintptr_t)PAGE_TABLE[i].field.address << 4);
-				free(PAGE);
+				void *PAGE = (void *)((uintptr_t)PAGE_TABLE[j].field.address << 4);
+				if (PAGE_TABLE[j].field.shared) {
+					m68_page_pool_release(PAGE);
+				} else if (!PAGE_TABLE[j].field.external) {
+					free(PAGE);
+				}
 			}
 
 			free(PAGE_TABLE);
@@ -77,54 +102,213 @@ void m68_mmu_destroy(void)
 
 		free(MMU_PAGE_DIR);
 		MMU_PAGE_DIR = NULL;
+		m68_mmu_flush_tlb();
 	}
 }
 
 // MARK: - Page Management
 
-void *m68_mmu_page_alloc(uint32_t address)
+/* Unallocated memory reads as this page, so that reading memory never
+ * allocates it. Writes that raise a bus error are sent to the sink. */
+static const uint8_t m68_mmu_zero_page[M68_MMU_PAGE_SIZE] __attribute__((aligned(16)));
+static uint8_t m68_mmu_sink_page[M68_MMU_PAGE_SIZE] __attribute__((aligned(16)));
+
+/* Pages that have not been allocated or mapped at or above the limit raise a
+ * bus error, or zero for no limit. */
+static uint32_t m68_mmu_memory_limit = 0;
+
+void m68_mmu_set_memory_limit(uint32_t limit)
+{
+	m68_mmu_memory_limit = limit;
+	m68_mmu_flush_tlb();
+}
+
+/* Find the page entry for the specified memory address, or NULL if there is
+ * no page table for it. */
+static union m68_mmu_page_entry *m68_mmu_find_page_entry(uint32_t address)
+{
+	uint32_t dir_idx = (address >> 22) & 0x3FF;
+	if (!MMU_PAGE_DIR[dir_idx].field.present) {
+		return NULL;
+	}
+	union m68_mmu_page_entry *table = (void *)((uintptr_t)MMU_PAGE_DIR[dir_idx].field.address << 2);
+	return &table[(address >> 12) & 0x3FF];
+}
+
+/* Find the page entry for the specified memory address, allocating the page
+ * table if it isn't already allocated. */
+static union m68_mmu_page_entry *m68_mmu_page_entry(uint32_t address)
 {
 	union m68_mmu_page_entry *table = NULL;
-	void *page = NULL;
 
-	/* First determine the page table and the page that the address relates
-	 * to. */
+	/* First determine the page table that the address relates to. */
 	uint32_t dir_idx = (address >> 22) & 0x3FF;
 	uint32_t table_idx = (address >> 12) & 0x3FF;
 
-	/* Now check if a table already exists. If not create it. To do this we need
-	 * to request an allocation for the page and then ensure it is aligned to a
-	 * 16 byte boundary. */
+	/* Now check if a table already exists. If not create it. */
 	if (!MMU_PAGE_DIR[dir_idx].field.present) {
-		table = calloc(MMU_PAGE_TABLE_MAX_ENTRIES + 4, sizeof(union m68_mmu_page_entry));
-		uintptr_t address = (uintptr_t)table;
-		if (address & 0xF) {
-			address = ((address + 0x10) & ~0xF);
-			table = (void *)address;
-		}
-
-		MMU_PAGE_DIR[dir_idx].field.address = (address >> 2);
+		table = calloc(MMU_PAGE_TABLE_MAX_ENTRIES, sizeof(union m68_mmu_page_entry));
+		MMU_PAGE_DIR[dir_idx].field.address = ((uintptr_t)table >> 2);
 		MMU_PAGE_DIR[dir_idx].field.present = 1;
 	} else {
 		table = (void *)((uintptr_t)MMU_PAGE_DIR[dir_idx].field.address << 2);
 	}
 
-	/* Now check for the presence of the desired page in the table. If the page
-	 * is not there then allocate it. */
-	if (!table[table_idx].field.present) {
-		page = calloc(0x1000, 1);
-		uintptr_t address = (uintptr_t)page;
-		if (address & 0xF) {
-			address = ((address + 0x10) & ~0xF);
-			page = (void *)address;
+	return &table[table_idx];
+}
+
+static inline uint8_t *m68_mmu_page_address(const union m68_mmu_page_entry *entry)
+{
+	return (uint8_t *)((uintptr_t)entry->field.address << 4);
+}
+
+static inline void m68_mmu_set_page(union m68_mmu_page_entry *entry, void *page, int shared)
+{
+	entry->field.address = ((uintptr_t)page >> 4);
+	entry->field.present = 1;
+	entry->field.dirty = 0;
+	entry->field.shared = shared ? 1 : 0;
+	entry->field.referenced = 1;
+	entry->field.compressed = 0;
+	entry->field.external = 0;
+}
+
+// MARK: - Compression
+
+/* A compressed page is held as its size followed by the compressed data, in
+ * a block at least 16 byte aligned like any other page. */
+struct m68_mmu_compressed_page {
+	uint32_t length;
+	uint8_t data[];
+};
+
+/* Replace a page with its compressed form, if it compresses to half a page
+ * or less. Returns 1 if it was compressed. */
+static int m68_mmu_compress(union m68_mmu_page_entry *entry)
+{
+	uint8_t buffer[M68_MMU_PAGE_SIZE / 2];
+	uint8_t *page = m68_mmu_page_address(entry);
+	size_t length = m68_lz_compress(page, M68_MMU_PAGE_SIZE, buffer, sizeof(buffer));
+	if (length == 0) {
+		return 0;
+	}
+
+	struct m68_mmu_compressed_page *compressed = malloc(sizeof(*compressed) + length);
+	if (compressed == NULL) {
+		return 0;
+	}
+	compressed->length = (uint32_t)length;
+	memcpy(compressed->data, buffer, length);
+	free(page);
+
+	entry->field.address = ((uintptr_t)compressed >> 4);
+	entry->field.compressed = 1;
+	return 1;
+}
+
+static void m68_mmu_decompress(union m68_mmu_page_entry *entry)
+{
+	struct m68_mmu_compressed_page *compressed = (void *)m68_mmu_page_address(entry);
+	uint8_t *page = malloc(M68_MMU_PAGE_SIZE);
+	if (page == NULL) {
+		fprintf(stderr, "lib68: out of memory decompressing a page\n");
+		abort();
+	}
+	m68_lz_decompress(compressed->data, compressed->length, page, M68_MMU_PAGE_SIZE);
+	free(compressed);
+
+	entry->field.address = ((uintptr_t)page >> 4);
+	entry->field.compressed = 0;
+	++m68_mmu_decompressions;
+}
+
+/* The page behind a present entry, decompressing it if need be. The page is
+ * marked as referenced. */
+static inline uint8_t *m68_mmu_page_resident(union m68_mmu_page_entry *entry)
+{
+	entry->field.referenced = 1;
+	if (__builtin_expect(entry->field.compressed, 0)) {
+		m68_mmu_decompress(entry);
+	}
+	return m68_mmu_page_address(entry);
+}
+
+/* Release the page behind an entry, back to the pool if it is shared. */
+static void m68_mmu_release_page(union m68_mmu_page_entry *entry)
+{
+	if (!entry->field.present) {
+		return;
+	}
+	if (entry->field.shared) {
+		m68_page_pool_release(m68_mmu_page_address(entry));
+	} else if (!entry->field.external) {
+		free(m68_mmu_page_address(entry));
+	}
+	entry->field.present = 0;
+	entry->field.dirty = 0;
+	entry->field.shared = 0;
+	entry->field.referenced = 0;
+	entry->field.compressed = 0;
+	entry->field.external = 0;
+	entry->field.address = 0;
+}
+
+/* Find the page at the specified address for reading, or NULL if it has not
+ * been allocated. The page may be shared. */
+static uint8_t *m68_mmu_page_lookup(uint32_t address)
+{
+	union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address);
+	if (entry == NULL || !entry->field.present) {
+		return NULL;
+	}
+	return m68_mmu_page_resident(entry);
+}
+
+/* The read look-aside buffer may point at an old page (the zero page, or a
+ * shared page) for an address whose page has just been replaced. When the
+ * PMMU is translating, the buffer is indexed by logical address, and any
+ * entry may lead to the physical page. */
+static inline void m68_mmu_invalidate_read(uint32_t address)
+{
+	if (m68_mmu_translating) {
+		for (int i = 0; i < M68_MMU_TLB_ENTRIES; ++i) {
+			MMU_READ_TLB[i].tag = M68_MMU_TLB_INVALID;
 		}
+		return;
+	}
+	struct m68_mmu_tlb_entry *tlb = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	if (tlb->tag == (address & M68_MMU_PAGE_MASK)) {
+		tlb->tag = M68_MMU_TLB_INVALID;
+	}
+}
 
-		table[table_idx].field.address = (address >> 2);
-		table[table_idx].field.present = 1;
-	} else {
-		page = (void *)((uintptr_t)table[table_idx].field.address << 2);
+/* Replace a shared page with a private copy. */
+static uint8_t *m68_mmu_unshare(union m68_mmu_page_entry *entry, uint32_t address)
+{
+	uint8_t *shared = m68_mmu_page_address(entry);
+	uint8_t *page = malloc(M68_MMU_PAGE_SIZE);
+	memcpy(page, shared, M68_MMU_PAGE_SIZE);
+	m68_page_pool_release(shared);
+	m68_mmu_set_page(entry, page, 0);
+	m68_mmu_invalidate_read(address);
+	return page;
+}
+
+void *m68_mmu_page_alloc(uint32_t address)
+{
+	union m68_mmu_page_entry *entry = m68_mmu_page_entry(address);
+	if (entry->field.present) {
+		if (entry->field.shared) {
+			return m68_mmu_unshare(entry, address);
+		}
+		return m68_mmu_page_resident(entry);
 	}
 
+	/* Allocations are at least 16 byte aligned, leaving the low bits of the
+	 * entry free for flags. */
+	void *page = calloc(M68_MMU_PAGE_SIZE, 1);
+	m68_mmu_set_page(entry, page, 0);
+	m68_mmu_invalidate_read(address);
 	return page;
 }
 
@@ -135,50 +319,576 @@ void *m68_mmu_translate(uint32_t address)
 	return (void *)(page + page_offset);
 }
 
+const void *m68_mmu_translate_read(uint32_t address)
+{
+	const uint8_t *page = m68_mmu_page_lookup(address);
+	if (page == NULL) {
+		page = m68_mmu_zero_page;
+	}
+	return page + (address & ~M68_MMU_PAGE_MASK);
+}
+
+uint32_t m68_mmu_read_physical_long(uint32_t address)
+{
+	return m68_mmu_load_long(m68_mmu_translate_read(address));
+}
+
+void m68_mmu_write_physical_long(uint32_t address, uint32_t value)
+{
+	m68_mmu_store_long(m68_mmu_translate(address), value);
+	m68_mmu_page_entry(address)->field.dirty = 1;
+}
+
+// MARK: - Block Copies
+
+/* Copy guest-ordered bytes into a page, at the specified offset. */
+static void m68_mmu_copy_in(uint8_t *page, uint32_t offset, const uint8_t *data, uint32_t length)
+{
+	if (!M68_MMU_SWIZZLE) {
+		memcpy(page + offset, data, length);
+		return;
+	}
+	for (uint32_t i = 0; i < length; ++i) {
+		page[M68_MMU_BYTE_OFFSET(offset + i)] = data[i];
+	}
+}
+
+static void m68_mmu_copy_out(uint8_t *buffer, const uint8_t *page, uint32_t offset, uint32_t length)
+{
+	if (!M68_MMU_SWIZZLE) {
+		memcpy(buffer, page + offset, length);
+		return;
+	}
+	for (uint32_t i = 0; i < length; ++i) {
+		buffer[i] = page[M68_MMU_BYTE_OFFSET(offset + i)];
+	}
+}
+
+void m68_mmu_write_block(uint32_t address, const void *data, uint32_t length)
+{
+	const uint8_t *bytes = data;
+	while (length) {
+		uint32_t offset = address & ~M68_MMU_PAGE_MASK;
+		uint32_t count = M68_MMU_PAGE_SIZE - offset < length ? M68_MMU_PAGE_SIZE - offset : length;
+		m68_mmu_copy_in(m68_mmu_page_alloc(address), offset, bytes, count);
+		m68_mmu_page_entry(address)->field.dirty = 1;
+		address += count;
+		bytes += count;
+		length -= count;
+	}
+}
+
+void m68_mmu_read_block(uint32_t address, void *buffer, uint32_t length)
+{
+	uint8_t *bytes = buffer;
+	while (length) {
+		uint32_t offset = address & ~M68_MMU_PAGE_MASK;
+		uint32_t count = M68_MMU_PAGE_SIZE - offset < length ? M68_MMU_PAGE_SIZE - offset : length;
+		m68_mmu_copy_out(bytes, m68_mmu_translate_read(address & M68_MMU_PAGE_MASK), offset, count);
+		address += count;
+		bytes += count;
+		length -= count;
+	}
+}
+
+// MARK: - Host Spans
+
+int m68_mmu_map_span(uint32_t address, uint32_t length, int writable, struct iovec *out, uint32_t count)
+{
+	if ((uint64_t)address + length > 0x100000000ULL || (M68_MMU_SWIZZLE && ((address | length) & 1))) {
+		return -1;
+	}
+
+	uint32_t spans = 0;
+	while (length) {
+		uint32_t offset = address & ~M68_MMU_PAGE_MASK;
+		uint32_t size = M68_MMU_PAGE_SIZE - offset < length ? M68_MMU_PAGE_SIZE - offset : length;
+		if (m68_mmu_memory_limit && address >= m68_mmu_memory_limit && m68_mmu_page_lookup(address) == NULL) {
+			return -1;
+		}
+
+		uint8_t *base;
+		if (writable) {
+			base = (uint8_t *)m68_mmu_page_alloc(address) + offset;
+			m68_mmu_page_entry(address)->field.dirty = 1;
+		} else {
+			base = (uint8_t *)m68_mmu_translate_read(address);
+		}
+
+		if (spans && (uint8_t *)out[spans - 1].iov_base + out[spans - 1].iov_len == base) {
+			out[spans - 1].iov_len += size;
+		} else if (spans == count) {
+			return -1;
+		} else {
+			out[spans].iov_base = base;
+			out[spans].iov_len = size;
+			++spans;
+		}
+		address += size;
+		length -= size;
+	}
+	return (int)spans;
+}
+
+// MARK: - Shared Pages
+
+int m68_mmu_map_shared(uint32_t address, const void *data, uint32_t length)
+{
+	const uint8_t *bytes = data;
+	uint8_t buffer[M68_MMU_PAGE_SIZE];
+
+	if (address & ~M68_MMU_PAGE_MASK) {
+		return 1;
+	}
+
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		const uint8_t *source = bytes + offset;
+		if (length - offset < M68_MMU_PAGE_SIZE || M68_MMU_SWIZZLE) {
+			uint32_t count = length - offset < M68_MMU_PAGE_SIZE ? length - offset : M68_MMU_PAGE_SIZE;
+			memset(buffer, 0, sizeof(buffer));
+			m68_mmu_copy_in(buffer, 0, source, count);
+			source = buffer;
+		}
+
+		uint8_t *page = m68_page_pool_acquire(source);
+		if (page == NULL) {
+			m68_mmu_flush_tlb();
+			return 1;
+		}
+		union m68_mmu_page_entry *entry = m68_mmu_page_entry(address + offset);
+		m68_mmu_release_page(entry);
+		m68_mmu_set_page(entry, page, 1);
+	}
+
+	m68_mmu_flush_tlb();
+	return 0;
+}
+
+int m68_mmu_map_host(uint32_t address, void *host, uint32_t length)
+{
+	if ((address & ~M68_MMU_PAGE_MASK) || ((uintptr_t)host & 0xF)) {
+		return 1;
+	}
+
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		union m68_mmu_page_entry *entry = m68_mmu_page_entry(address + offset);
+		m68_mmu_release_page(entry);
+		m68_mmu_set_page(entry, (uint8_t *)host + offset, 0);
+		entry->field.external = 1;
+	}
+
+	m68_mmu_flush_tlb();
+	return 0;
+}
+
+void m68_mmu_unmap_host(uint32_t address, uint32_t length)
+{
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address + offset);
+		if (entry == NULL || !entry->field.present || !entry->field.external) {
+			continue;
+		}
+
+		uint8_t *page = malloc(M68_MMU_PAGE_SIZE);
+		memcpy(page, m68_mmu_page_address(entry), M68_MMU_PAGE_SIZE);
+		int dirty = entry->field.dirty;
+		m68_mmu_set_page(entry, page, 0);
+		entry->field.dirty = dirty;
+	}
+
+	m68_mmu_flush_tlb();
+}
+
+uint32_t m68_mmu_collect_dirty(uint32_t address, uint32_t length, uint64_t *bitmap)
+{
+	uint32_t dirty = 0;
+	int rearmed = 0;
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address + offset);
+		if (entry == NULL || !entry->field.dirty) {
+			continue;
+		}
+
+		uint32_t page = offset / M68_MMU_PAGE_SIZE;
+		__atomic_fetch_or(&bitmap[page / 64], 1ULL << (page % 64), __ATOMIC_RELEASE);
+		entry->field.dirty = 0;
+		++dirty;
+
+		/* Only the slow path marks a page dirty, so it has to be taken by the
+		 * next write. The write buffer is indexed by logical address when
+		 * the PMMU is translating. */
+		struct m68_mmu_tlb_entry *tlb = m68_mmu_tlb_entry(MMU_WRITE_TLB, address + offset);
+		if (m68_mmu_translating) {
+			rearmed = 1;
+		} else if (tlb->tag == address + offset) {
+			tlb->tag = M68_MMU_TLB_INVALID;
+		}
+	}
+
+	if (rearmed) {
+		m68_mmu_flush_write_tlb();
+	}
+	return dirty;
+}
+
+int m68_mmu_share_range(uint32_t address, uint32_t length)
+{
+	if (address & ~M68_MMU_PAGE_MASK) {
+		return 1;
+	}
+
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address + offset);
+		if (entry == NULL || !entry->field.present || entry->field.shared) {
+			continue;
+		}
+
+		uint8_t *page = m68_page_pool_acquire(m68_mmu_page_resident(entry));
+		if (page == NULL) {
+			m68_mmu_flush_tlb();
+			return 1;
+		}
+		m68_mmu_release_page(entry);
+		m68_mmu_set_page(entry, page, 1);
+	}
+
+	m68_mmu_flush_tlb();
+	return 0;
+}
+
+// MARK: - Sweeping
+
+uint32_t m68_mmu_sweep(void)
+{
+	uint32_t compressed = 0;
+	for (int i = 0; i < MMU_PAGE_DIR_MAX_ENTRIES; ++i) {
+		if (!MMU_PAGE_DIR[i].field.present) {
+			continue;
+		}
+		union m68_mmu_page_entry *table = (void *)((uintptr_t)MMU_PAGE_DIR[i].field.address << 2);
+		for (int j = 0; j < MMU_PAGE_TABLE_MAX_ENTRIES; ++j) {
+			union m68_mmu_page_entry *entry = &table[j];
+			if (!entry->field.present || entry->field.shared || entry->field.compressed || entry->field.external) {
+				continue;
+			}
+			if (entry->field.referenced) {
+				entry->field.referenced = 0;
+			} else {
+				compressed += m68_mmu_compress(entry);
+			}
+		}
+	}
+
+	/* Pages held by the look-aside buffers are accessed without setting the
+	 * referenced flag, so they have to be loaded again. Decoded instructions
+	 * do not refer to pages, and are kept. */
+	for (int i = 0; i < M68_MMU_TLB_ENTRIES; ++i) {
+		MMU_READ_TLB[i].tag = M68_MMU_TLB_INVALID;
+		MMU_WRITE_TLB[i].tag = M68_MMU_TLB_INVALID;
+	}
+	return compressed;
+}
+
+void m68_mmu_compression_stats(struct m68_mmu_compression_stats *stats)
+{
+	memset(stats, 0, sizeof(*stats));
+	stats->decompressions = m68_mmu_decompressions;
+	for (int i = 0; i < MMU_PAGE_DIR_MAX_ENTRIES; ++i) {
+		if (!MMU_PAGE_DIR[i].field.present) {
+			continue;
+		}
+		union m68_mmu_page_entry *table = (void *)((uintptr_t)MMU_PAGE_DIR[i].field.address << 2);
+		for (int j = 0; j < MMU_PAGE_TABLE_MAX_ENTRIES; ++j) {
+			if (!table[j].field.present || table[j].field.shared) {
+				continue;
+			}
+			if (table[j].field.compressed) {
+				const struct m68_mmu_compressed_page *page = (void *)m68_mmu_page_address(&table[j]);
+				++stats->compressed_pages;
+				stats->compressed_bytes += page->length;
+			} else {
+				++stats->resident_pages;
+			}
+		}
+	}
+}
+
+// MARK: - Translation Look-aside Buffers
+
+/* Decoded instructions are cached by logical address, so they go whenever a
+ * translation does. */
+void m68_mmu_flush_tlb(void)
+{
+	for (int i = 0; i < M68_MMU_TLB_ENTRIES; ++i) {
+		MMU_READ_TLB[i].tag = M68_MMU_TLB_INVALID;
+		MMU_WRITE_TLB[i].tag = M68_MMU_TLB_INVALID;
+	}
+	m68_cache_flush();
+}
+
+void m68_mmu_flush_write_tlb(void)
+{
+	for (int i = 0; i < M68_MMU_TLB_ENTRIES; ++i) {
+		MMU_WRITE_TLB[i].tag = M68_MMU_TLB_INVALID;
+	}
+}
+
+void m68_mmu_invalidate_tlb(uint32_t address)
+{
+	uint32_t tag = address & M68_MMU_PAGE_MASK;
+	struct m68_mmu_tlb_entry *read = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	struct m68_mmu_tlb_entry *write = m68_mmu_tlb_entry(MMU_WRITE_TLB, address);
+	if (read->tag == tag) {
+		read->tag = M68_MMU_TLB_INVALID;
+	}
+	if (write->tag == tag) {
+		write->tag = M68_MMU_TLB_INVALID;
+	}
+	m68_cache_flush_range(tag, M68_MMU_PAGE_SIZE);
+}
+
+void m68_mmu_set_translation(int enabled, uint32_t boundary)
+{
+	m68_mmu_translating = enabled;
+	m68_mmu_boundary = boundary;
+	m68_mmu_flush_tlb();
+}
+
+void m68_mmu_set_debug_flags(uint32_t address, int watch, int breakpoint)
+{
+	/* A page without a table has no flags to clear, so only setting them
+	 * allocates one. */
+	union m68_mmu_page_entry *entry = (watch || breakpoint)
+		? m68_mmu_page_entry(address)
+		: m68_mmu_find_page_entry(address);
+	if (entry == NULL) {
+		return;
+	}
+	if (entry->field.watch == (watch != 0) && entry->field.breakpoint == (breakpoint != 0)) {
+		return;
+	}
+	if (entry->field.watch != (watch != 0)) {
+		m68_mmu_watched_pages += watch ? 1 : -1;
+	}
+	entry->field.watch = watch ? 1 : 0;
+	entry->field.breakpoint = breakpoint ? 1 : 0;
+
+	/* Only this page's look-aside entries and decoded instructions can have
+	 * been cached with the old flags. */
+	m68_mmu_invalidate_tlb(address);
+}
+
+/* Whether the page containing the address has a watchpoint. This is only
+ * reached from the slow paths, and is skipped entirely if no page does. */
+static inline int m68_mmu_watched(uint32_t address)
+{
+	if (__builtin_expect(m68_mmu_watched_pages == 0, 1)) {
+		return 0;
+	}
+	union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address);
+	return entry && entry->field.watch;
+}
+
+/* Whether an access to an unallocated page at the address is a bus error. */
+static inline int m68_mmu_out_of_range(uint32_t address)
+{
+	return m68_mmu_memory_limit && address >= m68_mmu_memory_limit;
+}
+
+/* Translate a logical address to a physical one with the PMMU, if it is
+ * enabled. Returns 1 if the look-aside buffers may cache the page, 0 if not,
+ * or -1 if the access raised a bus error. */
+static inline int m68_mmu_physical(uint32_t address, int write, int fetch, uint32_t *physical)
+{
+	*physical = address;
+	if (__builtin_expect(!m68_mmu_translating, 1)) {
+		return 1;
+	}
+	return m68_pmmu_translate(address, write, fetch, physical);
+}
+
+/* Load the page containing the address into the read look-aside buffer.
+ * Memory that has never been written reads as zero without being allocated,
+ * unless it is out of range. The debug flags belong to the logical address,
+ * and the page to the physical one. */
+static uint8_t *m68_mmu_fill_read(uint32_t address, int fetch)
+{
+	uint32_t physical;
+	int cacheable = m68_mmu_physical(address, 0, fetch, &physical);
+	if (cacheable < 0) {
+		return (uint8_t *)m68_mmu_zero_page + (address & ~M68_MMU_PAGE_MASK);
+	}
+
+	union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address);
+	uint8_t *page = m68_mmu_page_lookup(physical);
+	if (page == NULL) {
+		/* A bus error is raised on every access, so the page is not cached. */
+		if (m68_mmu_out_of_range(physical)) {
+			m68_exception_bus_error(address, 0, 0);
+			return (uint8_t *)m68_mmu_zero_page + (address & ~M68_MMU_PAGE_MASK);
+		}
+		page = (uint8_t *)m68_mmu_zero_page;
+	}
+	if (!cacheable || (entry && (entry->field.watch || entry->field.breakpoint))) {
+		return page + (physical & ~M68_MMU_PAGE_MASK);
+	}
+
+	struct m68_mmu_tlb_entry *tlb = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	tlb->page = page;
+	tlb->tag = address & M68_MMU_PAGE_MASK;
+	return page + (address & ~M68_MMU_PAGE_MASK);
+}
+
+/* Load the page containing the address into the write look-aside buffer. As
+ * writes only reach the page table here, this is where it is marked dirty, and
+ * where a page is allocated or a shared page is copied. */
+static uint8_t *m68_mmu_fill_write(uint32_t address)
+{
+	uint32_t physical;
+	int cacheable = m68_mmu_physical(address, 1, 0, &physical);
+	if (cacheable < 0) {
+		return m68_mmu_sink_page + (address & ~M68_MMU_PAGE_MASK);
+	}
+
+	if (m68_mmu_out_of_range(physical) && m68_mmu_page_lookup(physical) == NULL) {
+		m68_exception_bus_error(address, 1, 0);
+		return m68_mmu_sink_page + (address & ~M68_MMU_PAGE_MASK);
+	}
+
+	uint8_t *page = m68_mmu_page_alloc(physical);
+	m68_mmu_page_entry(physical)->field.dirty = 1;
+	union m68_mmu_page_entry *flags = m68_mmu_find_page_entry(address);
+	if (!cacheable || (flags && flags->field.watch)) {
+		return page + (physical & ~M68_MMU_PAGE_MASK);
+	}
+
+	struct m68_mmu_tlb_entry *tlb = m68_mmu_tlb_entry(MMU_WRITE_TLB, address);
+	tlb->page = page;
+	tlb->tag = address & M68_MMU_PAGE_MASK;
+	return page + (address & ~M68_MMU_PAGE_MASK);
+}
+
+/* Misaligned word and long accesses are an address error on the 68000 and
+ * 68010, and permitted from the 68020 onwards. */
+static inline int m68_mmu_check_alignment(uint32_t address, int write)
+{
+	if ((address & 1) && CPU68.model < M68_MODEL_68020) {
+		m68_exception_address_error(address, write, 0);
+		return 0;
+	}
+	return 1;
+}
+
+/* Whether an access of the specified size crosses into the next page, or
+ * with the PMMU using smaller pages, the next of those. */
+static inline int m68_mmu_crosses_page(uint32_t address, uint32_t size)
+{
+	return (address & (m68_mmu_boundary - 1)) > m68_mmu_boundary - size;
+}
+
 // MARK: - Write
 
-void m68_mmu_write_byte(uint32_t address, uint8_t value)
+void m68_mmu_write_byte_slow(uint32_t address, uint8_t value)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	*ptr = value;
+	++MMU_SLOW_WRITES;
+	m68_mmu_store_byte(m68_mmu_fill_write(address), value);
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 1, value, 1);
+	}
 }
 
-void m68_mmu_write_word(uint32_t address, uint16_t value)
+void m68_mmu_write_word_slow(uint32_t address, uint16_t value)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	value = TO_BIG_WORD(value);
-	*(ptr + 1) = (value >> 8);
-	*(ptr + 0) = value;
+	++MMU_SLOW_WRITES;
+	if (!m68_mmu_check_alignment(address, 1)) {
+		return;
+	}
+	if (m68_mmu_crosses_page(address, 2)) {
+		m68_mmu_write_byte(address, value >> 8);
+		m68_mmu_write_byte(address + 1, value);
+		return;
+	}
+	m68_mmu_store_word_unaligned(m68_mmu_fill_write(address), value);
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 2, value, 1);
+	}
 }
 
-void m68_mmu_write_long(uint32_t address, uint32_t value)
+void m68_mmu_write_long_slow(uint32_t address, uint32_t value)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	value = TO_BIG_LONG(value);
-	*(ptr + 3) = (value >> 24);
-	*(ptr + 2) = (value >> 16);
-	*(ptr + 1) = (value >> 8);
-	*(ptr + 0) = value;
+	++MMU_SLOW_WRITES;
+	if (!m68_mmu_check_alignment(address, 1)) {
+		return;
+	}
+	if (m68_mmu_crosses_page(address, 4)) {
+		m68_mmu_write_byte(address, value >> 24);
+		m68_mmu_write_byte(address + 1, value >> 16);
+		m68_mmu_write_byte(address + 2, value >> 8);
+		m68_mmu_write_byte(address + 3, value);
+		return;
+	}
+	m68_mmu_store_long_unaligned(m68_mmu_fill_write(address), value);
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 4, value, 1);
+	}
 }
 
 // MARK: - Read
 
-uint8_t m68_mmu_read_byte(uint32_t address)
+uint8_t m68_mmu_read_byte_slow(uint32_t address)
+{
+	uint8_t value = m68_mmu_load_byte(m68_mmu_fill_read(address, 0));
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 1, value, 0);
+	}
+	return value;
+}
+
+uint16_t m68_mmu_read_word_slow(uint32_t address)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	return *ptr;
+	if (!m68_mmu_check_alignment(address, 0)) {
+		return 0;
+	}
+	if (m68_mmu_crosses_page(address, 2)) {
+		return (uint16_t)((m68_mmu_read_byte(address) << 8) | m68_mmu_read_byte(address + 1));
+	}
+	uint16_t value = m68_mmu_load_word_unaligned(m68_mmu_fill_read(address, 0));
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 2, value, 0);
+	}
+	return value;
 }
 
-uint16_t m68_mmu_read_word(uint32_t address)
+uint32_t m68_mmu_read_long_slow(uint32_t address)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	uint16_t value = (*(ptr + 1) << 8) | *(ptr + 0);
-	return FROM_BIG_WORD(value);
+	if (!m68_mmu_check_alignment(address, 0)) {
+		return 0;
+	}
+	if (m68_mmu_crosses_page(address, 4)) {
+		return ((uint32_t)m68_mmu_read_byte(address) << 24)
+			| ((uint32_t)m68_mmu_read_byte(address + 1) << 16)
+			| ((uint32_t)m68_mmu_read_byte(address + 2) << 8)
+			| m68_mmu_read_byte(address + 3);
+	}
+	uint32_t value = m68_mmu_load_long_unaligned(m68_mmu_fill_read(address, 0));
+	if (m68_mmu_watched(address)) {
+		m68_debug_access(address, 4, value, 0);
+	}
+	return value;
 }
 
-uint32_t m68_mmu_read_long(uint32_t address)
+// MARK: - Instruction Fetch
+
+int m68_mmu_fetch_word_slow(uint32_t address, uint16_t *opcode)
 {
-	uint8_t *ptr = m68_mmu_translate(address);
-	uint32_t value = (*(ptr + 3) << 24) | (*(ptr + 2) << 16) | (*(ptr + 1) << 8) | *(ptr + 0);
-	return FROM_BIG_LONG(value);
+	union m68_mmu_page_entry *entry = m68_mmu_find_page_entry(address);
+	if (entry && entry->field.breakpoint && !m68_debug_fetch(address)) {
+		return 0;
+	}
+
+	/* Instruction fetches are not data accesses, so do not trigger
+	 * watchpoints. The run loop only fetches from even addresses, so the word
+	 * never crosses a page. */
+	*opcode = m68_mmu_load_word(m68_mmu_fill_read(address, 1));
+	return 1;
 }
@@ -21,7 +21,9 @@
  */
 
 #include <stdint.h>
+#include <string.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 
 #if !defined(lib68_MemoryManagementUnit)
 #define lib68_MemoryManagementUnit
@@ -36,17 +38,65 @@ union m68_mmu_page_table_entry {
 	} field __attribute__((packed));
 };
 
+/* Page Entry
+ * A shared page belongs to the process wide page pool (cpu/page_pool.h) and
+ * may be mapped by other address spaces, so it is copied into a private page
+ * before it is first written.
+ *
+ * The referenced flag is set whenever the page is loaded into a look-aside
+ * buffer, and cleared by m68_mmu_sweep(), which compresses pages that have not
+ * been referenced since the last sweep. The address of a compressed page is
+ * that of its compressed data.
+ *
+ * An external page belongs to host memory mapped with m68_mmu_map_host(),
+ * and is never freed, compressed or moved by the MMU.
+ *
+ * Pages with watchpoints or breakpoints (cpu/debug.h) are kept out of the
+ * look-aside buffers, so that only accesses to those pages take the slow path
+ * where the exact ranges are checked. The debug flags belong to the address
+ * rather than the page, and may be set before the page is present.
+ *
+ * Pages are at least 16 byte aligned, so the address is stored shifted down
+ * by 4 bits. */
 union m68_mmu_page_entry {
 	uintptr_t value;
 	struct {
 		uintptr_t present:1;
 		uintptr_t dirty:1;
-		uintptr_t reserved:2;
-		uintptr_t address:60;
+		uintptr_t shared:1;
+		uintptr_t watch:1;
+		uintptr_t breakpoint:1;
+		uintptr_t referenced:1;
+		uintptr_t compressed:1;
+		uintptr_t external:1;
+		uintptr_t address:56;
 	} field __attribute__((packed));
 };
 
+#define M68_MMU_PAGE_SIZE	0x1000
+#define M68_MMU_PAGE_MASK	(~(uint32_t)(M68_MMU_PAGE_SIZE - 1))
+#define M68_MMU_TLB_ENTRIES	256
+
+/* Translation Look-aside Buffer Entry
+ * Caches the host page backing a guest page. Reads and writes have their own
+ * buffers so that a page can be made to take the slow path for one kind of
+ * access only. The tag is the guest page address, and is never odd, so that
+ * the alignment of an access can be checked in the same comparison. */
+struct m68_mmu_tlb_entry {
+	uint32_t tag;
+	uint8_t *page;
+};
+
+#define M68_MMU_TLB_INVALID	0x2
+
 extern union m68_mmu_page_table_entry *MMU_PAGE_DIR;
+extern struct m68_mmu_tlb_entry MMU_READ_TLB[M68_MMU_TLB_ENTRIES];
+extern struct m68_mmu_tlb_entry MMU_WRITE_TLB[M68_MMU_TLB_ENTRIES];
+
+/* Number of writes that have taken the slow path. After flushing the write
+ * look-aside buffer, every write takes the slow path until its page is loaded
+ * again, so this can be used to tell whether anything was written. */
+extern uint64_t MMU_SLOW_WRITES;
 
 /* Initialise memory with the specified number of bytes. As there can only be
  * a single memory structure, it is initialised into a global variable.
@@ -58,25 +108,335 @@ int m68_mmu_initialise(void);
 void m68_mmu_destroy(void);
 
 /* Allocate the page at the specified memory address if it isn't already 
- * allocated. */
+ * allocated. The page returned is private to this address space, and may be
+ * written, so a shared page is copied first. */
 void *m68_mmu_page_alloc(uint32_t address);
 
+/* Translate the specified address into a pointer to host memory, allocating
+ * the page if it isn't already allocated. The memory is in the layout
+ * described under Host Memory below. */
+void *m68_mmu_translate(uint32_t address);
+
+/* Translate the specified address into a pointer to host memory that may only
+ * be read. Nothing is allocated, and shared pages are not copied. Memory that
+ * has not been allocated reads as zero. */
+const void *m68_mmu_translate_read(uint32_t address);
+
+/* Copy between host memory, in the guest's byte order, and guest memory at a
+ * physical address, converting between layouts if need be. Writing allocates
+ * memory and marks it dirty, but does not trip watchpoints. The decode cache
+ * must be flushed after writing code (cpu/cache.h). */
+void m68_mmu_write_block(uint32_t address, const void *data, uint32_t length);
+void m68_mmu_read_block(uint32_t address, void *buffer, uint32_t length);
+
+/* Describe guest memory at a physical address as spans of host memory, so
+ * that a device can transfer straight to or from it with readv()/writev() and
+ * friends. Spans are written to out, a page at a time, with neighbouring
+ * pages that are contiguous in host memory merged into one. Returns the
+ * number of spans written, or -1 if the range does not fit in count spans or
+ * runs into missing memory beyond the limit.
+ *
+ * If writable is set, the pages are allocated, shared pages are copied and
+ * every page is marked dirty, as by m68_mmu_write_block(); otherwise the
+ * spans may point at shared pages or the zero page and must only be read. The
+ * spans hold memory in the memory layout, so in a swizzled build the address
+ * and length must be even and the host has to swap the bytes of each word.
+ * They are only good until memory is next remapped, swept or collected, so
+ * they should be mapped afresh for each transfer. */
+int m68_mmu_map_span(uint32_t address, uint32_t length, int writable, struct iovec *out, uint32_t count);
+
+/* Memory is allocated on its first write, and reads as zero until then. With
+ * a limit set, reads and writes of unallocated pages at or above the limit
+ * raise a bus error instead, so a guest sizing memory or probing for hardware
+ * sees where memory ends. Mapped pages are unaffected. Zero removes the
+ * limit, which is the default. */
+void m68_mmu_set_memory_limit(uint32_t limit);
+
+/* Map the specified data, such as a ROM image, at the specified page aligned
+ * address using shared pages. Any pages already there are replaced, and the
+ * end of the last page is filled with zeroes. Returns 0 on success. */
+int m68_mmu_map_shared(uint32_t address, const void *data, uint32_t length);
+
+/* Back the specified page aligned range with host memory, which must be
+ * 16 byte aligned and hold the range in the memory layout. The memory is
+ * used in place, and must outlive the mapping. Any pages already there are
+ * replaced. Returns 0 on success. */
+int m68_mmu_map_host(uint32_t address, void *host, uint32_t length);
+
+/* Replace the host memory mapped in the specified range with private copies
+ * of its contents. */
+void m68_mmu_unmap_host(uint32_t address, uint32_t length);
+
+/* Set the bit of each page in the specified page aligned range that has been
+ * written since the last collection in the bitmap, one bit per page from the
+ * start of the range, in 64-bit words. The bits are set atomically, so the
+ * bitmap may be shared with another thread or process. The pages are marked
+ * clean, and their next write marks them dirty again. Returns the number of
+ * dirty pages. */
+uint32_t m68_mmu_collect_dirty(uint32_t address, uint32_t length, uint64_t *bitmap);
+
+/* Move every allocated page in the specified page aligned range into the
+ * shared page pool, so that they are held once if another address space has
+ * identical pages. Returns 0 on success. */
+int m68_mmu_share_range(uint32_t address, uint32_t length);
+
+// MARK: - Cold Page Compression
+
+/* Hosts that keep many idle instances can hold their cold pages compressed
+ * (cpu/lz.h). Each sweep compresses the private pages that have not been
+ * accessed since the previous one, and that compress to half a page or less.
+ * A compressed page is decompressed transparently on its next access, which
+ * reaches it through the slow paths.
+ *
+ * Sweeping is optional, and only done when the host calls m68_mmu_sweep(),
+ * between instructions or while the instance is parked. The look-aside
+ * buffers are flushed by a sweep, so pointers returned by m68_mmu_translate()
+ * and m68_mmu_translate_read() must not be kept across one. */
+struct m68_mmu_compression_stats {
+	uint32_t resident_pages;	/* Private pages held uncompressed */
+	uint32_t compressed_pages;
+	uint64_t compressed_bytes;	/* Held by the compressed pages */
+	uint64_t decompressions;	/* Since memory was initialised */
+};
+
+/* Compress the pages that have not been referenced since the last sweep.
+ * Returns the number of pages compressed. */
+uint32_t m68_mmu_sweep(void);
+
+void m68_mmu_compression_stats(struct m68_mmu_compression_stats *stats);
+
+/* Invalidate every entry in the translation look-aside buffers, and every
+ * decoded instruction (cpu/cache.h). This must be done whenever a page is
+ * remapped. */
+void m68_mmu_flush_tlb(void);
+
+/* Set the watch and breakpoint flags of the page containing the address, and
+ * invalidate anything cached for that page alone. */
+void m68_mmu_set_debug_flags(uint32_t address, int watch, int breakpoint);
+
+/* Invalidate every entry in the write look-aside buffer only. */
+void m68_mmu_flush_write_tlb(void);
+
+/* Invalidate the look-aside buffer entries and decoded instructions for the
+ * page containing the address. */
+void m68_mmu_invalidate_tlb(uint32_t address);
+
+// MARK: - Address Translation
+
+/* With translation enabled, the addresses given to the accessors below are
+ * logical, and are translated by the PMMU (cpu/pmmu.h) on the slow paths. The
+ * look-aside buffers then map logical pages to host pages. The page table,
+ * m68_mmu_translate() and friends always use physical addresses, while the
+ * debug flags belong to the logical address. Accesses are split at the
+ * specified boundary, which is the PMMU page size if that is below 4KiB.
+ * This is called by the PMMU, and flushes the look-aside buffers. */
+void m68_mmu_set_translation(int enabled, uint32_t boundary);
+
+/* Read or write a long at a physical address, as the PMMU does when walking
+ * the translation tables. */
+uint32_t m68_mmu_read_physical_long(uint32_t address);
+void m68_mmu_write_physical_long(uint32_t address, uint32_t value);
+
+// MARK: - Slow Paths
+
+/* The slow paths handle everything the inline accessors below do not: filling
+ * the look-aside buffers, accesses that cross a page boundary, and misaligned
+ * accesses, which raise an address error on the 68000 and 68010. */
+void m68_mmu_write_byte_slow(uint32_t address, uint8_t value);
+void m68_mmu_write_word_slow(uint32_t address, uint16_t value);
+void m68_mmu_write_long_slow(uint32_t address, uint32_t value);
+uint8_t m68_mmu_read_byte_slow(uint32_t address);
+uint16_t m68_mmu_read_word_slow(uint32_t address);
+uint32_t m68_mmu_read_long_slow(uint32_t address);
+int m68_mmu_fetch_word_slow(uint32_t address, uint16_t *opcode);
+
+// MARK: - Host Memory
+
+/* Memory Layout
+ * Pages normally hold guest memory in the guest's byte order, so every word
+ * and long access swaps bytes on a little-endian host. Built with
+ * M68_SWIZZLED_MEMORY, pages hold guest memory as host 16-bit words instead:
+ * the guest byte at offset n into a page is at host offset n ^ 1. A word at
+ * an even address is then a plain load, and a long only exchanges its two
+ * halves. On a big-endian host both layouts are the same.
+ *
+ * Anything that looks inside a page must use the helpers below, which take
+ * the page plus the guest offset. Words and longs must be at even offsets,
+ * other than with the unaligned helpers. */
+#if defined(M68_SWIZZLED_MEMORY) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#	define M68_MMU_SWIZZLE	1
+#else
+#	define M68_MMU_SWIZZLE	0
+#endif
+
+/* The host offset of the guest byte at the specified offset into a page. */
+#define M68_MMU_BYTE_OFFSET(_OFFSET)	((_OFFSET) ^ M68_MMU_SWIZZLE)
+
+static inline uint8_t m68_mmu_load_byte(const uint8_t *ptr)
+{
+	return *(const uint8_t *)((uintptr_t)ptr ^ M68_MMU_SWIZZLE);
+}
+
+static inline void m68_mmu_store_byte(uint8_t *ptr, uint8_t value)
+{
+	*(uint8_t *)((uintptr_t)ptr ^ M68_MMU_SWIZZLE) = value;
+}
+
+static inline uint16_t m68_mmu_load_word(const uint8_t *ptr)
+{
+#if M68_MMU_SWIZZLE
+	uint16_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return value;
+#else
+	return (uint16_t)((ptr[0] << 8) | ptr[1]);
+#endif
+}
+
+static inline uint32_t m68_mmu_load_long(const uint8_t *ptr)
+{
+#if M68_MMU_SWIZZLE
+	uint32_t value;
+	memcpy(&value, ptr, sizeof(value));
+	return (value << 16) | (value >> 16);
+#else
+	return ((uint32_t)ptr[0] << 24) | ((uint32_t)ptr[1] << 16) | ((uint32_t)ptr[2] << 8) | ptr[3];
+#endif
+}
+
+static inline void m68_mmu_store_word(uint8_t *ptr, uint16_t value)
+{
+#if M68_MMU_SWIZZLE
+	memcpy(ptr, &value, sizeof(value));
+#else
+	ptr[0] = (uint8_t)(value >> 8);
+	ptr[1] = (uint8_t)value;
+#endif
+}
+
+static inline void m68_mmu_store_long(uint8_t *ptr, uint32_t value)
+{
+#if M68_MMU_SWIZZLE
+	value = (value << 16) | (value >> 16);
+	memcpy(ptr, &value, sizeof(value));
+#else
+	ptr[0] = (uint8_t)(value >> 24);
+	ptr[1] = (uint8_t)(value >> 16);
+	ptr[2] = (uint8_t)(value >> 8);
+	ptr[3] = (uint8_t)value;
+#endif
+}
+
+static inline uint16_t m68_mmu_load_word_unaligned(const uint8_t *ptr)
+{
+	return (uint16_t)((m68_mmu_load_byte(ptr) << 8) | m68_mmu_load_byte(ptr + 1));
+}
+
+static inline uint32_t m68_mmu_load_long_unaligned(const uint8_t *ptr)
+{
+	return ((uint32_t)m68_mmu_load_word_unaligned(ptr) << 16) | m68_mmu_load_word_unaligned(ptr + 2);
+}
+
+static inline void m68_mmu_store_word_unaligned(uint8_t *ptr, uint16_t value)
+{
+	m68_mmu_store_byte(ptr, (uint8_t)(value >> 8));
+	m68_mmu_store_byte(ptr + 1, (uint8_t)value);
+}
+
+static inline void m68_mmu_store_long_unaligned(uint8_t *ptr, uint32_t value)
+{
+	m68_mmu_store_word_unaligned(ptr, (uint16_t)(value >> 16));
+	m68_mmu_store_word_unaligned(ptr + 2, (uint16_t)value);
+}
+
+static inline struct m68_mmu_tlb_entry *m68_mmu_tlb_entry(struct m68_mmu_tlb_entry *tlb, uint32_t address)
+{
+	return &tlb[(address >> 12) & (M68_MMU_TLB_ENTRIES - 1)];
+}
+
+// MARK: - Write
+
 /* Write byte to the specified address. */
-void m68_mmu_write_byte(uint32_t address, uint8_t value);
+static inline void m68_mmu_write_byte(uint32_t address, uint8_t value)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_WRITE_TLB, address);
+	if (__builtin_expect((address & M68_MMU_PAGE_MASK) == entry->tag, 1)) {
+		m68_mmu_store_byte(entry->page + (address & ~M68_MMU_PAGE_MASK), value);
+		return;
+	}
+	m68_mmu_write_byte_slow(address, value);
+}
 
 /* Write word to the specified address. */
-void m68_mmu_write_word(uint32_t address, uint16_t value);
+static inline void m68_mmu_write_word(uint32_t address, uint16_t value)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_WRITE_TLB, address);
+	if (__builtin_expect((address & (M68_MMU_PAGE_MASK | 1)) == entry->tag, 1)) {
+		m68_mmu_store_word(entry->page + (address & ~M68_MMU_PAGE_MASK), value);
+		return;
+	}
+	m68_mmu_write_word_slow(address, value);
+}
 
-/* Write long to the specified address. */
-void m68_mmu_write_long(uint32_t address, uint32_t value);
+/* Write long to the specified address. The tag is checked against the
+ * address of the second word, which only lies in the same page as the first
+ * if the long does not cross into the next page. */
+static inline void m68_mmu_write_long(uint32_t address, uint32_t value)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_WRITE_TLB, address);
+	if (__builtin_expect(((address + 2) & (M68_MMU_PAGE_MASK | 1)) == entry->tag, 1)) {
+		m68_mmu_store_long(entry->page + (address & ~M68_MMU_PAGE_MASK), value);
+		return;
+	}
+	m68_mmu_write_long_slow(address, value);
+}
+
+// MARK: - Read
 
 /* Read byte from the specified address. */
-uint8_t m68_mmu_read_byte(uint32_t address);
+static inline uint8_t m68_mmu_read_byte(uint32_t address)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	if (__builtin_expect((address & M68_MMU_PAGE_MASK) == entry->tag, 1)) {
+		return m68_mmu_load_byte(entry->page + (address & ~M68_MMU_PAGE_MASK));
+	}
+	return m68_mmu_read_byte_slow(address);
+}
 
 /* Read word from the specified address. */
-uint16_t m68_mmu_read_word(uint32_t address);
+static inline uint16_t m68_mmu_read_word(uint32_t address)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	if (__builtin_expect((address & (M68_MMU_PAGE_MASK | 1)) == entry->tag, 1)) {
+		return m68_mmu_load_word(entry->page + (address & ~M68_MMU_PAGE_MASK));
+	}
+	return m68_mmu_read_word_slow(address);
+}
+
+/* Read long from the specified address. See m68_mmu_write_long. */
+static inline uint32_t m68_mmu_read_long(uint32_t address)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	if (__builtin_expect(((address + 2) & (M68_MMU_PAGE_MASK | 1)) == entry->tag, 1)) {
+		return m68_mmu_load_long(entry->page + (address & ~M68_MMU_PAGE_MASK));
+	}
+	return m68_mmu_read_long_slow(address);
+}
+
+// MARK: - Instruction Fetch
 
-/* Read long from the specified address. */
-uint32_t m68_mmu_read_long(uint32_t address);
+/* Fetch the opcode at the specified address. This is a read, except that
+ * breakpoints are checked. Returns 0 if a breakpoint stops execution before
+ * the instruction, in which case the opcode is not fetched. The fast path
+ * always succeeds, so the caller's check disappears from it. */
+static inline int m68_mmu_fetch_word(uint32_t address, uint16_t *opcode)
+{
+	struct m68_mmu_tlb_entry *entry = m68_mmu_tlb_entry(MMU_READ_TLB, address);
+	if (__builtin_expect((address & (M68_MMU_PAGE_MASK | 1)) == entry->tag, 1)) {
+		*opcode = m68_mmu_load_word(entry->page + (address & ~M68_MMU_PAGE_MASK));
+		return 1;
+	}
+	return m68_mmu_fetch_word_slow(address, opcode);
+}
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "cpu/mmu.h"
+#include "cpu/page_pool.h"
+
+#define M68_PAGE_POOL_BUCKETS	1024
+
+struct m68_shared_page {
+	struct m68_shared_page *next;
+	uint64_t hash;
+	uint32_t references;
+	_Alignas(16) uint8_t data[M68_MMU_PAGE_SIZE];
+};
+
+static pthread_mutex_t m68_page_pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct m68_shared_page *m68_page_pool_buckets[M68_PAGE_POOL_BUCKETS];
+static uint32_t m68_page_pool_pages = 0;
+
+// MARK: - Helpers
+
+/* FNV-1a over the page, a word at a time. */
+static uint64_t m68_page_pool_hash(const uint8_t *data)
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < M68_MMU_PAGE_SIZE; i += sizeof(uint64_t)) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 0x100000001B3ULL;
+	}
+	return hash ^ (hash >> 32);
+}
+
+static inline struct m68_shared_page *m68_page_pool_header(const uint8_t *page)
+{
+	return (struct m68_shared_page *)(page - offsetof(struct m68_shared_page, data));
+}
+
+// MARK: - Pool
+
+uint8_t *m68_page_pool_acquire(const uint8_t *data)
+{
+	uint64_t hash = m68_page_pool_hash(data);
+	struct m68_shared_page **bucket = &m68_page_pool_buckets[hash % M68_PAGE_POOL_BUCKETS];
+
+	pthread_mutex_lock(&m68_page_pool_lock);
+	for (struct m68_shared_page *shared = *bucket; shared; shared = shared->next) {
+		if (shared->hash == hash && memcmp(shared->data, data, M68_MMU_PAGE_SIZE) == 0) {
+			++shared->references;
+			pthread_mutex_unlock(&m68_page_pool_lock);
+			return shared->data;
+		}
+	}
+
+	struct m68_shared_page *shared = malloc(sizeof(*shared));
+	if (shared == NULL) {
+		pthread_mutex_unlock(&m68_page_pool_lock);
+		return NULL;
+	}
+	memcpy(shared->data, data, M68_MMU_PAGE_SIZE);
+	shared->hash = hash;
+	shared->references = 1;
+	shared->next = *bucket;
+	*bucket = shared;
+	++m68_page_pool_pages;
+	pthread_mutex_unlock(&m68_page_pool_lock);
+
+	return shared->data;
+}
+
+void m68_page_pool_release(uint8_t *page)
+{
+	struct m68_shared_page *shared = m68_page_pool_header(page);
+
+	pthread_mutex_lock(&m68_page_pool_lock);
+	if (--shared->references == 0) {
+		struct m68_shared_page **link = &m68_page_pool_buckets[shared->hash % M68_PAGE_POOL_BUCKETS];
+		while (*link != shared) {
+			link = &(*link)->next;
+		}
+		*link = shared->next;
+		--m68_page_pool_pages;
+		free(shared);
+	}
+	pthread_mutex_unlock(&m68_page_pool_lock);
+}
+
+uint32_t m68_page_pool_references(const uint8_t *page)
+{
+	pthread_mutex_lock(&m68_page_pool_lock);
+	uint32_t references = m68_page_pool_header(page)->references;
+	pthread_mutex_unlock(&m68_page_pool_lock);
+	return references;
+}
+
+uint32_t m68_page_pool_count(void)
+{
+	pthread_mutex_lock(&m68_page_pool_lock);
+	uint32_t count = m68_page_pool_pages;
+	pthread_mutex_unlock(&m68_page_pool_lock);
+	return count;
+}
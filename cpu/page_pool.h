@@ -0,0 +1,52 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_PagePool)
+#define lib68_PagePool
+
+/* Shared Page Pool
+ * Read-only pages (ROM images, and pages of system files that every guest
+ * loads) are kept once per process, however many address spaces map them.
+ * Pages are found by content, and reference counted. The pool is guarded by a
+ * lock, as it is only used when pages are mapped, copied on write or
+ * released, never on an ordinary access.
+ *
+ * Pages in the pool must never be written. The MMU copies a shared page into
+ * a private one before the first write to it. */
+
+/* Find the shared page with the same contents as the specified page of data,
+ * adding it to the pool if there isn't one, and take a reference to it.
+ * Returns NULL if the page could not be allocated. */
+uint8_t *m68_page_pool_acquire(const uint8_t *data);
+
+/* Drop a reference to a shared page, removing it once no-one refers to it. */
+void m68_page_pool_release(uint8_t *page);
+
+/* Number of references to a shared page. */
+uint32_t m68_page_pool_references(const uint8_t *page);
+
+/* Number of distinct pages held by the pool. */
+uint32_t m68_page_pool_count(void);
+
+#endif
@@ -0,0 +1,780 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/exception.h"
+#include "cpu/pmmu.h"
+
+/* Descriptor types. */
+#define M68_PMMU_DT_INVALID	0
+#define M68_PMMU_DT_PAGE	1
+#define M68_PMMU_DT_SHORT	2
+#define M68_PMMU_DT_LONG	3
+
+/* Descriptor status bits, in the first long of every format. */
+#define M68_PMMU_DESC_WP	(1u << 2)
+#define M68_PMMU_DESC_U		(1u << 3)
+#define M68_PMMU_DESC_M		(1u << 4)
+#define M68_PMMU_DESC_S		(1u << 8)	/* Long format only */
+
+/* The decoded TC. */
+struct m68_pmmu_config {
+	int enabled;
+	uint8_t sre;
+	uint8_t fcl;
+	uint8_t page_shift;
+	uint8_t initial_shift;
+	uint8_t levels;		/* Index fields, not counting function code lookup */
+	uint8_t widths[4];
+	uint32_t page_mask;
+};
+
+/* An ATC entry. Translations that fault are cached too, with bus_error set. */
+struct m68_pmmu_atc_entry {
+	uint32_t logical;
+	uint32_t physical;
+	uint32_t last_used;
+	uint8_t valid;
+	uint8_t fc;
+	uint8_t bus_error;
+	uint8_t write_protected;
+	uint8_t supervisor;
+	uint8_t modified;
+};
+
+/* The outcome of a table walk. */
+struct m68_pmmu_walk {
+	uint32_t physical;
+	uint32_t descriptor;
+	uint8_t levels;
+	uint8_t invalid;
+	uint8_t limit;
+	uint8_t write_protected;
+	uint8_t supervisor;
+	uint8_t modified;
+};
+
+/* A transparent translation window, decoded from one of the TT registers. */
+struct m68_pmmu_window {
+	uint32_t base;
+	uint32_t mask;		/* Address bits that must match the base */
+	uint8_t fcs;		/* Function codes that match, one bit for each */
+	uint8_t accesses;	/* Bit 0 if reads match, bit 1 if writes match */
+	uint8_t write_protected;
+};
+
+static struct m68_pmmu_config m68_pmmu_config;
+static struct m68_pmmu_window m68_pmmu_windows[M68_PMMU_TT_COUNT];
+static const struct m68_pmmu_window *m68_pmmu_active_windows[M68_PMMU_TT_COUNT];
+static int m68_pmmu_active_window_count = 0;
+static struct m68_pmmu_atc_entry m68_pmmu_atc[M68_PMMU_ATC_ENTRIES];
+static uint32_t m68_pmmu_atc_clock = 0;
+static uint64_t m68_pmmu_walk_count = 0;
+
+// MARK: - Configuration
+
+static m68_register32_t *m68_pmmu_tt_register(enum m68_pmmu_tt tt)
+{
+	switch (tt) {
+		case M68_PMMU_TT0: return &CPU68.TT0;
+		case M68_PMMU_TT1: return &CPU68.TT1;
+		case M68_PMMU_ITT0: return &CPU68.ITT0;
+		case M68_PMMU_ITT1: return &CPU68.ITT1;
+		case M68_PMMU_DTT0: return &CPU68.DTT0;
+		default: return &CPU68.DTT1;
+	}
+}
+
+/* Decode and check a TC value. Returns 0, or 1 if it is not valid. */
+static int m68_pmmu_decode_tc(uint32_t tc, struct m68_pmmu_config *config)
+{
+	struct m68_pmmu_config decoded = { .enabled = (tc & M68_PMMU_TC_E) != 0 };
+	if (!decoded.enabled) {
+		*config = decoded;
+		return 0;
+	}
+
+	decoded.sre = (tc & M68_PMMU_TC_SRE) != 0;
+	decoded.fcl = (tc & M68_PMMU_TC_FCL) != 0;
+	decoded.page_shift = (tc >> 20) & 0xF;
+	decoded.initial_shift = (tc >> 16) & 0xF;
+
+	/* The index fields end at the first zero, and together with the initial
+	 * shift and page size must cover the whole address. */
+	uint32_t bits = decoded.initial_shift + decoded.page_shift;
+	for (int i = 0; i < 4; ++i) {
+		uint8_t width = (tc >> (12 - 4 * i)) & 0xF;
+		if (width == 0) {
+			break;
+		}
+		decoded.widths[decoded.levels++] = width;
+		bits += width;
+	}
+	if (decoded.page_shift < 8 || decoded.levels == 0 || bits != 32) {
+		return 1;
+	}
+
+	decoded.page_mask = ~((1u << decoded.page_shift) - 1);
+	*config = decoded;
+	return 0;
+}
+
+static void m68_pmmu_flush_atc(void)
+{
+	for (int i = 0; i < M68_PMMU_ATC_ENTRIES; ++i) {
+		m68_pmmu_atc[i].valid = 0;
+	}
+}
+
+/* Apply a TC value, flushing the ATC unless asked not to. The look-aside
+ * buffers are always flushed, as they may hold translations that the ATC
+ * has since evicted. */
+static int m68_pmmu_configure(uint32_t tc, int flush)
+{
+	struct m68_pmmu_config config;
+	if (m68_pmmu_decode_tc(tc, &config)) {
+		return 1;
+	}
+
+	CPU68.TC.value = tc;
+	m68_pmmu_config = config;
+	if (flush || !config.enabled) {
+		m68_pmmu_flush_atc();
+	}
+
+	uint32_t boundary = M68_MMU_PAGE_SIZE;
+	if (config.enabled && config.page_shift < 12) {
+		boundary = 1u << config.page_shift;
+	}
+	m68_mmu_set_translation(config.enabled, boundary);
+	return 0;
+}
+
+int m68_pmmu_set_tc(uint32_t tc)
+{
+	return m68_pmmu_configure(tc, 1);
+}
+
+int m68_pmmu_enabled(void)
+{
+	return m68_pmmu_config.enabled;
+}
+
+void m68_pmmu_reset(void)
+{
+	m68_pmmu_config = (struct m68_pmmu_config){ 0 };
+	m68_pmmu_active_window_count = 0;
+	for (int i = 0; i < M68_PMMU_TT_COUNT; ++i) {
+		m68_pmmu_tt_register(i)->value &= ~M68_PMMU_TT_E;
+	}
+	m68_pmmu_flush_atc();
+	m68_pmmu_atc_clock = 0;
+	m68_pmmu_walk_count = 0;
+	m68_mmu_set_translation(0, M68_MMU_PAGE_SIZE);
+}
+
+uint64_t m68_pmmu_walks(void)
+{
+	return m68_pmmu_walk_count;
+}
+
+void m68_pmmu_supervisor_changed(void)
+{
+	/* The look-aside buffers do not know which privilege level they were
+	 * loaded for. The ATC does, so it is kept. */
+	if (m68_pmmu_config.enabled) {
+		m68_mmu_flush_tlb();
+	}
+}
+
+// MARK: - Transparent Translation
+
+/* Decode a TT register into the function codes and accesses it matches. The
+ * 68030 registers select function codes with a base and mask, and reads or
+ * writes with R/W and RWM. The 68040 registers select user or supervisor
+ * accesses with the S field, and instruction or data accesses by being an
+ * ITT or a DTT. */
+static void m68_pmmu_decode_tt(enum m68_pmmu_tt tt, uint32_t value, struct m68_pmmu_window *window)
+{
+	*window = (struct m68_pmmu_window){
+		.base = value & 0xFF000000,
+		.mask = ~(value << 8) & 0xFF000000,
+	};
+
+	if (tt == M68_PMMU_TT0 || tt == M68_PMMU_TT1) {
+		uint8_t fc_base = (value >> 4) & 7;
+		uint8_t fc_mask = value & 7;
+		for (uint8_t fc = 0; fc < 8; ++fc) {
+			if (((fc ^ fc_base) & ~fc_mask) == 0) {
+				window->fcs |= 1 << fc;
+			}
+		}
+		if (value & M68_PMMU_TT_RWM) {
+			window->accesses = 3;
+		} else {
+			window->accesses = (value & M68_PMMU_TT_RW) ? 1 : 2;
+		}
+		return;
+	}
+
+	uint8_t kind = (tt == M68_PMMU_ITT0 || tt == M68_PMMU_ITT1) ? 2 : 1;
+	uint8_t s_field = (value >> 13) & 3;
+	for (uint8_t fc = 0; fc < 8; ++fc) {
+		int supervisor = (fc & 4) != 0;
+		if ((fc & kind) && (s_field >= 2 || s_field == supervisor)) {
+			window->fcs |= 1 << fc;
+		}
+	}
+	window->accesses = 3;
+	window->write_protected = (value & M68_PMMU_TT_W) != 0;
+}
+
+void m68_pmmu_set_tt(enum m68_pmmu_tt tt, uint32_t value)
+{
+	m68_pmmu_tt_register(tt)->value = value;
+	m68_pmmu_decode_tt(tt, value, &m68_pmmu_windows[tt]);
+
+	m68_pmmu_active_window_count = 0;
+	for (int i = 0; i < M68_PMMU_TT_COUNT; ++i) {
+		if (m68_pmmu_tt_register(i)->value & M68_PMMU_TT_E) {
+			m68_pmmu_active_windows[m68_pmmu_active_window_count++] = &m68_pmmu_windows[i];
+		}
+	}
+
+	/* The look-aside buffers may hold pages that this window now covers, or
+	 * no longer covers. */
+	m68_mmu_flush_tlb();
+}
+
+/* Find the enabled window that the access falls inside, if any. */
+static inline const struct m68_pmmu_window *m68_pmmu_transparent(uint32_t address, uint8_t fc, int write)
+{
+	for (int i = 0; i < m68_pmmu_active_window_count; ++i) {
+		const struct m68_pmmu_window *window = m68_pmmu_active_windows[i];
+		if (((address ^ window->base) & window->mask) == 0
+			&& (window->fcs >> fc) & 1
+			&& (window->accesses >> (write ? 1 : 0)) & 1)
+		{
+			return window;
+		}
+	}
+	return NULL;
+}
+
+// MARK: - Table Walk
+
+static inline uint32_t m68_pmmu_offset_mask(uint32_t bits)
+{
+	return bits >= 32 ? UINT32_MAX : (1u << bits) - 1;
+}
+
+/* Read a descriptor, and if update is set, set its used bit, and for a page
+ * descriptor being written through, its modified bit. Indirect descriptors,
+ * which are table descriptors at the last level, hold an address in place of
+ * those bits and are left alone. */
+static uint32_t m68_pmmu_read_descriptor(uint32_t address, int size, int last, int write, int update, uint32_t *pointer)
+{
+	uint32_t status = m68_mmu_read_physical_long(address);
+	*pointer = size == 8 ? m68_mmu_read_physical_long(address + 4) : status;
+
+	uint8_t dt = status & 3;
+	if (!update || dt == M68_PMMU_DT_INVALID || (last && dt != M68_PMMU_DT_PAGE)) {
+		return status;
+	}
+
+	uint32_t updated = status | M68_PMMU_DESC_U;
+	if (dt == M68_PMMU_DT_PAGE && write && !(status & M68_PMMU_DESC_WP)) {
+		updated |= M68_PMMU_DESC_M;
+	}
+	if (updated != status) {
+		m68_mmu_write_physical_long(address, updated);
+	}
+	return updated;
+}
+
+/* Walk the translation tables for the address, stopping after the specified
+ * number of levels. */
+static struct m68_pmmu_walk m68_pmmu_walk(uint32_t address, uint8_t fc, int write, int update, int max_levels)
+{
+	const struct m68_pmmu_config *config = &m68_pmmu_config;
+	const m68_root_pointer_t *root = (config->sre && (fc & 4)) ? &CPU68.SRP : &CPU68.CRP;
+	struct m68_pmmu_walk walk = { 0 };
+	uint32_t status = root->limit.value;
+	uint32_t pointer = root->address.value;
+	int has_limit = 1;
+	int shift = 32 - config->initial_shift;
+	int levels = config->levels + config->fcl;
+
+	++m68_pmmu_walk_count;
+	for (int level = 0; level < max_levels; ++level) {
+		uint8_t dt = status & 3;
+		if (dt == M68_PMMU_DT_INVALID) {
+			walk.invalid = 1;
+			return walk;
+		}
+		if (dt == M68_PMMU_DT_PAGE) {
+			/* The address bits not yet used to index a table are the offset,
+			 * which is larger than a page if the walk terminated early. */
+			uint32_t offset = m68_pmmu_offset_mask((uint32_t)shift);
+			walk.physical = (pointer & 0xFFFFFF00) + (address & offset);
+			walk.modified = (status & M68_PMMU_DESC_M) != 0;
+			return walk;
+		}
+
+		uint32_t index;
+		if (config->fcl && level == 0) {
+			index = fc;
+		} else {
+			shift -= config->widths[level - config->fcl];
+			index = (address >> shift) & m68_pmmu_offset_mask(config->widths[level - config->fcl]);
+		}
+
+		/* Long format descriptors limit the index into the next table, from
+		 * above or, with the L/U bit set, from below. */
+		if (has_limit) {
+			uint32_t limit = (status >> 16) & 0x7FFF;
+			if ((status & 0x80000000) ? index < limit : index > limit) {
+				walk.limit = 1;
+				return walk;
+			}
+		}
+
+		int size = dt == M68_PMMU_DT_SHORT ? 4 : 8;
+		int last = level + 1 == levels;
+		walk.descriptor = (pointer & 0xFFFFFFF0) + index * (uint32_t)size;
+		++walk.levels;
+		status = m68_pmmu_read_descriptor(walk.descriptor, size, last, write && !walk.write_protected, update, &pointer);
+		has_limit = size == 8;
+
+		/* A table descriptor where a page descriptor should be is an
+		 * indirect descriptor, pointing at the page descriptor. */
+		if (last && (status & 3) >= M68_PMMU_DT_SHORT) {
+			size = (status & 3) == M68_PMMU_DT_SHORT ? 4 : 8;
+			walk.descriptor = pointer & 0xFFFFFFFC;
+			status = m68_pmmu_read_descriptor(walk.descriptor, size, 0, write && !walk.write_protected, update, &pointer);
+			if ((status & 3) != M68_PMMU_DT_PAGE) {
+				walk.invalid = 1;
+				return walk;
+			}
+		}
+
+		if ((status & 3) != M68_PMMU_DT_INVALID) {
+			walk.write_protected |= (status & M68_PMMU_DESC_WP) != 0;
+			walk.supervisor |= size == 8 && (status & M68_PMMU_DESC_S);
+		}
+	}
+
+	/* Stopped early by PTEST. */
+	walk.invalid = (status & 3) == M68_PMMU_DT_INVALID;
+	walk.modified = (status & 3) == M68_PMMU_DT_PAGE && (status & M68_PMMU_DESC_M);
+	return walk;
+}
+
+// MARK: - Address Translation Cache
+
+static struct m68_pmmu_atc_entry *m68_pmmu_atc_lookup(uint8_t fc, uint32_t page)
+{
+	for (int i = 0; i < M68_PMMU_ATC_ENTRIES; ++i) {
+		struct m68_pmmu_atc_entry *entry = &m68_pmmu_atc[i];
+		if (entry->valid && entry->logical == page && entry->fc == fc) {
+			entry->last_used = ++m68_pmmu_atc_clock;
+			return entry;
+		}
+	}
+	return NULL;
+}
+
+/* Walk the tables and load the result into the ATC, replacing the existing
+ * entry for the page or the least recently used one. */
+static struct m68_pmmu_atc_entry *m68_pmmu_atc_fill(uint32_t address, uint8_t fc, int write)
+{
+	uint32_t page = address & m68_pmmu_config.page_mask;
+	struct m68_pmmu_atc_entry *victim = &m68_pmmu_atc[0];
+	for (int i = 0; i < M68_PMMU_ATC_ENTRIES; ++i) {
+		struct m68_pmmu_atc_entry *entry = &m68_pmmu_atc[i];
+		if (entry->valid && entry->logical == page && entry->fc == fc) {
+			victim = entry;
+			break;
+		}
+		if (!entry->valid || (victim->valid && entry->last_used < victim->last_used)) {
+			victim = entry;
+		}
+	}
+
+	struct m68_pmmu_walk walk = m68_pmmu_walk(address, fc, write, 1, 8);
+	*victim = (struct m68_pmmu_atc_entry){
+		.logical = page,
+		.physical = walk.physical & m68_pmmu_config.page_mask,
+		.last_used = ++m68_pmmu_atc_clock,
+		.valid = 1,
+		.fc = fc,
+		.bus_error = walk.invalid || walk.limit,
+		.write_protected = walk.write_protected,
+		.supervisor = walk.supervisor,
+		.modified = walk.modified,
+	};
+	return victim;
+}
+
+/* Find the ATC entry for an access, walking the tables if there is none, or
+ * if the access is a write and the modified bit has not been set yet. */
+static struct m68_pmmu_atc_entry *m68_pmmu_atc_entry(uint32_t address, uint8_t fc, int write)
+{
+	struct m68_pmmu_atc_entry *entry = m68_pmmu_atc_lookup(fc, address & m68_pmmu_config.page_mask);
+	if (entry == NULL || (write && !entry->modified && !entry->bus_error && !entry->write_protected)) {
+		entry = m68_pmmu_atc_fill(address, fc, write);
+	}
+	return entry;
+}
+
+void m68_pmmu_flush(void)
+{
+	m68_pmmu_flush_atc();
+	m68_mmu_flush_tlb();
+}
+
+void m68_pmmu_flush_fc(uint8_t fc, uint8_t mask)
+{
+	for (int i = 0; i < M68_PMMU_ATC_ENTRIES; ++i) {
+		if ((m68_pmmu_atc[i].fc & mask) == (fc & mask)) {
+			m68_pmmu_atc[i].valid = 0;
+		}
+	}
+	m68_mmu_flush_tlb();
+}
+
+void m68_pmmu_flush_page(uint8_t fc, uint8_t mask, uint32_t address)
+{
+	uint32_t page = address & m68_pmmu_config.page_mask;
+	for (int i = 0; i < M68_PMMU_ATC_ENTRIES; ++i) {
+		struct m68_pmmu_atc_entry *entry = &m68_pmmu_atc[i];
+		if ((entry->fc & mask) == (fc & mask) && entry->logical == page) {
+			entry->valid = 0;
+		}
+	}
+
+	/* Only the look-aside buffer entries within the page are affected. */
+	uint32_t size = m68_pmmu_config.page_shift >= 12 ? 1u << m68_pmmu_config.page_shift : M68_MMU_PAGE_SIZE;
+	uint32_t start = address & ~(size - 1);
+	for (uint32_t offset = 0; offset < size; offset += M68_MMU_PAGE_SIZE) {
+		m68_mmu_invalidate_tlb(start + offset);
+	}
+}
+
+// MARK: - Translation
+
+int m68_pmmu_translate(uint32_t address, int write, int fetch, uint32_t *physical)
+{
+	uint8_t fc = (CPU68.CCR.bitmask.mask.S ? 4 : 0) | (fetch ? 2 : 1);
+
+	/* Windows are at least 16MiB and aligned, so they always cover whole
+	 * pages and the look-aside buffers can hold them. */
+	const struct m68_pmmu_window *window = m68_pmmu_transparent(address, fc, write);
+	if (window) {
+		if (write && window->write_protected) {
+			m68_exception_bus_error(address, write, fetch);
+			return -1;
+		}
+		*physical = address;
+		return 1;
+	}
+
+	struct m68_pmmu_atc_entry *entry = m68_pmmu_atc_entry(address, fc, write);
+
+	if (entry->bus_error || (entry->supervisor && !(fc & 4)) || (write && entry->write_protected)) {
+		m68_exception_bus_error(address, write, fetch);
+		return -1;
+	}
+
+	*physical = entry->physical | (address & ~m68_pmmu_config.page_mask);
+	return m68_pmmu_config.page_shift >= 12 && !m68_pmmu_config.fcl;
+}
+
+void m68_pmmu_load(uint32_t address, uint8_t fc, int write)
+{
+	m68_pmmu_atc_fill(address, fc, write);
+}
+
+uint16_t m68_pmmu_test(uint32_t address, uint8_t fc, int write, int level, uint32_t *descriptor)
+{
+	uint16_t mmusr = m68_pmmu_transparent(address, fc, write) ? M68_PMMU_MMUSR_T : 0;
+
+	if (level == 0) {
+		struct m68_pmmu_atc_entry *entry = m68_pmmu_atc_lookup(fc, address & m68_pmmu_config.page_mask);
+		if (entry == NULL) {
+			return mmusr | M68_PMMU_MMUSR_I;
+		}
+		mmusr |= entry->bus_error ? M68_PMMU_MMUSR_B : 0;
+		mmusr |= entry->write_protected ? M68_PMMU_MMUSR_W : 0;
+		mmusr |= entry->modified ? M68_PMMU_MMUSR_M : 0;
+		return mmusr;
+	}
+
+	struct m68_pmmu_walk walk = m68_pmmu_walk(address, fc, write, 0, level);
+	mmusr |= walk.levels & M68_PMMU_MMUSR_N;
+	mmusr |= walk.invalid ? M68_PMMU_MMUSR_I : 0;
+	mmusr |= walk.limit ? M68_PMMU_MMUSR_L | M68_PMMU_MMUSR_I : 0;
+	mmusr |= (walk.supervisor && !(fc & 4)) ? M68_PMMU_MMUSR_S : 0;
+	mmusr |= walk.write_protected ? M68_PMMU_MMUSR_W : 0;
+	mmusr |= walk.modified ? M68_PMMU_MMUSR_M : 0;
+	if (descriptor) {
+		*descriptor = walk.descriptor;
+	}
+	return mmusr;
+}
+
+// MARK: - Instructions
+
+/* Resolve a memory operand, advancing *pc past any extension words. Returns
+ * 0, or -1 if the addressing mode is not supported. */
+static int m68_pmmu_address(uint8_t ea, uint32_t size, uint32_t *pc, uint32_t *address)
+{
+	m68_register32_t *an = &CPU68.A[ea & 7];
+
+	switch ((ea >> 3) & 7) {
+		case 2:
+			*address = an->value;
+			return 0;
+		case 3:
+			*address = an->value;
+			an->value += size;
+			return 0;
+		case 4:
+			an->value -= size;
+			*address = an->value;
+			return 0;
+		case 5:
+			*address = an->value + (int16_t)m68_mmu_read_word(*pc);
+			*pc += 2;
+			return 0;
+		case 7:
+			if ((ea & 7) == 0) {
+				*address = (uint32_t)(int16_t)m68_mmu_read_word(*pc);
+				*pc += 2;
+				return 0;
+			}
+			if ((ea & 7) == 1) {
+				*address = m68_mmu_read_long(*pc);
+				*pc += 4;
+				return 0;
+			}
+			break;
+	}
+	return -1;
+}
+
+/* Decode the function code field of PFLUSH, PLOAD and PTEST. */
+static int m68_pmmu_function_code(uint8_t field, uint8_t *fc)
+{
+	if ((field & 0x18) == 0x10) {
+		*fc = field & 7;
+	} else if ((field & 0x18) == 0x08) {
+		*fc = CPU68.D[field & 7].value & 7;
+	} else if (field == 0) {
+		*fc = CPU68.SFC.value & 7;
+	} else if (field == 1) {
+		*fc = CPU68.DFC.value & 7;
+	} else {
+		return -1;
+	}
+	return 0;
+}
+
+/* PMOVE to or from TC, SRP, CRP, TT0, TT1 or MMUSR. Returns 0, -1 for an
+ * invalid instruction, or 1 for an invalid configuration. */
+static int m68_pmmu_move(uint16_t command, uint8_t ea, uint32_t *pc)
+{
+	int to_memory = (command >> 9) & 1;
+	int flush = !((command >> 8) & 1);
+	uint8_t preg = (command >> 10) & 7;
+	m68_register32_t *reg = NULL;
+	m68_root_pointer_t *root = NULL;
+
+	switch (command >> 13) {
+		case 0:
+			if (preg == 2 || preg == 3) {
+				reg = preg == 2 ? &CPU68.TT0 : &CPU68.TT1;
+			}
+			break;
+		case 2:
+			if (preg == 0) {
+				reg = &CPU68.TC;
+			} else if (preg == 2 || preg == 3) {
+				root = preg == 2 ? &CPU68.SRP : &CPU68.CRP;
+			}
+			break;
+		case 3:
+			if (preg == 0 && !(command & 0x0100)) {
+				reg = &CPU68.MMUSR;
+			}
+			break;
+	}
+	if (reg == NULL && root == NULL) {
+		return -1;
+	}
+
+	uint32_t size = root ? 8 : reg == &CPU68.MMUSR ? 2 : 4;
+	uint32_t address;
+	if (m68_pmmu_address(ea, size, pc, &address)) {
+		return -1;
+	}
+
+	if (to_memory) {
+		if (root) {
+			m68_mmu_write_long(address, root->limit.value);
+			m68_mmu_write_long(address + 4, root->address.value);
+		} else if (size == 2) {
+			m68_mmu_write_word(address, reg->word[0]);
+		} else {
+			m68_mmu_write_long(address, reg->value);
+		}
+		return 0;
+	}
+
+	if (root) {
+		uint32_t limit = m68_mmu_read_long(address);
+		if ((limit & 3) == M68_PMMU_DT_INVALID) {
+			return 1;
+		}
+		root->limit.value = limit;
+		root->address.value = m68_mmu_read_long(address + 4);
+	} else if (reg == &CPU68.TC) {
+		return m68_pmmu_configure(m68_mmu_read_long(address), flush);
+	} else if (reg == &CPU68.TT0 || reg == &CPU68.TT1) {
+		m68_pmmu_set_tt(reg == &CPU68.TT0 ? M68_PMMU_TT0 : M68_PMMU_TT1, m68_mmu_read_long(address));
+	} else if (size == 2) {
+		reg->value = m68_mmu_read_word(address);
+		return 0;
+	} else {
+		reg->value = m68_mmu_read_long(address);
+	}
+
+	if (flush) {
+		m68_pmmu_flush();
+	} else {
+		m68_mmu_flush_tlb();
+	}
+	return 0;
+}
+
+/* PFLUSHA, PFLUSH and PLOAD. */
+static int m68_pmmu_flush_or_load(uint16_t command, uint8_t ea, uint32_t *pc)
+{
+	uint8_t mode = (command >> 10) & 7;
+	uint8_t mask = (command >> 5) & 7;
+	uint32_t address;
+	uint8_t fc;
+
+	if (mode == 1) {
+		m68_pmmu_flush();
+		return 0;
+	}
+	if (m68_pmmu_function_code(command & 0x1F, &fc)) {
+		return -1;
+	}
+
+	switch (mode) {
+		case 0:
+			if (command & 0x01E0) {
+				return -1;
+			}
+			if (m68_pmmu_address(ea, 0, pc, &address)) {
+				return -1;
+			}
+			m68_pmmu_load(address, fc, !((command >> 9) & 1));
+			return 0;
+		case 4:
+			m68_pmmu_flush_fc(fc, mask);
+			return 0;
+		case 6:
+			if (m68_pmmu_address(ea, 0, pc, &address)) {
+				return -1;
+			}
+			m68_pmmu_flush_page(fc, mask, address);
+			return 0;
+	}
+	return -1;
+}
+
+/* PTEST, which sets MMUSR and optionally loads an address register with the
+ * address of the last descriptor. */
+static int m68_pmmu_ptest(uint16_t command, uint8_t ea, uint32_t *pc)
+{
+	int level = (command >> 10) & 7;
+	int write = !((command >> 9) & 1);
+	int load_address = (command >> 8) & 1;
+	uint32_t address;
+	uint8_t fc;
+
+	if ((level == 0 && load_address) || m68_pmmu_function_code(command & 0x1F, &fc)) {
+		return -1;
+	}
+	if (m68_pmmu_address(ea, 0, pc, &address)) {
+		return -1;
+	}
+
+	uint32_t descriptor = 0;
+	CPU68.MMUSR.value = m68_pmmu_test(address, fc, write, level, &descriptor);
+	if (load_address) {
+		CPU68.A[(command >> 5) & 7].value = descriptor;
+	}
+	return 0;
+}
+
+void m68_pmmu_instruction(void)
+{
+	uint32_t pc = CPU68.PC.value;
+	uint8_t ea = m68_mmu_read_word(pc) & 0x3F;
+	uint16_t command = m68_mmu_read_word(pc + 2);
+	uint32_t next = pc + 4;
+	int result = -1;
+
+	if (!CPU68.CCR.bitmask.mask.S) {
+		m68_exception_process(M68_VECTOR_PRIVILEGE_VIOLATION, pc);
+		return;
+	}
+
+	switch (command >> 13) {
+		case 0:
+		case 2:
+		case 3:
+			result = m68_pmmu_move(command, ea, &next);
+			break;
+		case 1:
+			result = m68_pmmu_flush_or_load(command, ea, &next);
+			break;
+		case 4:
+			result = m68_pmmu_ptest(command, ea, &next);
+			break;
+	}
+
+	if (result < 0) {
+		m68_exception_process(M68_VECTOR_LINE_1111, pc);
+		return;
+	}
+	if (result > 0) {
+		m68_exception_process(M68_VECTOR_MMU_CONFIGURATION_ERROR, pc);
+		return;
+	}
+	CPU68.PC.value = next;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/cpu.h"
+
+#if !defined(lib68_PMMU)
+#define lib68_PMMU
+
+/* 68030 Paged Memory Management Unit
+ * Translates logical addresses to physical addresses by walking the guest's
+ * translation tables, as described by TC, CRP and SRP. Short and long format
+ * descriptors, early termination, indirect descriptors, limits, write and
+ * supervisor protection, and the used and modified bits are supported.
+ *
+ * Translations are cached at two levels. The address translation cache (ATC)
+ * behaves like the 68030's own: 22 entries, tagged by function code and
+ * logical page, and holding failed translations as well as good ones. On top
+ * of that, the look-aside buffers in cpu/mmu.h hold the host page for each
+ * logical page, so hot accesses never leave the inline accessors. They are
+ * only used with pages of 4KiB or more and without function code lookup, and
+ * a page is only loaded for writing once its modified bit has been set.
+ *
+ * The transparent translation registers describe windows of at least 16MiB
+ * that bypass the tables. They are decoded when written, and checked before
+ * the ATC whenever the look-aside buffers miss. Both the 68030 registers (TT0
+ * and TT1) and the 68040 ones (ITT0, ITT1, DTT0 and DTT1) are understood.
+ *
+ * Translation is enabled by writing TC through PMOVE or m68_pmmu_set_tc(),
+ * and the windows by m68_pmmu_set_tt(). Writing the registers in struct
+ * M68000 directly has no effect until then.
+ * The supervisor state selects the translation tables, so anything other than
+ * exception processing that changes it must call
+ * m68_pmmu_supervisor_changed(). */
+
+#define M68_PMMU_ATC_ENTRIES	22
+
+/* TC fields. */
+#define M68_PMMU_TC_E		(1u << 31)
+#define M68_PMMU_TC_SRE		(1u << 25)
+#define M68_PMMU_TC_FCL		(1u << 24)
+
+/* Transparent translation register fields. R/W and RWM are 68030 only, and W
+ * is 68040 only. */
+#define M68_PMMU_TT_E		(1u << 15)
+#define M68_PMMU_TT_CI		(1u << 10)
+#define M68_PMMU_TT_RW		(1u << 9)
+#define M68_PMMU_TT_RWM		(1u << 8)
+#define M68_PMMU_TT_W		(1u << 2)
+
+enum m68_pmmu_tt {
+	M68_PMMU_TT0,
+	M68_PMMU_TT1,
+	M68_PMMU_ITT0,
+	M68_PMMU_ITT1,
+	M68_PMMU_DTT0,
+	M68_PMMU_DTT1,
+	M68_PMMU_TT_COUNT,
+};
+
+/* MMUSR bits, as set by PTEST. */
+#define M68_PMMU_MMUSR_B	(1u << 15)	/* Bus error */
+#define M68_PMMU_MMUSR_L	(1u << 14)	/* Limit violation */
+#define M68_PMMU_MMUSR_S	(1u << 13)	/* Supervisor only */
+#define M68_PMMU_MMUSR_W	(1u << 11)	/* Write protected */
+#define M68_PMMU_MMUSR_I	(1u << 10)	/* Invalid */
+#define M68_PMMU_MMUSR_M	(1u << 9)	/* Modified */
+#define M68_PMMU_MMUSR_T	(1u << 6)	/* Transparent */
+#define M68_PMMU_MMUSR_N	0x7		/* Number of levels */
+
+/* Set the translation control register. Returns 0, or 1 if translation is
+ * being enabled with an invalid configuration, in which case nothing is
+ * changed. The ATC and look-aside buffers are flushed. */
+int m68_pmmu_set_tc(uint32_t tc);
+
+/* Set a transparent translation register and decode the window it describes.
+ * The look-aside buffers are flushed. */
+void m68_pmmu_set_tt(enum m68_pmmu_tt tt, uint32_t value);
+
+/* Whether addresses are currently being translated. */
+int m68_pmmu_enabled(void);
+
+/* Disable translation and every transparent window, and flush the ATC. */
+void m68_pmmu_reset(void);
+
+/* Flush every ATC entry (PFLUSHA), the entries for the function codes that
+ * match fc in the bits set in mask, or only those that also translate the
+ * page containing the address. */
+void m68_pmmu_flush(void);
+void m68_pmmu_flush_fc(uint8_t fc, uint8_t mask);
+void m68_pmmu_flush_page(uint8_t fc, uint8_t mask, uint32_t address);
+
+/* Translate a logical address for the current privilege level, checking the
+ * transparent windows, then searching the ATC and walking the tables on a miss. Returns 1 if the look-aside buffers
+ * may cache the translation of the 4KiB page, 0 if they may not, or -1 if the
+ * access faults, in which case a bus error has been raised. */
+int m68_pmmu_translate(uint32_t address, int write, int fetch, uint32_t *physical);
+
+/* Load the translation for the specified function code into the ATC
+ * (PLOAD). */
+void m68_pmmu_load(uint32_t address, uint8_t fc, int write);
+
+/* Search the ATC (level 0) or the translation tables, down to the specified
+ * level, for the address, and return the resulting MMUSR (PTEST). The address
+ * of the last descriptor fetched is stored through descriptor, if not NULL. */
+uint16_t m68_pmmu_test(uint32_t address, uint8_t fc, int write, int level, uint32_t *descriptor);
+
+/* Must be called when the supervisor state changes. */
+void m68_pmmu_supervisor_changed(void);
+
+/* Number of table walks so far. */
+uint64_t m68_pmmu_walks(void);
+
+/* Instruction handler for PMOVE, PFLUSH, PLOAD and PTEST (F-line coprocessor
+ * ID 0), which only the 68030 table has. */
+void m68_pmmu_instruction(void);
+
+#endif
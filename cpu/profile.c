@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/scheduler.h"
+#include "cpu/profile.h"
+
+#define M68_PROFILE_MAX_NAME	256
+
+struct m68_profile_symbol {
+	uint32_t address;
+	uint32_t size;
+	char *name;
+};
+
+static struct m68_event m68_profile_event = { .slot = M68_EVENT_NOT_PENDING };
+static uint64_t m68_profile_period = 0;
+
+static struct m68_profile_sample *m68_profile_buffer = NULL;
+static uint32_t m68_profile_capacity = 0;
+static uint32_t m68_profile_count = 0;
+static uint32_t m68_profile_lost = 0;
+
+static struct m68_profile_symbol *m68_profile_symbols = NULL;
+static uint32_t m68_profile_symbol_count = 0;
+static uint32_t m68_profile_symbol_capacity = 0;
+static int m68_profile_symbols_sorted = 1;
+
+// MARK: - Guest Memory
+
+/* The profiler reads guest memory without going through the look-aside
+ * buffers, so that it neither allocates memory nor trips watchpoints. */
+static inline uint8_t m68_profile_byte(uint32_t address)
+{
+	return m68_mmu_load_byte(m68_mmu_translate_read(address));
+}
+
+static inline uint16_t m68_profile_word(uint32_t address)
+{
+	return (uint16_t)((m68_profile_byte(address) << 8) | m68_profile_byte(address + 1));
+}
+
+/* The long at the top of the stack is read with a single translation, unless
+ * it crosses into the next page. */
+static inline uint32_t m68_profile_long(uint32_t address)
+{
+	if ((address & ~M68_MMU_PAGE_MASK) <= M68_MMU_PAGE_SIZE - 4) {
+		return m68_mmu_load_long_unaligned(m68_mmu_translate_read(address));
+	}
+	return ((uint32_t)m68_profile_word(address) << 16) | m68_profile_word(address + 2);
+}
+
+// MARK: - Sampling
+
+static void m68_profile_tick(struct m68_event *event)
+{
+	if (m68_profile_count < m68_profile_capacity) {
+		struct m68_profile_sample *sample = &m68_profile_buffer[m68_profile_count++];
+		sample->pc = CPU68.PC.value;
+		sample->return_address = m68_profile_long(CPU68.A[7].value);
+	} else {
+		++m68_profile_lost;
+	}
+	m68_event_schedule_at(event, event->when + m68_profile_period);
+}
+
+int m68_profile_start(uint64_t period, uint32_t capacity)
+{
+	m68_profile_stop();
+	if (period == 0) {
+		return 1;
+	}
+
+	struct m68_profile_sample *buffer = realloc(m68_profile_buffer, capacity * sizeof(*buffer));
+	if (buffer == NULL && capacity) {
+		return 1;
+	}
+	m68_profile_buffer = buffer;
+	m68_profile_capacity = capacity;
+	m68_profile_count = 0;
+	m68_profile_lost = 0;
+	m68_profile_period = period;
+
+	m68_event_initialise(&m68_profile_event, m68_profile_tick, NULL);
+	return m68_event_schedule(&m68_profile_event, period);
+}
+
+void m68_profile_stop(void)
+{
+	m68_event_cancel(&m68_profile_event);
+}
+
+const struct m68_profile_sample *m68_profile_samples(uint32_t *count)
+{
+	*count = m68_profile_count;
+	return m68_profile_buffer;
+}
+
+uint32_t m68_profile_dropped(void)
+{
+	return m68_profile_lost;
+}
+
+// MARK: - Symbols
+
+int m68_profile_add_symbol(uint32_t address, uint32_t size, const char *name)
+{
+	if (m68_profile_symbol_count == m68_profile_symbol_capacity) {
+		uint32_t capacity = m68_profile_symbol_capacity ? m68_profile_symbol_capacity * 2 : 256;
+		struct m68_profile_symbol *symbols = realloc(m68_profile_symbols, capacity * sizeof(*symbols));
+		if (symbols == NULL) {
+			return 1;
+		}
+		m68_profile_symbols = symbols;
+		m68_profile_symbol_capacity = capacity;
+	}
+
+	char *copy = strdup(name);
+	if (copy == NULL) {
+		return 1;
+	}
+	m68_profile_symbols[m68_profile_symbol_count++] = (struct m68_profile_symbol){ address, size, copy };
+	m68_profile_symbols_sorted = 0;
+	return 0;
+}
+
+uint32_t m68_profile_load_map(FILE *map)
+{
+	char line[512];
+	char first[M68_PROFILE_MAX_NAME], second[M68_PROFILE_MAX_NAME], third[M68_PROFILE_MAX_NAME];
+	uint32_t loaded = 0;
+
+	while (fgets(line, sizeof(line), map)) {
+		int fields = sscanf(line, "%255s %255s %255s", first, second, third);
+		char *end;
+		unsigned long address = strtoul(first, &end, 16);
+		if (fields < 2 || *end != '\0') {
+			continue;
+		}
+		const char *name = fields == 3 ? third : second;
+		if (m68_profile_add_symbol((uint32_t)address, 0, name) == 0) {
+			++loaded;
+		}
+	}
+	return loaded;
+}
+
+static inline int m68_profile_name_character(uint8_t c)
+{
+	return isalnum(c) || c == '_' || c == '%' || c == '.' || c == ':' || c == ' ';
+}
+
+/* Decode the MacsBug name at the specified address into name. Returns the
+ * address following the name and any constant data, or 0 if there is no
+ * valid name there.
+ *
+ *	$80 <length> <name>	variable length name, padded to a word, and
+ *	$81-$9F <name>		followed by a word count of constant data
+ *	(c | $80) ...		fixed 8 character name, or 16 if the second
+ *				character also has the high bit set */
+static uint32_t m68_profile_macsbug_name(uint32_t address, char *name)
+{
+	uint8_t b0 = m68_profile_byte(address);
+	uint32_t length, start, end;
+	int fixed = 0;
+
+	if (b0 >= 0x80 && b0 <= 0x9F) {
+		length = b0 & 0x1F;
+		start = address + 1;
+		if (length == 0) {
+			length = m68_profile_byte(address + 1);
+			start = address + 2;
+		}
+	} else if (b0 >= 0xA0) {
+		fixed = 1;
+		length = (m68_profile_byte(address + 1) & 0x80) ? 16 : 8;
+		start = address;
+	} else {
+		return 0;
+	}
+	if (length == 0) {
+		return 0;
+	}
+
+	for (uint32_t i = 0; i < length; ++i) {
+		uint8_t c = m68_profile_byte(start + i);
+		if (fixed && i < 2) {
+			c &= 0x7F;
+		}
+		if (!m68_profile_name_character(c)) {
+			return 0;
+		}
+		name[i] = (char)c;
+	}
+	name[length] = '\0';
+	end = start + length;
+
+	/* Fixed length names are padded with spaces. */
+	while (length && name[length - 1] == ' ') {
+		name[--length] = '\0';
+	}
+	if (length == 0) {
+		return 0;
+	}
+
+	if (!fixed) {
+		end = (end + 1) & ~1;
+		end += 2 + m68_profile_word(end);
+	}
+	return end;
+}
+
+uint32_t m68_profile_scan_macsbug(uint32_t address, uint32_t length)
+{
+	char name[M68_PROFILE_MAX_NAME];
+	uint32_t routine = address & ~1;
+	uint32_t found = 0;
+
+	for (uint32_t pc = routine; pc - address < length; pc += 2) {
+		uint16_t opcode = m68_profile_word(pc);
+		uint32_t after;
+		if (opcode == 0x4E75 || opcode == 0x4ED0) {
+			after = pc + 2;
+		} else if (opcode == 0x4E74) {
+			after = pc + 4;
+		} else {
+			continue;
+		}
+
+		uint32_t next = m68_profile_macsbug_name(after, name);
+		if (next == 0) {
+			continue;
+		}
+		if (m68_profile_add_symbol(routine, after - routine, name) == 0) {
+			++found;
+		}
+		routine = (next + 1) & ~1;
+		pc = routine - 2;
+	}
+	return found;
+}
+
+static int m68_profile_compare_symbols(const void *a, const void *b)
+{
+	const struct m68_profile_symbol *x = a, *y = b;
+	return (x->address > y->address) - (x->address < y->address);
+}
+
+/* Find the index of the symbol containing the address, or -1. */
+static int32_t m68_profile_find_symbol(uint32_t address)
+{
+	if (!m68_profile_symbols_sorted) {
+		qsort(m68_profile_symbols, m68_profile_symbol_count, sizeof(*m68_profile_symbols),
+			m68_profile_compare_symbols);
+		m68_profile_symbols_sorted = 1;
+	}
+
+	uint32_t low = 0, high = m68_profile_symbol_count;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (m68_profile_symbols[middle].address <= address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	if (low == 0) {
+		return -1;
+	}
+
+	const struct m68_profile_symbol *symbol = &m68_profile_symbols[low - 1];
+	if (symbol->size && address - symbol->address >= symbol->size) {
+		return -1;
+	}
+	return (int32_t)(low - 1);
+}
+
+const char *m68_profile_symbolicate(uint32_t address)
+{
+	int32_t index = m68_profile_find_symbol(address);
+	return index < 0 ? NULL : m68_profile_symbols[index].name;
+}
+
+static inline const char *m68_profile_symbol_name(int32_t index)
+{
+	return index < 0 ? "[unknown]" : m68_profile_symbols[index].name;
+}
+
+// MARK: - Reports
+
+static const uint32_t *m68_profile_sort_counts;
+
+static int m68_profile_compare_counts(const void *a, const void *b)
+{
+	uint32_t x = m68_profile_sort_counts[*(const int32_t *)a];
+	uint32_t y = m68_profile_sort_counts[*(const int32_t *)b];
+	return (x < y) - (x > y);
+}
+
+void m68_profile_write_flat(FILE *out)
+{
+	/* The last slot counts samples outside any symbol. */
+	uint32_t slots = m68_profile_symbol_count + 1;
+	uint32_t *counts = calloc(slots, sizeof(*counts));
+	int32_t *order = malloc(slots * sizeof(*order));
+	if (counts == NULL || order == NULL) {
+		free(counts);
+		free(order);
+		return;
+	}
+
+	for (uint32_t i = 0; i < m68_profile_count; ++i) {
+		int32_t index = m68_profile_find_symbol(m68_profile_buffer[i].pc);
+		++counts[index < 0 ? slots - 1 : (uint32_t)index];
+	}
+	for (uint32_t i = 0; i < slots; ++i) {
+		order[i] = (int32_t)i;
+	}
+	m68_profile_sort_counts = counts;
+	qsort(order, slots, sizeof(*order), m68_profile_compare_counts);
+
+	fprintf(out, "%u samples, %u dropped\n", m68_profile_count, m68_profile_lost);
+	for (uint32_t i = 0; i < slots && counts[order[i]]; ++i) {
+		int32_t index = order[i] == (int32_t)(slots - 1) ? -1 : order[i];
+		fprintf(out, "%8u %6.2f%%  %s\n", counts[order[i]],
+			100.0 * counts[order[i]] / m68_profile_count, m68_profile_symbol_name(index));
+	}
+
+	free(counts);
+	free(order);
+}
+
+static int m68_profile_compare_pairs(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+	return (x > y) - (x < y);
+}
+
+void m68_profile_write_collapsed(FILE *out)
+{
+	uint64_t *pairs = malloc((m68_profile_count ? m68_profile_count : 1) * sizeof(*pairs));
+	if (pairs == NULL) {
+		return;
+	}
+
+	/* Symbol indices are biased by one so that -1 (unknown) packs as 0. */
+	for (uint32_t i = 0; i < m68_profile_count; ++i) {
+		uint32_t caller = (uint32_t)(m68_profile_find_symbol(m68_profile_buffer[i].return_address) + 1);
+		uint32_t callee = (uint32_t)(m68_profile_find_symbol(m68_profile_buffer[i].pc) + 1);
+		pairs[i] = ((uint64_t)caller << 32) | callee;
+	}
+	qsort(pairs, m68_profile_count, sizeof(*pairs), m68_profile_compare_pairs);
+
+	for (uint32_t i = 0; i < m68_profile_count;) {
+		uint32_t run = i;
+		while (run < m68_profile_count && pairs[run] == pairs[i]) {
+			++run;
+		}
+		fprintf(out, "%s;%s %u\n",
+			m68_profile_symbol_name((int32_t)(pairs[i] >> 32) - 1),
+			m68_profile_symbol_name((int32_t)(uint32_t)pairs[i] - 1),
+			run - i);
+		i = run;
+	}
+
+	free(pairs);
+}
+
+void m68_profile_reset(void)
+{
+	m68_profile_stop();
+	free(m68_profile_buffer);
+	m68_profile_buffer = NULL;
+	m68_profile_capacity = 0;
+	m68_profile_count = 0;
+	m68_profile_lost = 0;
+
+	for (uint32_t i = 0; i < m68_profile_symbol_count; ++i) {
+		free(m68_profile_symbols[i].name);
+	}
+	free(m68_profile_symbols);
+	m68_profile_symbols = NULL;
+	m68_profile_symbol_count = 0;
+	m68_profile_symbol_capacity = 0;
+	m68_profile_symbols_sorted = 1;
+}
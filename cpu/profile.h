@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+
+#if !defined(lib68_Profile)
+#define lib68_Profile
+
+/* Sampling Profiler
+ * Every period cycles a scheduled event records the PC and the long at the
+ * top of the stack, which is the return address on entry to a routine, into
+ * a buffer allocated when profiling starts. Nothing is done between samples,
+ * and a sample costs about as much as five cycles of emulation. With a
+ * period of 5000 cycles or more bench/profile.c can't tell profiled runs from
+ * unprofiled ones, and at 1000 cycles they are about 1% slower.
+ *
+ * Samples are attributed to guest symbols, which can be loaded from a map
+ * file or found by scanning guest code for MacsBug procedure names. The
+ * result can be written as a flat profile, or as collapsed stacks for
+ * flamegraph tools. */
+
+struct m68_profile_sample {
+	uint32_t pc;
+	uint32_t return_address;
+};
+
+/* Start sampling every period cycles, keeping up to capacity samples. Any
+ * earlier samples are discarded. Returns 0 on success. */
+int m68_profile_start(uint64_t period, uint32_t capacity);
+
+/* Stop sampling. The samples are kept until the profiler is reset or
+ * started again. */
+void m68_profile_stop(void);
+
+/* The samples recorded, and the number that did not fit in the buffer. */
+const struct m68_profile_sample *m68_profile_samples(uint32_t *count);
+uint32_t m68_profile_dropped(void);
+
+// MARK: - Symbols
+
+/* Add a symbol starting at the specified address. A size of zero extends it
+ * to the next symbol. Returns 0 on success. */
+int m68_profile_add_symbol(uint32_t address, uint32_t size, const char *name);
+
+/* Load symbols from a map file, with one symbol per line as either
+ * "<hex address> <name>" or "<hex address> <type> <name>", as written by nm.
+ * Other lines are ignored. Returns the number of symbols loaded. */
+uint32_t m68_profile_load_map(FILE *map);
+
+/* Scan guest memory for MacsBug procedure names, which follow the RTS, RTD or
+ * JMP (A0) that ends a routine, and add a symbol for each routine. Returns the
+ * number of symbols found. */
+uint32_t m68_profile_scan_macsbug(uint32_t address, uint32_t length);
+
+/* The name of the symbol containing the address, or NULL. */
+const char *m68_profile_symbolicate(uint32_t address);
+
+// MARK: - Reports
+
+/* Write the number of samples in each symbol, most frequent first. */
+void m68_profile_write_flat(FILE *out);
+
+/* Write one "caller;callee count" line per distinct pair, attributing the
+ * caller by the return address. */
+void m68_profile_write_collapsed(FILE *out);
+
+/* Stop sampling, and discard the samples and symbols. */
+void m68_profile_reset(void);
+
+#endif
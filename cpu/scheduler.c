@@ -0,0 +1,183 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include "cpu/cpu.h"
+#include "cpu/scheduler.h"
+
+#define M68_SCHEDULER_INITIAL_CAPACITY	64
+
+/* Pending events are kept in a binary min-heap ordered by time, then by the
+ * order they were scheduled in. Each event records its slot, so cancelling or
+ * rescheduling one is O(log n) rather than a search. */
+static struct m68_event **m68_scheduler_heap = NULL;
+static uint32_t m68_scheduler_size = 0;
+static uint32_t m68_scheduler_capacity = 0;
+static uint64_t m68_scheduler_sequence = 0;
+
+// MARK: - Heap
+
+static inline int m68_scheduler_before(const struct m68_event *a, const struct m68_event *b)
+{
+	return a->when < b->when || (a->when == b->when && a->sequence < b->sequence);
+}
+
+static inline void m68_scheduler_place(struct m68_event *event, uint32_t slot)
+{
+	m68_scheduler_heap[slot] = event;
+	event->slot = slot;
+}
+
+static void m68_scheduler_sift_up(uint32_t slot)
+{
+	struct m68_event *event = m68_scheduler_heap[slot];
+	while (slot > 0) {
+		uint32_t parent = (slot - 1) / 2;
+		if (!m68_scheduler_before(event, m68_scheduler_heap[parent])) {
+			break;
+		}
+		m68_scheduler_place(m68_scheduler_heap[parent], slot);
+		slot = parent;
+	}
+	m68_scheduler_place(event, slot);
+}
+
+static void m68_scheduler_sift_down(uint32_t slot)
+{
+	struct m68_event *event = m68_scheduler_heap[slot];
+	for (;;) {
+		uint32_t child = slot * 2 + 1;
+		if (child >= m68_scheduler_size) {
+			break;
+		}
+		if (child + 1 < m68_scheduler_size
+			&& m68_scheduler_before(m68_scheduler_heap[child + 1], m68_scheduler_heap[child])) {
+			++child;
+		}
+		if (!m68_scheduler_before(m68_scheduler_heap[child], event)) {
+			break;
+		}
+		m68_scheduler_place(m68_scheduler_heap[child], slot);
+		slot = child;
+	}
+	m68_scheduler_place(event, slot);
+}
+
+static void m68_scheduler_remove(struct m68_event *event)
+{
+	uint32_t slot = event->slot;
+	struct m68_event *last = m68_scheduler_heap[--m68_scheduler_size];
+	event->slot = M68_EVENT_NOT_PENDING;
+	if (last == event) {
+		return;
+	}
+	m68_scheduler_place(last, slot);
+	m68_scheduler_sift_up(slot);
+	m68_scheduler_sift_down(last->slot);
+}
+
+// MARK: - Events
+
+void m68_event_initialise(struct m68_event *event, m68_event_callback callback, void *context)
+{
+	event->callback = callback;
+	event->context = context;
+	event->when = 0;
+	event->sequence = 0;
+	event->slot = M68_EVENT_NOT_PENDING;
+}
+
+int m68_event_schedule(struct m68_event *event, uint64_t delay)
+{
+	return m68_event_schedule_at(event, CPU68.cycles + delay);
+}
+
+int m68_event_schedule_at(struct m68_event *event, uint64_t when)
+{
+	/* Grow the heap before touching it, so that a failure leaves the event
+	 * as it was. A pending event already has its slot. */
+	if (!m68_event_pending(event) && m68_scheduler_size == m68_scheduler_capacity) {
+		uint32_t capacity = m68_scheduler_capacity ? m68_scheduler_capacity * 2 : M68_SCHEDULER_INITIAL_CAPACITY;
+		struct m68_event **heap = realloc(m68_scheduler_heap, capacity * sizeof(*heap));
+		if (heap == NULL) {
+			return -1;
+		}
+		m68_scheduler_heap = heap;
+		m68_scheduler_capacity = capacity;
+	}
+
+	if (m68_event_pending(event)) {
+		m68_scheduler_remove(event);
+	}
+
+	event->when = when;
+	event->sequence = m68_scheduler_sequence++;
+	m68_scheduler_place(event, m68_scheduler_size++);
+	m68_scheduler_sift_up(event->slot);
+
+	/* An instruction or callback may schedule an event sooner than the one
+	 * the run loop is heading for. */
+	if (when < CPU68.deadline) {
+		CPU68.deadline = when;
+	}
+	return 0;
+}
+
+void m68_event_cancel(struct m68_event *event)
+{
+	if (m68_event_pending(event)) {
+		m68_scheduler_remove(event);
+	}
+}
+
+// MARK: - Scheduler
+
+uint64_t m68_scheduler_next(void)
+{
+	return m68_scheduler_size ? m68_scheduler_heap[0]->when : UINT64_MAX;
+}
+
+uint32_t m68_scheduler_count(void)
+{
+	return m68_scheduler_size;
+}
+
+void m68_scheduler_dispatch(void)
+{
+	while (m68_scheduler_size && m68_scheduler_heap[0]->when <= CPU68.cycles) {
+		struct m68_event *event = m68_scheduler_heap[0];
+		m68_scheduler_remove(event);
+		event->callback(event);
+	}
+}
+
+void m68_scheduler_reset(void)
+{
+	for (uint32_t i = 0; i < m68_scheduler_size; ++i) {
+		m68_scheduler_heap[i]->slot = M68_EVENT_NOT_PENDING;
+	}
+	free(m68_scheduler_heap);
+	m68_scheduler_heap = NULL;
+	m68_scheduler_size = 0;
+	m68_scheduler_capacity = 0;
+	m68_scheduler_sequence = 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+
+#if !defined(lib68_Scheduler)
+#define lib68_Scheduler
+
+struct m68_event;
+
+/* Called once the CPU has reached the cycle the event was scheduled for. The
+ * event is no longer pending, so a periodic event can reschedule itself. */
+typedef void(*m68_event_callback)(struct m68_event *event);
+
+/* Timed Event
+ * Events are owned by the caller, typically embedded in a device, so that
+ * scheduling one never allocates. Initialise with m68_event_initialise() and
+ * do not modify an event while it is pending. */
+struct m68_event {
+	m68_event_callback callback;
+	void *context;
+	uint64_t when;		/* CPU cycle the event fires on */
+
+	/* Scheduler State */
+	uint64_t sequence;
+	uint32_t slot;
+};
+
+#define M68_EVENT_NOT_PENDING	UINT32_MAX
+
+/* Prepare an event for use. */
+void m68_event_initialise(struct m68_event *event, m68_event_callback callback, void *context);
+
+/* Schedule the event to fire the specified number of cycles from now,
+ * replacing any time it was already scheduled for. Events due on the same
+ * cycle fire in the order they were scheduled.
+ * Returns 0 on success. */
+int m68_event_schedule(struct m68_event *event, uint64_t delay);
+
+/* Schedule the event to fire on the specified cycle. A periodic event should
+ * reschedule relative to its previous time with this, so that it does not
+ * drift when it is dispatched late. */
+int m68_event_schedule_at(struct m68_event *event, uint64_t when);
+
+/* Remove the event from the schedule, if it is pending. */
+void m68_event_cancel(struct m68_event *event);
+
+/* Whether the event is waiting to fire. */
+static inline int m68_event_pending(const struct m68_event *event)
+{
+	return event->slot != M68_EVENT_NOT_PENDING;
+}
+
+/* The cycle the next event is due on, or UINT64_MAX if there are none. */
+uint64_t m68_scheduler_next(void);
+
+/* Number of pending events. */
+uint32_t m68_scheduler_count(void);
+
+/* Fire every event that is due, in order. This is called by m68_run(). */
+void m68_scheduler_dispatch(void);
+
+/* Forget every pending event and release the schedule's storage. */
+void m68_scheduler_reset(void);
+
+#endif
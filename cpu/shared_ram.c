@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "cpu/mmu.h"
+#include "cpu/shared_ram.h"
+
+struct m68_shared_ram {
+	uint32_t address;
+	uint32_t length;
+	int fd;
+	uint64_t size;
+	uint8_t *host;
+	uint64_t *bitmap;
+};
+
+// MARK: - Files
+
+/* Create an anonymous shared memory file. memfd is Linux only, so elsewhere
+ * a POSIX shared memory object is created and unlinked straight away. */
+static int m68_shared_ram_open(const char *name)
+{
+#if defined(__linux__)
+	return memfd_create(name, MFD_CLOEXEC);
+#else
+	char path[64];
+	for (int attempt = 0; attempt < 16; ++attempt) {
+		snprintf(path, sizeof(path), "/lib68-%d-%d", (int)getpid(), rand());
+		int fd = shm_open(path, O_RDWR | O_CREAT | O_EXCL, 0600);
+		if (fd >= 0) {
+			shm_unlink(path);
+			return fd;
+		}
+	}
+	return -1;
+#endif
+}
+
+// MARK: - Creation & Destruction
+
+struct m68_shared_ram *m68_shared_ram_create(uint32_t address, uint32_t length, const char *name)
+{
+	if ((address & ~M68_MMU_PAGE_MASK) || (length & ~M68_MMU_PAGE_MASK) || length == 0) {
+		return NULL;
+	}
+
+	struct m68_shared_ram *ram = calloc(1, sizeof(*ram));
+	if (ram == NULL) {
+		return NULL;
+	}
+	ram->address = address;
+	ram->length = length;
+	uint64_t bitmap_size = m68_shared_ram_bitmap_words(length) * sizeof(uint64_t);
+	ram->size = m68_shared_ram_bitmap_offset(length) + m68_shared_ram_bitmap_offset((uint32_t)bitmap_size);
+	ram->fd = m68_shared_ram_open(name);
+	if (ram->fd < 0 || ftruncate(ram->fd, (off_t)ram->size) != 0) {
+		goto fail;
+	}
+	ram->host = mmap(NULL, ram->size, PROT_READ | PROT_WRITE, MAP_SHARED, ram->fd, 0);
+	if (ram->host == MAP_FAILED) {
+		ram->host = NULL;
+		goto fail;
+	}
+	ram->bitmap = (uint64_t *)(ram->host + m68_shared_ram_bitmap_offset(length));
+
+	/* The pages are copied as they are, in the memory layout. */
+	for (uint32_t offset = 0; offset < length; offset += M68_MMU_PAGE_SIZE) {
+		memcpy(ram->host + offset, m68_mmu_translate_read(address + offset), M68_MMU_PAGE_SIZE);
+	}
+	if (m68_mmu_map_host(address, ram->host, length) != 0) {
+		goto fail;
+	}
+
+	/* Mapping leaves the pages clean. Readers start with every page dirty,
+	 * so that they draw the whole range. */
+	for (uint32_t page = 0; page < length / M68_MMU_PAGE_SIZE; ++page) {
+		ram->bitmap[page / 64] |= 1ULL << (page % 64);
+	}
+	return ram;
+
+fail:
+	if (ram->host) {
+		munmap(ram->host, ram->size);
+	}
+	if (ram->fd >= 0) {
+		close(ram->fd);
+	}
+	free(ram);
+	return NULL;
+}
+
+void m68_shared_ram_destroy(struct m68_shared_ram *ram)
+{
+	if (ram == NULL) {
+		return;
+	}
+	m68_mmu_unmap_host(ram->address, ram->length);
+	munmap(ram->host, ram->size);
+	close(ram->fd);
+	free(ram);
+}
+
+// MARK: - Accessors
+
+int m68_shared_ram_fd(const struct m68_shared_ram *ram)
+{
+	return ram->fd;
+}
+
+uint64_t m68_shared_ram_size(const struct m68_shared_ram *ram)
+{
+	return ram->size;
+}
+
+// MARK: - Publishing
+
+uint32_t m68_shared_ram_publish(struct m68_shared_ram *ram)
+{
+	return m68_mmu_collect_dirty(ram->address, ram->length, ram->bitmap);
+}
@@ -0,0 +1,97 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include "cpu/mmu.h"
+
+#if !defined(lib68_SharedRAM)
+#define lib68_SharedRAM
+
+/* Shared Guest RAM
+ * A range of guest memory, such as the framebuffer or the low memory
+ * globals, can be backed by a shared memory file (a memfd on Linux), so that
+ * a display process or monitoring tool can map it read-only and read guest
+ * memory in place rather than copying it out.
+ *
+ * The file holds the range, followed by a dirty page bitmap at an offset
+ * aligned for any host page size, so that readers can map the memory
+ * read-only and the bitmap read-write:
+ *	[0, length)		guest memory, in the memory layout of the
+ *				library (cpu/mmu.h), so M68_MMU_BYTE_OFFSET()
+ *				applies to each byte offset
+ *	[bitmap offset, ...)	one bit per page of the range, in 64-bit
+ *				words in host byte order
+ *
+ * The CPU thread calls m68_shared_ram_publish(), typically once a frame from
+ * a scheduled event, to set the bits of the pages written since the last
+ * call. A reader takes and clears the bits with m68_shared_ram_take_dirty()
+ * on its mapping of the bitmap, and redraws only those pages. Neither side
+ * takes a lock, and a page written while it is being read is simply
+ * reported again by the next publish. */
+struct m68_shared_ram;
+
+/* Back the specified page aligned range of guest memory with a new shared
+ * memory file. The current contents of the range are kept. Returns NULL if
+ * the file could not be created or mapped. */
+struct m68_shared_ram *m68_shared_ram_create(uint32_t address, uint32_t length, const char *name);
+
+/* Return the range to private memory, keeping its contents, and close the
+ * file. Readers that have mapped it keep their mapping. */
+void m68_shared_ram_destroy(struct m68_shared_ram *ram);
+
+/* The file descriptor, to be passed to readers, and the size to map. */
+int m68_shared_ram_fd(const struct m68_shared_ram *ram);
+uint64_t m68_shared_ram_size(const struct m68_shared_ram *ram);
+
+/* Set the bits of the pages written since the last publish. Must be called
+ * on the CPU thread. Returns the number of pages published. */
+uint32_t m68_shared_ram_publish(struct m68_shared_ram *ram);
+
+#define M68_SHARED_RAM_ALIGN	0x10000
+
+/* Offset and size of the bitmap in the file, for a range of the specified
+ * length. */
+static inline uint64_t m68_shared_ram_bitmap_offset(uint32_t length)
+{
+	return ((uint64_t)length + M68_SHARED_RAM_ALIGN - 1) & ~(uint64_t)(M68_SHARED_RAM_ALIGN - 1);
+}
+
+static inline uint32_t m68_shared_ram_bitmap_words(uint32_t length)
+{
+	return (length / M68_MMU_PAGE_SIZE + 63) / 64;
+}
+
+/* Take the dirty page bits from a mapping of the bitmap, clearing them. The
+ * bits are stored into dirty, which must hold the bitmap of a range of the
+ * specified length. Returns the number of dirty pages. */
+static inline uint32_t m68_shared_ram_take_dirty(uint64_t *bitmap, uint32_t length, uint64_t *dirty)
+{
+	uint32_t words = m68_shared_ram_bitmap_words(length);
+	uint32_t count = 0;
+	for (uint32_t i = 0; i < words; ++i) {
+		dirty[i] = __atomic_exchange_n(&bitmap[i], 0, __ATOMIC_ACQUIRE);
+		count += (uint32_t)__builtin_popcountll(dirty[i]);
+	}
+	return count;
+}
+
+#endif
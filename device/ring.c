@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "device/ring.h"
+#include <stdlib.h>
+#include <string.h>
+
+// MARK: - Initialisation & Destruction
+
+int m68_ring_initialise(struct m68_ring *ring, size_t element_size, size_t capacity)
+{
+	/* The capacity must be a power of two so that indices can be wrapped with
+	 * a mask rather than a division, so it can't be rounded up past the
+	 * largest one. */
+	const size_t largest = (SIZE_MAX >> 1) + 1;
+	if (element_size == 0 || capacity == 0 || capacity > largest) {
+		return 1;
+	}
+
+	size_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+
+	/* The buffer is padded to a whole number of cache lines, which must not
+	 * overflow either. */
+	if (size > (SIZE_MAX - (M68_CACHE_LINE_SIZE - 1)) / element_size) {
+		return 1;
+	}
+	size_t bytes = (size * element_size + M68_CACHE_LINE_SIZE - 1) & ~(size_t)(M68_CACHE_LINE_SIZE - 1);
+
+	ring->buffer = aligned_alloc(M68_CACHE_LINE_SIZE, bytes);
+	if (ring->buffer == NULL) {
+		return 1;
+	}
+
+	ring->mask = size - 1;
+	ring->element_size = element_size;
+	ring->cached_tail = 0;
+	ring->cached_head = 0;
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->tail, 0);
+
+	return 0;
+}
+
+void m68_ring_destroy(struct m68_ring *ring)
+{
+	free(ring->buffer);
+	ring->buffer = NULL;
+}
+
+// MARK: - Element Copying
+
+static inline void m68_ring_copy_in(struct m68_ring *ring, size_t index, const uint8_t *src, size_t count)
+{
+	size_t start = index & ring->mask;
+	size_t first = m68_ring_capacity(ring) - start;
+	if (first > count) {
+		first = count;
+	}
+
+	memcpy(ring->buffer + start * ring->element_size, src, first * ring->element_size);
+	memcpy(ring->buffer, src + first * ring->element_size, (count - first) * ring->element_size);
+}
+
+static inline void m68_ring_copy_out(struct m68_ring *ring, size_t index, uint8_t *dst, size_t count)
+{
+	size_t start = index & ring->mask;
+	size_t first = m68_ring_capacity(ring) - start;
+	if (first > count) {
+		first = count;
+	}
+
+	memcpy(dst, ring->buffer + start * ring->element_size, first * ring->element_size);
+	memcpy(dst + first * ring->element_size, ring->buffer, (count - first) * ring->element_size);
+}
+
+// MARK: - Producer
+
+size_t m68_ring_enqueue(struct m68_ring *ring, const void *elements, size_t count)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+	size_t capacity = m68_ring_capacity(ring);
+
+	/* Only go to the consumers cache line if our private copy of the head
+	 * suggests there isn't enough room. */
+	size_t available = capacity - (tail - ring->cached_head);
+	if (available < count) {
+		ring->cached_head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		available = capacity - (tail - ring->cached_head);
+	}
+
+	if (count > available) {
+		count = available;
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	m68_ring_copy_in(ring, tail, elements, count);
+	atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+	return count;
+}
+
+// MARK: - Consumer
+
+size_t m68_ring_dequeue(struct m68_ring *ring, void *elements, size_t count)
+{
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	/* Only go to the producers cache line if our private copy of the tail
+	 * suggests there isn't enough waiting. */
+	size_t waiting = ring->cached_tail - head;
+	if (waiting < count) {
+		ring->cached_tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+		waiting = ring->cached_tail - head;
+	}
+
+	if (count > waiting) {
+		count = waiting;
+	}
+	if (count == 0) {
+		return 0;
+	}
+
+	m68_ring_copy_out(ring, head, elements, count);
+	atomic_store_explicit(&ring->head, head + count, memory_order_release);
+	return count;
+}
+
+size_t m68_ring_count(struct m68_ring *ring)
+{
+	size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+	size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+	return tail - head;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#if !defined(lib68_RingBuffer)
+#define lib68_RingBuffer
+
+#define M68_CACHE_LINE_SIZE	64
+
+/* Single Producer / Single Consumer Ring Buffer
+ * Used to move data (input events, serial bytes, audio samples, etc) between
+ * the emulator thread and a host I/O thread. Exactly one thread may enqueue and
+ * exactly one thread may dequeue. Neither side takes a lock or makes a system
+ * call, so it is safe to service from within an MMIO callback.
+ *
+ * The producer and consumer indices live on their own cache lines, alongside
+ * a private copy of the opposing index, so that in the common case each side
+ * only touches memory it owns. */
+struct m68_ring {
+	/* Consumer State */
+	_Alignas(M68_CACHE_LINE_SIZE) _Atomic size_t head;
+	size_t cached_tail;
+
+	/* Producer State */
+	_Alignas(M68_CACHE_LINE_SIZE) _Atomic size_t tail;
+	size_t cached_head;
+
+	/* Shared State - Read only after initialisation */
+	_Alignas(M68_CACHE_LINE_SIZE) size_t mask;
+	size_t element_size;
+	uint8_t *buffer;
+};
+
+/* Initialise a ring that can hold at least the specified number of elements
+ * of the given size. The capacity is rounded up to a power of two.
+ * Returns 0 on success, or non-zero if the capacity is zero, can't be
+ * rounded up, or the buffer would be too large to allocate. */
+int m68_ring_initialise(struct m68_ring *ring, size_t element_size, size_t capacity);
+
+/* Destroy the ring, releasing its storage. Neither side may be using the ring
+ * at this point. */
+void m68_ring_destroy(struct m68_ring *ring);
+
+/* Enqueue up to count elements into the ring. Producer side only.
+ * Returns the number of elements actually enqueued. */
+size_t m68_ring_enqueue(struct m68_ring *ring, const void *elements, size_t count);
+
+/* Dequeue up to count elements from the ring. Consumer side only.
+ * Returns the number of elements actually dequeued. */
+size_t m68_ring_dequeue(struct m68_ring *ring, void *elements, size_t count);
+
+/* The number of elements currently waiting in the ring. This is exact when
+ * called from the consumer side, and a lower bound otherwise. */
+size_t m68_ring_count(struct m68_ring *ring);
+
+/* The maximum number of elements the ring can hold. */
+static inline size_t m68_ring_capacity(const struct m68_ring *ring)
+{
+	return ring->mask + 1;
+}
+
+#endif
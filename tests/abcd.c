@@ -34,8 +34,8 @@ TEST_CASE(ABCD, DataRegisters_ExtendBitClear_NoCarry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x01;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x01;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -60,8 +60,8 @@ TEST_CASE(ABCD, DataRegisters_ExtendBitSet_NoCarry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x01;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x01;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -86,8 +86,8 @@ TEST_CASE(ABCD, DataRegisters_ExtendBitClear_Carry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x01;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x01;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -112,8 +112,8 @@ TEST_CASE(ABCD, DataRegisters_ExtendBitSet_Carry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x01;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x01;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -138,8 +138,8 @@ TEST_CASE(ABCD, DataRegisters_ExtendBitSet_Carry_Zero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x01;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x01;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -166,10 +166,10 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitClear_NoCarry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x09;
-	*(ptr + 0x0F) = 0x46;
-	*(ptr + 0x1F) = 0x28;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x09;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x46;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1F)) = 0x28;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -181,8 +181,8 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitClear_NoCarry_NoneZero_CorrectResult)
 	// Perform the operation and check if the results are as expected.
 	abcd_m8_m8();
 
-	ASSERT_EQ(*(ptr + 0x0F), 0x46);
-	ASSERT_EQ(*(ptr + 0x1F), 0x74);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x0F)), 0x46);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1F)), 0x74);
 	ASSERT_EQ(CPU68.A[0].value, 0x0F);
 	ASSERT_EQ(CPU68.A[1].value, 0x1F);
 	ASSERT_EQ(CPU68.CCR.bitmask.user.X, 0);
@@ -196,10 +196,10 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_NoCarry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x09;
-	*(ptr + 0x0F) = 0x46;
-	*(ptr + 0x1F) = 0x28;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x09;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x46;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1F)) = 0x28;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -211,8 +211,8 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_NoCarry_NoneZero_CorrectResult)
 	// Perform the operation and check if the results are as expected.
 	abcd_m8_m8();
 
-	ASSERT_EQ(*(ptr + 0x0F), 0x46);
-	ASSERT_EQ(*(ptr + 0x1F), 0x75);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x0F)), 0x46);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1F)), 0x75);
 	ASSERT_EQ(CPU68.A[0].value, 0x0F);
 	ASSERT_EQ(CPU68.A[1].value, 0x1F);
 	ASSERT_EQ(CPU68.CCR.bitmask.user.X, 0);
@@ -226,10 +226,10 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitClear_Carry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x09;
-	*(ptr + 0x0F) = 0x91;
-	*(ptr + 0x1F) = 0x10;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x09;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x91;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1F)) = 0x10;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -241,8 +241,8 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitClear_Carry_NoneZero_CorrectResult)
 	// Perform the operation and check if the results are as expected.
 	abcd_m8_m8();
 
-	ASSERT_EQ(*(ptr + 0x0F), 0x91);
-	ASSERT_EQ(*(ptr + 0x1F), 0x01);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x0F)), 0x91);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1F)), 0x01);
 	ASSERT_EQ(CPU68.A[0].value, 0x0F);
 	ASSERT_EQ(CPU68.A[1].value, 0x1F);
 	ASSERT_EQ(CPU68.CCR.bitmask.user.X, 1);
@@ -256,10 +256,10 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_Carry_NoneZero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x09;
-	*(ptr + 0x0F) = 0x90;
-	*(ptr + 0x1F) = 0x10;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x09;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x90;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1F)) = 0x10;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -271,8 +271,8 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_Carry_NoneZero_CorrectResult)
 	// Perform the operation and check if the results are as expected.
 	abcd_m8_m8();
 
-	ASSERT_EQ(*(ptr + 0x0F), 0x90);
-	ASSERT_EQ(*(ptr + 0x1F), 0x01);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x0F)), 0x90);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1F)), 0x01);
 	ASSERT_EQ(CPU68.A[0].value, 0x0F);
 	ASSERT_EQ(CPU68.A[1].value, 0x1F);
 	ASSERT_EQ(CPU68.CCR.bitmask.user.X, 1);
@@ -286,10 +286,10 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_Carry_Zero_CorrectResult)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xC1;
-	*(ptr + 1) = 0x09;
-	*(ptr + 0x0F) = 0x90;
-	*(ptr + 0x1F) = 0x10;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x09;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x90;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1F)) = 0x10;
 
 	// Configure the CPU registers.
 	CPU68.PC.value = 0x0000;
@@ -301,8 +301,8 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_Carry_Zero_CorrectResult)
 	// Perform the operation and check if the results are as expected.
 	abcd_m8_m8();
 
-	ASSERT_EQ(*(ptr + 0x0F), 0x90);
-	ASSERT_EQ(*(ptr + 0x1F), 0x00);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x0F)), 0x90);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1F)), 0x00);
 	ASSERT_EQ(CPU68.A[0].value, 0x0F);
 	ASSERT_EQ(CPU68.A[1].value, 0x1F);
 	ASSERT_EQ(CPU68.CCR.bitmask.user.X, 1);
@@ -310,4 +310,73 @@ TEST_CASE(ABCD, IndirectMemory_ExtendBitSet_Carry_Zero_CorrectResult)
 	ASSERT_EQ(CPU68.CCR.bitmask.user.C, 1);
 }
 
+// MARK: - Dispatch
+
+TEST_CASE(ABCD, IndirectMemory_StackPointer_KeepsItAligned)
+{
+	// Configure the operation in memory: ABCD -(A7),-(A0)
+	m68_mmu_initialise();
+
+	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xC1;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0x0F;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x0F)) = 0x46;
+	*(ptr + M68_MMU_BYTE_OFFSET(0x1E)) = 0x28;
+
+	// Configure the CPU registers.
+	CPU68.PC.value = 0x0000;
+	CPU68.A[0].value = 0x10;
+	CPU68.A[7].value = 0x20;
+	CPU68.CCR.bitmask.user.Z = 1;
+	CPU68.CCR.bitmask.user.X = 0;
+
+	// Perform the operation and check if the results are as expected.
+	abcd_m8_m8();
+
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0x1E)), 0x74);
+	ASSERT_EQ(CPU68.A[0].value, 0x0F);
+	ASSERT_EQ(CPU68.A[7].value, 0x1E);
+	ASSERT_EQ(CPU68.PC.value, 0x02);
+}
+
+TEST_CASE(ABCD, TableHandlerMatchesGenericHandlerForEveryEncoding)
+{
+	m68_mmu_initialise();
+	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
+	int mismatches = 0;
+
+	for (uint16_t rx = 0; rx < 8; ++rx) {
+		for (uint16_t ry = 0; ry < 8; ++ry) {
+			uint16_t opcode = 0xC100 | (rx << 9) | ry;
+
+			// Run the generic handler, then the table entry, from the same state.
+			struct M68000 results[2];
+			for (int pass = 0; pass < 2; ++pass) {
+				*(ptr + M68_MMU_BYTE_OFFSET(0)) = opcode >> 8;
+				*(ptr + M68_MMU_BYTE_OFFSET(1)) = opcode & 0xFF;
+				CPU68.PC.value = 0x0000;
+				for (int r = 0; r < 8; ++r) {
+					CPU68.D[r].value = 0x11 * (r + 1);
+				}
+				CPU68.CCR.bitmask.user.Z = 1;
+				CPU68.CCR.bitmask.user.X = 1;
+
+				if (pass == 0) {
+					abcd_dn_dn();
+				} else {
+					m68_instruction_table[opcode].imp();
+				}
+				results[pass] = CPU68;
+			}
+
+			for (int r = 0; r < 8; ++r) {
+				mismatches += results[0].D[r].value != results[1].D[r].value;
+			}
+			mismatches += results[0].CCR.value != results[1].CCR.value;
+		}
+	}
+
+	ASSERT_EQ(mismatches, 0);
+}
+
 #endif
\ No newline at end of file
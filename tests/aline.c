@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/aline.h"
+
+#if defined(UNIT_TEST)
+
+static struct m68_aline_trap aline_test_last_trap;
+static int aline_test_calls = 0;
+
+static int aline_test_handler(const struct m68_aline_trap *trap)
+{
+	aline_test_last_trap = *trap;
+	++aline_test_calls;
+	return 1;
+}
+
+static int aline_test_clobbering_handler(const struct m68_aline_trap *trap)
+{
+	CPU68.A[0].value = 0xDEADBEEF;
+	CPU68.A[1].value = 0xDEADBEEF;
+	CPU68.D[0].value = 0;
+	CPU68.D[1].value = 0xDEADBEEF;
+	return 1;
+}
+
+static int aline_test_declining_handler(const struct m68_aline_trap *trap)
+{
+	return 0;
+}
+
+static void aline_test_configure(uint16_t opcode)
+{
+	m68_mmu_initialise();
+	m68_aline_reset();
+	aline_test_calls = 0;
+
+	m68_mmu_write_long(M68_VECTOR_LINE_1010 * 4, 0x00003000);
+	m68_mmu_write_word(0x1000, opcode);
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2000;
+	CPU68.A[7].value = 0x8000;
+}
+
+// MARK: - Decoding
+
+TEST_CASE(ALine, DecodeToolboxTrap)
+{
+	struct m68_aline_trap trap = m68_aline_decode(0xADF4);
+	ASSERT_EQ(trap.toolbox, 1);
+	ASSERT_EQ(trap.auto_pop, 1);
+	ASSERT_EQ(trap.number, 0x1F4);
+}
+
+TEST_CASE(ALine, DecodeOSTrap)
+{
+	struct m68_aline_trap trap = m68_aline_decode(0xA71E);
+	ASSERT_EQ(trap.toolbox, 0);
+	ASSERT_EQ(trap.number, 0x1E);
+	ASSERT_EQ(trap.flags, 3);
+	ASSERT_EQ(trap.return_a0, 1);
+}
+
+TEST_CASE(ALine, EveryLine1010OpcodeIsInTheTable)
+{
+	struct m68_instruction *ins = m68_fetch_instruction_for_opcode(0xA9F4);
+	ASSERT_NEQ(ins, NULL);
+	ASSERT_EQ(ins->imp, m68_aline_dispatch);
+	ASSERT_EQ_STR(ins->mnemonic, "DC.W $A9F4");
+}
+
+// MARK: - Dispatch
+
+TEST_CASE(ALine, NativeToolboxHandlerIsCalled)
+{
+	aline_test_configure(0xA9F4);
+	m68_aline_register_toolbox(0xA9F4, aline_test_handler);
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(aline_test_calls, 1);
+	ASSERT_EQ(aline_test_last_trap.number, 0x1F4);
+	ASSERT_EQ(aline_test_last_trap.address, 0x1000);
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+}
+
+TEST_CASE(ALine, AutoPopReturnsToCallerOfGlue)
+{
+	aline_test_configure(0xADF4);
+	m68_aline_register_toolbox(0x1F4, aline_test_handler);
+	CPU68.A[7].value = 0x7FFC;
+	m68_mmu_write_long(0x7FFC, 0x00002468);
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(CPU68.PC.value, 0x2468);
+	ASSERT_EQ(CPU68.A[7].value, 0x8000);
+}
+
+TEST_CASE(ALine, OSTrapPreservesRegistersAndTestsResult)
+{
+	aline_test_configure(0xA01E);
+	m68_aline_register_os(0x1E, aline_test_clobbering_handler);
+	CPU68.A[0].value = 0x1111;
+	CPU68.A[1].value = 0x2222;
+	CPU68.D[0].value = 0x3333;
+	CPU68.D[1].value = 0x4444;
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(CPU68.A[0].value, 0x1111);
+	ASSERT_EQ(CPU68.A[1].value, 0x2222);
+	ASSERT_EQ(CPU68.D[1].value, 0x4444);
+	ASSERT_EQ(CPU68.D[0].value, 0);
+	ASSERT_EQ(CPU68.CCR.bitmask.user.Z, 1);
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+}
+
+TEST_CASE(ALine, OSTrapMayReturnA0)
+{
+	aline_test_configure(0xA11E);
+	m68_aline_register_os(0x1E, aline_test_clobbering_handler);
+	CPU68.A[0].value = 0x1111;
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(CPU68.A[0].value, 0xDEADBEEF);
+}
+
+TEST_CASE(ALine, UnhandledTrapTakesLine1010Exception)
+{
+	aline_test_configure(0xA9F4);
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	ASSERT_EQ(m68_mmu_read_long(CPU68.A[7].value + 2), 0x1000);
+}
+
+TEST_CASE(ALine, DeclinedTrapTakesLine1010Exception)
+{
+	aline_test_configure(0xA9F4);
+	m68_aline_register_toolbox(0xA9F4, aline_test_declining_handler);
+
+	m68_aline_dispatch();
+
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	ASSERT_EQ(m68_mmu_read_long(CPU68.A[7].value + 2), 0x1000);
+}
+
+#endif
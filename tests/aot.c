@@ -0,0 +1,269 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/instruction_bodies.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/idle.h"
+#include "cpu/cache.h"
+#include "cpu/fusion.h"
+#include "cpu/aot.h"
+
+#if defined(UNIT_TEST)
+
+#define AOT_TEST_ILLEGAL	0x4AFC
+
+static uint32_t aot_test_block_runs = 0;
+
+// MARK: - Translated Module
+
+/* As written by tools/aot for ABCD -(A1),-(A0); ABCD -(A3),-(A2) twice, with
+ * a count of the times the block runs. */
+static const uint16_t aot_test_code_00001000[] = {
+	0xC109, 0xC50B, 0xC109, 0xC50B
+};
+
+static void aot_test_block_00001000(void)
+{
+	uint32_t generation = DECODE_CACHE_GENERATION;
+	++aot_test_block_runs;
+
+	/* $00001000  ABCD -(A1),-(A0) */
+	M68_ABCD_M8_M8_BODY(0xC109, M68_MODEL_68030);
+	CPU68.cycles += 18;
+	if (!m68_aot_continue(0x00001000, 0x00001000, 0x00001002, generation)) {
+		return;
+	}
+
+	/* $00001002  ABCD -(A3),-(A2) */
+	M68_ABCD_M8_M8_BODY(0xC50B, M68_MODEL_68030);
+	CPU68.cycles += 18;
+	if (!m68_aot_continue(0x00001000, 0x00001002, 0x00001004, generation)) {
+		return;
+	}
+
+	/* $00001004  ABCD -(A1),-(A0) */
+	M68_ABCD_M8_M8_BODY(0xC109, M68_MODEL_68030);
+	CPU68.cycles += 18;
+	if (!m68_aot_continue(0x00001000, 0x00001004, 0x00001006, generation)) {
+		return;
+	}
+
+	/* $00001006  ABCD -(A3),-(A2) */
+	M68_ABCD_M8_M8_BODY(0xC50B, M68_MODEL_68030);
+	CPU68.cycles += 18;
+	if (!m68_aot_continue(0x00001000, 0x00001006, 0x00001008, generation)) {
+		return;
+	}
+}
+
+static const struct m68_aot_block aot_test_blocks[] = {
+	{ 0x00001000, 8, aot_test_code_00001000, { "aot_test $00001000", aot_test_block_00001000, 0 } },
+};
+
+static const struct m68_aot_module aot_test = {
+	"aot_test", M68_MODEL_68030, 1, aot_test_blocks
+};
+
+/* ABCD is the same on every model, so the block also stands in for one
+ * translated for the 68000. */
+static const struct m68_aot_module aot_test_68000 = {
+	"aot_test_68000", M68_MODEL_68000, 1, aot_test_blocks
+};
+
+// MARK: - Helpers
+
+struct aot_test_result {
+	uint32_t destination;
+	uint16_t ccr;
+	uint32_t a0, a2, pc;
+	uint64_t cycles;
+};
+
+static void aot_test_configure(int translated)
+{
+	struct m68_idle_config idle = { 0, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+
+	m68_mmu_initialise();
+	m68_scheduler_reset();
+	m68_idle_configure(&idle);
+	m68_mmu_write_long(M68_VECTOR_BUS_ERROR * 4, 0x00003000);
+	m68_mmu_write_long(M68_VECTOR_ILLEGAL_INSTRUCTION * 4, 0x00003000);
+	for (uint32_t i = 0; i < 4; ++i) {
+		m68_mmu_write_word(0x1000 + i * 2, aot_test_code_00001000[i]);
+	}
+
+	m68_set_model(M68_MODEL_68030);
+	m68_cache_set_mode(M68_CACHE_TRUST);
+	m68_cache_set_cacr(M68_CACR_EI);
+	m68_fusion_set_enabled(0);
+	m68_aot_reset();
+	if (translated) {
+		m68_aot_register(&aot_test);
+	}
+	CPU68.VBR.value = 0;
+	aot_test_block_runs = 0;
+}
+
+/* Add two four digit BCD numbers with the program at 0x1000, a digit pair at
+ * a time from alternate address registers. */
+static void aot_test_reset(uint16_t ccr)
+{
+	m68_mmu_write_long(0x2000, 0x12345678);
+	m68_mmu_write_long(0x2100, 0x87654329);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = ccr;
+	CPU68.A[0].value = 0x2104;
+	CPU68.A[1].value = 0x2004;
+	CPU68.A[2].value = 0x2103;
+	CPU68.A[3].value = 0x2003;
+	CPU68.A[7].value = 0x8000;
+	CPU68.cycles = 0;
+}
+
+static struct aot_test_result aot_test_result(void)
+{
+	return (struct aot_test_result){
+		m68_mmu_read_long(0x2100), CPU68.CCR.value, CPU68.A[0].value,
+		CPU68.A[2].value, CPU68.PC.value, CPU68.cycles
+	};
+}
+
+/* Run the program twice, so that the second run is from the decode cache. */
+static struct aot_test_result aot_test_run(int translated, uint16_t ccr)
+{
+	aot_test_configure(translated);
+	aot_test_reset(ccr);
+	m68_run(72);
+	aot_test_reset(ccr);
+	m68_run(72);
+	return aot_test_result();
+}
+
+static void aot_test_restore(void)
+{
+	struct m68_idle_config idle = { 1, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+	m68_idle_configure(&idle);
+	m68_aot_reset();
+	m68_fusion_set_enabled(1);
+	m68_cache_set_mode(M68_CACHE_STRICT);
+	m68_mmu_set_memory_limit(0);
+	m68_set_model(M68_MODEL_68000);
+}
+
+// MARK: - Translated Execution
+
+TEST_CASE(AOT, BlocksMatchInterpretedInstructions)
+{
+	for (uint16_t ccr = 0x2000; ccr <= 0x2014; ccr += 0x14) {
+		struct aot_test_result interpreted = aot_test_run(0, ccr);
+		ASSERT_EQ(aot_test_block_runs, 0);
+		struct aot_test_result translated = aot_test_run(1, ccr);
+		ASSERT_EQ(aot_test_block_runs, 1);
+
+		ASSERT_EQ(translated.destination, interpreted.destination);
+		ASSERT_EQ(translated.ccr, interpreted.ccr);
+		ASSERT_EQ(translated.a0, interpreted.a0);
+		ASSERT_EQ(translated.a2, interpreted.a2);
+		ASSERT_EQ(translated.pc, 0x1008);
+		ASSERT_EQ(translated.cycles, interpreted.cycles);
+	}
+	aot_test_restore();
+}
+
+TEST_CASE(AOT, ChangedCodeIsNotTranslated)
+{
+	aot_test_configure(1);
+	m68_mmu_write_word(0x1006, AOT_TEST_ILLEGAL);
+	aot_test_reset(0x2000);
+	m68_run(72);
+	aot_test_reset(0x2000);
+	m68_run(72);
+
+	ASSERT_EQ(aot_test_block_runs, 0);
+	aot_test_restore();
+}
+
+TEST_CASE(AOT, StepDoesNotRunBlocks)
+{
+	aot_test_run(1, 0x2000);
+	aot_test_reset(0x2000);
+	m68_step();
+
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+	ASSERT_EQ(aot_test_block_runs, 1);
+	aot_test_restore();
+}
+
+TEST_CASE(AOT, BlocksRunInTheStrictModeOnThe68000)
+{
+	aot_test_configure(0);
+	m68_set_model(M68_MODEL_68000);
+	m68_cache_set_mode(M68_CACHE_STRICT);
+	m68_aot_register(&aot_test_68000);
+	aot_test_reset(0x2000);
+	m68_run(72);
+	aot_test_reset(0x2000);
+	m68_run(72);
+
+	ASSERT_EQ(aot_test_block_runs, 1);
+	ASSERT_EQ(CPU68.PC.value, 0x1008);
+	ASSERT_EQ(CPU68.cycles, 72);
+
+	// The code is checked each time, so changing it needs no flush.
+	m68_mmu_write_word(0x1006, AOT_TEST_ILLEGAL);
+	aot_test_reset(0x2000);
+	m68_run(54);
+	ASSERT_EQ(aot_test_block_runs, 1);
+	ASSERT_EQ(CPU68.PC.value, 0x1006);
+	aot_test_restore();
+}
+
+TEST_CASE(AOT, FaultInABlockIsTakenOnTheInstruction)
+{
+	struct aot_test_result results[2];
+	for (int translated = 0; translated < 2; ++translated) {
+		aot_test_configure(translated);
+		m68_mmu_set_memory_limit(0x100000);
+		aot_test_reset(0x2000);
+		m68_run(72);
+
+		aot_test_reset(0x2000);
+		CPU68.A[2].value = 0x200001;
+		m68_run(36);
+		results[translated] = aot_test_result();
+		ASSERT_EQ(m68_mmu_read_long(CPU68.A[7].value + 2), 0x1002);
+	}
+
+	ASSERT_EQ(aot_test_block_runs, 1);
+	ASSERT_EQ(results[1].destination, results[0].destination);
+	ASSERT_EQ(results[1].pc, 0x3000);
+	ASSERT_EQ(results[1].cycles, results[0].cycles);
+	aot_test_restore();
+}
+
+#endif
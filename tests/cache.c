@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/debug.h"
+#include "cpu/cache.h"
+
+#if defined(UNIT_TEST)
+
+#define CACHE_TEST_ABCD		0xC101	/* ABCD D1,D0 */
+#define CACHE_TEST_ILLEGAL	0x4AFC
+
+static void cache_test_configure(enum m68_model model, enum m68_cache_mode mode, uint32_t cacr)
+{
+	m68_mmu_initialise();
+	m68_mmu_write_long(M68_VECTOR_ILLEGAL_INSTRUCTION * 4, 0x00003000);
+	m68_mmu_write_long(M68_VECTOR_PRIVILEGE_VIOLATION * 4, 0x00003100);
+	m68_mmu_write_long(M68_VECTOR_LINE_1111 * 4, 0x00003200);
+	m68_mmu_write_word(0x1000, CACHE_TEST_ABCD);
+
+	m68_set_model(model);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2000;
+	CPU68.A[7].value = 0x8000;
+	CPU68.VBR.value = 0;
+	m68_cache_set_mode(mode);
+	m68_cache_set_cacr(cacr);
+}
+
+/* Run the instruction at 0x1000, replace it with an illegal instruction, and
+ * run it again. */
+static void cache_test_modify(void)
+{
+	m68_step();
+	m68_mmu_write_word(0x1000, CACHE_TEST_ILLEGAL);
+	CPU68.PC.value = 0x1000;
+	m68_step();
+}
+
+static void cache_test_restore(void)
+{
+	m68_cache_set_mode(M68_CACHE_STRICT);
+	m68_debug_reset();
+	m68_set_model(M68_MODEL_68000);
+}
+
+// MARK: - Modes
+
+TEST_CASE(Cache, StrictModeSeesModifiedCode)
+{
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_STRICT, M68_CACR_EI);
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, TrustModeRunsCachedDecodesUntilFlushed)
+{
+	static const uint16_t program[] = { 0x4E7B, 0x2002 };	/* MOVEC D2,CACR */
+
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_TRUST, M68_CACR_EI);
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+
+	m68_mmu_write_word(0x1100, program[0]);
+	m68_mmu_write_word(0x1102, program[1]);
+	CPU68.D[2].value = M68_CACR_EI | M68_CACR_CI;
+	CPU68.PC.value = 0x1100;
+	m68_step();
+	ASSERT_EQ(CPU68.CACR.value, M68_CACR_EI);
+
+	CPU68.PC.value = 0x1000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, TrustModeIsStrictWithTheCacheDisabled)
+{
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_TRUST, 0);
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+
+	cache_test_configure(M68_MODEL_68000, M68_CACHE_TRUST, M68_CACR_EI);
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, ClearEntryFlushesTheLineAtCAAR)
+{
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_TRUST, M68_CACR_EI);
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+
+	CPU68.CAAR.value = 0x1008;
+	m68_cache_set_cacr(M68_CACR_EI | M68_CACR_CEI);
+	CPU68.PC.value = 0x1000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, BreakpointsAreNotSkippedByCachedDecodes)
+{
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_TRUST, M68_CACR_EI);
+	m68_step();
+	m68_debug_add_breakpoint(0x1000, NULL, NULL);
+	CPU68.PC.value = 0x1000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x1000);
+	ASSERT_EQ(m68_debug_stopped(), 1);
+	cache_test_restore();
+}
+
+// MARK: - CACR
+
+TEST_CASE(Cache, CACRKeepsOnlyTheModelsBits)
+{
+	cache_test_configure(M68_MODEL_68020, M68_CACHE_STRICT, 0x0000FFFF);
+	ASSERT_EQ(CPU68.CACR.value, M68_CACR_EI | M68_CACR_FI);
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_STRICT, 0x0000FFFF);
+	ASSERT_EQ(CPU68.CACR.value, 0x3313);
+	cache_test_configure(M68_MODEL_68040, M68_CACHE_STRICT, 0xFFFFFFFF);
+	ASSERT_EQ(CPU68.CACR.value, M68_CACR_040_IE | M68_CACR_040_DE);
+	cache_test_restore();
+}
+
+// MARK: - CINV and CPUSH
+
+TEST_CASE(Cache, CINVFlushesOnlyTheInstructionCache)
+{
+	cache_test_configure(M68_MODEL_68040, M68_CACHE_TRUST, M68_CACR_040_IE);
+	m68_mmu_write_word(0x1100, 0xF448);	/* CINVL DC,(A0) */
+	m68_mmu_write_word(0x1102, 0xF488);	/* CINVL IC,(A0) */
+	CPU68.A[0].value = 0x1000;
+	cache_test_modify();
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+
+	CPU68.PC.value = 0x1100;
+	m68_step();
+	CPU68.PC.value = 0x1000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+
+	CPU68.PC.value = 0x1102;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x1104);
+	CPU68.PC.value = 0x1000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, CPUSHIsOnlyOnThe68040)
+{
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_STRICT, 0);
+	m68_mmu_write_word(0x1000, 0xF4F8);	/* CPUSHA BC */
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3200);
+	cache_test_restore();
+}
+
+// MARK: - MOVEC
+
+TEST_CASE(Cache, MOVECMovesControlRegisters)
+{
+	cache_test_configure(M68_MODEL_68020, M68_CACHE_STRICT, 0);
+	m68_mmu_write_word(0x1000, 0x4E7B);	/* MOVEC A1,VBR */
+	m68_mmu_write_word(0x1002, 0x9801);
+	m68_mmu_write_word(0x1004, 0x4E7A);	/* MOVEC VBR,D3 */
+	m68_mmu_write_word(0x1006, 0x3801);
+	m68_mmu_write_word(0x1008, 0x4E7B);	/* MOVEC D1,SFC */
+	m68_mmu_write_word(0x100A, 0x1000);
+	CPU68.A[1].value = 0x00004000;
+	CPU68.D[1].value = 0xFFFFFFFD;
+
+	m68_step();
+	m68_step();
+	m68_step();
+	ASSERT_EQ(CPU68.VBR.value, 0x00004000);
+	ASSERT_EQ(CPU68.D[3].value, 0x00004000);
+	ASSERT_EQ(CPU68.SFC.value, 5);
+	ASSERT_EQ(CPU68.PC.value, 0x100C);
+	cache_test_restore();
+}
+
+TEST_CASE(Cache, MOVECChecksModelAndPrivilege)
+{
+	/* CAAR does not exist on the 68040. */
+	cache_test_configure(M68_MODEL_68040, M68_CACHE_STRICT, 0);
+	m68_mmu_write_word(0x1000, 0x4E7A);	/* MOVEC CAAR,D0 */
+	m68_mmu_write_word(0x1002, 0x0802);
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+
+	cache_test_configure(M68_MODEL_68030, M68_CACHE_STRICT, 0);
+	m68_mmu_write_word(0x1000, 0x4E7A);
+	m68_mmu_write_word(0x1002, 0x0802);
+	CPU68.CCR.value = 0x0000;
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3100);
+	cache_test_restore();
+}
+
+#endif
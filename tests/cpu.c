@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+
+#if defined(UNIT_TEST)
+
+TEST_CASE(CPU, UnifiedRegisterFileAliasesDataAndAddressRegisters)
+{
+	CPU68.D[3].value = 0x12345678;
+	CPU68.A[5].value = 0x9ABCDEF0;
+
+	ASSERT_EQ(CPU68.R[3].value, 0x12345678);
+	ASSERT_EQ(CPU68.R[8 + 5].value, 0x9ABCDEF0);
+}
+
+TEST_CASE(CPU, ControlRegistersAreReachableByName)
+{
+	CPU68.VBR.value = 0x00400000;
+	CPU68.TC.value = 0x80000000;
+
+	ASSERT_EQ(CPU68.control.VBR.value, 0x00400000);
+	ASSERT_EQ(CPU68.control.TC.value, 0x80000000);
+}
+
+TEST_CASE(CPU, HotRegistersShareTheFirstCacheLines)
+{
+	ASSERT_EQ(offsetof(struct M68000, R), 0);
+	ASSERT_EQ(offsetof(struct M68000, PC) / M68_CPU_CACHE_LINE_SIZE, 1);
+	ASSERT_EQ(offsetof(struct M68000, control) % M68_CPU_CACHE_LINE_SIZE, 0);
+}
+
+#endif
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/debug.h"
+
+#if defined(UNIT_TEST)
+
+static struct m68_watch_hit debug_test_last_hit;
+static int debug_test_hits = 0;
+
+static void debug_test_watch(const struct m68_watch_hit *hit, void *context)
+{
+	debug_test_last_hit = *hit;
+	++debug_test_hits;
+}
+
+static int debug_test_count_and_continue(uint32_t address, void *context)
+{
+	++*(int *)context;
+	return 0;
+}
+
+static void debug_test_configure(void)
+{
+	m68_mmu_initialise();
+	m68_scheduler_reset();
+	m68_debug_reset();
+	debug_test_hits = 0;
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.cycles = 0;
+	CPU68.fault.vector = 0;
+	for (uint32_t address = 0x1000; address < 0x1100; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+}
+
+// MARK: - Watchpoints
+
+TEST_CASE(Debug, WatchpointReportsExactRange)
+{
+	debug_test_configure();
+	ASSERT_NEQ(m68_debug_add_watchpoint(0x5000, 2, M68_WATCH_WRITE, debug_test_watch, NULL), -1);
+
+	m68_mmu_write_word(0x5000, 0x1234);
+	ASSERT_EQ(debug_test_hits, 1);
+	ASSERT_EQ(debug_test_last_hit.address, 0x5000);
+	ASSERT_EQ(debug_test_last_hit.value, 0x1234);
+	ASSERT_EQ(debug_test_last_hit.size, 2);
+	ASSERT_EQ(debug_test_last_hit.write, 1);
+
+	// A long crossing into the page is split, and reported a byte at a time.
+	m68_mmu_write_long(0x4FFE, 0xAABBCCDD);
+	ASSERT_EQ(debug_test_hits, 3);
+	ASSERT_EQ(debug_test_last_hit.address, 0x5001);
+	ASSERT_EQ(debug_test_last_hit.value, 0xDD);
+
+	m68_mmu_write_word(0x5002, 0x5678);
+	ASSERT_EQ(m68_mmu_read_word(0x5000), 0xCCDD);
+	ASSERT_EQ(debug_test_hits, 3);
+	m68_debug_reset();
+}
+
+TEST_CASE(Debug, WatchpointOnlySlowsItsPage)
+{
+	debug_test_configure();
+	int watchpoint = m68_debug_add_watchpoint(0x5010, 1, M68_WATCH_ACCESS, debug_test_watch, NULL);
+
+	m68_mmu_write_byte(0x6000, 1);
+	m68_mmu_write_byte(0x5000, 1);
+	ASSERT_EQ(m68_mmu_tlb_entry(MMU_WRITE_TLB, 0x6000)->tag, 0x6000);
+	ASSERT_EQ(m68_mmu_tlb_entry(MMU_WRITE_TLB, 0x5000)->tag, M68_MMU_TLB_INVALID);
+	ASSERT_EQ(m68_mmu_read_byte(0x5010), 0);
+	ASSERT_EQ(debug_test_hits, 1);
+	ASSERT_EQ(debug_test_last_hit.write, 0);
+
+	m68_debug_remove_watchpoint(watchpoint);
+	m68_mmu_write_byte(0x5000, 1);
+	m68_mmu_read_byte(0x5010);
+	ASSERT_EQ(m68_mmu_tlb_entry(MMU_WRITE_TLB, 0x5000)->tag, 0x5000);
+	ASSERT_EQ(debug_test_hits, 1);
+}
+
+TEST_CASE(Debug, WatchpointRejectsWrappingRange)
+{
+	debug_test_configure();
+	ASSERT_EQ(m68_debug_add_watchpoint(0xFFFFFFF0, 0x20, M68_WATCH_ACCESS, debug_test_watch, NULL), -1);
+	ASSERT_EQ(m68_debug_add_watchpoint(0x5000, 0, M68_WATCH_ACCESS, debug_test_watch, NULL), -1);
+
+	int watchpoint = m68_debug_add_watchpoint(0xFFFFFFF0, 0x10, M68_WATCH_ACCESS, debug_test_watch, NULL);
+	ASSERT_NEQ(watchpoint, -1);
+	m68_debug_remove_watchpoint(watchpoint);
+}
+
+TEST_CASE(Debug, PageFlagsOnlyInvalidateTheirPage)
+{
+	debug_test_configure();
+	m68_mmu_write_byte(0x6000, 1);
+	int watchpoint = m68_debug_add_watchpoint(0x5010, 1, M68_WATCH_ACCESS, debug_test_watch, NULL);
+	ASSERT_EQ(m68_mmu_tlb_entry(MMU_WRITE_TLB, 0x6000)->tag, 0x6000);
+	m68_debug_remove_watchpoint(watchpoint);
+	ASSERT_EQ(m68_mmu_tlb_entry(MMU_WRITE_TLB, 0x6000)->tag, 0x6000);
+
+	// Clearing the flags of a page without a table doesn't allocate one.
+	m68_mmu_set_debug_flags(0x00C00000, 0, 0);
+	ASSERT_EQ(MMU_PAGE_DIR[3].field.present, 0);
+}
+
+// MARK: - Breakpoints
+
+TEST_CASE(Debug, BreakpointStopsBeforeInstruction)
+{
+	debug_test_configure();
+	m68_debug_add_breakpoint(0x1006, NULL, NULL);
+
+	m68_run(1000);
+	ASSERT_EQ(CPU68.PC.value, 0x1006);
+	ASSERT_EQ(CPU68.cycles, 18);
+	ASSERT_EQ(m68_debug_stopped(), 1);
+
+	m68_run(12);
+	ASSERT_EQ(CPU68.PC.value, 0x100A);
+	ASSERT_EQ(m68_debug_stopped(), 0);
+	m68_debug_reset();
+}
+
+TEST_CASE(Debug, BreakpointCallbackCanContinue)
+{
+	int count = 0;
+	debug_test_configure();
+	m68_debug_add_breakpoint(0x1004, debug_test_count_and_continue, &count);
+
+	m68_run(60);
+	ASSERT_EQ(CPU68.PC.value, 0x1014);
+	ASSERT_EQ(count, 1);
+	m68_debug_reset();
+}
+
+#endif
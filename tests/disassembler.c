@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/disassembler.h"
+
+#if defined(UNIT_TEST)
+
+static void disassembler_test_handler(void)
+{
+}
+
+TEST_CASE(Disassembler, ABCDFromHostBuffer)
+{
+	uint8_t code[] = { 0xC1, 0x01, 0xC3, 0x0F };
+	struct m68_disassembly out[4];
+
+	ASSERT_EQ(m68_disassemble_buffer(code, sizeof(code), 0x1000, out, 4), 2);
+	ASSERT_EQ(out[0].address, 0x1000);
+	ASSERT_EQ(out[0].length, 2);
+	ASSERT_EQ_STR(out[0].text, "ABCD D1,D0");
+	ASSERT_EQ(out[1].address, 0x1002);
+	ASSERT_EQ_STR(out[1].text, "ABCD -(A7),-(A1)");
+}
+
+TEST_CASE(Disassembler, UnknownOpcodeIsReportedAsData)
+{
+	uint8_t code[] = { 0xFF, 0xFF };
+	struct m68_disassembly out[1];
+
+	ASSERT_EQ(m68_disassemble_buffer(code, sizeof(code), 0, out, 1), 1);
+	ASSERT_EQ_STR(out[0].text, "DC.W $FFFF");
+}
+
+TEST_CASE(Disassembler, StopsWhenOutputIsFull)
+{
+	uint8_t code[] = { 0xC1, 0x01, 0xC1, 0x02, 0xC1, 0x03 };
+	struct m68_disassembly out[2];
+
+	ASSERT_EQ(m68_disassemble_buffer(code, sizeof(code), 0, out, 2), 2);
+	ASSERT_EQ_STR(out[1].text, "ABCD D2,D0");
+}
+
+TEST_CASE(Disassembler, GuestRangeAcrossPageBoundary)
+{
+	m68_mmu_initialise();
+
+	m68_mmu_write_word(0x1FFE, 0xC101);
+	m68_mmu_write_word(0x2000, 0xC30F);
+
+	struct m68_disassembly out[4];
+	ASSERT_EQ(m68_disassemble_range(0x1FFE, 4, out, 4), 2);
+	ASSERT_EQ_STR(out[0].text, "ABCD D1,D0");
+	ASSERT_EQ(out[1].address, 0x2000);
+	ASSERT_EQ_STR(out[1].text, "ABCD -(A7),-(A1)");
+}
+
+TEST_CASE(Disassembler, OddWordAcrossPageBoundaryLeavesNoFault)
+{
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68000);
+	m68_mmu_set_memory_limit(0x100000);
+
+	m68_mmu_write_byte(0x1FFF, 0xC1);
+	m68_mmu_write_byte(0x2000, 0x01);
+	m68_mmu_write_byte(0xFFFFF, 0xC1);
+
+	struct m68_disassembly out[1];
+	ASSERT_EQ(m68_disassemble_range(0x1FFF, 2, out, 1), 1);
+	ASSERT_EQ_STR(out[0].text, "ABCD D1,D0");
+	ASSERT_EQ(m68_disassemble_range(0xFFFFF, 2, out, 1), 1);
+	ASSERT_EQ_STR(out[0].text, "ABCD D0,D0");
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_mmu_set_memory_limit(0);
+}
+
+// MARK: - Effective Addresses
+
+TEST_CASE(Disassembler, AbsoluteLongAndImmediateOperands)
+{
+	m68_instruction_table[0x3039] = (struct m68_instruction){ "MOVE.W %ew,%Ew", disassembler_test_handler };
+	m68_instruction_table[0x303C] = (struct m68_instruction){ "MOVE.W %ew,%Ew", disassembler_test_handler };
+
+	uint8_t code[] = {
+		0x30, 0x39, 0x00, 0x01, 0x23, 0x45,
+		0x30, 0x3C, 0x12, 0x34,
+	};
+	struct m68_disassembly out[2];
+	size_t n = m68_disassemble_buffer(code, sizeof(code), 0, out, 2);
+
+	m68_instruction_table[0x3039] = (struct m68_instruction){ 0 };
+	m68_instruction_table[0x303C] = (struct m68_instruction){ 0 };
+
+	ASSERT_EQ(n, 2);
+	ASSERT_EQ(out[0].length, 6);
+	ASSERT_EQ_STR(out[0].text, "MOVE.W $00012345.L,D0");
+	ASSERT_EQ(out[1].length, 4);
+	ASSERT_EQ_STR(out[1].text, "MOVE.W #$1234,D0");
+}
+
+TEST_CASE(Disassembler, BriefAndFullExtensionWords)
+{
+	m68_instruction_table[0x3030] = (struct m68_instruction){ "MOVE.W %ew,%Ew", disassembler_test_handler };
+
+	uint8_t code[] = {
+		0x30, 0x30, 0x14, 0x10,
+		0x30, 0x30, 0x09, 0x22, 0x00, 0x04, 0xFF, 0xF8,
+	};
+	struct m68_disassembly out[2];
+	size_t n = m68_disassemble_buffer(code, sizeof(code), 0, out, 2);
+
+	m68_instruction_table[0x3030] = (struct m68_instruction){ 0 };
+
+	ASSERT_EQ(n, 2);
+	ASSERT_EQ_STR(out[0].text, "MOVE.W ($10,A0,D1.W*4),D0");
+	ASSERT_EQ(out[1].length, 8);
+	ASSERT_EQ_STR(out[1].text, "MOVE.W ([$4,A0,D0.L],-$8),D0");
+}
+
+TEST_CASE(Disassembler, TruncatedExtensionWordsAreReportedAsData)
+{
+	m68_instruction_table[0x3039] = (struct m68_instruction){ "MOVE.W %ew,%Ew", disassembler_test_handler };
+
+	uint8_t code[] = { 0x30, 0x39, 0x00, 0x01 };
+	struct m68_disassembly out[2];
+	size_t n = m68_disassemble_buffer(code, sizeof(code), 0, out, 2);
+
+	m68_instruction_table[0x3039] = (struct m68_instruction){ 0 };
+
+	ASSERT_EQ(n, 2);
+	ASSERT_EQ_STR(out[0].text, "DC.W $3039");
+	ASSERT_EQ_STR(out[1].text, "DC.W $0001");
+}
+
+#endif
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/ea.h"
+
+#if defined(UNIT_TEST)
+
+/* Start with the extension words at 0x1002 and the registers pointing at
+ * data in 0x2000-0x3000. */
+static void ea_test_reset(enum m68_model model)
+{
+	m68_mmu_initialise();
+	m68_set_model(model);
+	for (int r = 0; r < 8; ++r) {
+		CPU68.D[r].value = 0;
+		CPU68.A[r].value = 0x2000 + r * 0x100;
+	}
+	for (uint32_t address = 0x2000; address < 0x3000; address += 4) {
+		m68_mmu_write_long(address, address);
+	}
+}
+
+static void ea_test_restore(void)
+{
+	m68_set_model(M68_MODEL_68000);
+}
+
+// MARK: - Address Registers
+
+TEST_CASE(EffectiveAddress, ByteStepsOfA7KeepItAligned)
+{
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68000);
+
+	ASSERT_EQ(m68_ea_address(M68_EA_POST, 7, M68_EA_BYTE, &next), 0x2700);
+	ASSERT_EQ(CPU68.A[7].value, 0x2702);
+	ASSERT_EQ(m68_ea_address(M68_EA_PRE, 7, M68_EA_BYTE, &next), 0x2700);
+	ASSERT_EQ(CPU68.A[7].value, 0x2700);
+	ASSERT_EQ(m68_ea_address(M68_EA_POST, 0, M68_EA_BYTE, &next), 0x2000);
+	ASSERT_EQ(CPU68.A[0].value, 0x2001);
+	ASSERT_EQ(m68_ea_address(M68_EA_PRE, 1, M68_EA_LONG, &next), 0x20FC);
+	ASSERT_EQ(next, 0x1002);
+	ea_test_restore();
+}
+
+TEST_CASE(EffectiveAddress, DisplacementAndAbsoluteModesUseExtensionWords)
+{
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68000);
+	m68_mmu_write_word(0x1002, 0xFFF0);
+	m68_mmu_write_word(0x1004, 0xFFF0);
+	m68_mmu_write_long(0x1006, 0x00123456);
+
+	ASSERT_EQ(m68_ea_address(M68_EA_DISP, 2, M68_EA_WORD, &next), 0x21F0);
+	ASSERT_EQ(m68_ea_address(M68_EA_OTHER, M68_EA_ABSW, M68_EA_WORD, &next), 0xFFFFFFF0);
+	ASSERT_EQ(m68_ea_address(M68_EA_OTHER, M68_EA_ABSL, M68_EA_WORD, &next), 0x00123456);
+	ASSERT_EQ(next, 0x100A);
+	ea_test_restore();
+}
+
+TEST_CASE(EffectiveAddress, PCRelativeAndImmediateModesUseTheInstructionStream)
+{
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68000);
+	m68_mmu_write_word(0x1002, 0x0100);
+	m68_mmu_write_word(0x1004, 0x00AB);
+	m68_mmu_write_long(0x1006, 0xCAFEF00D);
+
+	ASSERT_EQ(m68_ea_address(M68_EA_OTHER, M68_EA_PCDISP, M68_EA_WORD, &next), 0x1102);
+	ASSERT_EQ(m68_ea_read(M68_EA_OTHER, M68_EA_IMM, M68_EA_BYTE, &next), 0xAB);
+	ASSERT_EQ(m68_ea_read(M68_EA_OTHER, M68_EA_IMM, M68_EA_LONG, &next), 0xCAFEF00D);
+	ASSERT_EQ(next, 0x100A);
+	ea_test_restore();
+}
+
+// MARK: - Indexed Modes
+
+TEST_CASE(EffectiveAddress, BriefExtensionIgnoresTheScaleBefore68020)
+{
+	/* (16,A0,D1.W*4) */
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68000);
+	m68_mmu_write_word(0x1002, 0x1410);
+	CPU68.D[1].value = 0x0001FFFC;
+
+	ASSERT_EQ(m68_ea_address(M68_EA_INDEX, 0, M68_EA_WORD, &next), 0x200C);
+	ASSERT_EQ(next, 0x1004);
+
+	next = 0x1002;
+	m68_set_model(M68_MODEL_68020);
+	ASSERT_EQ(m68_ea_address(M68_EA_INDEX, 0, M68_EA_WORD, &next), 0x2000);
+	ea_test_restore();
+}
+
+TEST_CASE(EffectiveAddress, FullExtensionIndexesBeforeOrAfterIndirection)
+{
+	/* ([$10,A0],D1.L*2,$4) and ([$10,A0,D1.L*2],$4) */
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68020);
+	m68_mmu_write_word(0x1002, 0x1B26);
+	m68_mmu_write_word(0x1004, 0x0010);
+	m68_mmu_write_word(0x1006, 0x0004);
+	m68_mmu_write_word(0x1008, 0x1B22);
+	m68_mmu_write_word(0x100A, 0x0010);
+	m68_mmu_write_word(0x100C, 0x0004);
+	CPU68.D[1].value = 0x20;
+
+	ASSERT_EQ(m68_ea_address(M68_EA_INDEX, 0, M68_EA_LONG, &next), 0x2054);
+	ASSERT_EQ(next, 0x1008);
+	ASSERT_EQ(m68_ea_address(M68_EA_INDEX, 0, M68_EA_LONG, &next), 0x2054);
+	ASSERT_EQ(next, 0x100E);
+	ea_test_restore();
+}
+
+TEST_CASE(EffectiveAddress, FullExtensionCanSuppressTheBaseAndIndex)
+{
+	/* ($2100).L from the PC, with the base and index suppressed */
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68030);
+	m68_mmu_write_word(0x1002, 0x01F0);
+	m68_mmu_write_long(0x1004, 0x00002100);
+
+	ASSERT_EQ(m68_ea_read(M68_EA_OTHER, M68_EA_PCINDEX, M68_EA_LONG, &next), 0x2100);
+	ASSERT_EQ(next, 0x1008);
+	ea_test_restore();
+}
+
+// MARK: - Registers
+
+TEST_CASE(EffectiveAddress, RegisterWritesOnlyChangeTheOperand)
+{
+	uint32_t next = 0x1002;
+	ea_test_reset(M68_MODEL_68000);
+	CPU68.D[0].value = 0x11223344;
+	CPU68.D[1].value = 0x11223344;
+
+	m68_ea_write(M68_EA_DN, 0, M68_EA_BYTE, &next, 0xAABBCCDD);
+	m68_ea_write(M68_EA_DN, 1, M68_EA_WORD, &next, 0xAABBCCDD);
+	m68_ea_write(M68_EA_AN, 2, M68_EA_WORD, &next, 0x8000);
+
+	ASSERT_EQ(CPU68.D[0].value, 0x112233DD);
+	ASSERT_EQ(CPU68.D[1].value, 0x1122CCDD);
+	ASSERT_EQ(CPU68.A[2].value, 0xFFFF8000);
+	ASSERT_EQ(m68_ea_read(M68_EA_DN, 1, M68_EA_BYTE, &next), 0xDD);
+	ASSERT_EQ(next, 0x1002);
+	ea_test_restore();
+}
+
+// MARK: - Accessor Table
+
+TEST_CASE(EffectiveAddress, TableMatchesInlineAccessors)
+{
+	const uint8_t sizes[3] = { M68_EA_BYTE, M68_EA_WORD, M68_EA_LONG };
+	int mismatches = 0;
+
+	for (uint8_t ea = 0; ea <= 0x3C; ++ea) {
+		for (int i = 0; i < 3; ++i) {
+			uint32_t values[2], next[2], registers[2];
+			for (int pass = 0; pass < 2; ++pass) {
+				ea_test_reset(M68_MODEL_68020);
+				m68_mmu_write_word(0x1002, 0x1010);
+				m68_mmu_write_long(0x1004, 0x00002400);
+				CPU68.D[1].value = 0x40;
+
+				next[pass] = 0x1002;
+				if (pass == 0) {
+					values[pass] = m68_ea_read(ea >> 3, ea & 7, sizes[i], &next[pass]);
+				} else {
+					values[pass] = m68_ea_table[ea].read[M68_EA_SIZE_INDEX(sizes[i])](&next[pass]);
+				}
+				registers[pass] = CPU68.A[ea & 7].value;
+			}
+			mismatches += values[0] != values[1] || next[0] != next[1] || registers[0] != registers[1];
+		}
+	}
+
+	ASSERT_EQ(mismatches, 0);
+	ASSERT_EQ(m68_ea_table[0x3D].read[0] == NULL, 1);
+	ea_test_restore();
+}
+
+#endif
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+
+#if defined(UNIT_TEST)
+
+TEST_CASE(Exception, AddressErrorBuildsGroupZeroFrameOn68000)
+{
+	m68_mmu_initialise();
+
+	// Configure the vector table and a faulting instruction.
+	m68_mmu_write_long(M68_VECTOR_ADDRESS_ERROR * 4, 0x00002000);
+	m68_mmu_write_word(0x1000, 0xC109);
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2700;
+	CPU68.A[7].value = 0x8000;
+
+	m68_mmu_read_word(0x3001);
+	ASSERT_EQ(m68_exception_process_fault(), 1);
+
+	ASSERT_EQ(CPU68.PC.value, 0x2000);
+	ASSERT_EQ(CPU68.A[7].value, 0x8000 - 14);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 14) & 0x10, 0x10);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 12), 0x3001);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 8), 0xC109);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 6), 0x2700);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 4), 0x1000);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+}
+
+TEST_CASE(Exception, BusErrorBuildsAccessErrorFrameOn68040)
+{
+	m68_mmu_initialise();
+
+	m68_mmu_write_long(M68_VECTOR_BUS_ERROR * 4, 0x00002000);
+	m68_mmu_set_memory_limit(0x100000);
+	m68_set_model(M68_MODEL_68040);
+	CPU68.VBR.value = 0;
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2700;
+	CPU68.A[7].value = 0x8000;
+
+	m68_mmu_read_long(0x200000);
+	ASSERT_EQ(m68_exception_process_fault(), 1);
+
+	ASSERT_EQ(CPU68.PC.value, 0x2000);
+	ASSERT_EQ(CPU68.A[7].value, 0x8000 - 60);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 60), 0x2700);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 58), 0x1000);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 54), 0x7000 | (M68_VECTOR_BUS_ERROR * 4));
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 48), 0x0105);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 40), 0x200000);
+
+	m68_mmu_set_memory_limit(0);
+	m68_set_model(M68_MODEL_68000);
+}
+
+TEST_CASE(Exception, AddressErrorBuildsFormatTwoFrameOn68040)
+{
+	m68_mmu_initialise();
+
+	m68_mmu_write_long(M68_VECTOR_ADDRESS_ERROR * 4, 0x00002000);
+	m68_set_model(M68_MODEL_68040);
+	CPU68.VBR.value = 0;
+	CPU68.PC.value = 0x1001;
+	CPU68.CCR.value = 0x2700;
+	CPU68.A[7].value = 0x8000;
+
+	m68_exception_address_error(0x1001, 0, 1);
+	ASSERT_EQ(m68_exception_process_fault(), 1);
+
+	ASSERT_EQ(CPU68.PC.value, 0x2000);
+	ASSERT_EQ(CPU68.A[7].value, 0x8000 - 12);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 10), 0x1001);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 6), 0x2000 | (M68_VECTOR_ADDRESS_ERROR * 4));
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 4), 0x1001);
+
+	m68_set_model(M68_MODEL_68000);
+}
+
+TEST_CASE(Exception, NoFaultPending)
+{
+	CPU68.fault.vector = 0;
+	ASSERT_EQ(m68_exception_process_fault(), 0);
+}
+
+TEST_CASE(Exception, UserModeExceptionSwitchesToSupervisorStack)
+{
+	m68_mmu_initialise();
+
+	m68_mmu_write_long(M68_VECTOR_TRAP_0 * 4, 0x00004000);
+	m68_set_model(M68_MODEL_68020);
+	CPU68.CCR.value = 0x0000;
+	CPU68.A[7].value = 0x6000;
+	CPU68.SSP.value = 0x8000;
+
+	m68_exception_process(M68_VECTOR_TRAP_0, 0x1002);
+
+	ASSERT_EQ(CPU68.PC.value, 0x4000);
+	ASSERT_EQ(CPU68.USP.value, 0x6000);
+	ASSERT_EQ(CPU68.A[7].value, 0x8000 - 8);
+	ASSERT_EQ(CPU68.CCR.bitmask.mask.S, 1);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 8), 0x0000);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 6), 0x1002);
+	ASSERT_EQ(m68_mmu_read_word(0x8000 - 2), M68_VECTOR_TRAP_0 * 4);
+
+	m68_set_model(M68_MODEL_68000);
+}
+
+#endif
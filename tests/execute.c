@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/idle.h"
+
+#if defined(UNIT_TEST)
+
+/* Stand-ins for instructions that are not implemented yet. */
+static void execute_test_bra_self(void)
+{
+}
+
+static void execute_test_bra_back(void)
+{
+	CPU68.PC.value -= 2;
+}
+
+static void execute_test_addq(void)
+{
+	CPU68.D[0].value += 1;
+	CPU68.PC.value += 2;
+}
+
+static void execute_test_move(void)
+{
+	m68_mmu_write_word(CPU68.A[0].value, CPU68.D[0].word[0]);
+	CPU68.PC.value += 2;
+}
+
+/* A Ticks style counter, bumped every 1000 cycles. */
+static void execute_test_tick(struct m68_event *event)
+{
+	m68_mmu_write_long(0x16A, m68_mmu_read_long(0x16A) + 1);
+	m68_event_schedule_at(event, event->when + 1000);
+}
+
+static void execute_test_configure(void)
+{
+	struct m68_idle_config config = { 1, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+
+	m68_mmu_initialise();
+	m68_idle_configure(&config);
+
+	m68_instruction_table[0x60FE] = (struct m68_instruction){ "BRA.S *", execute_test_bra_self, 10 };
+	m68_instruction_table[0x60FC] = (struct m68_instruction){ "BRA.S *-2", execute_test_bra_back, 10 };
+	m68_instruction_table[0x5240] = (struct m68_instruction){ "ADDQ.W #1,D0", execute_test_addq, 4 };
+	m68_instruction_table[0x3080] = (struct m68_instruction){ "MOVE.W D0,(A0)", execute_test_move, 8 };
+
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2000;
+	CPU68.A[7].value = 0x8000;
+	CPU68.D[0].value = 0;
+	CPU68.A[0].value = 0x4000;
+	CPU68.cycles = 0;
+}
+
+static void execute_test_restore(void)
+{
+	struct m68_idle_config config = { 1, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+	m68_idle_configure(&config);
+
+	m68_instruction_table[0x60FE] = (struct m68_instruction){ 0 };
+	m68_instruction_table[0x60FC] = (struct m68_instruction){ 0 };
+	m68_instruction_table[0x5240] = (struct m68_instruction){ 0 };
+	m68_instruction_table[0x3080] = (struct m68_instruction){ 0 };
+}
+
+// MARK: - Stepping
+
+TEST_CASE(Execute, StepAdvancesPCAndCycles)
+{
+	execute_test_configure();
+	m68_mmu_write_word(0x1000, 0xC300);
+	CPU68.D[0].byte[0] = 0x12;
+	CPU68.D[1].byte[0] = 0x34;
+
+	m68_step();
+
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+	ASSERT_EQ(CPU68.cycles, 6);
+	ASSERT_EQ(CPU68.D[0].byte[0], 0x46);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, UnknownOpcodeTakesIllegalInstruction)
+{
+	execute_test_configure();
+	m68_mmu_write_long(M68_VECTOR_ILLEGAL_INSTRUCTION * 4, 0x00002000);
+	m68_mmu_write_word(0x1000, 0x4AFC);
+
+	m68_step();
+
+	ASSERT_EQ(CPU68.PC.value, 0x2000);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 4), 0x1000);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, OddPCTakesAddressError)
+{
+	execute_test_configure();
+	m68_mmu_write_long(M68_VECTOR_ADDRESS_ERROR * 4, 0x00002000);
+	CPU68.PC.value = 0x1001;
+
+	m68_step();
+
+	ASSERT_EQ(CPU68.PC.value, 0x2000);
+	ASSERT_EQ(m68_mmu_read_long(0x8000 - 12), 0x1001);
+	execute_test_restore();
+}
+
+// MARK: - Run Loop
+
+TEST_CASE(Execute, RunStopsAtDeadline)
+{
+	execute_test_configure();
+	for (uint32_t address = 0x1000; address < 0x1100; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+
+	ASSERT_EQ(m68_run(61), 66);
+	ASSERT_EQ(CPU68.PC.value, 0x1000 + 11 * 2);
+	execute_test_restore();
+}
+
+// MARK: - Idle Loops
+
+TEST_CASE(Execute, BranchToSelfIsSkipped)
+{
+	execute_test_configure();
+	m68_mmu_write_word(0x1000, 0x60FE);
+
+	ASSERT_EQ(m68_run(100000), 100000);
+	ASSERT_NEQ(m68_idle_skipped_cycles(), 0);
+	ASSERT_EQ(CPU68.PC.value, 0x1000);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, LoopChangingRegistersIsNotSkipped)
+{
+	execute_test_configure();
+	m68_mmu_write_word(0x1000, 0x5240);
+	m68_mmu_write_word(0x1002, 0x60FC);
+
+	ASSERT_EQ(m68_run(1400), 1400);
+	ASSERT_EQ(m68_idle_skipped_cycles(), 0);
+	ASSERT_EQ(CPU68.D[0].value, 100);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, LoopWritingMemoryIsNotSkipped)
+{
+	execute_test_configure();
+	m68_mmu_write_word(0x1000, 0x3080);
+	m68_mmu_write_word(0x1002, 0x60FC);
+
+	ASSERT_EQ(m68_run(1800), 1800);
+	ASSERT_EQ(m68_idle_skipped_cycles(), 0);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, LoopIsStillSkippedAfterEventsWriteMemory)
+{
+	struct m68_event tick;
+	uint64_t skipped = 0;
+
+	execute_test_configure();
+	m68_scheduler_reset();
+	m68_mmu_write_word(0x1000, 0x60FE);
+	m68_event_initialise(&tick, execute_test_tick, NULL);
+	m68_event_schedule(&tick, 1000);
+
+	// Each tick costs the loop a miss, but the iterations between ticks
+	// are unchanged, so it is never given up on.
+	for (int frame = 0; frame < 20; ++frame) {
+		skipped = m68_idle_skipped_cycles();
+		m68_run(1000);
+	}
+	skipped = m68_idle_skipped_cycles() - skipped;
+	m68_scheduler_reset();
+
+	ASSERT_EQ(m68_mmu_read_long(0x16A), 20);
+	ASSERT_NEQ(skipped, 0);
+	execute_test_restore();
+}
+
+TEST_CASE(Execute, IdleDetectionCanBeDisabled)
+{
+	struct m68_idle_config config = { 0, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+
+	execute_test_configure();
+	m68_idle_configure(&config);
+	m68_mmu_write_word(0x1000, 0x60FE);
+
+	ASSERT_EQ(m68_run(1000), 1000);
+	ASSERT_EQ(m68_idle_skipped_cycles(), 0);
+	execute_test_restore();
+}
+
+#endif
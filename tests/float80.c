@@ -0,0 +1,171 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/float80.h"
+
+#if defined(UNIT_TEST)
+
+static m68_float80_t float80_test_value(double d)
+{
+	uint64_t bits;
+	memcpy(&bits, &d, sizeof(bits));
+	return m68_float80_from_double(bits);
+}
+
+static double float80_test_double(m68_float80_t x)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	uint64_t bits = m68_float80_to_double(x, &env);
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+// MARK: - Representation
+
+TEST_CASE(Float80, DoubleWidensExactly)
+{
+	m68_float80_t one = float80_test_value(1.0);
+	ASSERT_EQ(one.exponent, 0x3FFF);
+	ASSERT_EQ(one.mantissa, 0x8000000000000000ULL);
+
+	m68_float80_t minus_three = float80_test_value(-3.0);
+	ASSERT_EQ(minus_three.exponent, 0xC000);
+	ASSERT_EQ(minus_three.mantissa, 0xC000000000000000ULL);
+}
+
+TEST_CASE(Float80, IntegersConvertExactly)
+{
+	m68_float80_t x = m68_float80_from_int32(INT32_MIN);
+	ASSERT_EQ(x.exponent, 0xC01E);
+	ASSERT_EQ(x.mantissa, 0x8000000000000000ULL);
+
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	ASSERT_EQ(m68_float80_to_int32(x, &env), INT32_MIN);
+	ASSERT_EQ(env.exceptions, 0);
+}
+
+// MARK: - Arithmetic
+
+TEST_CASE(Float80, AdditionKeepsExtendedPrecision)
+{
+	/* 1 + 2^-60 is not representable as a double, but is in extended. */
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t tiny = float80_test_value(0x1p-60);
+	m68_float80_t sum = m68_float80_add(float80_test_value(1.0), tiny, &env);
+	ASSERT_EQ(sum.mantissa, 0x8000000000000008ULL);
+	ASSERT_EQ(env.exceptions, 0);
+
+	m68_float80_t difference = m68_float80_sub(sum, float80_test_value(1.0), &env);
+	ASSERT_EQ(float80_test_double(difference), 0x1p-60);
+}
+
+TEST_CASE(Float80, RoundingPrecisionIsApplied)
+{
+	/* 1/3 rounded to single precision. */
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_SINGLE, 0 };
+	m68_float80_t third = m68_float80_div(float80_test_value(1.0), float80_test_value(3.0), &env);
+	ASSERT_EQ(float80_test_double(third), (double)(1.0f / 3.0f));
+	ASSERT_NEQ(env.exceptions & M68_FLOAT80_INEX2, 0);
+}
+
+TEST_CASE(Float80, RoundingDirectionIsApplied)
+{
+	struct m68_float80_env down = { M68_ROUND_MINUS, M68_PRECISION_DOUBLE, 0 };
+	struct m68_float80_env up = { M68_ROUND_PLUS, M68_PRECISION_DOUBLE, 0 };
+	m68_float80_t a = m68_float80_div(float80_test_value(1.0), float80_test_value(3.0), &down);
+	m68_float80_t b = m68_float80_div(float80_test_value(1.0), float80_test_value(3.0), &up);
+	ASSERT_EQ(b.mantissa - a.mantissa, 1ULL << 11);
+}
+
+TEST_CASE(Float80, SquareRootIsExact)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t root = m68_float80_sqrt(float80_test_value(144.0), &env);
+	ASSERT_EQ(float80_test_double(root), 12.0);
+	ASSERT_EQ(env.exceptions, 0);
+
+	m68_float80_t two = m68_float80_sqrt(float80_test_value(2.0), &env);
+	ASSERT_EQ(two.mantissa, 0xB504F333F9DE6484ULL);
+	ASSERT_NEQ(env.exceptions & M68_FLOAT80_INEX2, 0);
+}
+
+TEST_CASE(Float80, IntRoundsHalfToEven)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	ASSERT_EQ(float80_test_double(m68_float80_int(float80_test_value(2.5), &env)), 2.0);
+	ASSERT_EQ(float80_test_double(m68_float80_int(float80_test_value(3.5), &env)), 4.0);
+	ASSERT_EQ(float80_test_double(m68_float80_int(float80_test_value(-0.25), &env)), 0.0);
+
+	env.rounding = M68_ROUND_ZERO;
+	ASSERT_EQ(float80_test_double(m68_float80_int(float80_test_value(-7.75), &env)), -7.0);
+}
+
+// MARK: - Exceptional Values
+
+TEST_CASE(Float80, DivideByZeroGivesInfinity)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t x = m68_float80_div(float80_test_value(-1.0), float80_test_value(0.0), &env);
+	ASSERT_EQ(m68_float80_is_inf(x), 1);
+	ASSERT_EQ(m68_float80_sign(x), 1);
+	ASSERT_EQ(env.exceptions, M68_FLOAT80_DZ);
+}
+
+TEST_CASE(Float80, InvalidOperationGivesNaN)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t inf = m68_float80_div(float80_test_value(1.0), float80_test_value(0.0), &env);
+	env.exceptions = 0;
+
+	m68_float80_t x = m68_float80_sub(inf, inf, &env);
+	ASSERT_EQ(m68_float80_is_nan(x), 1);
+	ASSERT_EQ(env.exceptions, M68_FLOAT80_OPERR);
+	ASSERT_EQ(m68_float80_compare(x, x), M68_FLOAT80_UNORDERED);
+}
+
+TEST_CASE(Float80, OverflowDependsOnRounding)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	m68_float80_t big = { 0xFFFFFFFFFFFFFFFFULL, 0x7FFE };
+	ASSERT_EQ(m68_float80_is_inf(m68_float80_add(big, big, &env)), 1);
+	ASSERT_EQ(env.exceptions, M68_FLOAT80_OVFL | M68_FLOAT80_INEX2);
+
+	env.rounding = M68_ROUND_ZERO;
+	m68_float80_t x = m68_float80_add(big, big, &env);
+	ASSERT_EQ(x.exponent, 0x7FFE);
+	ASSERT_EQ(x.mantissa, 0xFFFFFFFFFFFFFFFFULL);
+}
+
+TEST_CASE(Float80, NarrowingToSingleRounds)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	ASSERT_EQ(m68_float80_to_single(float80_test_value(1.0), &env), 0x3F800000);
+	ASSERT_EQ(env.exceptions, 0);
+	ASSERT_EQ(m68_float80_to_single(float80_test_value(0.1), &env), 0x3DCCCCCD);
+	ASSERT_EQ(env.exceptions, M68_FLOAT80_INEX2);
+}
+
+#endif
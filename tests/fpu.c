@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/fpu.h"
+
+#if defined(UNIT_TEST)
+
+static void fpu_test_configure(enum m68_fpu_mode mode, const uint16_t *code, int count)
+{
+	m68_mmu_initialise();
+	m68_mmu_write_long(M68_VECTOR_LINE_1111 * 4, 0x00003000);
+	for (int i = 0; i < count; ++i) {
+		m68_mmu_write_word(0x1000 + 2 * i, code[i]);
+	}
+
+	m68_fpu_set_mode(mode);
+	m68_fpu_reset();
+	m68_set_model(M68_MODEL_68020);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = 0x2000;
+	CPU68.A[7].value = 0x8000;
+}
+
+static double fpu_test_register(int n)
+{
+	struct m68_float80_env env = { M68_ROUND_NEAREST, M68_PRECISION_EXTENDED, 0 };
+	uint64_t bits = m68_float80_to_double(m68_fpu_get(n), &env);
+	double d;
+	memcpy(&d, &bits, sizeof(d));
+	return d;
+}
+
+static void fpu_test_restore(void)
+{
+	m68_fpu_set_mode(M68_FPU_EXACT);
+	m68_fpu_reset();
+}
+
+// MARK: - Decoding
+
+TEST_CASE(FPU, GeneralOpcodesAreInTheTable)
+{
+	m68_set_model(M68_MODEL_68020);
+	struct m68_instruction *ins = m68_fetch_instruction_for_opcode(0xF23C);
+	ASSERT_NEQ(ins, NULL);
+	ASSERT_EQ(ins->imp, m68_fpu_general);
+	ASSERT_EQ(m68_fetch_instruction_for_opcode(0xF230), NULL);
+	m68_set_model(M68_MODEL_68000);
+}
+
+// MARK: - Arithmetic
+
+static const uint16_t fpu_test_add_program[] = {
+	0xF23C, 0x5400, 0x3FF8, 0x0000, 0x0000, 0x0000,	/* FMOVE.D #1.5,FP0 */
+	0xF23C, 0x5480, 0x4004, 0x0000, 0x0000, 0x0000,	/* FMOVE.D #2.5,FP1 */
+	0xF200, 0x0422,					/* FADD.X FP1,FP0 */
+	0xF200, 0x6000,					/* FMOVE.L FP0,D0 */
+};
+
+static void fpu_test_run(enum m68_fpu_mode mode, const uint16_t *code, int count, int steps)
+{
+	fpu_test_configure(mode, code, count);
+	for (int i = 0; i < steps; ++i) {
+		m68_step();
+	}
+}
+
+TEST_CASE(FPU, ExactAddition)
+{
+	fpu_test_run(M68_FPU_EXACT, fpu_test_add_program, sizeof(fpu_test_add_program) / 2, 4);
+	ASSERT_EQ(CPU68.PC.value, 0x1000 + sizeof(fpu_test_add_program));
+	ASSERT_EQ(fpu_test_register(0), 4.0);
+	ASSERT_EQ(CPU68.D[0].value, 4);
+	ASSERT_EQ(CPU68.FPIAR.value, 0x101C);
+	fpu_test_restore();
+}
+
+TEST_CASE(FPU, FastAddition)
+{
+	fpu_test_run(M68_FPU_FAST, fpu_test_add_program, sizeof(fpu_test_add_program) / 2, 4);
+	ASSERT_EQ(CPU68.PC.value, 0x1000 + sizeof(fpu_test_add_program));
+	ASSERT_EQ(fpu_test_register(0), 4.0);
+	ASSERT_EQ(CPU68.D[0].value, 4);
+	fpu_test_restore();
+}
+
+static const uint16_t fpu_test_divide_program[] = {
+	0xF200, 0x4000,					/* FMOVE.L D0,FP0 */
+	0xF201, 0x4420,					/* FDIV.S D1,FP0 */
+	0xF202, 0xA800,					/* FMOVE.L FPSR,D2 */
+};
+
+static void fpu_test_divide_by_zero(enum m68_fpu_mode mode)
+{
+	CPU68.D[0].value = (uint32_t)-5;
+	CPU68.D[1].value = 0;
+	fpu_test_run(mode, fpu_test_divide_program, sizeof(fpu_test_divide_program) / 2, 3);
+}
+
+TEST_CASE(FPU, ExactDivideByZero)
+{
+	fpu_test_divide_by_zero(M68_FPU_EXACT);
+	ASSERT_EQ(CPU68.D[2].value & (M68_FPSR_N | M68_FPSR_Z | M68_FPSR_I | M68_FPSR_NAN), M68_FPSR_N | M68_FPSR_I);
+	ASSERT_EQ(CPU68.D[2].value & (M68_FLOAT80_DZ | M68_FPSR_DZ), M68_FLOAT80_DZ | M68_FPSR_DZ);
+	ASSERT_EQ(fpu_test_register(0), -1.0 / 0.0);
+	fpu_test_restore();
+}
+
+TEST_CASE(FPU, FastDivideByZero)
+{
+	fpu_test_divide_by_zero(M68_FPU_FAST);
+	ASSERT_EQ(CPU68.D[2].value & (M68_FPSR_N | M68_FPSR_Z | M68_FPSR_I | M68_FPSR_NAN), M68_FPSR_N | M68_FPSR_I);
+	ASSERT_EQ(fpu_test_register(0), -1.0 / 0.0);
+	fpu_test_restore();
+}
+
+// MARK: - Control Registers
+
+static const uint16_t fpu_test_rounding_program[] = {
+	0xF201, 0x9000,					/* FMOVE.L D1,FPCR */
+	0xF200, 0x4000,					/* FMOVE.L D0,FP0 */
+	0xF23C, 0x4420, 0x4040, 0x0000,			/* FDIV.S #3.0,FP0 */
+	0xF200, 0x0001,					/* FINT.X FP0 */
+	0xF203, 0x6000,					/* FMOVE.L FP0,D3 */
+};
+
+static void fpu_test_rounding(enum m68_fpu_mode mode)
+{
+	CPU68.D[0].value = 7;
+	CPU68.D[1].value = M68_ROUND_PLUS << 4;
+	fpu_test_run(mode, fpu_test_rounding_program, sizeof(fpu_test_rounding_program) / 2, 5);
+}
+
+TEST_CASE(FPU, ExactRoundingModeIsHonoured)
+{
+	fpu_test_rounding(M68_FPU_EXACT);
+	ASSERT_EQ(CPU68.FPCR.value, M68_ROUND_PLUS << 4);
+	ASSERT_EQ(CPU68.D[3].value, 3);
+	fpu_test_restore();
+}
+
+TEST_CASE(FPU, FastRoundingModeIsHonoured)
+{
+	fpu_test_rounding(M68_FPU_FAST);
+	ASSERT_EQ(CPU68.FPCR.value, M68_ROUND_PLUS << 4);
+	ASSERT_EQ(CPU68.D[3].value, 3);
+	fpu_test_restore();
+}
+
+static const uint16_t fpu_test_directed_program[] = {
+	0xF201, 0x9000,					/* FMOVE.L D1,FPCR */
+	0xF200, 0x4000,					/* FMOVE.L D0,FP0 */
+	0xF23C, 0x4420, 0x4040, 0x0000,			/* FDIV.S #3.0,FP0 */
+	0xF200, 0x4022,					/* FADD.L D0,FP0 */
+};
+
+/* Divide -1 by 3 and add -1, both inexact, rounding to double precision in
+ * the specified direction. Returns the quotient and the sum. */
+static void fpu_test_directed(enum m68_fpu_mode mode, enum m68_float80_rounding rounding, double *results)
+{
+	CPU68.D[0].value = (uint32_t)-1;
+	CPU68.D[1].value = (M68_PRECISION_DOUBLE << 6) | (rounding << 4);
+	fpu_test_run(mode, fpu_test_directed_program, sizeof(fpu_test_directed_program) / 2, 3);
+	results[0] = fpu_test_register(0);
+	m68_step();
+	results[1] = fpu_test_register(0);
+}
+
+TEST_CASE(FPU, FastDirectedRoundingMatchesExact)
+{
+	double exact[2], zero[2], minus[2];
+
+	fpu_test_directed(M68_FPU_EXACT, M68_ROUND_ZERO, exact);
+	fpu_test_directed(M68_FPU_FAST, M68_ROUND_ZERO, zero);
+	ASSERT_EQ(zero[0], exact[0]);
+	ASSERT_EQ(zero[1], exact[1]);
+
+	fpu_test_directed(M68_FPU_EXACT, M68_ROUND_MINUS, exact);
+	fpu_test_directed(M68_FPU_FAST, M68_ROUND_MINUS, minus);
+	ASSERT_EQ(minus[0], exact[0]);
+	ASSERT_EQ(minus[1], exact[1]);
+
+	ASSERT_EQ(minus[0] < zero[0], 1);
+	ASSERT_EQ(minus[1] < zero[1], 1);
+	fpu_test_restore();
+}
+
+TEST_CASE(FPU, ModeSwitchKeepsRegisterValues)
+{
+	fpu_test_configure(M68_FPU_EXACT, fpu_test_add_program, 0);
+	m68_fpu_set(3, m68_float80_from_int32(-12345));
+	m68_fpu_set_mode(M68_FPU_FAST);
+	ASSERT_EQ(CPU68.FP[3].d, -12345.0);
+	m68_fpu_set_mode(M68_FPU_EXACT);
+	ASSERT_EQ(fpu_test_register(3), -12345.0);
+	fpu_test_restore();
+}
+
+TEST_CASE(FPU, UnsupportedOperationRaisesLine1111)
+{
+	static const uint16_t program[] = { 0xF200, 0x000E };	/* FSIN.X FP0 */
+	fpu_test_configure(M68_FPU_EXACT, program, 2);
+	m68_step();
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	fpu_test_restore();
+}
+
+#endif
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/idle.h"
+#include "cpu/cache.h"
+#include "cpu/fusion.h"
+
+#if defined(UNIT_TEST)
+
+#define FUSION_TEST_ABCD_A1_A0	0xC109	/* ABCD -(A1),-(A0) */
+#define FUSION_TEST_ABCD_A3_A2	0xC50B	/* ABCD -(A3),-(A2) */
+#define FUSION_TEST_ABCD_D2_D0	0xC500	/* ABCD D2,D0 */
+#define FUSION_TEST_ABCD_D3_D1	0xC701	/* ABCD D3,D1 */
+#define FUSION_TEST_ILLEGAL	0x4AFC
+
+struct fusion_test_result {
+	uint32_t destination;
+	uint16_t ccr;
+	uint32_t a0, a1, pc;
+	uint64_t cycles;
+	uint64_t fired;
+};
+
+static void fusion_test_configure(int enabled)
+{
+	struct m68_idle_config idle = { 0, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+
+	m68_mmu_initialise();
+	m68_scheduler_reset();
+	m68_idle_configure(&idle);
+	m68_mmu_write_long(M68_VECTOR_BUS_ERROR * 4, 0x00003000);
+	m68_mmu_write_long(M68_VECTOR_ILLEGAL_INSTRUCTION * 4, 0x00003000);
+	for (uint32_t pc = 0x1000; pc < 0x1008; pc += 2) {
+		m68_mmu_write_word(pc, FUSION_TEST_ABCD_A1_A0);
+	}
+
+	m68_set_model(M68_MODEL_68030);
+	m68_cache_set_mode(M68_CACHE_TRUST);
+	m68_cache_set_cacr(M68_CACR_EI);
+	m68_fusion_set_enabled(enabled);
+	CPU68.VBR.value = 0;
+}
+
+/* Add two four digit BCD numbers with the program at 0x1000, starting from
+ * the specified condition codes. */
+static void fusion_test_reset(uint16_t ccr)
+{
+	m68_mmu_write_long(0x2000, 0x12345678);
+	m68_mmu_write_long(0x2100, 0x87654329);
+	CPU68.PC.value = 0x1000;
+	CPU68.CCR.value = ccr;
+	CPU68.A[0].value = 0x2104;
+	CPU68.A[1].value = 0x2004;
+	CPU68.A[7].value = 0x8000;
+	CPU68.cycles = 0;
+	m68_fusion_reset();
+}
+
+/* Run the program twice, so that the second run is from the decode cache. */
+static struct fusion_test_result fusion_test_run(int enabled, uint16_t ccr)
+{
+	fusion_test_configure(enabled);
+	fusion_test_reset(ccr);
+	m68_run(72);
+	fusion_test_reset(ccr);
+	m68_run(72);
+
+	uint32_t count = 0;
+	return (struct fusion_test_result){
+		m68_mmu_read_long(0x2000), CPU68.CCR.value, CPU68.A[0].value,
+		CPU68.A[1].value, CPU68.PC.value, CPU68.cycles, m68_fusions(&count)[0].fired
+	};
+}
+
+/* Add two two digit BCD numbers held a byte to a register, twice. */
+static struct fusion_test_result fusion_test_run_registers(int enabled, uint16_t ccr)
+{
+	fusion_test_configure(enabled);
+	m68_mmu_write_word(0x1000, FUSION_TEST_ABCD_D2_D0);
+	m68_mmu_write_word(0x1002, FUSION_TEST_ABCD_D3_D1);
+	m68_cache_flush();
+	for (int run = 0; run < 2; ++run) {
+		fusion_test_reset(ccr);
+		CPU68.D[0].value = 0x99;
+		CPU68.D[1].value = 0x45;
+		CPU68.D[2].value = 0x01;
+		CPU68.D[3].value = 0x54;
+		m68_run(12);
+	}
+
+	uint32_t count = 0;
+	return (struct fusion_test_result){
+		(CPU68.D[1].value << 8) | CPU68.D[0].value, CPU68.CCR.value, CPU68.A[0].value,
+		CPU68.A[1].value, CPU68.PC.value, CPU68.cycles, m68_fusions(&count)[1].fired
+	};
+}
+
+static void fusion_test_restore(void)
+{
+	struct m68_idle_config idle = { 1, M68_IDLE_DEFAULT_MAX_LOOP_SIZE };
+	m68_idle_configure(&idle);
+	m68_fusion_set_enabled(1);
+	m68_fusion_reset();
+	m68_cache_set_mode(M68_CACHE_STRICT);
+	m68_mmu_set_memory_limit(0);
+	m68_set_model(M68_MODEL_68000);
+}
+
+// MARK: - Fused Execution
+
+TEST_CASE(Fusion, FusedPairsMatchSeparateInstructions)
+{
+	for (uint16_t ccr = 0x2000; ccr <= 0x2014; ccr += 0x14) {
+		struct fusion_test_result separate = fusion_test_run(0, ccr);
+		struct fusion_test_result fused = fusion_test_run(1, ccr);
+
+		ASSERT_EQ(separate.fired, 0);
+		ASSERT_EQ(fused.fired, 2);
+		ASSERT_EQ(fused.destination, separate.destination);
+		ASSERT_EQ(fused.ccr, separate.ccr);
+		ASSERT_EQ(fused.a0, separate.a0);
+		ASSERT_EQ(fused.a1, separate.a1);
+		ASSERT_EQ(fused.pc, 0x1008);
+		ASSERT_EQ(fused.cycles, separate.cycles);
+	}
+	fusion_test_restore();
+}
+
+TEST_CASE(Fusion, FusedRegisterPairsMatchSeparateInstructions)
+{
+	for (uint16_t ccr = 0x2000; ccr <= 0x2014; ccr += 0x14) {
+		struct fusion_test_result separate = fusion_test_run_registers(0, ccr);
+		struct fusion_test_result fused = fusion_test_run_registers(1, ccr);
+
+		ASSERT_EQ(separate.fired, 0);
+		ASSERT_EQ(fused.fired, 1);
+		ASSERT_EQ(fused.destination, (ccr & 0x10) ? 0x0001 : 0x0000);
+		ASSERT_EQ(fused.destination, separate.destination);
+		ASSERT_EQ(fused.ccr, separate.ccr);
+		ASSERT_EQ(fused.pc, 0x1004);
+		ASSERT_EQ(fused.cycles, separate.cycles);
+	}
+	fusion_test_restore();
+}
+
+TEST_CASE(Fusion, StepExecutesASingleInstruction)
+{
+	fusion_test_run(1, 0x2000);
+	fusion_test_reset(0x2000);
+	m68_step();
+
+	uint32_t count = 0;
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+	ASSERT_EQ(m68_fusions(&count)[0].fired, 0);
+	fusion_test_restore();
+}
+
+TEST_CASE(Fusion, FlushingTheSecondInstructionBreaksThePair)
+{
+	fusion_test_run(1, 0x2000);
+	m68_mmu_write_word(0x1002, FUSION_TEST_ILLEGAL);
+	m68_cache_flush_range(0x1002, 2);
+	fusion_test_reset(0x2000);
+	m68_run(1);
+
+	uint32_t count = 0;
+	ASSERT_EQ(CPU68.PC.value, 0x1002);
+	ASSERT_EQ(m68_fusions(&count)[0].fired, 0);
+	fusion_test_restore();
+}
+
+TEST_CASE(Fusion, FaultInTheSecondInstructionIsTakenOnIt)
+{
+	fusion_test_configure(1);
+	m68_mmu_set_memory_limit(0x100000);
+	m68_mmu_write_word(0x1002, FUSION_TEST_ABCD_A3_A2);
+	fusion_test_reset(0x2000);
+	m68_step();
+
+	fusion_test_reset(0x2000);
+	CPU68.A[2].value = 0x200001;
+	CPU68.A[3].value = 0x2008;
+	m68_run(1);
+
+	uint32_t count = 0;
+	ASSERT_EQ(m68_fusions(&count)[0].fired, 1);
+	ASSERT_EQ(m68_mmu_read_long(0x2000), 0x12345607);
+	ASSERT_EQ(CPU68.PC.value, 0x3000);
+	ASSERT_EQ(m68_mmu_read_long(CPU68.A[7].value + 2), 0x1002);
+	fusion_test_restore();
+}
+
+// MARK: - Reports
+
+TEST_CASE(Fusion, ReportListsFiredFusions)
+{
+	char buffer[256] = { 0 };
+	fusion_test_run(1, 0x2000);
+
+	FILE *out = fmemopen(buffer, sizeof(buffer) - 1, "w");
+	m68_fusion_write_report(out);
+	fclose(out);
+
+	ASSERT_EQ_STR(buffer, "2 fusions, enabled\n"
+		"           2  ABCD -(Ay),-(Ax); ABCD -(Ay),-(Ax)\n"
+		"           0  ABCD Dy,Dx; ABCD Dy,Dx\n");
+	fusion_test_restore();
+}
+
+#endif
@@ -24,6 +24,7 @@
 #include "cpu/cpu.h"
 #include "cpu/mmu.h"
 #include "cpu/instruction.h"
+#include "cpu/instruction_forms.h"
 
 #if defined(UNIT_TEST)
 
@@ -32,8 +33,8 @@ TEST_CASE(InstructionLookup, FetchCorrectOpcodeFromMemory)
 	m68_mmu_initialise();
 
 	uint8_t *page = m68_mmu_page_alloc(0x0000);
-	page[10] = 0xCB;
-	page[11] = 0x05;
+	page[M68_MMU_BYTE_OFFSET(10)] = 0xCB;
+	page[M68_MMU_BYTE_OFFSET(11)] = 0x05;
 
 	CPU68.PC.value = 0x000A;
 
@@ -57,4 +58,69 @@ TEST_CASE(InstructionLookup, ValidABCD)
 	ASSERT_EQ_STR(abcd->mnemonic, "ABCD D5,D5");
 }
 
+// MARK: - Instruction Forms
+
+TEST_CASE(InstructionLookup, OpcodeFormMatchesSpecification)
+{
+	ASSERT_EQ(m68_instruction_form_index[0xCB05], M68_FORM_ABCD_DN_DN);
+	ASSERT_EQ(m68_instruction_form_index[0xCB0D], M68_FORM_ABCD_M8_M8);
+	ASSERT_EQ(m68_instruction_form_index[0xFFFF], M68_FORM_NONE);
+	ASSERT_EQ_STR(m68_instruction_forms[M68_FORM_ABCD_M8_M8].name, "abcd_m8_m8");
+}
+
+TEST_CASE(InstructionLookup, EveryTableEntryBelongsToItsForm)
+{
+	static const enum m68_model models[] = {
+		M68_MODEL_68000, M68_MODEL_68010, M68_MODEL_68020, M68_MODEL_68030, M68_MODEL_68040
+	};
+
+	int mismatches = 0;
+	for (int m = 0; m < 5; ++m) {
+		struct m68_instruction *table = m68_instruction_table_for_model(models[m]);
+		for (uint32_t opcode = 0; opcode < M68_MAX_AVAILABLE_INSTRUCTIONS; ++opcode) {
+			uint16_t form = m68_instruction_form_index[opcode];
+			const struct m68_instruction_form *info = &m68_instruction_forms[form];
+			int available = form && info->model <= models[m] && models[m] <= info->last;
+			mismatches += available != (table[opcode].imp != NULL);
+			mismatches += form && (opcode & info->mask) != info->match;
+		}
+	}
+	ASSERT_EQ(mismatches, 0);
+}
+
+// MARK: - Models
+
+TEST_CASE(InstructionLookup, TablesOnlyHoldTheirModelsInstructions)
+{
+	ASSERT_EQ(m68_instruction_table_68000[0x4E7A].imp, NULL);	/* MOVEC */
+	ASSERT_NEQ(m68_instruction_table_68010[0x4E7A].imp, NULL);
+	ASSERT_EQ(m68_instruction_table_68020[0xF010].imp, NULL);	/* PMOVE */
+	ASSERT_NEQ(m68_instruction_table_68030[0xF010].imp, NULL);
+	ASSERT_EQ(m68_instruction_table_68040[0xF010].imp, NULL);
+	ASSERT_EQ(m68_instruction_table_68030[0xF4F8].imp, NULL);	/* CPUSHA */
+	ASSERT_NEQ(m68_instruction_table_68040[0xF4F8].imp, NULL);
+	ASSERT_EQ(m68_instruction_table_68000[0xCB05].imp, m68_instruction_table_68040[0xCB05].imp);
+}
+
+TEST_CASE(InstructionLookup, ModelSpecialisedHandlersDiffer)
+{
+	ASSERT_NEQ(m68_instruction_table_68010[0x4E7A].imp, m68_instruction_table_68040[0x4E7A].imp);
+}
+
+TEST_CASE(InstructionLookup, SelectingAModelSwitchesTable)
+{
+	m68_set_model(M68_MODEL_68030);
+	ASSERT_EQ(CPU68.model, M68_MODEL_68030);
+	ASSERT_EQ(m68_instruction_table, m68_instruction_table_68030);
+	ASSERT_NEQ(m68_fetch_instruction_for_opcode(0xF010), NULL);
+	m68_set_model(M68_MODEL_68000);
+	ASSERT_EQ(m68_fetch_instruction_for_opcode(0xF010), NULL);
+}
+
+TEST_CASE(InstructionLookup, GeneratedOperandDecoders)
+{
+	ASSERT_EQ(M68_ABCD_DN_DN_X(0xC701), 3);
+	ASSERT_EQ(M68_ABCD_DN_DN_Y(0xC701), 1);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,104 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cpu/lz.h"
+
+#if defined(UNIT_TEST)
+
+#define LZ_TEST_SIZE	0x1000
+
+/* Code-like data: a few opcodes repeated, with a table of offsets and a run
+ * of zeroes. */
+static void lz_test_fill(uint8_t *data)
+{
+	static const uint8_t code[] = { 0x4E, 0x56, 0xFF, 0xFC, 0x20, 0x6E, 0x00, 0x08, 0x4E, 0x5E, 0x4E, 0x75 };
+	memset(data, 0, LZ_TEST_SIZE);
+	for (uint32_t i = 0; i < 0x800; ++i) {
+		data[i] = code[(i * 7) % sizeof(code)];
+	}
+	for (uint32_t i = 0x800; i < 0xA00; i += 2) {
+		data[i] = (uint8_t)(i >> 3);
+		data[i + 1] = (uint8_t)(i * 13);
+	}
+}
+
+TEST_CASE(LZ, ZeroPageCompressesToAFewBytes)
+{
+	uint8_t page[LZ_TEST_SIZE] = { 0 };
+	uint8_t compressed[64];
+	uint8_t out[LZ_TEST_SIZE];
+	memset(out, 0xFF, sizeof(out));
+
+	size_t length = m68_lz_compress(page, sizeof(page), compressed, sizeof(compressed));
+	ASSERT_NEQ(length, 0);
+	ASSERT_EQ(length < 32, 1);
+	ASSERT_EQ(m68_lz_decompress(compressed, length, out, sizeof(out)), LZ_TEST_SIZE);
+	ASSERT_EQ(memcmp(page, out, sizeof(out)), 0);
+}
+
+TEST_CASE(LZ, MixedDataRoundTrips)
+{
+	static uint8_t data[LZ_TEST_SIZE];
+	static uint8_t compressed[LZ_TEST_SIZE * 2];
+	static uint8_t out[LZ_TEST_SIZE];
+	lz_test_fill(data);
+
+	size_t length = m68_lz_compress(data, sizeof(data), compressed, sizeof(compressed));
+	ASSERT_NEQ(length, 0);
+	ASSERT_EQ(length < LZ_TEST_SIZE / 4, 1);
+	ASSERT_EQ(m68_lz_decompress(compressed, length, out, sizeof(out)), LZ_TEST_SIZE);
+	ASSERT_EQ(memcmp(data, out, sizeof(out)), 0);
+}
+
+TEST_CASE(LZ, IncompressibleDataDoesNotFit)
+{
+	static uint8_t data[LZ_TEST_SIZE];
+	static uint8_t compressed[LZ_TEST_SIZE * 2];
+	static uint8_t out[LZ_TEST_SIZE];
+	srand(68030);
+	for (uint32_t i = 0; i < sizeof(data); ++i) {
+		data[i] = (uint8_t)rand();
+	}
+
+	ASSERT_EQ(m68_lz_compress(data, sizeof(data), compressed, LZ_TEST_SIZE / 2), 0);
+
+	size_t length = m68_lz_compress(data, sizeof(data), compressed, sizeof(compressed));
+	ASSERT_NEQ(length, 0);
+	ASSERT_EQ(m68_lz_decompress(compressed, length, out, sizeof(out)), LZ_TEST_SIZE);
+	ASSERT_EQ(memcmp(data, out, sizeof(out)), 0);
+}
+
+TEST_CASE(LZ, CorruptStreamsAreRejected)
+{
+	static const uint8_t bad_offset[] = { 0x14, 0xAA, 0x08, 0x00 };
+	static const uint8_t truncated[] = { 0xF0, 0xFF };
+	uint8_t out[LZ_TEST_SIZE];
+
+	ASSERT_EQ(m68_lz_decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)), 0);
+	ASSERT_EQ(m68_lz_decompress(truncated, sizeof(truncated), out, sizeof(out)), 0);
+	ASSERT_EQ(m68_lz_decompress(bad_offset, sizeof(bad_offset), out, 0), 0);
+}
+
+#endif
@@ -20,8 +20,14 @@
  * SOFTWARE.
  */
 
+#include <stdlib.h>
+#include <string.h>
 #include <libUnit/unit.h>
+#include "cpu/cpu.h"
 #include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/page_pool.h"
 
 #if defined(UNIT_TEST)
 
@@ -52,7 +58,7 @@ TEST_CASE(MMU, WriteByteToMemory)
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
 	m68_mmu_write_byte(0x3, 0xCD);
 
-	ASSERT_EQ(*(ptr + 3), 0xCD);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(3)), 0xCD);
 }
 
 TEST_CASE(MMU, WriteWordToMemory)
@@ -62,8 +68,8 @@ TEST_CASE(MMU, WriteWordToMemory)
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
 	m68_mmu_write_word(0x0, 0xDEAD);
 
-	ASSERT_EQ(*(ptr + 0), 0xDE);
-	ASSERT_EQ(*(ptr + 1), 0xAD);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0)), 0xDE);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(1)), 0xAD);
 }
 
 TEST_CASE(MMU, WriteLongToMemory)
@@ -73,10 +79,10 @@ TEST_CASE(MMU, WriteLongToMemory)
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
 	m68_mmu_write_long(0x0, 0xDEADBEEF);
 
-	ASSERT_EQ(*(ptr + 0), 0xDE);
-	ASSERT_EQ(*(ptr + 1), 0xAD);
-	ASSERT_EQ(*(ptr + 2), 0xBE);
-	ASSERT_EQ(*(ptr + 3), 0xEF);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(0)), 0xDE);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(1)), 0xAD);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(2)), 0xBE);
+	ASSERT_EQ(*(ptr + M68_MMU_BYTE_OFFSET(3)), 0xEF);
 }
 
 TEST_CASE(MMU, ReadByteFromMemory)
@@ -84,7 +90,7 @@ TEST_CASE(MMU, ReadByteFromMemory)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xDE;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xDE;
 
 	ASSERT_EQ(m68_mmu_read_byte(0x0), 0xDE);
 }
@@ -94,8 +100,8 @@ TEST_CASE(MMU, ReadWordFromMemory)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xDE;
-	*(ptr + 1) = 0xAD;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xDE;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0xAD;
 
 	ASSERT_EQ(m68_mmu_read_word(0x0), 0xDEAD);
 }
@@ -105,12 +111,344 @@ TEST_CASE(MMU, ReadLongFromMemory)
 	m68_mmu_initialise();
 
 	uint8_t *ptr = m68_mmu_page_alloc(0x0000);
-	*(ptr + 0) = 0xDE;
-	*(ptr + 1) = 0xAD;
-	*(ptr + 2) = 0xBE;
-	*(ptr + 3) = 0xEF;
+	*(ptr + M68_MMU_BYTE_OFFSET(0)) = 0xDE;
+	*(ptr + M68_MMU_BYTE_OFFSET(1)) = 0xAD;
+	*(ptr + M68_MMU_BYTE_OFFSET(2)) = 0xBE;
+	*(ptr + M68_MMU_BYTE_OFFSET(3)) = 0xEF;
 
 	ASSERT_EQ(m68_mmu_read_long(0x0), 0xDEADBEEF);
 }
 
-#endif
\ No newline at end of file
+// MARK: - Page Boundaries & Alignment
+
+TEST_CASE(MMU, ReadLongAcrossPageBoundary)
+{
+	m68_mmu_initialise();
+
+	uint8_t *a = m68_mmu_page_alloc(0x0000);
+	uint8_t *b = m68_mmu_page_alloc(0x1000);
+	*(a + M68_MMU_BYTE_OFFSET(0xFFE)) = 0xDE;
+	*(a + M68_MMU_BYTE_OFFSET(0xFFF)) = 0xAD;
+	*(b + M68_MMU_BYTE_OFFSET(0x000)) = 0xBE;
+	*(b + M68_MMU_BYTE_OFFSET(0x001)) = 0xEF;
+
+	ASSERT_EQ(m68_mmu_read_long(0x0FFE), 0xDEADBEEF);
+}
+
+TEST_CASE(MMU, WriteLongAcrossPageBoundary)
+{
+	m68_mmu_initialise();
+
+	uint8_t *a = m68_mmu_page_alloc(0x0000);
+	uint8_t *b = m68_mmu_page_alloc(0x1000);
+	m68_mmu_write_long(0x0FFE, 0xDEADBEEF);
+
+	ASSERT_EQ(*(a + M68_MMU_BYTE_OFFSET(0xFFE)), 0xDE);
+	ASSERT_EQ(*(a + M68_MMU_BYTE_OFFSET(0xFFF)), 0xAD);
+	ASSERT_EQ(*(b + M68_MMU_BYTE_OFFSET(0x000)), 0xBE);
+	ASSERT_EQ(*(b + M68_MMU_BYTE_OFFSET(0x001)), 0xEF);
+}
+
+TEST_CASE(MMU, MisalignedWordRaisesAddressErrorOn68000)
+{
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68000);
+	CPU68.fault.vector = 0;
+
+	m68_mmu_read_word(0x0001);
+
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_ADDRESS_ERROR);
+	ASSERT_EQ(CPU68.fault.address, 0x0001);
+	CPU68.fault.vector = 0;
+}
+
+TEST_CASE(MMU, MisalignedLongIsPermittedOn68020)
+{
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68020);
+	CPU68.fault.vector = 0;
+
+	uint8_t *a = m68_mmu_page_alloc(0x0000);
+	uint8_t *b = m68_mmu_page_alloc(0x1000);
+	*(a + M68_MMU_BYTE_OFFSET(0xFFD)) = 0xDE;
+	*(a + M68_MMU_BYTE_OFFSET(0xFFE)) = 0xAD;
+	*(a + M68_MMU_BYTE_OFFSET(0xFFF)) = 0xBE;
+	*(b + M68_MMU_BYTE_OFFSET(0x000)) = 0xEF;
+
+	ASSERT_EQ(m68_mmu_read_long(0x0FFD), 0xDEADBEEF);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_set_model(M68_MODEL_68000);
+}
+
+TEST_CASE(MMU, WriteMarksPageDirty)
+{
+	m68_mmu_initialise();
+
+	m68_mmu_read_byte(0x5000);
+	union m68_mmu_page_table_entry *dir = &MMU_PAGE_DIR[0];
+	union m68_mmu_page_entry *table = (void *)((uintptr_t)dir->field.address << 2);
+	ASSERT_EQ(table[5].field.dirty, 0);
+
+	m68_mmu_write_byte(0x5000, 0xFF);
+	ASSERT_EQ(table[5].field.dirty, 1);
+}
+
+// MARK: - Block Copies
+
+TEST_CASE(MMU, WriteBlockIsReadInGuestOrder)
+{
+	static const uint8_t data[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x12 };
+
+	m68_mmu_initialise();
+	m68_mmu_write_block(0x0FFE, data, sizeof(data));
+
+	ASSERT_EQ(m68_mmu_read_long(0x0FFE), 0xDEADBEEF);
+	ASSERT_EQ(m68_mmu_read_byte(0x1002), 0x12);
+	union m68_mmu_page_entry *table = (void *)((uintptr_t)MMU_PAGE_DIR[0].field.address << 2);
+	ASSERT_EQ(table[1].field.dirty, 1);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, ReadBlockReturnsGuestOrder)
+{
+	uint8_t buffer[6] = { 0 };
+
+	m68_mmu_initialise();
+	m68_mmu_write_long(0x2FFE, 0x01234567);
+	m68_mmu_read_block(0x2FFD, buffer, sizeof(buffer));
+
+	ASSERT_EQ(buffer[0], 0x00);
+	ASSERT_EQ(buffer[1], 0x01);
+	ASSERT_EQ(buffer[2], 0x23);
+	ASSERT_EQ(buffer[3], 0x45);
+	ASSERT_EQ(buffer[4], 0x67);
+	ASSERT_EQ(buffer[5], 0x00);
+	m68_mmu_destroy();
+}
+
+// MARK: - Host Spans
+
+TEST_CASE(MMU, SpansCoverTheRangePageByPage)
+{
+	struct iovec spans[2];
+
+	m68_mmu_initialise();
+	m68_mmu_write_long(0x2FFC, 0x01234567);
+	m68_mmu_write_long(0x3000, 0x89ABCDEF);
+
+	ASSERT_EQ(m68_mmu_map_span(0x2FFC, 8, 0, spans, 1), -1);
+	ASSERT_EQ(m68_mmu_map_span(0x2FFC, 8, 0, spans, 2), 2);
+	ASSERT_EQ(spans[0].iov_len, 4);
+	ASSERT_EQ(spans[1].iov_len, 4);
+	ASSERT_EQ(((uint8_t *)spans[0].iov_base)[M68_MMU_BYTE_OFFSET(0)], 0x01);
+	ASSERT_EQ(((uint8_t *)spans[1].iov_base)[M68_MMU_BYTE_OFFSET(3)], 0xEF);
+
+	ASSERT_EQ(m68_mmu_map_span(0x00A01000, 0x10, 0, spans, 2), 1);
+	ASSERT_EQ(MMU_PAGE_DIR[2].field.present, 0);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, WritableSpansAllocateAndMarkPagesDirty)
+{
+	struct iovec spans[2];
+	uint64_t bitmap[1] = { 0 };
+
+	m68_mmu_initialise();
+	ASSERT_EQ(m68_mmu_map_span(0x10000, 0x2000, 1, spans, 2), 2);
+	memset(spans[0].iov_base, 0x5A, spans[0].iov_len);
+	memset(spans[1].iov_base, 0xA5, spans[1].iov_len);
+
+	ASSERT_EQ(m68_mmu_read_long(0x10FFE), 0x5A5AA5A5);
+	ASSERT_EQ(m68_mmu_collect_dirty(0x10000, 0x2000, bitmap), 2);
+	ASSERT_EQ(bitmap[0], 3);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, ContiguousHostPagesShareASpan)
+{
+	static uint8_t host[3 * M68_MMU_PAGE_SIZE] __attribute__((aligned(16)));
+	struct iovec span;
+
+	m68_mmu_initialise();
+	ASSERT_EQ(m68_mmu_map_host(0x40000, host, sizeof(host)), 0);
+	ASSERT_EQ(m68_mmu_map_span(0x40010, 0x2000, 1, &span, 1), 1);
+	ASSERT_EQ(span.iov_base == host + 0x10, 1);
+	ASSERT_EQ(span.iov_len, 0x2000);
+	m68_mmu_unmap_host(0x40000, sizeof(host));
+	m68_mmu_destroy();
+}
+
+// MARK: - Cold Page Compression
+
+TEST_CASE(MMU, SweepCompressesPagesNotReferencedSinceTheLastSweep)
+{
+	struct m68_mmu_compression_stats stats;
+
+	m68_mmu_initialise();
+	m68_mmu_write_long(0x3000, 0x4E714E75);
+	m68_mmu_write_long(0x5000, 0xDEADBEEF);
+
+	ASSERT_EQ(m68_mmu_sweep(), 0);
+	ASSERT_EQ(m68_mmu_read_long(0x3000), 0x4E714E75);
+	ASSERT_EQ(m68_mmu_sweep(), 2);
+
+	m68_mmu_compression_stats(&stats);
+	ASSERT_EQ(stats.resident_pages, 1);
+	ASSERT_EQ(stats.compressed_pages, 2);
+	ASSERT_EQ(stats.compressed_bytes < 64, 1);
+	ASSERT_EQ(stats.decompressions, 0);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, CompressedPagesAreDecompressedOnAccess)
+{
+	struct m68_mmu_compression_stats stats;
+
+	m68_mmu_initialise();
+	m68_mmu_write_long(0x5000, 0xDEADBEEF);
+	m68_mmu_sweep();
+	m68_mmu_sweep();
+
+	ASSERT_EQ(m68_mmu_read_long(0x5000), 0xDEADBEEF);
+	m68_mmu_write_word(0x5FFE, 0x1234);
+	ASSERT_EQ(m68_mmu_read_word(0x5FFE), 0x1234);
+
+	m68_mmu_compression_stats(&stats);
+	ASSERT_EQ(stats.compressed_pages, 1);
+	ASSERT_EQ(stats.resident_pages, 1);
+	ASSERT_EQ(stats.decompressions, 1);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, SharedAndIncompressiblePagesAreLeftAlone)
+{
+	static uint8_t rom[0x1000] = { 0x12, 0x34 };
+	struct m68_mmu_compression_stats stats;
+
+	m68_mmu_initialise();
+	m68_mmu_map_shared(0x400000, rom, sizeof(rom));
+	srand(68040);
+	for (uint32_t address = 0x6000; address < 0x7000; address += 2) {
+		m68_mmu_write_word(address, (uint16_t)rand());
+	}
+	m68_mmu_sweep();
+	m68_mmu_sweep();
+
+	m68_mmu_compression_stats(&stats);
+	ASSERT_EQ(stats.compressed_pages, 1);
+	ASSERT_EQ(stats.resident_pages, 1);
+	ASSERT_EQ(m68_mmu_read_word(0x400000), 0x1234);
+	m68_mmu_destroy();
+}
+
+// MARK: - Shared Pages
+
+TEST_CASE(MMU, IdenticalSharedPagesAreHeldOnce)
+{
+	static uint8_t rom[0x2800];
+	for (uint32_t i = 0; i < sizeof(rom); ++i) {
+		rom[i] = (uint8_t)(i * 13 + (i >> 12));
+	}
+
+	m68_mmu_initialise();
+	uint32_t pages = m68_page_pool_count();
+	ASSERT_EQ(m68_mmu_map_shared(0x400000, rom, sizeof(rom)), 0);
+	ASSERT_EQ(m68_mmu_map_shared(0x800000, rom, sizeof(rom)), 0);
+
+	ASSERT_EQ(m68_page_pool_count(), pages + 3);
+	ASSERT_EQ(m68_mmu_read_long(0x401000), m68_mmu_read_long(0x801000));
+	ASSERT_EQ(m68_mmu_read_byte(0x402010), (uint8_t)(0x2010 * 13 + 2));
+	ASSERT_EQ(m68_mmu_read_byte(0x402900), 0);
+	m68_mmu_destroy();
+	ASSERT_EQ(m68_page_pool_count(), pages);
+}
+
+TEST_CASE(MMU, WriteToSharedPageMakesPrivateCopy)
+{
+	static uint8_t rom[0x1000];
+	memset(rom, 0xA5, sizeof(rom));
+
+	m68_mmu_initialise();
+	m68_mmu_map_shared(0x400000, rom, sizeof(rom));
+	m68_mmu_map_shared(0x800000, rom, sizeof(rom));
+	ASSERT_EQ(m68_mmu_read_byte(0x400010), 0xA5);
+	uint8_t *shared = m68_mmu_tlb_entry(MMU_READ_TLB, 0x400010)->page;
+	ASSERT_EQ(m68_page_pool_references(shared), 2);
+
+	m68_mmu_write_byte(0x400010, 0x11);
+
+	ASSERT_EQ(m68_mmu_read_byte(0x400010), 0x11);
+	ASSERT_EQ(m68_mmu_read_byte(0x800010), 0xA5);
+	ASSERT_EQ(m68_page_pool_references(shared), 1);
+	ASSERT_EQ(shared[0x10], 0xA5);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, ShareRangeMergesIdenticalPages)
+{
+	m68_mmu_initialise();
+	uint32_t pages = m68_page_pool_count();
+	for (uint32_t address = 0x10000; address < 0x14000; address += 4) {
+		m68_mmu_write_long(address, address & 0xFFF);
+	}
+
+	ASSERT_EQ(m68_mmu_share_range(0x10000, 0x4000), 0);
+	ASSERT_EQ(m68_page_pool_count(), pages + 1);
+	ASSERT_EQ(m68_mmu_read_long(0x12FFC), 0xFFC);
+	ASSERT_EQ(m68_page_pool_references(m68_mmu_tlb_entry(MMU_READ_TLB, 0x12FFC)->page), 4);
+	m68_mmu_destroy();
+	ASSERT_EQ(m68_page_pool_count(), pages);
+}
+
+// MARK: - Allocation on Write
+
+TEST_CASE(MMU, ReadOfUntouchedMemoryDoesNotAllocate)
+{
+	m68_mmu_initialise();
+
+	ASSERT_EQ(m68_mmu_read_long(0x00A01230), 0);
+	ASSERT_EQ(m68_mmu_read_byte(0x00A01FFF), 0);
+	ASSERT_EQ(MMU_PAGE_DIR[2].field.present, 0);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, WriteAfterReadAllocatesPage)
+{
+	m68_mmu_initialise();
+
+	ASSERT_EQ(m68_mmu_read_word(0x6000), 0);
+	m68_mmu_write_word(0x6000, 0x4E71);
+	ASSERT_EQ(m68_mmu_read_word(0x6000), 0x4E71);
+	ASSERT_EQ(m68_mmu_read_word(0x7000), 0);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(MMU, MemoryLimitRaisesBusError)
+{
+	static uint8_t rom[0x1000] = { 0x12, 0x34 };
+
+	m68_mmu_initialise();
+	m68_mmu_map_shared(0x400000, rom, sizeof(rom));
+	m68_mmu_set_memory_limit(0x100000);
+	CPU68.fault.vector = 0;
+
+	ASSERT_EQ(m68_mmu_read_word(0x400000), 0x1234);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_mmu_write_byte(0x0FFFFF, 1);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+
+	ASSERT_EQ(m68_mmu_read_word(0x200000), 0);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	ASSERT_EQ(CPU68.fault.address, 0x200000);
+	CPU68.fault.vector = 0;
+
+	m68_mmu_write_word(0x200000, 0xFFFF);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	ASSERT_EQ(CPU68.fault.write, 1);
+	CPU68.fault.vector = 0;
+
+	m68_mmu_set_memory_limit(0);
+	m68_mmu_destroy();
+}
+
+#endif
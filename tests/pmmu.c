@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/exception.h"
+#include "cpu/execute.h"
+#include "cpu/pmmu.h"
+
+#if defined(UNIT_TEST)
+
+/* 4KiB pages, with two levels of 10 bits. The root table is at 0x10000 and
+ * the page tables follow it, one for each 4MiB of logical memory. */
+#define PMMU_TEST_TC		0x80C0AA00
+#define PMMU_TEST_ROOT		0x00010000
+#define PMMU_TEST_TABLES	0x00011000
+
+static uint32_t pmmu_test_descriptor(uint32_t logical)
+{
+	return PMMU_TEST_TABLES + (logical >> 22) * 0x1000 + ((logical >> 12) & 0x3FF) * 4;
+}
+
+static void pmmu_test_map(uint32_t logical, uint32_t physical, uint32_t flags)
+{
+	uint32_t table = PMMU_TEST_TABLES + (logical >> 22) * 0x1000;
+	m68_mmu_write_physical_long(PMMU_TEST_ROOT + (logical >> 22) * 4, table | 2);
+	m68_mmu_write_physical_long(pmmu_test_descriptor(logical), (physical & 0xFFFFF000) | flags | 1);
+}
+
+static void pmmu_test_configure(void)
+{
+	m68_mmu_initialise();
+	m68_set_model(M68_MODEL_68030);
+	CPU68.CCR.value = 0x2000;
+	CPU68.PC.value = 0x1000;
+	CPU68.fault.vector = 0;
+	CPU68.CRP.limit.value = 0x7FFF0002;
+	CPU68.CRP.address.value = PMMU_TEST_ROOT;
+
+	/* Low memory is mapped one to one. */
+	for (uint32_t address = 0; address < 0x4000; address += 0x1000) {
+		pmmu_test_map(address, address, 0);
+	}
+}
+
+static void pmmu_test_restore(void)
+{
+	m68_pmmu_reset();
+	CPU68.fault.vector = 0;
+}
+
+// MARK: - Configuration
+
+TEST_CASE(PMMU, InvalidTranslationControlIsRejected)
+{
+	pmmu_test_configure();
+	ASSERT_EQ(m68_pmmu_set_tc(0x80C0A000), 1);
+	ASSERT_EQ(m68_pmmu_enabled(), 0);
+	ASSERT_EQ(m68_pmmu_set_tc(PMMU_TEST_TC), 0);
+	ASSERT_EQ(m68_pmmu_enabled(), 1);
+	pmmu_test_restore();
+}
+
+// MARK: - Translation
+
+TEST_CASE(PMMU, AccessesAreTranslatedThroughTheTables)
+{
+	pmmu_test_configure();
+	m68_mmu_write_physical_long(0x00050010, 0x12345678);
+	pmmu_test_map(0x00400000, 0x00050000, 0);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	ASSERT_EQ(m68_mmu_read_long(0x00400010), 0x12345678);
+	m68_mmu_write_long(0x00400020, 0xCAFEBABE);
+	ASSERT_EQ(m68_mmu_read_physical_long(0x00050020), 0xCAFEBABE);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, HotAccessesDoNotWalkTheTables)
+{
+	pmmu_test_configure();
+	pmmu_test_map(0x00400000, 0x00050000, 0);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	m68_mmu_read_long(0x00400000);
+	uint64_t walks = m68_pmmu_walks();
+	for (uint32_t i = 0; i < 1000; i += 4) {
+		m68_mmu_read_long(0x00400000 + i);
+	}
+	ASSERT_EQ(m68_pmmu_walks(), walks);
+
+	/* Without the look-aside buffers, the ATC still has the translation. */
+	m68_mmu_flush_tlb();
+	m68_mmu_read_long(0x00400000);
+	ASSERT_EQ(m68_pmmu_walks(), walks);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, UsedAndModifiedBitsAreSet)
+{
+	pmmu_test_configure();
+	pmmu_test_map(0x00400000, 0x00050000, 0);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	m68_mmu_read_byte(0x00400000);
+	ASSERT_EQ(m68_mmu_read_physical_long(pmmu_test_descriptor(0x00400000)) & 0x18, 0x08);
+	ASSERT_EQ(m68_mmu_read_physical_long(PMMU_TEST_ROOT + 4) & 0x08, 0x08);
+
+	m68_mmu_write_byte(0x00400000, 1);
+	ASSERT_EQ(m68_mmu_read_physical_long(pmmu_test_descriptor(0x00400000)) & 0x18, 0x18);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, EarlyTerminationMapsABlock)
+{
+	pmmu_test_configure();
+	m68_mmu_write_physical_long(0x00003000, 0xFEEDFACE);
+	m68_mmu_write_physical_long(PMMU_TEST_ROOT + 3 * 4, 0x00000001);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	ASSERT_EQ(m68_mmu_read_long(0x00C03000), 0xFEEDFACE);
+	pmmu_test_restore();
+}
+
+// MARK: - Faults
+
+TEST_CASE(PMMU, InvalidDescriptorRaisesBusError)
+{
+	pmmu_test_configure();
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	m68_mmu_read_word(0x00800000);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	ASSERT_EQ(CPU68.fault.address, 0x00800000);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, WriteProtectedPageRaisesBusErrorOnWrite)
+{
+	pmmu_test_configure();
+	m68_mmu_write_physical_long(0x00050000, 0x11111111);
+	pmmu_test_map(0x00400000, 0x00050000, 0x4);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	ASSERT_EQ(m68_mmu_read_long(0x00400000), 0x11111111);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_mmu_write_long(0x00400000, 0x22222222);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	ASSERT_EQ(CPU68.fault.write, 1);
+	ASSERT_EQ(m68_mmu_read_physical_long(0x00050000), 0x11111111);
+	pmmu_test_restore();
+}
+
+// MARK: - Transparent Translation
+
+TEST_CASE(PMMU, TransparentWindowBypassesTheTables)
+{
+	pmmu_test_configure();
+	m68_mmu_write_physical_long(0x40001000, 0x13579BDF);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+	m68_pmmu_set_tt(M68_PMMU_TT0, 0x40008107);	/* 0x40xxxxxx, any FC, reads and writes */
+
+	uint64_t walks = m68_pmmu_walks();
+	ASSERT_EQ(m68_mmu_read_long(0x40001000), 0x13579BDF);
+	m68_mmu_write_long(0x40002000, 0x2468ACE0);
+	ASSERT_EQ(m68_mmu_read_physical_long(0x40002000), 0x2468ACE0);
+	ASSERT_EQ(m68_pmmu_walks(), walks);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+
+	/* Disabling the window puts the tables back in charge. */
+	m68_pmmu_set_tt(M68_PMMU_TT0, 0x40000107);
+	m68_mmu_read_long(0x40001000);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, TransparentWindowMatchesOnlyItsAccesses)
+{
+	pmmu_test_configure();
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+	/* 0x40xxxxxx to 0x43xxxxxx, reads only, supervisor data only. */
+	m68_pmmu_set_tt(M68_PMMU_TT1, 0x40038250);
+
+	m68_mmu_read_long(0x43000000);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_mmu_write_long(0x43000000, 0);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	CPU68.fault.vector = 0;
+
+	m68_mmu_read_long(0x44000000);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	CPU68.fault.vector = 0;
+
+	ASSERT_EQ(m68_pmmu_test(0x41000000, 5, 0, 0, NULL) & M68_PMMU_MMUSR_T, M68_PMMU_MMUSR_T);
+	ASSERT_EQ(m68_pmmu_test(0x41000000, 1, 0, 0, NULL) & M68_PMMU_MMUSR_T, 0);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, WriteProtectedDataWindow)
+{
+	pmmu_test_configure();
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+	m68_pmmu_set_tt(M68_PMMU_DTT0, 0x5000C004);	/* 0x50xxxxxx, user and supervisor, W */
+
+	m68_mmu_read_long(0x50000000);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	m68_mmu_write_long(0x50000000, 0);
+	ASSERT_EQ(CPU68.fault.vector, M68_VECTOR_BUS_ERROR);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, PMOVEToTTEnablesTheWindow)
+{
+	pmmu_test_configure();
+	m68_mmu_write_word(0x1000, 0xF010);	/* PMOVE (A0),TT0 */
+	m68_mmu_write_word(0x1002, 0x0800);
+	m68_mmu_write_long(0x2000, 0x60008107);
+	CPU68.A[0].value = 0x2000;
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	m68_step();
+	ASSERT_EQ(CPU68.TT0.value, 0x60008107);
+	m68_mmu_read_long(0x60000000);
+	ASSERT_EQ(CPU68.fault.vector, 0);
+	pmmu_test_restore();
+}
+
+// MARK: - Flushing
+
+TEST_CASE(PMMU, FlushingAPageReloadsItsTranslation)
+{
+	pmmu_test_configure();
+	m68_mmu_write_physical_long(0x00050000, 0x11111111);
+	m68_mmu_write_physical_long(0x00060000, 0x22222222);
+	pmmu_test_map(0x00400000, 0x00050000, 0);
+	pmmu_test_map(0x00401000, 0x00050000, 0);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	ASSERT_EQ(m68_mmu_read_long(0x00400000), 0x11111111);
+	ASSERT_EQ(m68_mmu_read_long(0x00401000), 0x11111111);
+
+	/* The cached translation is used until the page is flushed, and only the
+	 * flushed page is affected. */
+	pmmu_test_map(0x00400000, 0x00060000, 0);
+	pmmu_test_map(0x00401000, 0x00060000, 0);
+	ASSERT_EQ(m68_mmu_read_long(0x00400000), 0x11111111);
+	m68_pmmu_flush_page(0, 0, 0x00400000);
+	ASSERT_EQ(m68_mmu_read_long(0x00400000), 0x22222222);
+	ASSERT_EQ(m68_mmu_read_long(0x00401000), 0x11111111);
+	pmmu_test_restore();
+}
+
+// MARK: - Instructions
+
+TEST_CASE(PMMU, PMOVEEnablesTranslation)
+{
+	static const uint16_t program[] = {
+		0xF010, 0x4C00,		/* PMOVE (A0),CRP */
+		0xF011, 0x4000,		/* PMOVE (A1),TC */
+		0xF012, 0x4200,		/* PMOVE TC,(A2) */
+	};
+
+	pmmu_test_configure();
+	pmmu_test_map(0x00400000, 0x00002000, 0);
+	for (int i = 0; i < 6; ++i) {
+		m68_mmu_write_word(0x1000 + 2 * i, program[i]);
+	}
+	CPU68.CRP.limit.value = 0;
+	CPU68.CRP.address.value = 0;
+	m68_mmu_write_long(0x2000, 0x7FFF0002);
+	m68_mmu_write_long(0x2004, PMMU_TEST_ROOT);
+	m68_mmu_write_long(0x2008, PMMU_TEST_TC);
+	CPU68.A[0].value = 0x2000;
+	CPU68.A[1].value = 0x2008;
+	CPU68.A[2].value = 0x400010;
+
+	m68_step();
+	m68_step();
+	ASSERT_EQ(CPU68.CRP.address.value, PMMU_TEST_ROOT);
+	ASSERT_EQ(m68_pmmu_enabled(), 1);
+	ASSERT_EQ(CPU68.PC.value, 0x1008);
+
+	m68_step();
+	ASSERT_EQ(m68_mmu_read_physical_long(0x2010), PMMU_TEST_TC);
+	pmmu_test_restore();
+}
+
+TEST_CASE(PMMU, PTESTReportsTheWalk)
+{
+	pmmu_test_configure();
+	pmmu_test_map(0x00400000, 0x00050000, 0x4);
+	m68_pmmu_set_tc(PMMU_TEST_TC);
+
+	uint32_t descriptor = 0;
+	uint16_t mmusr = m68_pmmu_test(0x00400000, 5, 0, 7, &descriptor);
+	ASSERT_EQ(mmusr, M68_PMMU_MMUSR_W | 2);
+	ASSERT_EQ(descriptor, pmmu_test_descriptor(0x00400000));
+
+	ASSERT_EQ(m68_pmmu_test(0x00800000, 5, 0, 7, NULL), M68_PMMU_MMUSR_I | 1);
+	ASSERT_EQ(m68_pmmu_test(0x00400000, 5, 0, 0, NULL), M68_PMMU_MMUSR_I);
+	pmmu_test_restore();
+}
+
+#endif
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/execute.h"
+#include "cpu/scheduler.h"
+#include "cpu/profile.h"
+
+#if defined(UNIT_TEST)
+
+static void profile_test_configure(void)
+{
+	m68_mmu_initialise();
+	m68_scheduler_reset();
+	m68_profile_reset();
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.A[7].value = 0x8000;
+	CPU68.cycles = 0;
+}
+
+/* Write a report to a temporary file and read it back. */
+static void profile_test_report(void(*write)(FILE *), char *text, size_t size)
+{
+	FILE *file = tmpfile();
+	write(file);
+	rewind(file);
+	size_t length = fread(text, 1, size - 1, file);
+	text[length] = '\0';
+	fclose(file);
+}
+
+// MARK: - Symbols
+
+TEST_CASE(Profile, LoadMapFile)
+{
+	profile_test_configure();
+	FILE *map = tmpfile();
+	fputs("00001000 T _main\n00002000 _helper\nnot a symbol\n00003000 t _tail\n", map);
+	rewind(map);
+
+	ASSERT_EQ(m68_profile_load_map(map), 3);
+	fclose(map);
+	ASSERT_EQ_STR(m68_profile_symbolicate(0x1800), "_main");
+	ASSERT_EQ_STR(m68_profile_symbolicate(0x2000), "_helper");
+	ASSERT_EQ(m68_profile_symbolicate(0x0FFF), NULL);
+	m68_profile_reset();
+}
+
+TEST_CASE(Profile, ScanMacsBugNames)
+{
+	static const uint8_t code[] = {
+		0x4E, 0x56, 0x00, 0x00,			// LINK A6,#0
+		0x4E, 0x5E,				// UNLK A6
+		0x4E, 0x75,				// RTS
+		0x84, 'M', 'A', 'I', 'N', 0x00,		// Variable length name
+		0x00, 0x02, 0xAA, 0xBB,			// Two bytes of constants
+		0x4E, 0x71,				// NOP
+		0x4E, 0xD0,				// JMP (A0)
+		'D' | 0x80, 'R', 'A', 'W', ' ', ' ', ' ', ' ',	// Fixed length name
+	};
+	profile_test_configure();
+	for (uint32_t i = 0; i < sizeof(code); ++i) {
+		m68_mmu_write_byte(0x1000 + i, code[i]);
+	}
+
+	ASSERT_EQ(m68_profile_scan_macsbug(0x1000, sizeof(code)), 2);
+	ASSERT_EQ_STR(m68_profile_symbolicate(0x1000), "MAIN");
+	ASSERT_EQ_STR(m68_profile_symbolicate(0x1006), "MAIN");
+	ASSERT_EQ(m68_profile_symbolicate(0x1008), NULL);
+	ASSERT_EQ_STR(m68_profile_symbolicate(0x1012), "DRAW");
+	m68_profile_reset();
+}
+
+// MARK: - Sampling
+
+TEST_CASE(Profile, SamplesDuringRun)
+{
+	char text[512];
+	profile_test_configure();
+	for (uint32_t address = 0x1000; address < 0x2000; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+	m68_mmu_write_long(0x8000, 0x00004000);
+	m68_profile_add_symbol(0x1000, 0x1000, "abcd_run");
+	m68_profile_add_symbol(0x4000, 0, "caller");
+
+	ASSERT_EQ(m68_profile_start(100, 8), 0);
+	m68_run(1000);
+	m68_profile_stop();
+
+	uint32_t count = 0;
+	const struct m68_profile_sample *samples = m68_profile_samples(&count);
+	ASSERT_EQ(count, 8);
+	ASSERT_EQ(m68_profile_dropped(), 2);
+	ASSERT_EQ(samples[0].return_address, 0x4000);
+
+	profile_test_report(m68_profile_write_flat, text, sizeof(text));
+	ASSERT_NEQ(strstr(text, "100.00%  abcd_run"), NULL);
+	profile_test_report(m68_profile_write_collapsed, text, sizeof(text));
+	ASSERT_EQ_STR(text, "caller;abcd_run 8\n");
+	m68_profile_reset();
+}
+
+TEST_CASE(Profile, SampleReadsReturnAddressAcrossPage)
+{
+	profile_test_configure();
+	for (uint32_t address = 0x1000; address < 0x1100; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+	CPU68.A[7].value = 0x8FFE;
+	m68_mmu_write_long(0x8FFE, 0x00123456);
+
+	ASSERT_EQ(m68_profile_start(10, 1), 0);
+	m68_run(20);
+	m68_profile_stop();
+
+	uint32_t count = 0;
+	const struct m68_profile_sample *samples = m68_profile_samples(&count);
+	ASSERT_EQ(count, 1);
+	ASSERT_EQ(samples[0].return_address, 0x00123456);
+	m68_profile_reset();
+}
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include <pthread.h>
+#include "device/ring.h"
+
+#if defined(UNIT_TEST)
+
+TEST_CASE(Ring, CapacityRoundsUpToPowerOfTwo)
+{
+	struct m68_ring ring;
+	ASSERT_EQ(m68_ring_initialise(&ring, sizeof(uint16_t), 100), 0);
+	ASSERT_EQ(m68_ring_capacity(&ring), 128);
+	m68_ring_destroy(&ring);
+}
+
+TEST_CASE(Ring, RejectsCapacitiesThatCannotBeAllocated)
+{
+	struct m68_ring ring;
+	ASSERT_NEQ(m68_ring_initialise(&ring, sizeof(uint16_t), 0), 0);
+	ASSERT_NEQ(m68_ring_initialise(&ring, sizeof(uint8_t), (SIZE_MAX >> 1) + 2), 0);
+	ASSERT_NEQ(m68_ring_initialise(&ring, sizeof(uint8_t), SIZE_MAX), 0);
+	ASSERT_NEQ(m68_ring_initialise(&ring, sizeof(uint32_t), (SIZE_MAX >> 2) + 1), 0);
+}
+
+TEST_CASE(Ring, DequeueFromEmptyRingReturnsNothing)
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint8_t), 16);
+
+	uint8_t value = 0;
+	ASSERT_EQ(m68_ring_dequeue(&ring, &value, 1), 0);
+	ASSERT_EQ(m68_ring_count(&ring), 0);
+
+	m68_ring_destroy(&ring);
+}
+
+TEST_CASE(Ring, EnqueueThenDequeuePreservesOrder)
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint16_t), 16);
+
+	uint16_t in[5] = { 0xDEAD, 0xBEEF, 0x1234, 0x5678, 0x9ABC };
+	uint16_t out[5] = { 0 };
+
+	ASSERT_EQ(m68_ring_enqueue(&ring, in, 5), 5);
+	ASSERT_EQ(m68_ring_count(&ring), 5);
+	ASSERT_EQ(m68_ring_dequeue(&ring, out, 5), 5);
+
+	ASSERT_EQ(out[0], 0xDEAD);
+	ASSERT_EQ(out[1], 0xBEEF);
+	ASSERT_EQ(out[2], 0x1234);
+	ASSERT_EQ(out[3], 0x5678);
+	ASSERT_EQ(out[4], 0x9ABC);
+
+	m68_ring_destroy(&ring);
+}
+
+TEST_CASE(Ring, EnqueueIntoFullRingIsTruncated)
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint8_t), 4);
+
+	uint8_t in[6] = { 1, 2, 3, 4, 5, 6 };
+	ASSERT_EQ(m68_ring_enqueue(&ring, in, 6), 4);
+	ASSERT_EQ(m68_ring_enqueue(&ring, in, 1), 0);
+
+	m68_ring_destroy(&ring);
+}
+
+TEST_CASE(Ring, BatchWrapsAroundEndOfBuffer)
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint8_t), 4);
+
+	uint8_t in[4] = { 1, 2, 3, 4 };
+	uint8_t out[4] = { 0 };
+
+	// Move the indices part way through the buffer.
+	m68_ring_enqueue(&ring, in, 3);
+	m68_ring_dequeue(&ring, out, 3);
+
+	// This batch now straddles the end of the buffer.
+	ASSERT_EQ(m68_ring_enqueue(&ring, in, 4), 4);
+	ASSERT_EQ(m68_ring_dequeue(&ring, out, 4), 4);
+
+	ASSERT_EQ(out[0], 1);
+	ASSERT_EQ(out[1], 2);
+	ASSERT_EQ(out[2], 3);
+	ASSERT_EQ(out[3], 4);
+
+	m68_ring_destroy(&ring);
+}
+
+// MARK: - Concurrency
+
+#define RING_TEST_ELEMENTS	100000
+
+static void *ring_test_producer(void *context)
+{
+	struct m68_ring *ring = context;
+	uint32_t next = 0;
+	while (next < RING_TEST_ELEMENTS) {
+		uint32_t batch[7];
+		size_t count = 0;
+		while (count < 7 && next + count < RING_TEST_ELEMENTS) {
+			batch[count] = next + count;
+			++count;
+		}
+		next += m68_ring_enqueue(ring, batch, count);
+	}
+	return NULL;
+}
+
+TEST_CASE(Ring, ConcurrentProducerAndConsumerSeeEveryElementInOrder)
+{
+	struct m68_ring ring;
+	m68_ring_initialise(&ring, sizeof(uint32_t), 64);
+
+	pthread_t producer;
+	pthread_create(&producer, NULL, ring_test_producer, &ring);
+
+	uint32_t expected = 0;
+	uint32_t mismatches = 0;
+	while (expected < RING_TEST_ELEMENTS) {
+		uint32_t batch[5];
+		size_t count = m68_ring_dequeue(&ring, batch, 5);
+		for (size_t i = 0; i < count; ++i) {
+			mismatches += (batch[i] != expected++);
+		}
+	}
+
+	pthread_join(producer, NULL);
+	m68_ring_destroy(&ring);
+
+	ASSERT_EQ(mismatches, 0);
+}
+
+#endif
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/execute.h"
+#include "cpu/idle.h"
+#include "cpu/scheduler.h"
+
+#if defined(UNIT_TEST)
+
+#define SCHEDULER_TEST_EVENTS	500
+
+static uint64_t scheduler_test_fired[SCHEDULER_TEST_EVENTS];
+static int scheduler_test_count = 0;
+
+static void scheduler_test_record(struct m68_event *event)
+{
+	scheduler_test_fired[scheduler_test_count++] = (uint64_t)(uintptr_t)event->context;
+}
+
+static void scheduler_test_periodic(struct m68_event *event)
+{
+	scheduler_test_fired[scheduler_test_count++] = CPU68.cycles;
+	m68_event_schedule_at(event, event->when + 1000);
+}
+
+static struct m68_event scheduler_test_follow_up;
+
+static void scheduler_test_chain(struct m68_event *event)
+{
+	m68_event_schedule(&scheduler_test_follow_up, 5);
+}
+
+static void scheduler_test_record_cycles(struct m68_event *event)
+{
+	scheduler_test_fired[scheduler_test_count++] = CPU68.cycles;
+}
+
+static void scheduler_test_bra_self(void)
+{
+}
+
+static void scheduler_test_configure(void)
+{
+	m68_mmu_initialise();
+	m68_scheduler_reset();
+	m68_idle_reset();
+	scheduler_test_count = 0;
+	m68_set_model(M68_MODEL_68000);
+	CPU68.PC.value = 0x1000;
+	CPU68.cycles = 0;
+	CPU68.deadline = 0;
+}
+
+// MARK: - Ordering
+
+TEST_CASE(Scheduler, EventsFireInOrder)
+{
+	struct m68_event events[4];
+	scheduler_test_configure();
+	for (uintptr_t i = 0; i < 4; ++i) {
+		m68_event_initialise(&events[i], scheduler_test_record, (void *)i);
+	}
+
+	m68_event_schedule(&events[0], 30);
+	m68_event_schedule(&events[1], 10);
+	m68_event_schedule(&events[2], 20);
+	m68_event_schedule(&events[3], 10);
+	ASSERT_EQ(m68_scheduler_next(), 10);
+
+	CPU68.cycles = 20;
+	m68_scheduler_dispatch();
+	ASSERT_EQ(scheduler_test_count, 3);
+	ASSERT_EQ(scheduler_test_fired[0], 1);
+	ASSERT_EQ(scheduler_test_fired[1], 3);
+	ASSERT_EQ(scheduler_test_fired[2], 2);
+	ASSERT_EQ(m68_event_pending(&events[0]), 1);
+	ASSERT_EQ(m68_event_pending(&events[1]), 0);
+	ASSERT_EQ(m68_scheduler_next(), 30);
+	m68_scheduler_reset();
+}
+
+TEST_CASE(Scheduler, CancelAndReschedule)
+{
+	struct m68_event events[3];
+	scheduler_test_configure();
+	for (uintptr_t i = 0; i < 3; ++i) {
+		m68_event_initialise(&events[i], scheduler_test_record, (void *)i);
+		m68_event_schedule(&events[i], 10 * (i + 1));
+	}
+
+	m68_event_cancel(&events[0]);
+	m68_event_schedule(&events[2], 5);
+	ASSERT_EQ(m68_scheduler_count(), 2);
+	ASSERT_EQ(m68_event_pending(&events[0]), 0);
+
+	CPU68.cycles = 100;
+	m68_scheduler_dispatch();
+	ASSERT_EQ(scheduler_test_count, 2);
+	ASSERT_EQ(scheduler_test_fired[0], 2);
+	ASSERT_EQ(scheduler_test_fired[1], 1);
+	m68_scheduler_reset();
+}
+
+TEST_CASE(Scheduler, ManyEventsFireInOrder)
+{
+	static struct m68_event events[SCHEDULER_TEST_EVENTS];
+	scheduler_test_configure();
+	for (uintptr_t i = 0; i < SCHEDULER_TEST_EVENTS; ++i) {
+		uint64_t delay = (i * 7919) % 1000;
+		m68_event_initialise(&events[i], scheduler_test_record, (void *)(uintptr_t)delay);
+		m68_event_schedule(&events[i], delay);
+	}
+	for (uintptr_t i = 0; i < SCHEDULER_TEST_EVENTS; i += 3) {
+		m68_event_cancel(&events[i]);
+	}
+
+	CPU68.cycles = 1000;
+	m68_scheduler_dispatch();
+	ASSERT_EQ(scheduler_test_count, SCHEDULER_TEST_EVENTS - (SCHEDULER_TEST_EVENTS + 2) / 3);
+	int ordered = 1;
+	for (int i = 1; i < scheduler_test_count; ++i) {
+		ordered &= scheduler_test_fired[i - 1] <= scheduler_test_fired[i];
+	}
+	ASSERT_EQ(ordered, 1);
+	m68_scheduler_reset();
+}
+
+// MARK: - Run Loop
+
+TEST_CASE(Scheduler, PeriodicEventDuringRun)
+{
+	struct m68_event event;
+	scheduler_test_configure();
+	for (uint32_t address = 0x1000; address < 0x2000; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+	m68_event_initialise(&event, scheduler_test_periodic, NULL);
+	m68_event_schedule(&event, 1000);
+
+	m68_run(5000);
+
+	ASSERT_EQ(scheduler_test_count, 5);
+	ASSERT_EQ(scheduler_test_fired[0], 1002);
+	ASSERT_EQ(scheduler_test_fired[4], 5004);
+	ASSERT_EQ(event.when, 6000);
+	m68_scheduler_reset();
+}
+
+TEST_CASE(Scheduler, EventScheduledDuringRunShortensSlice)
+{
+	struct m68_event event;
+	scheduler_test_configure();
+	for (uint32_t address = 0x1000; address < 0x2000; address += 2) {
+		m68_mmu_write_word(address, 0xC300);
+	}
+	m68_event_initialise(&event, scheduler_test_chain, NULL);
+	m68_event_initialise(&scheduler_test_follow_up, scheduler_test_record_cycles, NULL);
+	m68_event_schedule(&event, 600);
+
+	m68_run(6000);
+
+	ASSERT_EQ(scheduler_test_count, 1);
+	ASSERT_EQ(scheduler_test_fired[0], 606);
+	m68_scheduler_reset();
+}
+
+TEST_CASE(Scheduler, IdleLoopSkipsToNextEvent)
+{
+	struct m68_event event;
+	scheduler_test_configure();
+	m68_instruction_table[0x60FE] = (struct m68_instruction){ "BRA.S *", scheduler_test_bra_self, 10 };
+	m68_mmu_write_word(0x1000, 0x60FE);
+	m68_event_initialise(&event, scheduler_test_periodic, NULL);
+	m68_event_schedule(&event, 1000);
+
+	ASSERT_EQ(m68_run(10000), 10000);
+
+	ASSERT_EQ(scheduler_test_count, 10);
+	ASSERT_EQ(scheduler_test_fired[0], 1000);
+	ASSERT_EQ(scheduler_test_fired[9], 10000);
+	ASSERT_NEQ(m68_idle_skipped_cycles(), 0);
+	m68_instruction_table[0x60FE] = (struct m68_instruction){ 0 };
+	m68_scheduler_reset();
+}
+
+#endif
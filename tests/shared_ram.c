@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <libUnit/unit.h>
+#include <sys/mman.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/shared_ram.h"
+
+#if defined(UNIT_TEST)
+
+#define SHARED_RAM_TEST_ADDRESS	0x10000
+#define SHARED_RAM_TEST_LENGTH	0x2000
+
+TEST_CASE(SharedRAM, ReadersSeeGuestMemoryInPlace)
+{
+	m68_mmu_initialise();
+	m68_mmu_write_long(SHARED_RAM_TEST_ADDRESS, 0x12345678);
+	struct m68_shared_ram *ram = m68_shared_ram_create(SHARED_RAM_TEST_ADDRESS, SHARED_RAM_TEST_LENGTH, "lib68-test");
+	ASSERT_NEQ(ram, NULL);
+
+	const uint8_t *mapping = mmap(NULL, SHARED_RAM_TEST_LENGTH, PROT_READ, MAP_SHARED, m68_shared_ram_fd(ram), 0);
+	ASSERT_NEQ(mapping, MAP_FAILED);
+	ASSERT_EQ(mapping[M68_MMU_BYTE_OFFSET(0)], 0x12);
+	ASSERT_EQ(mapping[M68_MMU_BYTE_OFFSET(3)], 0x78);
+
+	m68_mmu_write_byte(SHARED_RAM_TEST_ADDRESS + 0x1005, 0xAB);
+	ASSERT_EQ(mapping[M68_MMU_BYTE_OFFSET(0x1005)], 0xAB);
+
+	munmap((void *)mapping, SHARED_RAM_TEST_LENGTH);
+	m68_shared_ram_destroy(ram);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(SharedRAM, PublishSetsTheBitsOfWrittenPages)
+{
+	uint64_t dirty[1] = { 0 };
+
+	m68_mmu_initialise();
+	struct m68_shared_ram *ram = m68_shared_ram_create(SHARED_RAM_TEST_ADDRESS, SHARED_RAM_TEST_LENGTH, "lib68-test");
+	uint64_t offset = m68_shared_ram_bitmap_offset(SHARED_RAM_TEST_LENGTH);
+	uint64_t *bitmap = mmap(NULL, m68_shared_ram_size(ram) - offset, PROT_READ | PROT_WRITE, MAP_SHARED, m68_shared_ram_fd(ram), (off_t)offset);
+	ASSERT_NEQ(bitmap, MAP_FAILED);
+
+	ASSERT_EQ(m68_shared_ram_take_dirty(bitmap, SHARED_RAM_TEST_LENGTH, dirty), 2);
+	ASSERT_EQ(m68_shared_ram_take_dirty(bitmap, SHARED_RAM_TEST_LENGTH, dirty), 0);
+
+	m68_mmu_write_word(SHARED_RAM_TEST_ADDRESS + 0x1000, 0x4E75);
+	ASSERT_EQ(m68_shared_ram_publish(ram), 1);
+	ASSERT_EQ(m68_shared_ram_take_dirty(bitmap, SHARED_RAM_TEST_LENGTH, dirty), 1);
+	ASSERT_EQ(dirty[0], 2);
+	ASSERT_EQ(m68_shared_ram_publish(ram), 0);
+
+	m68_mmu_write_word(SHARED_RAM_TEST_ADDRESS + 0x1002, 0x4E71);
+	ASSERT_EQ(m68_shared_ram_publish(ram), 1);
+
+	munmap(bitmap, m68_shared_ram_size(ram) - offset);
+	m68_shared_ram_destroy(ram);
+	m68_mmu_destroy();
+}
+
+TEST_CASE(SharedRAM, DestroyKeepsTheContents)
+{
+	m68_mmu_initialise();
+	struct m68_shared_ram *ram = m68_shared_ram_create(SHARED_RAM_TEST_ADDRESS, SHARED_RAM_TEST_LENGTH, "lib68-test");
+	m68_mmu_write_long(SHARED_RAM_TEST_ADDRESS + 0x10, 0xCAFEF00D);
+	m68_shared_ram_destroy(ram);
+
+	ASSERT_EQ(m68_mmu_read_long(SHARED_RAM_TEST_ADDRESS + 0x10), 0xCAFEF00D);
+	m68_mmu_write_long(SHARED_RAM_TEST_ADDRESS + 0x10, 0x00000001);
+	ASSERT_EQ(m68_mmu_read_long(SHARED_RAM_TEST_ADDRESS + 0x10), 1);
+	m68_mmu_destroy();
+}
+
+#endif
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Ahead-of-Time Translator
+ * Translates the straight-line code reachable from each entry point of a ROM
+ * or application image into C, for the host to compile in and register with
+ * m68_aot_register() (cpu/aot.h). The image is decoded with the same tables
+ * as the library, so this runs on the build host linked against lib68.a.
+ *
+ *	aot <image> <load-address> <model> <module> <output.c> <entry>...
+ *
+ * Code is followed from each entry until an instruction that can not be
+ * translated, which is left to the interpreter. As the run loop falls back to
+ * the interpreter whenever a block leaves the straight line, only the code
+ * after an entry is translated: anything reached another way needs an entry
+ * point of its own. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "cpu/cpu.h"
+#include "cpu/mmu.h"
+#include "cpu/instruction.h"
+#include "cpu/disassembler.h"
+#include "cpu/aot.h"
+
+#define AOT_MAX_BLOCKS		65536
+
+struct aot_block {
+	uint32_t pc;
+	uint32_t count;
+	struct m68_disassembly instructions[M68_AOT_MAX_BLOCK_INSTRUCTIONS];
+};
+
+static uint8_t *aot_image;
+static size_t aot_image_length;
+static uint32_t aot_origin;
+
+static struct aot_block *aot_blocks;
+static uint32_t aot_block_count = 0;
+
+// MARK: - Translation
+
+/* Whether the instruction has a handler body to call. */
+static int aot_translatable(uint16_t opcode)
+{
+	const struct m68_instruction_form *form = &m68_instruction_forms[m68_instruction_form_index[opcode]];
+	return m68_instruction_table[opcode].imp != NULL && form->specialised;
+}
+
+static int aot_translated(uint32_t pc)
+{
+	for (uint32_t i = 0; i < aot_block_count; ++i) {
+		if (aot_blocks[i].pc == pc) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/* Translate a block starting at the PC, returning the number of instructions
+ * in it. */
+static uint32_t aot_translate_block(struct aot_block *block, uint32_t pc)
+{
+	block->pc = pc;
+	block->count = 0;
+	while (block->count < M68_AOT_MAX_BLOCK_INSTRUCTIONS && pc - aot_origin < aot_image_length) {
+		struct m68_disassembly *instruction = &block->instructions[block->count];
+		uint32_t offset = pc - aot_origin;
+		if (m68_disassemble_buffer(aot_image + offset, aot_image_length - offset, pc, instruction, 1) == 0) {
+			break;
+		}
+
+		uint32_t end = pc + instruction->length;
+		if (!aot_translatable(instruction->opcode)
+			|| end - aot_origin > aot_image_length
+			|| end - block->pc > M68_AOT_MAX_BLOCK_LENGTH
+			|| ((end - 1) & M68_MMU_PAGE_MASK) != (block->pc & M68_MMU_PAGE_MASK)) {
+			break;
+		}
+		++block->count;
+		pc = end;
+	}
+	return block->count;
+}
+
+/* Follow the code from an entry point, a block at a time. */
+static void aot_translate(uint32_t pc)
+{
+	while (pc - aot_origin < aot_image_length && !aot_translated(pc) && aot_block_count < AOT_MAX_BLOCKS) {
+		struct aot_block *block = &aot_blocks[aot_block_count];
+		if (aot_translate_block(block, pc) == 0) {
+			return;
+		}
+		++aot_block_count;
+
+		const struct m68_disassembly *last = &block->instructions[block->count - 1];
+		pc = last->address + last->length;
+	}
+}
+
+static int aot_compare_blocks(const void *lhs, const void *rhs)
+{
+	const struct aot_block *a = lhs;
+	const struct aot_block *b = rhs;
+	return (a->pc > b->pc) - (a->pc < b->pc);
+}
+
+// MARK: - Output
+
+static void aot_upper(char *dst, const char *src)
+{
+	while (*src) {
+		*dst++ = (char)toupper((unsigned char)*src++);
+	}
+	*dst = '\0';
+}
+
+static uint16_t aot_word(uint32_t address)
+{
+	const uint8_t *p = aot_image + (address - aot_origin);
+	return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void aot_write_block(FILE *out, const char *module, unsigned model, const struct aot_block *block)
+{
+	const struct m68_disassembly *last = &block->instructions[block->count - 1];
+	uint32_t length = last->address + last->length - block->pc;
+
+	fprintf(out, "\nstatic const uint16_t %s_code_%08X[] = {", module, block->pc);
+	for (uint32_t offset = 0; offset < length; offset += 2) {
+		fprintf(out, "%s0x%04X", offset % 16 ? ", " : "\n\t", aot_word(block->pc + offset));
+	}
+	fprintf(out, "\n};\n");
+
+	fprintf(out, "\nstatic void %s_block_%08X(void)\n{\n", module, block->pc);
+	fprintf(out, "\tuint32_t generation = DECODE_CACHE_GENERATION;\n");
+	for (uint32_t i = 0; i < block->count; ++i) {
+		const struct m68_disassembly *instruction = &block->instructions[i];
+		char form[M68_DISASSEMBLY_TEXT_MAX];
+		aot_upper(form, m68_instruction_forms[m68_instruction_form_index[instruction->opcode]].name);
+
+		fprintf(out, "\n\t/* $%08X  %s */\n", instruction->address, instruction->text);
+		fprintf(out, "\tM68_%s_BODY(0x%04X, M68_MODEL_%u);\n", form, instruction->opcode, model);
+		fprintf(out, "\tCPU68.cycles += %u;\n", m68_instruction_table[instruction->opcode].cycles);
+		fprintf(out, "\tif (!m68_aot_continue(0x%08X, 0x%08X, 0x%08X, generation)) {\n\t\treturn;\n\t}\n",
+			block->pc, instruction->address, instruction->address + instruction->length);
+	}
+	fprintf(out, "}\n");
+}
+
+static void aot_write_module(FILE *out, const char *image, const char *module, unsigned model)
+{
+	fprintf(out, "/* Generated by tools/aot from %s. Do not edit. */\n\n", image);
+	fprintf(out, "#include \"cpu/cpu.h\"\n");
+	fprintf(out, "#include \"cpu/cache.h\"\n");
+	fprintf(out, "#include \"cpu/aot.h\"\n");
+	fprintf(out, "#include \"cpu/instruction_bodies.h\"\n");
+
+	for (uint32_t i = 0; i < aot_block_count; ++i) {
+		aot_write_block(out, module, model, &aot_blocks[i]);
+	}
+
+	fprintf(out, "\nstatic const struct m68_aot_block %s_blocks[] = {\n", module);
+	for (uint32_t i = 0; i < aot_block_count; ++i) {
+		const struct aot_block *block = &aot_blocks[i];
+		const struct m68_disassembly *last = &block->instructions[block->count - 1];
+		fprintf(out, "\t{ 0x%08X, %u, %s_code_%08X, { \"%s $%08X\", %s_block_%08X, 0 } },\n",
+			block->pc, last->address + last->length - block->pc, module, block->pc,
+			module, block->pc, module, block->pc);
+	}
+	fprintf(out, "};\n");
+
+	fprintf(out, "\nconst struct m68_aot_module %s = {\n", module);
+	fprintf(out, "\t\"%s\", M68_MODEL_%u, %u, %s_blocks\n};\n", module, model, aot_block_count, module);
+}
+
+// MARK: - Main
+
+static int aot_load_image(const char *path)
+{
+	FILE *in = fopen(path, "rb");
+	if (in == NULL || fseek(in, 0, SEEK_END) != 0) {
+		return -1;
+	}
+	long length = ftell(in);
+	rewind(in);
+	aot_image = malloc(length > 0 ? (size_t)length : 1);
+	aot_image_length = length > 0 ? (size_t)length : 0;
+	if (aot_image == NULL || fread(aot_image, 1, aot_image_length, in) != aot_image_length) {
+		fclose(in);
+		return -1;
+	}
+	fclose(in);
+	return 0;
+}
+
+int main(int argc, const char *argv[])
+{
+	if (argc < 7) {
+		fprintf(stderr, "usage: %s <image> <load-address> <model> <module> <output.c> <entry>...\n", argv[0]);
+		return 1;
+	}
+
+	unsigned model = (unsigned)strtoul(argv[3], NULL, 10);
+	if (model != M68_MODEL_68000 && model != M68_MODEL_68010 && model != M68_MODEL_68020
+		&& model != M68_MODEL_68030 && model != M68_MODEL_68040) {
+		fprintf(stderr, "aot: unknown model '%s'\n", argv[3]);
+		return 1;
+	}
+	m68_set_model((enum m68_model)model);
+
+	aot_origin = (uint32_t)strtoul(argv[2], NULL, 0);
+	if (aot_load_image(argv[1]) != 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	aot_blocks = malloc(AOT_MAX_BLOCKS * sizeof(*aot_blocks));
+	if (aot_blocks == NULL) {
+		perror("aot");
+		return 1;
+	}
+	for (int i = 6; i < argc; ++i) {
+		aot_translate((uint32_t)strtoul(argv[i], NULL, 0));
+	}
+	qsort(aot_blocks, aot_block_count, sizeof(*aot_blocks), aot_compare_blocks);
+
+	FILE *out = fopen(argv[5], "w");
+	if (out == NULL) {
+		perror(argv[5]);
+		return 1;
+	}
+	aot_write_module(out, argv[1], argv[4], model);
+	fclose(out);
+
+	fprintf(stderr, "aot: %u blocks\n", aot_block_count);
+	return 0;
+}
@@ -0,0 +1,733 @@
+/*
+ * Copyright (c) 2019 Tom Hancocks, The Diamond Project
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/* Opcode Table Generator
+ * Expands the instruction form specification (cpu/instructions.spec) into a
+ * dispatch table for each CPU model, the operand decoders, and a macro for
+ * each handler body. This runs on the build host as part of building the
+ * library.
+ *
+ *	opgen <spec> <table.c> <forms.h> <bodies.h>
+ */
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define OPGEN_MAX_FORMS		4096
+#define OPGEN_MAX_TEXT		256
+#define OPGEN_MAX_NAME		64
+#define OPGEN_OPCODES		0x10000
+#define OPGEN_MAX_INCLUDES	256
+#define OPGEN_MAX_SPECIALISE	8
+
+/* The models a table is generated for, oldest first. */
+static const unsigned opgen_models[] = { 68000, 68010, 68020, 68030, 68040 };
+#define OPGEN_MODEL_COUNT	(sizeof(opgen_models) / sizeof(opgen_models[0]))
+
+// MARK: - Addressing Modes
+
+enum opgen_ea_mode {
+	EA_DN, EA_AN, EA_IND, EA_POST, EA_PRE, EA_DISP, EA_INDEX,
+	EA_ABSW, EA_ABSL, EA_PCDISP, EA_PCINDEX, EA_IMM,
+	EA_MODE_COUNT
+};
+
+#define EA_BIT(_M)		(1 << (_M))
+#define EA_ALL			((1 << EA_MODE_COUNT) - 1)
+#define EA_DATA			(EA_ALL & ~EA_BIT(EA_AN))
+#define EA_MEMORY		(EA_ALL & ~(EA_BIT(EA_DN) | EA_BIT(EA_AN)))
+#define EA_CONTROL		(EA_BIT(EA_IND) | EA_BIT(EA_DISP) | EA_BIT(EA_INDEX) | EA_BIT(EA_ABSW) \
+				| EA_BIT(EA_ABSL) | EA_BIT(EA_PCDISP) | EA_BIT(EA_PCINDEX))
+#define EA_ALTERABLE		(EA_ALL & ~(EA_BIT(EA_PCDISP) | EA_BIT(EA_PCINDEX) | EA_BIT(EA_IMM)))
+
+static const struct {
+	const char *name;
+	uint16_t modes;
+} opgen_ea_names[] = {
+	{ "dn", EA_BIT(EA_DN) },
+	{ "an", EA_BIT(EA_AN) },
+	{ "ind", EA_BIT(EA_IND) },
+	{ "post", EA_BIT(EA_POST) },
+	{ "pre", EA_BIT(EA_PRE) },
+	{ "disp", EA_BIT(EA_DISP) },
+	{ "index", EA_BIT(EA_INDEX) },
+	{ "absw", EA_BIT(EA_ABSW) },
+	{ "absl", EA_BIT(EA_ABSL) },
+	{ "pcdisp", EA_BIT(EA_PCDISP) },
+	{ "pcindex", EA_BIT(EA_PCINDEX) },
+	{ "imm", EA_BIT(EA_IMM) },
+	{ "all", EA_ALL },
+	{ "data", EA_DATA },
+	{ "memory", EA_MEMORY },
+	{ "control", EA_CONTROL },
+	{ "alterable", EA_ALTERABLE },
+	{ "data-alterable", EA_DATA & EA_ALTERABLE },
+	{ "memory-alterable", EA_MEMORY & EA_ALTERABLE },
+	{ "control-alterable", EA_CONTROL & EA_ALTERABLE },
+};
+
+/* Map a 3-bit mode and 3-bit register onto an addressing mode. Returns -1 for
+ * the unassigned mode 7 encodings. */
+static int opgen_ea_mode(unsigned mode, unsigned reg)
+{
+	if (mode < 7) {
+		return (int)mode;
+	}
+	return reg <= 4 ? EA_ABSW + (int)reg : -1;
+}
+
+// MARK: - Forms
+
+struct opgen_form {
+	char name[OPGEN_MAX_NAME];
+	char handler[OPGEN_MAX_NAME];
+	char text[OPGEN_MAX_TEXT];
+	uint16_t mask;
+	uint16_t match;
+	uint16_t fields[26];
+	uint16_t ea_modes;
+	uint16_t dest_ea_modes;
+	int has_ea;
+	int has_dest_ea;
+	char specialise[OPGEN_MAX_SPECIALISE + 1];
+	int by_model;
+	unsigned model;
+	unsigned last;
+	unsigned cycles;
+	int line;
+};
+
+static struct opgen_form opgen_forms[OPGEN_MAX_FORMS];
+static int opgen_form_count = 0;
+static char *opgen_includes[OPGEN_MAX_INCLUDES];
+static int opgen_include_count = 0;
+static uint16_t opgen_opcode_form[OPGEN_OPCODES];
+static const char *opgen_spec_path = NULL;
+
+static void opgen_error(int line, const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	fprintf(stderr, "%s:%d: error: ", opgen_spec_path, line);
+	vfprintf(stderr, format, args);
+	fprintf(stderr, "\n");
+	va_end(args);
+	exit(1);
+}
+
+static uint16_t opgen_parse_modes(const char *list, int line)
+{
+	uint16_t modes = 0;
+	char buffer[OPGEN_MAX_TEXT];
+	strncpy(buffer, list, sizeof(buffer) - 1);
+	buffer[sizeof(buffer) - 1] = '\0';
+
+	for (char *name = strtok(buffer, ","); name; name = strtok(NULL, ",")) {
+		size_t i;
+		for (i = 0; i < sizeof(opgen_ea_names) / sizeof(*opgen_ea_names); ++i) {
+			if (strcmp(opgen_ea_names[i].name, name) == 0) {
+				modes |= opgen_ea_names[i].modes;
+				break;
+			}
+		}
+		if (i == sizeof(opgen_ea_names) / sizeof(*opgen_ea_names)) {
+			opgen_error(line, "unknown addressing mode '%s'", name);
+		}
+	}
+	return modes;
+}
+
+static void opgen_parse_pattern(struct opgen_form *form, const char *pattern)
+{
+	int bit = 15;
+	for (const char *c = pattern; *c; ++c) {
+		if (*c == '_') {
+			continue;
+		}
+		if (bit < 0) {
+			opgen_error(form->line, "pattern '%s' is longer than 16 bits", pattern);
+		}
+
+		if (*c == '0' || *c == '1') {
+			form->mask |= 1 << bit;
+			form->match |= (*c - '0') << bit;
+		} else if (*c == 'e') {
+			if (bit > 5) {
+				opgen_error(form->line, "'e' must occupy bits 5-0");
+			}
+			form->has_ea = 1;
+		} else if (*c == 'E') {
+			if (bit < 6 || bit > 11) {
+				opgen_error(form->line, "'E' must occupy bits 11-6");
+			}
+			form->has_dest_ea = 1;
+		} else if (islower((unsigned char)*c)) {
+			form->fields[*c - 'a'] |= 1 << bit;
+		} else {
+			opgen_error(form->line, "unexpected '%c' in pattern", *c);
+		}
+		--bit;
+	}
+	if (bit != -1) {
+		opgen_error(form->line, "pattern '%s' is shorter than 16 bits", pattern);
+	}
+}
+
+static void opgen_parse_line(char *line, int number)
+{
+	char *cursor = line;
+	char *tokens[16];
+	int count = 0;
+
+	/* Split on whitespace, keeping quoted values intact. */
+	while (*cursor && count < 16) {
+		while (isspace((unsigned char)*cursor)) ++cursor;
+		if (*cursor == '\0' || *cursor == '#') break;
+		tokens[count++] = cursor;
+		int quoted = 0;
+		while (*cursor && (quoted || !isspace((unsigned char)*cursor))) {
+			if (*cursor == '"') quoted = !quoted;
+			++cursor;
+		}
+		if (*cursor) *cursor++ = '\0';
+	}
+
+	if (count == 0) {
+		return;
+	}
+	if (strcmp(tokens[0], "@include") == 0) {
+		if (count != 2 || opgen_include_count == OPGEN_MAX_INCLUDES) {
+			opgen_error(number, "expected a single header to include");
+		}
+		opgen_includes[opgen_include_count++] = strdup(tokens[1]);
+		return;
+	}
+	if (count < 2) {
+		opgen_error(number, "expected a name and a pattern");
+	}
+	if (opgen_form_count == OPGEN_MAX_FORMS - 1) {
+		opgen_error(number, "too many forms");
+	}
+
+	/* Form 0 is reserved for "no form". */
+	struct opgen_form *form = &opgen_forms[++opgen_form_count];
+	form->line = number;
+	form->model = 68000;
+	form->last = 68040;
+	form->ea_modes = EA_ALL;
+	form->dest_ea_modes = EA_ALL;
+	snprintf(form->name, sizeof(form->name), "%s", tokens[0]);
+	snprintf(form->handler, sizeof(form->handler), "%s", tokens[0]);
+	opgen_parse_pattern(form, tokens[1]);
+
+	for (int i = 2; i < count; ++i) {
+		char *value = strchr(tokens[i], '=');
+		if (value == NULL) {
+			opgen_error(number, "expected key=value, found '%s'", tokens[i]);
+		}
+		*value++ = '\0';
+
+		if (strcmp(tokens[i], "handler") == 0) {
+			snprintf(form->handler, sizeof(form->handler), "%s", value);
+		} else if (strcmp(tokens[i], "model") == 0) {
+			form->model = (unsigned)strtoul(value, NULL, 10);
+		} else if (strcmp(tokens[i], "last") == 0) {
+			form->last = (unsigned)strtoul(value, NULL, 10);
+		} else if (strcmp(tokens[i], "cycles") == 0) {
+			form->cycles = (unsigned)strtoul(value, NULL, 10);
+		} else if (strcmp(tokens[i], "ea") == 0) {
+			form->ea_modes = opgen_parse_modes(value, number);
+		} else if (strcmp(tokens[i], "EA") == 0) {
+			form->dest_ea_modes = opgen_parse_modes(value, number);
+		} else if (strcmp(tokens[i], "specialise") == 0) {
+			int n = 0;
+			for (char *field = strtok(value, ","); field; field = strtok(NULL, ",")) {
+				if (strcmp(field, "model") == 0) {
+					form->by_model = 1;
+					continue;
+				}
+				if (strlen(field) != 1 || n == OPGEN_MAX_SPECIALISE) {
+					opgen_error(number, "cannot specialise on '%s'", field);
+				}
+				form->specialise[n++] = field[0];
+			}
+		} else if (strcmp(tokens[i], "text") == 0) {
+			size_t length = strlen(value);
+			if (length < 2 || value[0] != '"' || value[length - 1] != '"') {
+				opgen_error(number, "text must be quoted");
+			}
+			value[length - 1] = '\0';
+			snprintf(form->text, sizeof(form->text), "%s", value + 1);
+		} else {
+			opgen_error(number, "unknown key '%s'", tokens[i]);
+		}
+	}
+
+	if (form->text[0] == '\0') {
+		opgen_error(number, "form '%s' has no text", form->name);
+	}
+	if (form->last < form->model) {
+		opgen_error(number, "form '%s' is not available on any model", form->name);
+	}
+	if (form->by_model && form->specialise[0]) {
+		opgen_error(number, "cannot specialise on both the model and fields");
+	}
+	for (const char *f = form->specialise; *f; ++f) {
+		int valid = (*f == 'e') ? form->has_ea : (*f == 'E') ? form->has_dest_ea
+			: islower((unsigned char)*f) && form->fields[*f - 'a'];
+		if (!valid) {
+			opgen_error(number, "cannot specialise on unknown field '%c'", *f);
+		}
+	}
+}
+
+// MARK: - Expansion
+
+static unsigned opgen_field_value(uint16_t field_mask, uint16_t opcode)
+{
+	unsigned value = 0;
+	for (int bit = 15; bit >= 0; --bit) {
+		if (field_mask & (1 << bit)) {
+			value = (value << 1) | ((opcode >> bit) & 1);
+		}
+	}
+	return value;
+}
+
+static int opgen_opcode_valid(const struct opgen_form *form, uint16_t opcode)
+{
+	if (form->has_ea) {
+		int mode = opgen_ea_mode((opcode >> 3) & 7, opcode & 7);
+		if (mode < 0 || !(form->ea_modes & EA_BIT(mode))) {
+			return 0;
+		}
+	}
+	if (form->has_dest_ea) {
+		int mode = opgen_ea_mode((opcode >> 6) & 7, (opcode >> 9) & 7);
+		if (mode < 0 || !(form->dest_ea_modes & EA_BIT(mode))) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+static void opgen_expand_ea(char **out, unsigned mode, unsigned reg, char kind, char size)
+{
+	switch (opgen_ea_mode(mode, reg)) {
+		case EA_DN: *out += sprintf(*out, "D%u", reg); break;
+		case EA_AN: *out += sprintf(*out, "A%u", reg); break;
+		case EA_IND: *out += sprintf(*out, "(A%u)", reg); break;
+		case EA_POST: *out += sprintf(*out, "(A%u)+", reg); break;
+		case EA_PRE: *out += sprintf(*out, "-(A%u)", reg); break;
+		default: *out += sprintf(*out, "%%%c%c", kind, size); break;
+	}
+}
+
+static void opgen_expand_text(const struct opgen_form *form, uint16_t opcode, char *out)
+{
+	for (const char *c = form->text; *c; ++c) {
+		if (*c != '{') {
+			*out++ = *c;
+			continue;
+		}
+
+		char field = c[1];
+		if (field == 'e' || field == 'E') {
+			char size = (c[2] == ':') ? c[3] : 'l';
+			if (field == 'e') {
+				opgen_expand_ea(&out, (opcode >> 3) & 7, opcode & 7, 'e', size);
+			} else {
+				opgen_expand_ea(&out, (opcode >> 6) & 7, (opcode >> 9) & 7, 'E', size);
+			}
+		} else if (islower((unsigned char)field) && form->fields[field - 'a']) {
+			uint16_t mask = form->fields[field - 'a'];
+			unsigned value = opgen_field_value(mask, opcode);
+			if (c[2] == ':' && c[3] == 'x') {
+				int digits = (__builtin_popcount(mask) + 3) / 4;
+				out += sprintf(out, "%0*X", digits, value);
+			} else {
+				out += sprintf(out, "%u", value);
+			}
+		} else {
+			opgen_error(form->line, "unknown field '%c' in text", field);
+		}
+
+		c = strchr(c, '}');
+		if (c == NULL) {
+			opgen_error(form->line, "unterminated field in text");
+		}
+	}
+	*out = '\0';
+}
+
+/* Write the name of the specialised variant of a handler for an opcode. Each
+ * specialised field contributes its letter and value, so that opcodes which
+ * only differ in unspecialised fields share a variant. */
+static void opgen_variant_name(const struct opgen_form *form, uint16_t opcode, char *out)
+{
+	out += sprintf(out, "%s", form->handler);
+	for (const char *f = form->specialise; *f; ++f) {
+		if (*f == 'e') {
+			out += sprintf(out, "_e%u%u", (opcode >> 3) & 7, opcode & 7);
+		} else if (*f == 'E') {
+			out += sprintf(out, "_E%u%u", (opcode >> 6) & 7, (opcode >> 9) & 7);
+		} else {
+			out += sprintf(out, "_%c%u", *f, opgen_field_value(form->fields[*f - 'a'], opcode));
+		}
+	}
+}
+
+/* Write the arguments passed to a handler body for an opcode. Effective
+ * address fields are passed as a mode and a register. */
+static void opgen_variant_arguments(const struct opgen_form *form, uint16_t opcode, char *out)
+{
+	const char *separator = "";
+	for (const char *f = form->specialise; *f; ++f) {
+		if (*f == 'e') {
+			out += sprintf(out, "%s%u, %u", separator, (opcode >> 3) & 7, opcode & 7);
+		} else if (*f == 'E') {
+			out += sprintf(out, "%s%u, %u", separator, (opcode >> 6) & 7, (opcode >> 9) & 7);
+		} else {
+			out += sprintf(out, "%s%u", separator, opgen_field_value(form->fields[*f - 'a'], opcode));
+		}
+		separator = ", ";
+	}
+	*out = '\0';
+}
+
+/* Record that a variant has been emitted. Returns 0 if it already had been. */
+static int opgen_variant_insert(const char *name)
+{
+	static char *variants[OPGEN_OPCODES * 2];
+	uint32_t hash = 2166136261u;
+	for (const char *c = name; *c; ++c) {
+		hash = (hash ^ (uint8_t)*c) * 16777619u;
+	}
+
+	for (uint32_t slot = hash % (OPGEN_OPCODES * 2);; slot = (slot + 1) % (OPGEN_OPCODES * 2)) {
+		if (variants[slot] == NULL) {
+			variants[slot] = strdup(name);
+			return 1;
+		}
+		if (strcmp(variants[slot], name) == 0) {
+			return 0;
+		}
+	}
+}
+
+static void opgen_assign_opcodes(void)
+{
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		struct opgen_form *form = &opgen_forms[i];
+		for (uint32_t opcode = 0; opcode < OPGEN_OPCODES; ++opcode) {
+			if ((opcode & form->mask) != form->match || !opgen_opcode_valid(form, (uint16_t)opcode)) {
+				continue;
+			}
+			if (opgen_opcode_form[opcode]) {
+				opgen_error(form->line, "opcode $%04X is already defined by '%s' (line %d)",
+					opcode, opgen_forms[opgen_opcode_form[opcode]].name, opgen_forms[opgen_opcode_form[opcode]].line);
+			}
+			opgen_opcode_form[opcode] = (uint16_t)i;
+		}
+	}
+}
+
+// MARK: - Output
+
+static void opgen_upper(char *dst, const char *src)
+{
+	while (*src) {
+		*dst++ = (char)toupper((unsigned char)*src++);
+	}
+	*dst = '\0';
+}
+
+static void opgen_write_header_comment(FILE *out)
+{
+	fprintf(out, "/* Generated by tools/opgen from %s. Do not edit. */\n\n", opgen_spec_path);
+}
+
+/* Emit a decoder macro for a field, built up from each contiguous run of bits
+ * in the opcode. */
+static void opgen_write_decoder(FILE *out, const char *form, const char *field, uint16_t mask)
+{
+	fprintf(out, "#define M68_%s_%s(_OP)\t(0", form, field);
+	int shift = 0;
+	for (int bit = 0; bit < 16;) {
+		if (!(mask & (1 << bit))) {
+			++bit;
+			continue;
+		}
+		int length = 0;
+		while (bit + length < 16 && (mask & (1 << (bit + length)))) {
+			++length;
+		}
+		fprintf(out, " | ((((_OP) >> %d) & 0x%X) << %d)", bit, (1 << length) - 1, shift);
+		shift += length;
+		bit += length;
+	}
+	fprintf(out, ")\n");
+}
+
+static void opgen_write_forms_header(FILE *out)
+{
+	char upper[OPGEN_MAX_NAME];
+
+	opgen_write_header_comment(out);
+	fprintf(out, "#include <stdint.h>\n\n");
+	fprintf(out, "#if !defined(lib68_InstructionForms)\n#define lib68_InstructionForms\n\n");
+
+	fprintf(out, "enum m68_instruction_form_id {\n\tM68_FORM_NONE = 0,\n");
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		opgen_upper(upper, opgen_forms[i].name);
+		fprintf(out, "\tM68_FORM_%s = %d,\n", upper, i);
+	}
+	fprintf(out, "\tM68_INSTRUCTION_FORM_COUNT = %d\n};\n\n", opgen_form_count + 1);
+
+	fprintf(out, "/* Operand Decoders */\n");
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		struct opgen_form *form = &opgen_forms[i];
+		opgen_upper(upper, form->name);
+		for (int f = 0; f < 26; ++f) {
+			if (form->fields[f]) {
+				char field[2] = { (char)('A' + f), '\0' };
+				opgen_write_decoder(out, upper, field, form->fields[f]);
+			}
+		}
+		if (form->has_ea) {
+			opgen_write_decoder(out, upper, "EA_MODE", 0x0038);
+			opgen_write_decoder(out, upper, "EA_REG", 0x0007);
+		}
+		if (form->has_dest_ea) {
+			opgen_write_decoder(out, upper, "DEST_EA_MODE", 0x01C0);
+			opgen_write_decoder(out, upper, "DEST_EA_REG", 0x0E00);
+		}
+	}
+
+	fprintf(out, "\n/* Handlers */\n");
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		int seen = opgen_forms[i].by_model;
+		for (int j = 1; j < i && !seen; ++j) {
+			seen = strcmp(opgen_forms[i].handler, opgen_forms[j].handler) == 0;
+		}
+		if (!seen) {
+			fprintf(out, "void %s(void);\n", opgen_forms[i].handler);
+		}
+	}
+
+	fprintf(out, "\n#endif\n");
+}
+
+/* Write the dispatch table for a model, holding only the forms it has. */
+static void opgen_write_model_table(FILE *out, unsigned model)
+{
+	char text[OPGEN_MAX_TEXT * 2];
+	char name[OPGEN_MAX_TEXT];
+
+	fprintf(out, "\nstruct m68_instruction m68_instruction_table_%u[M68_MAX_AVAILABLE_INSTRUCTIONS] = {\n", model);
+	int previous = 0;
+	for (uint32_t opcode = 0; opcode < OPGEN_OPCODES; ++opcode) {
+		int index = opgen_opcode_form[opcode];
+		struct opgen_form *form = &opgen_forms[index];
+		if (index == 0 || model < form->model || model > form->last) {
+			continue;
+		}
+		if (index != previous) {
+			fprintf(out, "\n\t/* %s */\n", form->name);
+			previous = index;
+		}
+		opgen_expand_text(form, (uint16_t)opcode, text);
+		if (form->by_model) {
+			fprintf(out, "\t[0x%04X] = { \"%s\", %s_%u, %u },\n", opcode, text, form->handler, model, form->cycles);
+		} else if (form->specialise[0]) {
+			opgen_variant_name(form, (uint16_t)opcode, name);
+			fprintf(out, "\t[0x%04X] = { \"%s\", M68_HANDLER(%s, %s), %u },\n",
+				opcode, text, form->handler, name, form->cycles);
+		} else {
+			fprintf(out, "\t[0x%04X] = { \"%s\", %s, %u },\n", opcode, text, form->handler, form->cycles);
+		}
+	}
+	fprintf(out, "};\n");
+}
+
+static void opgen_write_table(FILE *out)
+{
+	char text[OPGEN_MAX_TEXT * 2];
+	char upper[OPGEN_MAX_NAME];
+
+	char name[OPGEN_MAX_TEXT];
+
+	opgen_write_header_comment(out);
+	fprintf(out, "#include <stddef.h>\n");
+	fprintf(out, "#include \"cpu/instruction.h\"\n");
+	fprintf(out, "#include \"cpu/instruction_forms.h\"\n");
+	for (int i = 0; i < opgen_include_count; ++i) {
+		fprintf(out, "#include \"%s\"\n", opgen_includes[i]);
+	}
+	fprintf(out, "\n");
+
+	/* Specialised variants of handlers, one per distinct combination of the
+	 * specialised fields. */
+	fprintf(out, "#if defined(M68_SPECIALISED_HANDLERS)\n");
+	for (uint32_t opcode = 0; opcode < OPGEN_OPCODES; ++opcode) {
+		struct opgen_form *form = &opgen_forms[opgen_opcode_form[opcode]];
+		if (opgen_opcode_form[opcode] == 0 || form->specialise[0] == '\0') {
+			continue;
+		}
+		opgen_variant_name(form, (uint16_t)opcode, name);
+		if (!opgen_variant_insert(name)) {
+			continue;
+		}
+		opgen_variant_arguments(form, (uint16_t)opcode, text);
+		fprintf(out, "static void %s(void) { %s_body(%s); }\n", name, form->handler, text);
+	}
+	fprintf(out, "#endif\n\n");
+
+	/* Variants of handlers that are specialised on the model, one for each
+	 * model that has the form. These are always generated. */
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		struct opgen_form *form = &opgen_forms[i];
+		for (size_t m = 0; form->by_model && m < OPGEN_MODEL_COUNT; ++m) {
+			unsigned model = opgen_models[m];
+			snprintf(name, sizeof(name), "%s_%u", form->handler, model);
+			if (model < form->model || model > form->last || !opgen_variant_insert(name)) {
+				continue;
+			}
+			fprintf(out, "static void %s(void) { %s_body(%u); }\n", name, form->handler, model);
+		}
+	}
+	fprintf(out, "\n");
+
+	fprintf(out, "const struct m68_instruction_form m68_instruction_forms[M68_INSTRUCTION_FORM_COUNT] = {\n");
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		struct opgen_form *form = &opgen_forms[i];
+		opgen_upper(upper, form->name);
+		fprintf(out, "\t[M68_FORM_%s] = { \"%s\", 0x%04X, 0x%04X, %u, %u, %d },\n",
+			upper, form->name, form->mask, form->match, form->model, form->last,
+			form->specialise[0] != '\0' || form->by_model);
+	}
+	fprintf(out, "};\n\n");
+
+	fprintf(out, "const uint16_t m68_instruction_form_index[M68_MAX_AVAILABLE_INSTRUCTIONS] = {\n");
+	for (uint32_t opcode = 0; opcode < OPGEN_OPCODES; ++opcode) {
+		if (opgen_opcode_form[opcode]) {
+			opgen_upper(upper, opgen_forms[opgen_opcode_form[opcode]].name);
+			fprintf(out, "\t[0x%04X] = M68_FORM_%s,\n", opcode, upper);
+		}
+	}
+	fprintf(out, "};\n\n");
+
+	for (size_t m = 0; m < OPGEN_MODEL_COUNT; ++m) {
+		opgen_write_model_table(out, opgen_models[m]);
+	}
+}
+
+/* Write a macro for each form with a handler body, that runs the body for an
+ * opcode and model, so that translated code (tools/aot) can call it with the
+ * operands as constants. */
+static void opgen_write_bodies_header(FILE *out)
+{
+	char upper[OPGEN_MAX_NAME];
+
+	opgen_write_header_comment(out);
+	fprintf(out, "#if !defined(lib68_InstructionBodies)\n#define lib68_InstructionBodies\n\n");
+	fprintf(out, "#include \"cpu/instruction.h\"\n");
+	fprintf(out, "#include \"cpu/instruction_forms.h\"\n");
+	for (int i = 0; i < opgen_include_count; ++i) {
+		fprintf(out, "#include \"%s\"\n", opgen_includes[i]);
+	}
+
+	fprintf(out, "\n/* Handler Bodies */\n");
+	for (int i = 1; i <= opgen_form_count; ++i) {
+		struct opgen_form *form = &opgen_forms[i];
+		opgen_upper(upper, form->name);
+		if (form->by_model) {
+			fprintf(out, "#define M68_%s_BODY(_OP, _MODEL)\t%s_body(_MODEL)\n", upper, form->handler);
+			continue;
+		}
+		if (form->specialise[0] == '\0') {
+			continue;
+		}
+
+		fprintf(out, "#define M68_%s_BODY(_OP, _MODEL)\t%s_body(", upper, form->handler);
+		const char *separator = "";
+		for (const char *f = form->specialise; *f; ++f) {
+			if (*f == 'e') {
+				fprintf(out, "%sM68_%s_EA_MODE(_OP), M68_%s_EA_REG(_OP)", separator, upper, upper);
+			} else if (*f == 'E') {
+				fprintf(out, "%sM68_%s_DEST_EA_MODE(_OP), M68_%s_DEST_EA_REG(_OP)", separator, upper, upper);
+			} else {
+				fprintf(out, "%sM68_%s_%c(_OP)", separator, upper, toupper((unsigned char)*f));
+			}
+			separator = ", ";
+		}
+		fprintf(out, ")\n");
+	}
+
+	fprintf(out, "\n#endif\n");
+}
+
+// MARK: - Main
+
+int main(int argc, char const *argv[])
+{
+	if (argc != 5) {
+		fprintf(stderr, "usage: %s <spec> <table.c> <forms.h> <bodies.h>\n", argv[0]);
+		return 1;
+	}
+	opgen_spec_path = argv[1];
+
+	FILE *spec = fopen(argv[1], "r");
+	if (spec == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	char line[1024];
+	int number = 0;
+	while (fgets(line, sizeof(line), spec)) {
+		opgen_parse_line(line, ++number);
+	}
+	fclose(spec);
+
+	opgen_assign_opcodes();
+
+	FILE *table = fopen(argv[2], "w");
+	FILE *forms = fopen(argv[3], "w");
+	FILE *bodies = fopen(argv[4], "w");
+	if (table == NULL || forms == NULL || bodies == NULL) {
+		perror("opgen");
+		return 1;
+	}
+	opgen_write_table(table);
+	opgen_write_forms_header(forms);
+	opgen_write_bodies_header(bodies);
+	fclose(table);
+	fclose(forms);
+	fclose(bodies);
+
+	return 0;
+}